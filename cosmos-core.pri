@@ -157,6 +157,12 @@ INCLUDEPATH += $$COSMOS_SOURCE_CORE/libraries/thirdparty/jpeg
         HEADERS += $$COSMOS_SOURCE_CORE/libraries/support/demlib.h
     }
 
+    contains(MODULES, contactlib){
+        message( "- support/contactlib" )
+        SOURCES += $$COSMOS_SOURCE_CORE/libraries/support/contactlib.cpp
+        HEADERS += $$COSMOS_SOURCE_CORE/libraries/support/contactlib.h
+    }
+
     contains(MODULES, cosmoserrno){
         message( "- support/cosmos-errno" )
         SOURCES += $$COSMOS_SOURCE_CORE/libraries/support/cosmos-errno.cpp
@@ -187,6 +193,8 @@ INCLUDEPATH += $$COSMOS_SOURCE_CORE/libraries/thirdparty/jpeg
         MODULES += math-matrix
         MODULES += math-rotation
         MODULES += math-quaternion
+        MODULES += math-quaternionbatch
+        MODULES += math-checksum
     }
 
     contains(MODULES, math-lsfit){
@@ -220,6 +228,13 @@ INCLUDEPATH += $$COSMOS_SOURCE_CORE/libraries/thirdparty/jpeg
         SOURCES += $$COSMOS_SOURCE_CORE/libraries/math/quaternion.cpp
     }
 
+    contains(MODULES, math-quaternionbatch){
+        message( "- math/quaternionbatch" )
+        HEADERS += $$COSMOS_SOURCE_CORE/libraries/math/quaternionbatch.h
+        SOURCES += $$COSMOS_SOURCE_CORE/libraries/math/quaternionbatch.cpp
+        MODULES += math-quaternion
+    }
+
     # -----------------------------------------------
     # Tier 0 libraries for physics
     message( "" )
@@ -257,6 +272,14 @@ INCLUDEPATH += $$COSMOS_SOURCE_CORE/libraries/thirdparty/jpeg
         message( "- support/sliplib" )
         SOURCES += $$COSMOS_SOURCE_CORE/libraries/support/sliplib.cpp
         HEADERS += $$COSMOS_SOURCE_CORE/libraries/support/sliplib.h
+        MODULES += math-checksum
+    }
+
+    # After mathlib and sliplib, which both use it
+    contains(MODULES, math-checksum){
+        message( "- math/checksum" )
+        HEADERS += $$COSMOS_SOURCE_CORE/libraries/math/checksum.h
+        SOURCES += $$COSMOS_SOURCE_CORE/libraries/math/checksum.cpp
     }
 
     contains(MODULES, timeutils){
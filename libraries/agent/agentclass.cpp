@@ -39,6 +39,11 @@
 #include <net/if_dl.h>
 #include <ifaddrs.h>
 #endif
+#if defined (COSMOS_LINUX_OS)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
 
 // Used to mark unused variables as known
 #ifndef UNUSED_VARIABLE_LOCALDEF
@@ -72,7 +77,9 @@ namespace Cosmos {
     //! the Agent already running.
     //! \param portnum The network port to listen on for requests. Defaults to 0 whereupon it will use whatever th OS assigns.
     //! \param dlevel debug level. Defaults to 1 so that if there is an error the user can immediately see it.
-    Agent::Agent(const string &nname, const string &aname, double bprd, uint32_t bsize, bool mflag, int32_t portnum, NetworkType ntype, size_t dlevel)
+    //! \param reactor Boolean controlling whether the message, request and heartbeat threads are replaced by a single
+    //! reactor thread, sleeping in epoll until there is something to do. Defaults to false. Ignored where epoll is not available.
+    Agent::Agent(const string &nname, const string &aname, double bprd, uint32_t bsize, bool mflag, int32_t portnum, NetworkType ntype, size_t dlevel, bool reactor)
     {
         int32_t iretn;
 
@@ -130,8 +137,24 @@ namespace Cosmos {
             return;
         }
 
-        // Start message listening thread
-        mthread = thread([=] { message_loop(); });
+        // Start message listening thread, or have the reactor listen
+#if defined (COSMOS_LINUX_OS)
+        reactor_mode = reactor;
+#endif
+        if (reactor_mode)
+        {
+            message_ring.resize(MESSAGE_RING_SIZE);
+            if ((iretn = reactor_add(cinfo->pdata.agent[0].sub.cudp, [=] { reactor_messages(); }, false)) < 0)
+            {
+                error_value = iretn;
+                Agent::shutdown();
+                return;
+            }
+        }
+        else
+        {
+            mthread = thread([=] { message_loop(); });
+        }
 
         // Return if all we are doing is setting up client.
         if (aname.length() == 0)
@@ -214,9 +237,21 @@ namespace Cosmos {
 
         // Start the heartbeat and request threads running
         //    iretn = start();
-        hthread = thread([=] { heartbeat_loop(); });
-        cthread = thread([=] { request_loop(); });
-        if (!hthread.joinable() || !cthread.joinable())
+        if (reactor_mode)
+        {
+            if ((iretn = reactor_serve()) < 0)
+            {
+                error_value = iretn;
+                Agent::shutdown();
+                return;
+            }
+        }
+        else
+        {
+            hthread = thread([=] { heartbeat_loop(); });
+            cthread = thread([=] { request_loop(); });
+        }
+        if (!reactor_mode && (!hthread.joinable() || !cthread.joinable()))
         {
             // TODO: create error value
             //error_value = iretn;
@@ -333,6 +368,10 @@ namespace Cosmos {
 */
     int32_t Agent::start()
     {
+        if (reactor_mode)
+        {
+            return reactor_serve();
+        }
 
         // start heartbeat thread
         hthread = thread([=] { heartbeat_loop(); });
@@ -356,6 +395,11 @@ namespace Cosmos {
         {
             cinfo->pdata.agent[0].stateflag = static_cast <uint16_t>(Agent::State::SHUTDOWN);
         }
+        reactor_stop();
+        if (reactor_mode && cinfo != nullptr && cinfo->pdata.agent[0].req.cudp >= 0 && cinfo->pdata.agent[0].req.cport)
+        {
+            socket_close(&cinfo->pdata.agent[0].req);
+        }
         if (agentName.size())
         {
             if (hthread.joinable())
@@ -723,50 +767,59 @@ namespace Cosmos {
 
         while (cinfo->pdata.agent[0].stateflag)
         {
+            heartbeat_beat(timer_beat);
 
-            // compute the jitter
-            cinfo->pdata.agent[0].beat.jitter = timer_beat.split() - cinfo->pdata.agent[0].beat.bprd;
-            timer_beat.start();
-
-            // post comes first
-            cinfo->pdata.agent[0].beat.utc = currentmjd(0.);
-            if ((Agent::State)(cinfo->pdata.agent[0].stateflag) != Agent::State::IDLE && !cinfo->pdata.agent[0].sohtable.empty())
-            {
-                Agent::post(AGENT_MESSAGE_BEAT, json_of_table(hbjstring, cinfo->pdata.agent[0].sohtable, ((cosmosstruc *)cinfo)->meta, ((cosmosstruc *)cinfo)->pdata));
-            }
-            else
+            if (timer_beat.split() <= cinfo->pdata.agent[0].beat.bprd)
             {
-                Agent::post(AGENT_MESSAGE_BEAT,"");
+                COSMOS_SLEEP(cinfo->pdata.agent[0].beat.bprd - timer_beat.split());
             }
+        }
+        Agent::unpublish();
+    }
 
-            // TODO: move the monitoring calculations to another thread with its own loop time that can be controlled
-            // Compute other monitored quantities if monitoring
-            if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::MONITOR))
-            {
-                // TODO: rename beat.cpu to beat.cpu_percent
-                // add beat.cpu_load
-                cinfo->pdata.agent[0].beat.cpu    = deviceCpu_.getPercentUseForCurrentProcess();//cpu.getLoad();
-                cinfo->pdata.agent[0].beat.memory = deviceCpu_.getVirtualMemoryUsed();
-            }
+    //! Send one Heartbeat
+    /*! Post the Heartbeat, update the jitter and any monitored quantities, and make sure the period
+ * is no shorter than ::AGENT_HEARTBEAT_PERIOD_MIN. Shared by ::Agent::heartbeat_loop and the reactor.
+ * \param timer_beat Timer started at the previous Heartbeat.
+ */
+    void Agent::heartbeat_beat(ElapsedTime &timer_beat)
+    {
+        // compute the jitter
+        cinfo->pdata.agent[0].beat.jitter = timer_beat.split() - cinfo->pdata.agent[0].beat.bprd;
+        timer_beat.start();
 
-            if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::SHUTDOWN))
-            {
-                cinfo->pdata.agent[0].beat.cpu = 0;
-                cinfo->pdata.agent[0].beat.memory = 0;
-            }
+        // post comes first
+        cinfo->pdata.agent[0].beat.utc = currentmjd(0.);
+        if ((Agent::State)(cinfo->pdata.agent[0].stateflag) != Agent::State::IDLE && !cinfo->pdata.agent[0].sohtable.empty())
+        {
+            Agent::post(AGENT_MESSAGE_BEAT, json_of_table(hbjstring, cinfo->pdata.agent[0].sohtable, ((cosmosstruc *)cinfo)->meta, ((cosmosstruc *)cinfo)->pdata));
+        }
+        else
+        {
+            Agent::post(AGENT_MESSAGE_BEAT,"");
+        }
 
+        // TODO: move the monitoring calculations to another thread with its own loop time that can be controlled
+        // Compute other monitored quantities if monitoring
+        if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::MONITOR))
+        {
+            // TODO: rename beat.cpu to beat.cpu_percent
+            // add beat.cpu_load
+            cinfo->pdata.agent[0].beat.cpu    = deviceCpu_.getPercentUseForCurrentProcess();//cpu.getLoad();
+            cinfo->pdata.agent[0].beat.memory = deviceCpu_.getVirtualMemoryUsed();
+        }
 
-            if (cinfo->pdata.agent[0].beat.bprd < AGENT_HEARTBEAT_PERIOD_MIN)
-            {
-                cinfo->pdata.agent[0].beat.bprd = AGENT_HEARTBEAT_PERIOD_MIN;
-            }
+        if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::SHUTDOWN))
+        {
+            cinfo->pdata.agent[0].beat.cpu = 0;
+            cinfo->pdata.agent[0].beat.memory = 0;
+        }
 
-            if (timer_beat.split() <= cinfo->pdata.agent[0].beat.bprd)
-            {
-                COSMOS_SLEEP(cinfo->pdata.agent[0].beat.bprd - timer_beat.split());
-            }
+
+        if (cinfo->pdata.agent[0].beat.bprd < AGENT_HEARTBEAT_PERIOD_MIN)
+        {
+            cinfo->pdata.agent[0].beat.bprd = AGENT_HEARTBEAT_PERIOD_MIN;
         }
-        Agent::unpublish();
     }
 
     //! Request Loop
@@ -776,96 +829,137 @@ namespace Cosmos {
  */
     void Agent::request_loop()
     {
-        char ebuffer[6]="[NOK]";
-        int32_t iretn, nbytes;
-        char *bufferin, *bufferout;
-        char request[AGENTMAXBUFFER+1];
-        uint32_t i;
+        int32_t iretn;
+        char *bufferin;
 
-        if ((iretn = socket_open(&cinfo->pdata.agent[0].req, NetworkType::UDP, (char *)"", cinfo->pdata.agent[0].beat.port, SOCKET_LISTEN, SOCKET_BLOCKING, 2000000)) < 0)
+        if ((iretn = request_open()) < 0)
         {
             return;
         }
 
-        cinfo->pdata.agent[0].beat.port = cinfo->pdata.agent[0].req.cport;
-
         if ((bufferin=(char *)calloc(1,cinfo->pdata.agent[0].beat.bsz)) == NULL)
         {
             iretn = -errno;
             return;
         }
 
+        // Requests that arrive together are taken with one system call, leaving room for the terminator
+        socket_batch batch;
+        if ((iretn = socket_batch_init(batch, SOCKET_BATCH_COUNT, cinfo->pdata.agent[0].beat.bsz - 1)) < 0)
+        {
+            free(bufferin);
+            return;
+        }
+
         while (cinfo->pdata.agent[0].stateflag)
         {
-            iretn = recvfrom(cinfo->pdata.agent[0].req.cudp,bufferin,cinfo->pdata.agent[0].beat.bsz,0,(struct sockaddr *)&cinfo->pdata.agent[0].req.caddr,(socklen_t *)&cinfo->pdata.agent[0].req.addrlen);
+            uint8_t *data;
+            iretn = socket_recvfrom(cinfo->pdata.agent[0].req, batch, data);
 
             if (iretn > 0)
             {
+                memcpy(bufferin, data, iretn);
                 bufferin[iretn] = 0;
+                process_request(bufferin, iretn);
+            }
+        }
+        free(bufferin);
+        return;
+    }
 
-                if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::DEBUG))
-                {
-                    printf("Request: [%d] %s ",iretn,bufferin);
-                }
+    //! Open Request channel
+    /*! Open the channel requests are received on, at the port in the Heartbeat, and update the
+ * Heartbeat with the port actually assigned.
+ * \return 0, or negative error.
+ */
+    int32_t Agent::request_open()
+    {
+        int32_t iretn;
 
-                fflush(stdout);
-                for (i=0; i<COSMOS_MAX_NAME; i++)
-                {
-                    if (bufferin[i] == ' ' || bufferin[i] == 0)
-                        break;
-                    request[i] = bufferin[i];
-                }
-                request[i] = 0;
+        if ((iretn = socket_open(&cinfo->pdata.agent[0].req, NetworkType::UDP, (char *)"", cinfo->pdata.agent[0].beat.port, SOCKET_LISTEN, SOCKET_BLOCKING, 2000000)) < 0)
+        {
+            return iretn;
+        }
 
-                for (i=0; i<Agent::reqs.size(); i++)
-                {
-                    if (!strcmp(request,Agent::reqs[i].token.c_str()))
-                        break;
-                }
+        cinfo->pdata.agent[0].beat.port = cinfo->pdata.agent[0].req.cport;
+        return 0;
+    }
 
-                if (i < Agent::reqs.size())
-                {
-                    iretn = -1;
-                    if (reqs[i].ifunction)
-                    {
-                        iretn = (this->*Agent::reqs[i].ifunction)(bufferin, request);
-                    }
-                    else
-                    {
-                        if (reqs[i].efunction != nullptr)
-                        {
-                            iretn = reqs[i].efunction(bufferin, request, this);
-                        }
-                    }
-                    if (iretn >= 0)
-                        bufferout = (char *)&request;
-                    else
-                        bufferout = nullptr;
-                }
-                else
-                {
-                    iretn = AGENT_ERROR_NULL;
-                    bufferout = nullptr;
-                }
+    //! Process Request
+    /*! Match the first word of a received request against the set of requests, perform the
+ * matched function, and send the response, or [NOK], back to where the request came from.
+ * \param bufferin Zero terminated text of request.
+ * \param nbytes Length of request.
+ * \return Bytes sent in response, or negative error.
+ */
+    int32_t Agent::process_request(char *bufferin, int32_t nbytes)
+    {
+        char ebuffer[6]="[NOK]";
+        int32_t iretn;
+        char *bufferout;
+        char request[AGENTMAXBUFFER+1];
+        uint32_t i;
 
-                if (bufferout == nullptr)
-                {
-                    bufferout = ebuffer;
-                }
-                else
-                {
-                    strcat(bufferout,"[OK]");
-                    bufferout[cinfo->pdata.agent[0].beat.bsz+3] = 0;
-                }
-                nbytes = sendto(cinfo->pdata.agent[0].req.cudp,bufferout,strlen(bufferout),0,(struct sockaddr *)&cinfo->pdata.agent[0].req.caddr,sizeof(struct sockaddr_in));
-                if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::DEBUG))
+        if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::DEBUG))
+        {
+            printf("Request: [%d] %s ",nbytes,bufferin);
+        }
+
+        fflush(stdout);
+        for (i=0; i<COSMOS_MAX_NAME; i++)
+        {
+            if (bufferin[i] == ' ' || bufferin[i] == 0)
+                break;
+            request[i] = bufferin[i];
+        }
+        request[i] = 0;
+
+        for (i=0; i<Agent::reqs.size(); i++)
+        {
+            if (!strcmp(request,Agent::reqs[i].token.c_str()))
+                break;
+        }
+
+        if (i < Agent::reqs.size())
+        {
+            iretn = -1;
+            if (reqs[i].ifunction)
+            {
+                iretn = (this->*Agent::reqs[i].ifunction)(bufferin, request);
+            }
+            else
+            {
+                if (reqs[i].efunction != nullptr)
                 {
-                    printf("[%d] %s\n",nbytes,bufferout);
+                    iretn = reqs[i].efunction(bufferin, request, this);
                 }
             }
+            if (iretn >= 0)
+                bufferout = (char *)&request;
+            else
+                bufferout = nullptr;
         }
-        free(bufferin);
-        return;
+        else
+        {
+            iretn = AGENT_ERROR_NULL;
+            bufferout = nullptr;
+        }
+
+        if (bufferout == nullptr)
+        {
+            bufferout = ebuffer;
+        }
+        else
+        {
+            strcat(bufferout,"[OK]");
+            bufferout[cinfo->pdata.agent[0].beat.bsz+3] = 0;
+        }
+        nbytes = sendto(cinfo->pdata.agent[0].req.cudp,bufferout,strlen(bufferout),0,(struct sockaddr *)&cinfo->pdata.agent[0].req.caddr,sizeof(struct sockaddr_in));
+        if (cinfo->pdata.agent[0].stateflag == static_cast <uint16_t>(Agent::State::DEBUG))
+        {
+            printf("[%d] %s\n",nbytes,bufferout);
+        }
+        return nbytes;
     }
 
     // TODO: describe function, what does it do?
@@ -882,34 +976,397 @@ namespace Cosmos {
             iretn = Agent::poll(mess, AGENT_MESSAGE_ALL, 5.);
             if (iretn > 0)
             {
-                bool found = false;
-                for (beatstruc &i : agent_list)
-                {
-                    if (!strcmp(i.node, mess.meta.beat.node) && !strcmp(i.proc, mess.meta.beat.proc))
-                    {
-                        i = mess.meta.beat;
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found)
+                process_message(mess);
+            }
+            COSMOS_SLEEP(.01);
+        }
+    }
+
+    //! Process Message
+    /*! Note the sending Agent in the list of active agents and place the message in the message ring.
+ * \param mess Message received on the subscription channel.
+ */
+    void Agent::process_message(messstruc &mess)
+    {
+        bool found = false;
+        for (beatstruc &i : agent_list)
+        {
+            if (!strcmp(i.node, mess.meta.beat.node) && !strcmp(i.proc, mess.meta.beat.proc))
+            {
+                i = mess.meta.beat;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            agent_list.push_back(mess.meta.beat);
+        }
+
+        size_t new_position;
+        new_position = message_head + 1;
+        if (new_position >= message_ring.size())
+        {
+            new_position = 0;
+        }
+        message_ring[new_position] = mess;
+        message_head = new_position;
+    }
+
+    //! Add file descriptor to reactor
+    /*! Have the reactor thread call a function whenever the file descriptor is ready for reading.
+ * The reactor is started if it is not already running, so this can be used whether or not the
+ * Agent itself was started in reactor mode. The function should read what is ready, and must not
+ * block.
+ * \param fd File descriptor to watch.
+ * \param handler Function to call with the file descriptor.
+ * \return Identifier for ::Agent::reactor_remove, or negative error.
+ */
+    int32_t Agent::reactor_add_fd(int fd, std::function<void(int)> handler)
+    {
+#if defined (COSMOS_LINUX_OS)
+        return reactor_add(fd, [=] { handler(fd); }, false);
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Add timer to reactor
+    /*! Have the reactor thread call a function every period seconds, in place of a thread of
+ * its own sleeping in between. Expirations missed while the reactor was busy result in a
+ * single call.
+ * \param period Seconds between calls.
+ * \param handler Function to call.
+ * \return Identifier for ::Agent::reactor_remove, or negative error.
+ */
+    int32_t Agent::reactor_add_timer(double period, std::function<void()> handler)
+    {
+        return reactor_timer(period, period, handler);
+    }
+
+    //! Remove from reactor
+    /*! Stop calling the function for a file descriptor or timer added to the reactor. A timer is
+ * also closed; a file descriptor is left open for its owner.
+ * \param id Identifier returned by ::Agent::reactor_add_fd or ::Agent::reactor_add_timer.
+ * \return 0, or negative error.
+ */
+    int32_t Agent::reactor_remove(int32_t id)
+    {
+#if defined (COSMOS_LINUX_OS)
+        std::lock_guard<std::mutex> locker(reactor_lock);
+        std::map<int, reactor_entry>::iterator it = reactor_handlers.find(id);
+        if (it == reactor_handlers.end())
+        {
+            return AGENT_ERROR_CHANNEL;
+        }
+        epoll_ctl(reactor_epoll, EPOLL_CTL_DEL, id, nullptr);
+        if (it->second.owned)
+        {
+            close(id);
+        }
+        reactor_handlers.erase(it);
+        return 0;
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Start reactor
+    /*! Create the epoll set, and the event used to wake it for shutdown, and start the reactor
+ * thread. Does nothing if already started.
+ * \return 0, or negative error.
+ */
+    int32_t Agent::reactor_start()
+    {
+#if defined (COSMOS_LINUX_OS)
+        if (reactor_epoll >= 0)
+        {
+            return 0;
+        }
+        if ((reactor_epoll = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        {
+            return -errno;
+        }
+        if ((reactor_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        {
+            int32_t iretn = -errno;
+            close(reactor_epoll);
+            reactor_epoll = -1;
+            return iretn;
+        }
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = reactor_wake;
+        epoll_ctl(reactor_epoll, EPOLL_CTL_ADD, reactor_wake, &event);
+        rthread = thread([=] { reactor_loop(); });
+        return 0;
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Stop reactor
+    /*! Wake the reactor thread, wait for it to finish, and close everything it was watching that
+ * belongs to it.
+ */
+    void Agent::reactor_stop()
+    {
+#if defined (COSMOS_LINUX_OS)
+        if (reactor_epoll < 0)
+        {
+            return;
+        }
+        uint64_t one = 1;
+        if (write(reactor_wake, &one, sizeof(one)) < 0)
+        {
+            // The thread will still see the state change on its next event
+        }
+        if (rthread.joinable())
+        {
+            rthread.join();
+        }
+        std::lock_guard<std::mutex> locker(reactor_lock);
+        for (std::pair<const int, reactor_entry> &entry : reactor_handlers)
+        {
+            if (entry.second.owned)
+            {
+                close(entry.first);
+            }
+        }
+        reactor_handlers.clear();
+        close(reactor_wake);
+        close(reactor_epoll);
+        reactor_wake = -1;
+        reactor_epoll = -1;
+#endif
+    }
+
+    //! Add to reactor
+    /*! Register a function to be called by the reactor thread when the file descriptor is ready
+ * for reading, starting the reactor if need be.
+ * \param fd File descriptor to watch.
+ * \param handler Function to call.
+ * \param owned Whether the file descriptor should be closed along with the reactor.
+ * \return File descriptor, or negative error.
+ */
+    int32_t Agent::reactor_add(int fd, std::function<void()> handler, bool owned)
+    {
+#if defined (COSMOS_LINUX_OS)
+        int32_t iretn;
+        std::lock_guard<std::mutex> locker(reactor_lock);
+        if (cinfo == nullptr)
+        {
+            return AGENT_ERROR_NULL;
+        }
+        if ((iretn = reactor_start()) < 0)
+        {
+            return iretn;
+        }
+        reactor_entry entry;
+        entry.handler = handler;
+        entry.owned = owned;
+        reactor_handlers[fd] = entry;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(reactor_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            iretn = -errno;
+            reactor_handlers.erase(fd);
+            return iretn;
+        }
+        return fd;
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Add timer to reactor, with first expiration
+    /*! As ::Agent::reactor_add_timer, but with the first call after a different delay to the rest.
+ * \param first Seconds until the first call.
+ * \param period Seconds between calls.
+ * \param handler Function to call.
+ * \return Identifier for ::Agent::reactor_remove, or negative error.
+ */
+    int32_t Agent::reactor_timer(double first, double period, std::function<void()> handler)
+    {
+#if defined (COSMOS_LINUX_OS)
+        int32_t iretn;
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0)
+        {
+            return -errno;
+        }
+        if ((iretn = reactor_arm(fd, first, period)) < 0)
+        {
+            close(fd);
+            return iretn;
+        }
+        iretn = reactor_add(fd, [=] {
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+            {
+                handler();
+            }
+        }, true);
+        if (iretn < 0)
+        {
+            close(fd);
+        }
+        return iretn;
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Set reactor timer
+    /*! \param fd Timer returned by ::Agent::reactor_timer.
+ * \param first Seconds until the next expiration. Zero or less expires as soon as possible.
+ * \param period Seconds between expirations after that.
+ * \return 0, or negative error.
+ */
+    int32_t Agent::reactor_arm(int fd, double first, double period)
+    {
+#if defined (COSMOS_LINUX_OS)
+        struct itimerspec spec;
+        // A zero first expiration would disarm the timer
+        if (first < 1e-9)
+        {
+            first = 1e-9;
+        }
+        spec.it_value.tv_sec = (time_t)first;
+        spec.it_value.tv_nsec = (long)(1e9 * (first - spec.it_value.tv_sec));
+        spec.it_interval.tv_sec = (time_t)period;
+        spec.it_interval.tv_nsec = (long)(1e9 * (period - spec.it_interval.tv_sec));
+        if (timerfd_settime(fd, 0, &spec, nullptr) < 0)
+        {
+            return -errno;
+        }
+        return 0;
+#else
+        return GENERAL_ERROR_UNIMPLEMENTED;
+#endif
+    }
+
+    //! Serve Agent from reactor
+    /*! Open the request channel and watch it from the reactor, and have the reactor send the
+ * Heartbeat, in place of ::Agent::request_loop and ::Agent::heartbeat_loop.
+ * \return 0, or negative error.
+ */
+    int32_t Agent::reactor_serve()
+    {
+        int32_t iretn;
+
+        if ((iretn = request_open()) < 0)
+        {
+            return iretn;
+        }
+        reactor_request.resize(cinfo->pdata.agent[0].beat.bsz);
+        if ((iretn = socket_batch_init(reactor_batch, SOCKET_BATCH_COUNT, cinfo->pdata.agent[0].beat.bsz - 1)) < 0)
+        {
+            return iretn;
+        }
+        if ((iretn = reactor_add(cinfo->pdata.agent[0].req.cudp, [=] { reactor_requests(); }, false)) < 0)
+        {
+            return iretn;
+        }
+
+        // First beat straight away, as for the thread
+        reactor_bprd = cinfo->pdata.agent[0].beat.bprd;
+        reactor_beat.start();
+        reactor_beat_timer = reactor_timer(0., reactor_bprd, [=] { reactor_heartbeat(); });
+        if (reactor_beat_timer < 0)
+        {
+            return reactor_beat_timer;
+        }
+        return 0;
+    }
+
+    //! Reactor Loop
+    /*! This function is run as the single thread of an Agent in reactor mode, in place of the
+ * heartbeat, request and message threads, and of any threads the Agent would otherwise run for
+ * its own file descriptors and timers. It sleeps in epoll until something is ready, then calls
+ * the function registered for it.
+ */
+    void Agent::reactor_loop()
+    {
+#if defined (COSMOS_LINUX_OS)
+        struct epoll_event events[AGENT_REACTOR_EVENTS];
+
+        while (cinfo->pdata.agent[0].stateflag)
+        {
+            int count = epoll_wait(reactor_epoll, events, AGENT_REACTOR_EVENTS, -1);
+            for (int i=0; i<count && cinfo->pdata.agent[0].stateflag; ++i)
+            {
+                if (events[i].data.fd == reactor_wake)
                 {
-                    agent_list.push_back(mess.meta.beat);
+                    continue;
                 }
-
-                size_t new_position;
-                new_position = message_head + 1;
-                if (new_position >= message_ring.size())
+                std::function<void()> handler;
                 {
-                    new_position = 0;
+                    std::lock_guard<std::mutex> locker(reactor_lock);
+                    std::map<int, reactor_entry>::iterator it = reactor_handlers.find(events[i].data.fd);
+                    if (it == reactor_handlers.end())
+                    {
+                        continue;
+                    }
+                    handler = it->second.handler;
                 }
-                message_ring[new_position] = mess;
-                message_head = new_position;
+                handler();
             }
-            COSMOS_SLEEP(.01);
+        }
+#endif
+    }
+
+    //! Reactor Heartbeat
+    /*! Send a Heartbeat, and follow any change in the period.
+ */
+    void Agent::reactor_heartbeat()
+    {
+        heartbeat_beat(reactor_beat);
+        if (cinfo->pdata.agent[0].beat.bprd != reactor_bprd)
+        {
+            reactor_bprd = cinfo->pdata.agent[0].beat.bprd;
+            reactor_arm(reactor_beat_timer, reactor_bprd, reactor_bprd);
+        }
+    }
+
+    //! Reactor Requests
+    /*! Process every request waiting on the request channel, without blocking.
+ */
+    void Agent::reactor_requests()
+    {
+        int32_t nbytes;
+        uint8_t *data;
+
+        while (cinfo->pdata.agent[0].stateflag && (nbytes = socket_recvfrom(cinfo->pdata.agent[0].req, reactor_batch, data, MSG_DONTWAIT)) > 0)
+        {
+            memcpy(reactor_request.data(), data, nbytes);
+            reactor_request[nbytes] = 0;
+            process_request(reactor_request.data(), nbytes);
         }
     }
 
+    //! Reactor Messages
+    /*! Take every message waiting on the subscription channel in to the message ring. The first
+ * read is known to be ready, and the rest come from what it brought in with it.
+ */
+    void Agent::reactor_messages()
+    {
+        messstruc mess;
+        bool pending;
+
+        do
+        {
+            if (Agent::poll(mess, AGENT_MESSAGE_ALL, 0.) > 0)
+            {
+                process_message(mess);
+            }
+            std::lock_guard<std::mutex> locker(sub_batch_lock);
+            pending = sub_batch.next < sub_batch.count;
+        } while (pending && cinfo->pdata.agent[0].stateflag);
+    }
+
     //! Built-in Forward request
     /*! Resends the received request, less count bytes, to all Publication channels of the Agent.
  * \param request Text of request.
@@ -1085,6 +1542,7 @@ namespace Cosmos {
 
     //! Built-in Set Internal Value request
     /*! Sets the current value of the requested Name Space values. Names and values are expressed as a JSON object.
+ * If the primary data is taken from a ::json_snapshot, the values are also queued to it.
  * \param request Text of request.
  * \param output Text of response to request.
  * \param agent Pointer to ::Agent to use.
@@ -1093,6 +1551,11 @@ namespace Cosmos {
     int32_t Agent::req_setvalue(char *request, char* output, Agent* agent)
     {
         int32_t iretn;
+        json_snapshot *snapshot = agent->snapshot;
+        if (snapshot != nullptr)
+        {
+            json_snapshot_set(*snapshot, request);
+        }
         iretn = json_parse(request,agent->cinfo->meta, agent->cinfo->pdata);
 
         sprintf(output,"%d",iretn);
@@ -1918,8 +2381,20 @@ namespace Cosmos {
             {
             case NetworkType::MULTICAST:
             case NetworkType::UDP:
-
-                nbytes = recvfrom(cinfo->pdata.agent[0].sub.cudp, (char *)input,AGENTMAXBUFFER, 0, (struct sockaddr *)&cinfo->pdata.agent[0].sub.caddr, (socklen_t *)&cinfo->pdata.agent[0].sub.addrlen);
+                {
+                    // Messages are taken from the channel a batch at a time, then handed out one per call
+                    std::lock_guard<std::mutex> locker(sub_batch_lock);
+                    if (sub_batch.lengths.empty())
+                    {
+                        socket_batch_init(sub_batch, SOCKET_BATCH_COUNT, AGENTMAXBUFFER);
+                    }
+                    uint8_t *data;
+                    nbytes = socket_recvfrom(cinfo->pdata.agent[0].sub, sub_batch, data);
+                    if (nbytes > 0)
+                    {
+                        memcpy(input, data, nbytes);
+                    }
+                }
 
                 // Return if port and address are our own
                 for (uint16_t i=0; i<cinfo->pdata.agent[0].ifcnt; ++i)
@@ -112,6 +112,11 @@
 //! Both Clients and Agents are formed using ::Agent. Once you have performed any initializations necessary, you should
 //! enter a continuous loop, protected by ::Agent::running, and preferably surrendering control periodically
 //! with ::COSMOS_SLEEP. Upon exiting from this loop, you should call ::Agent::shutdown.
+//!
+//! On Linux, an %Agent can instead be created in reactor mode, where one thread sleeps in epoll and serves the
+//! subscription channel, the request channel and the Heartbeat, in place of one thread each. Further file descriptors
+//! and periodic work can be handed to the same thread with ::Agent::reactor_add_fd and ::Agent::reactor_add_timer,
+//! in which case the main loop only needs to wait for ::Agent::running to go false.
 
 #include "support/configCosmos.h"
 #include "support/cosmos-errno.h"
@@ -123,6 +128,8 @@
 #include "support/jsonlib.h"
 #include "support/elapsedtime.h"
 #include "device/cpu/devicecpu.h"
+#include <functional>
+#include <atomic>
 
 using std::string;
 using std::vector;
@@ -132,7 +139,7 @@ class Agent
 {
 public:
 //    Agent(NetworkType ntype, const string &nname = "", const string &aname = "", double bprd = 1., uint32_t bsize = AGENTMAXBUFFER, bool mflag = false, int32_t portnum = 0);
-    Agent(const string &nname = "", const string &aname = "", double bprd = 1., uint32_t bsize = AGENTMAXBUFFER, bool mflag = false, int32_t portnum = 0, NetworkType ntype = NetworkType::UDP, size_t dlevel = 1);
+    Agent(const string &nname = "", const string &aname = "", double bprd = 1., uint32_t bsize = AGENTMAXBUFFER, bool mflag = false, int32_t portnum = 0, NetworkType ntype = NetworkType::UDP, size_t dlevel = 1, bool reactor = false);
     ~Agent();
 
     enum class State : uint16_t
@@ -184,6 +191,8 @@ public:
 #define AGENTMAXHEARTBEAT 200
     //! Default AGENT socket RCVTIMEO (100 msec)
 #define AGENTRCVTIMEO 100000
+    //! Most events taken from epoll at once by the reactor
+#define AGENT_REACTOR_EVENTS 32
     //! Default minium heartbeat period (10 msec)
 #define AGENT_HEARTBEAT_PERIOD_MIN 0.01
 
@@ -265,6 +274,9 @@ public:
     //    int32_t add_request(string token, request_function function, string description);
     int32_t add_request_internal(string token, internal_request_function function, string synopsis="", string description="");
     int32_t add_request(string token, external_request_function function, string synopsis="", string description="");
+    int32_t reactor_add_fd(int fd, std::function<void(int)> handler);
+    int32_t reactor_add_timer(double period, std::function<void()> handler);
+    int32_t reactor_remove(int32_t id);
     int32_t send_request(beatstruc cbeat, string request, string &output, float waitsec=5.);
     int32_t send_request_jsonnode(beatstruc cbeat, jsonnode &jnode, float waitsec=5.);
     int32_t get_server(string node, string name, float waitsec, beatstruc *cbeat);
@@ -324,6 +336,10 @@ public:
     //! Last message rad in message ring buffer
     size_t message_tail = MESSAGE_RING_SIZE;
 
+    //! Snapshot the primary data is taken from, if any. Values set by request are queued to it
+    //! as well, so that the next version taken keeps them.
+    std::atomic<json_snapshot *> snapshot{nullptr};
+
     // agent variables
 private:
 
@@ -348,6 +364,32 @@ private:
     thread hthread;
     //! Handle for message thread
     thread mthread;
+    //! Messages received on the subscription channel but not yet handed out by poll
+    socket_batch sub_batch;
+    std::mutex sub_batch_lock;
+    //! Whether the reactor thread stands in for the message, request and heartbeat threads
+    bool reactor_mode = false;
+    //! Handle for reactor thread
+    thread rthread;
+    //! Reactor epoll set, and event to wake it for shutdown
+    int reactor_epoll = -1;
+    int reactor_wake = -1;
+    //! Function to call for each file descriptor the reactor watches
+    struct reactor_entry
+    {
+        std::function<void()> handler;
+        //! Close along with the reactor
+        bool owned;
+    };
+    std::map<int, reactor_entry> reactor_handlers;
+    std::mutex reactor_lock;
+    //! Requests received but not yet processed by the reactor, and space to terminate one
+    socket_batch reactor_batch;
+    vector<char> reactor_request;
+    //! Heartbeat timer for the reactor, and the period it is set to
+    int32_t reactor_beat_timer = -1;
+    double reactor_bprd = 0.;
+    ElapsedTime reactor_beat;
     //! Flag for level of debugging
     size_t debug_level;
     //! Last error
@@ -371,6 +413,20 @@ private:
     void heartbeat_loop();
     void request_loop();
     void message_loop();
+    void heartbeat_beat(ElapsedTime &timer_beat);
+    int32_t request_open();
+    int32_t process_request(char *bufferin, int32_t nbytes);
+    void process_message(messstruc &mess);
+    int32_t reactor_start();
+    void reactor_stop();
+    int32_t reactor_add(int fd, std::function<void()> handler, bool owned);
+    int32_t reactor_timer(double first, double period, std::function<void()> handler);
+    int32_t reactor_arm(int fd, double first, double period);
+    int32_t reactor_serve();
+    void reactor_loop();
+    void reactor_heartbeat();
+    void reactor_requests();
+    void reactor_messages();
 
     char * parse_request(char *input);
     DeviceCpu deviceCpu_;
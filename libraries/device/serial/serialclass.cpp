@@ -1081,6 +1081,66 @@ namespace Cosmos {
         return (i);
     }
 
+    //! Read SLIP frame through a framer.
+    /*! Read whatever bytes are waiting, as many as are there with each call, and feed
+     * them to a ::slip_framer until it has a complete frame, or nothing arrives within
+     * the intercharacter timeout. Bytes after the frame stay in the framer for the next
+     * call, so none are lost between frames.
+        \param framer ::slip_framer set up by ::slip_framer_init.
+        \param data Set to the start of the decoded frame, which stays in place until the next call.
+        \return Length of the frame, or negative error.
+    */
+    int32_t Serial::get_slip(slip_framer &framer, uint8_t *&data)
+    {
+        if (fd < 0)
+        {
+            error = SERIAL_ERROR_OPEN;
+            return (error);
+        }
+
+        uint8_t buffer[4096];
+        ElapsedTime et;
+        do
+        {
+            int32_t iretn = slip_framer_next(framer, data);
+            if (iretn != 0)
+            {
+                return iretn;
+            }
+
+            int result;
+#ifdef COSMOS_WIN_OS
+            int n=0;
+            result = ReadFile(handle, buffer, sizeof(buffer), (LPDWORD)((void *)&n), NULL) ? n : -1;
+#else
+            result = read(fd, buffer, sizeof(buffer));
+#endif
+            if (result > 0)
+            {
+                slip_framer_feed(framer, buffer, result);
+                et.reset();
+                continue;
+            }
+            if (result < 0)
+            {
+#ifdef COSMOS_WIN_OS
+                error = -WSAGetLastError();
+                return error;
+#else
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    error = -errno;
+                    return error;
+                }
+#endif
+            }
+            COSMOS_SLEEP(ictimeout/10.);
+        } while (et.split() < ictimeout);
+
+        error = SERIAL_ERROR_TIMEOUT;
+        return (error);
+    }
+
     //! Read NMEA response.
     /*! Read an entire NMEA response from the serial port.
      * The leading $ and trailing * and checksum are removed, and only the
@@ -63,6 +63,7 @@ namespace Cosmos {
         int32_t get_string(string &data, size_t size=SIZE_MAX);
         int32_t get_data(uint8_t *data, size_t size);
         int32_t get_slip(vector <uint8_t> &data, size_t size);
+        int32_t get_slip(slip_framer &framer, uint8_t *&data);
         int32_t get_nmea(vector <uint8_t> &data, size_t size);
         int32_t get_xmodem(vector <uint8_t> &data, size_t size);
         int32_t get_error();
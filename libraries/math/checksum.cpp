@@ -0,0 +1,285 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+
+#include "checksum.h"
+
+#include <cstring>
+
+// The SSE4.2 kernel is built for its own target and only called when the processor
+// has SSE4.2, so the rest of the library keeps its own target.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC_SSE42
+#include <nmmintrin.h>
+#define CRC_TARGET __attribute__((target("sse4.2")))
+#endif
+
+// Polynomials, reversed for the CRCs worked from the least significant bit
+#define CRC16_POLY 0x1021
+#define CRC16_POLYR 0x8408
+#define CRC32C_POLYR 0x82f63b78
+
+// Table k advances a CRC over k+1 bytes, of which only the first is not zero
+struct crc_tables
+{
+    uint16_t crc16r[8][256];
+    uint16_t crc16[8][256];
+    uint32_t crc32c[8][256];
+};
+
+// Build the tables, one bit at a time
+static crc_tables make_tables()
+{
+    crc_tables t;
+    for (uint16_t i=0; i<256; ++i)
+    {
+        uint16_t r16 = i;
+        uint16_t m16 = i << 8;
+        uint32_t r32 = i;
+        for (uint16_t j=0; j<8; ++j)
+        {
+            r16 = (r16 >> 1) ^ ((r16 & 1) ? CRC16_POLYR : 0);
+            m16 = (m16 << 1) ^ ((m16 & 0x8000) ? CRC16_POLY : 0);
+            r32 = (r32 >> 1) ^ ((r32 & 1) ? CRC32C_POLYR : 0);
+        }
+        t.crc16r[0][i] = r16;
+        t.crc16[0][i] = m16;
+        t.crc32c[0][i] = r32;
+    }
+    for (uint16_t k=1; k<8; ++k)
+    {
+        for (uint16_t i=0; i<256; ++i)
+        {
+            uint16_t r16 = t.crc16r[k-1][i];
+            t.crc16r[k][i] = (r16 >> 8) ^ t.crc16r[0][r16 & 0xff];
+            uint16_t m16 = t.crc16[k-1][i];
+            t.crc16[k][i] = (m16 << 8) ^ t.crc16[0][m16 >> 8];
+            uint32_t r32 = t.crc32c[k-1][i];
+            t.crc32c[k][i] = (r32 >> 8) ^ t.crc32c[0][r32 & 0xff];
+        }
+    }
+    return t;
+}
+
+// The tables, built on first use
+static const crc_tables &tables()
+{
+    static const crc_tables t = make_tables();
+    return t;
+}
+
+// Eight bytes as a little endian word, whatever the byte order of the processor
+static inline uint64_t load_le64(const uint8_t *buf)
+{
+    return (uint64_t)buf[0] | (uint64_t)buf[1] << 8 | (uint64_t)buf[2] << 16 | (uint64_t)buf[3] << 24
+        | (uint64_t)buf[4] << 32 | (uint64_t)buf[5] << 40 | (uint64_t)buf[6] << 48 | (uint64_t)buf[7] << 56;
+}
+
+// Whether the processor has the SSE4.2 CRC instruction
+static bool simd_supported()
+{
+#ifdef CRC_SSE42
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+static bool use_simd = simd_supported();
+
+//! Use the processor's CRC instruction
+/*! Turn the SSE4.2 CRC-32C instruction on or off. It is on to begin
+ * with, if the processor has it.
+    \param enable True to use it, if the processor has it.
+    \return True if it is now in use.
+*/
+bool crc_simd(bool enable)
+{
+    use_simd = enable && simd_supported();
+    return use_simd;
+}
+
+//! CRC-16-CCITT, least significant bit first
+/*! Continue a 16-bit CCITT CRC, reversed polynomial 0x8408, over more
+ * bytes. Start from ::CRC16_INIT for the CRC used by SLIP and
+ * ::calc_crc16ccitt (CRC-16/MCRF4XX); the register is returned as is.
+    \param crc CRC so far.
+    \param buf Bytes to add.
+    \param size Number of bytes.
+    \return CRC including the new bytes.
+*/
+uint16_t crc16_update(uint16_t crc, const uint8_t *buf, size_t size)
+{
+    const crc_tables &t = tables();
+    for (; size>=8; size-=8, buf+=8)
+    {
+        uint64_t w = load_le64(buf) ^ crc;
+        crc = t.crc16r[7][w & 0xff] ^ t.crc16r[6][(w >> 8) & 0xff] ^ t.crc16r[5][(w >> 16) & 0xff] ^ t.crc16r[4][(w >> 24) & 0xff]
+            ^ t.crc16r[3][(w >> 32) & 0xff] ^ t.crc16r[2][(w >> 40) & 0xff] ^ t.crc16r[1][(w >> 48) & 0xff] ^ t.crc16r[0][w >> 56];
+    }
+    for (size_t i=0; i<size; ++i)
+    {
+        crc = (crc >> 8) ^ t.crc16r[0][(crc ^ buf[i]) & 0xff];
+    }
+    return crc;
+}
+
+//! CRC-16/X.25
+/*! Continue the frame check sequence of HDLC and AX.25 over more bytes.
+ * This is ::crc16_update with the register inverted going in and
+ * coming out, so start from 0.
+    \param crc CRC so far.
+    \param buf Bytes to add.
+    \param size Number of bytes.
+    \return CRC including the new bytes.
+*/
+uint16_t crc16_x25(uint16_t crc, const uint8_t *buf, size_t size)
+{
+    return ~crc16_update(~crc, buf, size);
+}
+
+//! CRC-16-CCITT, most significant bit first
+/*! Continue a 16-bit CCITT CRC, polynomial 0x1021, over more bytes.
+ * Start from ::CRC16_INIT for CRC-16/CCITT-FALSE, or from 0 for
+ * CRC-16/XMODEM; the register is returned as is.
+    \param crc CRC so far.
+    \param buf Bytes to add.
+    \param size Number of bytes.
+    \return CRC including the new bytes.
+*/
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *buf, size_t size)
+{
+    const crc_tables &t = tables();
+    for (; size>=8; size-=8, buf+=8)
+    {
+        crc = t.crc16[7][buf[0] ^ (crc >> 8)] ^ t.crc16[6][buf[1] ^ (crc & 0xff)] ^ t.crc16[5][buf[2]] ^ t.crc16[4][buf[3]]
+            ^ t.crc16[3][buf[4]] ^ t.crc16[2][buf[5]] ^ t.crc16[1][buf[6]] ^ t.crc16[0][buf[7]];
+    }
+    for (size_t i=0; i<size; ++i)
+    {
+        crc = (crc << 8) ^ t.crc16[0][(crc >> 8) ^ buf[i]];
+    }
+    return crc;
+}
+
+#ifdef CRC_SSE42
+// CRC-32C register over bytes with the processor's CRC instruction
+CRC_TARGET static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *buf, size_t size)
+{
+    uint64_t crc64 = crc;
+    for (; size>=8; size-=8, buf+=8)
+    {
+        uint64_t w;
+        memcpy(&w, buf, 8);
+        crc64 = _mm_crc32_u64(crc64, w);
+    }
+    crc = crc64;
+    for (size_t i=0; i<size; ++i)
+    {
+        crc = _mm_crc32_u8(crc, buf[i]);
+    }
+    return crc;
+}
+#endif
+
+//! CRC-32C (Castagnoli)
+/*! Continue a CRC-32C, reversed polynomial 0x82f63b78, over more bytes.
+ * As with zlib's crc32, the register is inverted going in and coming
+ * out, so start from 0.
+    \param crc CRC so far.
+    \param buf Bytes to add.
+    \param size Number of bytes.
+    \return CRC including the new bytes.
+*/
+uint32_t crc32c(uint32_t crc, const uint8_t *buf, size_t size)
+{
+    crc = ~crc;
+#ifdef CRC_SSE42
+    if (use_simd)
+    {
+        return ~crc32c_sse42(crc, buf, size);
+    }
+#endif
+    const crc_tables &t = tables();
+    for (; size>=8; size-=8, buf+=8)
+    {
+        uint64_t w = load_le64(buf) ^ crc;
+        crc = t.crc32c[7][w & 0xff] ^ t.crc32c[6][(w >> 8) & 0xff] ^ t.crc32c[5][(w >> 16) & 0xff] ^ t.crc32c[4][(w >> 24) & 0xff]
+            ^ t.crc32c[3][(w >> 32) & 0xff] ^ t.crc32c[2][(w >> 40) & 0xff] ^ t.crc32c[1][(w >> 48) & 0xff] ^ t.crc32c[0][w >> 56];
+    }
+    for (size_t i=0; i<size; ++i)
+    {
+        crc = (crc >> 8) ^ t.crc32c[0][(crc ^ buf[i]) & 0xff];
+    }
+    return ~crc;
+}
+
+//! Ones' complement sum of 16-bit words
+/*! Continue the sum used by the IP, UDP and TCP checksums over more
+ * bytes, taken as 16-bit words in the byte order of the processor, with
+ * the end around carry. An odd last byte is taken as if followed by a
+ * zero byte. The checksum itself is the complement of the final sum,
+ * in the same byte order as the words.
+    \param sum Sum so far.
+    \param buf Bytes to add.
+    \param size Number of bytes.
+    \return Sum including the new bytes.
+*/
+uint16_t checksum_sum16(uint16_t sum, const uint8_t *buf, size_t size)
+{
+    // Whole 32-bit words into 64 bits, carries and all, folded once at the end
+    uint64_t total = sum;
+    for (; size>=4; size-=4, buf+=4)
+    {
+        uint32_t w;
+        memcpy(&w, buf, 4);
+        total += w;
+    }
+    if (size >= 2)
+    {
+        uint16_t w;
+        memcpy(&w, buf, 2);
+        total += w;
+        size -= 2;
+        buf += 2;
+    }
+    if (size)
+    {
+        uint8_t w[2] = {buf[0], 0};
+        uint16_t w16;
+        memcpy(&w16, w, 2);
+        total += w16;
+    }
+    while (total > 0xffff)
+    {
+        total = (total & 0xffff) + (total >> 16);
+    }
+    return total;
+}
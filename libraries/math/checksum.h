@@ -0,0 +1,57 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+
+#ifndef _MATH_CHECKSUM_H
+#define _MATH_CHECKSUM_H
+
+//! \file checksum.h
+//! \brief Table driven CRCs and checksums
+//! The CRCs are worked eight bytes at a time from eight tables of 256
+//! entries (slicing by 8), built the first time they are needed. On x86
+//! processors with SSE4.2, CRC-32C uses the processor's CRC instruction
+//! instead, unless turned off with ::crc_simd. Every function takes the
+//! value left by the previous call, so a frame can be checked in pieces
+//! as it arrives: the result over a whole buffer is the same as over
+//! any split of it, fed through in order (for ::checksum_sum16, any
+//! split after an even number of bytes).
+
+#include "support/configCosmos.h"
+
+//! Starting register for ::crc16_update and ::crc16_ccitt_update
+#define CRC16_INIT 0xffff
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *buf, size_t size);
+uint16_t crc16_x25(uint16_t crc, const uint8_t *buf, size_t size);
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *buf, size_t size);
+uint32_t crc32c(uint32_t crc, const uint8_t *buf, size_t size);
+uint16_t checksum_sum16(uint16_t sum, const uint8_t *buf, size_t size);
+bool crc_simd(bool enable);
+
+#endif
@@ -0,0 +1,367 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+// dependencies: matrix
+#ifndef _MATH_FIXEDMATRIX_H
+#define _MATH_FIXEDMATRIX_H
+
+#include "support/configCosmos.h"
+#include "matrix.h"
+
+#include <cmath>
+
+//! RxC element fixed size matrix
+/*! Sized at compile time, unlike ::matrix2d, so every loop over one has
+ * constant bounds that the compiler can unroll and vectorize. Rows are
+ * contiguous and aligned for vector loads. Functions take them by
+ * reference, so only results are copied. Only small sizes (3x3 attitude,
+ * 4x4, 6x6 state covariance) are meant; all are done inline.
+*/
+template <size_t R, size_t C> struct fmatrix
+{
+    alignas(32) double a[R][C];
+};
+
+//! N element fixed size column vector
+template <size_t N> struct fvector
+{
+    alignas(32) double a[N];
+};
+
+typedef fmatrix<3,3> fmatrix3;
+typedef fmatrix<4,4> fmatrix4;
+typedef fmatrix<6,6> fmatrix6;
+typedef fvector<3> fvector3;
+typedef fvector<4> fvector4;
+typedef fvector<6> fvector6;
+
+//! Zero matrix
+template <size_t R, size_t C> inline fmatrix<R,C> fm_zero()
+{
+    fmatrix<R,C> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.a[i][j] = 0.;
+        }
+    }
+    return m;
+}
+
+//! Identity matrix
+template <size_t N> inline fmatrix<N,N> fm_eye()
+{
+    fmatrix<N,N> m = fm_zero<N,N>();
+    for (size_t i=0; i<N; ++i)
+    {
+        m.a[i][i] = 1.;
+    }
+    return m;
+}
+
+//! Sum of two matrices
+template <size_t R, size_t C> inline fmatrix<R,C> fm_add(const fmatrix<R,C> &m1, const fmatrix<R,C> &m2)
+{
+    fmatrix<R,C> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.a[i][j] = m1.a[i][j] + m2.a[i][j];
+        }
+    }
+    return m;
+}
+
+//! Difference of two matrices
+template <size_t R, size_t C> inline fmatrix<R,C> fm_sub(const fmatrix<R,C> &m1, const fmatrix<R,C> &m2)
+{
+    fmatrix<R,C> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.a[i][j] = m1.a[i][j] - m2.a[i][j];
+        }
+    }
+    return m;
+}
+
+//! Matrix times a scalar
+template <size_t R, size_t C> inline fmatrix<R,C> fm_smult(double s, const fmatrix<R,C> &m1)
+{
+    fmatrix<R,C> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.a[i][j] = s * m1.a[i][j];
+        }
+    }
+    return m;
+}
+
+//! Transpose of a matrix
+template <size_t R, size_t C> inline fmatrix<C,R> fm_transpose(const fmatrix<R,C> &m1)
+{
+    fmatrix<C,R> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.a[j][i] = m1.a[i][j];
+        }
+    }
+    return m;
+}
+
+//! Matrix product
+/*! When rows are a multiple of 4 long, each row of the result is built
+ * up as a sum of whole rows of m2, which the compiler turns into vector
+ * operations along contiguous memory. Otherwise each element is its own
+ * dot product, which keeps fewer sums waiting on each other.
+    \param m1 RxK matrix.
+    \param m2 KxC matrix.
+    \return RxC product.
+*/
+template <size_t R, size_t K, size_t C> inline fmatrix<R,C> fm_mmult(const fmatrix<R,K> &m1, const fmatrix<K,C> &m2)
+{
+    fmatrix<R,C> m;
+    for (size_t i=0; i<R; ++i)
+    {
+        if (C % 4 == 0)
+        {
+            for (size_t j=0; j<C; ++j)
+            {
+                m.a[i][j] = m1.a[i][0] * m2.a[0][j];
+            }
+            for (size_t k=1; k<K; ++k)
+            {
+                double s = m1.a[i][k];
+                for (size_t j=0; j<C; ++j)
+                {
+                    m.a[i][j] += s * m2.a[k][j];
+                }
+            }
+        }
+        else
+        {
+            for (size_t j=0; j<C; ++j)
+            {
+                double s = m1.a[i][0] * m2.a[0][j];
+                for (size_t k=1; k<K; ++k)
+                {
+                    s += m1.a[i][k] * m2.a[k][j];
+                }
+                m.a[i][j] = s;
+            }
+        }
+    }
+    return m;
+}
+
+//! Matrix times a vector
+template <size_t R, size_t C> inline fvector<R> fv_mmult(const fmatrix<R,C> &m1, const fvector<C> &v1)
+{
+    fvector<R> v;
+    for (size_t i=0; i<R; ++i)
+    {
+        v.a[i] = 0.;
+        for (size_t j=0; j<C; ++j)
+        {
+            v.a[i] += m1.a[i][j] * v1.a[j];
+        }
+    }
+    return v;
+}
+
+//! Covariance through a linear map
+/*! Propagate a covariance P through a linear map F, as F P F^T.
+    \param f RxN map.
+    \param p NxN covariance.
+    \return RxR covariance.
+*/
+template <size_t R, size_t N> inline fmatrix<R,R> fm_quadratic(const fmatrix<R,N> &f, const fmatrix<N,N> &p)
+{
+    return fm_mmult(fm_mmult(f, p), fm_transpose(f));
+}
+
+//! Inverse of a square matrix
+/*! Gauss-Jordan elimination with partial pivoting. A singular matrix
+ * gives a result of infinities or NaNs, as rm_inverse does.
+    \param m1 NxN matrix.
+    \return Inverse.
+*/
+template <size_t N> inline fmatrix<N,N> fm_inverse(const fmatrix<N,N> &m1)
+{
+    fmatrix<N,N> w = m1;
+    fmatrix<N,N> m = fm_eye<N>();
+    for (size_t c=0; c<N; ++c)
+    {
+        size_t pivot = c;
+        for (size_t r=c+1; r<N; ++r)
+        {
+            if (fabs(w.a[r][c]) > fabs(w.a[pivot][c]))
+            {
+                pivot = r;
+            }
+        }
+        if (pivot != c)
+        {
+            for (size_t j=0; j<N; ++j)
+            {
+                double t = w.a[c][j];
+                w.a[c][j] = w.a[pivot][j];
+                w.a[pivot][j] = t;
+                t = m.a[c][j];
+                m.a[c][j] = m.a[pivot][j];
+                m.a[pivot][j] = t;
+            }
+        }
+        double s = 1. / w.a[c][c];
+        for (size_t j=0; j<N; ++j)
+        {
+            w.a[c][j] *= s;
+            m.a[c][j] *= s;
+        }
+        for (size_t r=0; r<N; ++r)
+        {
+            if (r != c)
+            {
+                double f = w.a[r][c];
+                for (size_t j=0; j<N; ++j)
+                {
+                    w.a[r][j] -= f * w.a[c][j];
+                    m.a[r][j] -= f * m.a[c][j];
+                }
+            }
+        }
+    }
+    return m;
+}
+
+//! Inverse of a 3x3 matrix, from its cofactors
+template <> inline fmatrix<3,3> fm_inverse<3>(const fmatrix<3,3> &m1)
+{
+    fmatrix<3,3> m;
+    m.a[0][0] = m1.a[1][1]*m1.a[2][2] - m1.a[1][2]*m1.a[2][1];
+    m.a[0][1] = m1.a[0][2]*m1.a[2][1] - m1.a[0][1]*m1.a[2][2];
+    m.a[0][2] = m1.a[0][1]*m1.a[1][2] - m1.a[0][2]*m1.a[1][1];
+    m.a[1][0] = m1.a[1][2]*m1.a[2][0] - m1.a[1][0]*m1.a[2][2];
+    m.a[1][1] = m1.a[0][0]*m1.a[2][2] - m1.a[0][2]*m1.a[2][0];
+    m.a[1][2] = m1.a[0][2]*m1.a[1][0] - m1.a[0][0]*m1.a[1][2];
+    m.a[2][0] = m1.a[1][0]*m1.a[2][1] - m1.a[1][1]*m1.a[2][0];
+    m.a[2][1] = m1.a[0][1]*m1.a[2][0] - m1.a[0][0]*m1.a[2][1];
+    m.a[2][2] = m1.a[0][0]*m1.a[1][1] - m1.a[0][1]*m1.a[1][0];
+    double determinant = m1.a[0][0]*m.a[0][0] + m1.a[0][1]*m.a[1][0] + m1.a[0][2]*m.a[2][0];
+    return fm_smult(1. / determinant, m);
+}
+
+//! Fixed size matrix from ::rmatrix
+inline fmatrix3 fm_from_rm(const rmatrix &m1)
+{
+    fmatrix3 m;
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            m.a[i][j] = m1.row[i].col[j];
+        }
+    }
+    return m;
+}
+
+//! ::rmatrix from fixed size matrix
+inline rmatrix rm_from_fm(const fmatrix3 &m1)
+{
+    rmatrix m;
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            m.row[i].col[j] = m1.a[i][j];
+        }
+    }
+    return m;
+}
+
+//! Fixed size vector from ::rvector
+inline fvector3 fv_from_rv(const rvector &v1)
+{
+    fvector3 v;
+    v.a[0] = v1.col[0];
+    v.a[1] = v1.col[1];
+    v.a[2] = v1.col[2];
+    return v;
+}
+
+//! ::rvector from fixed size vector
+inline rvector rv_from_fv(const fvector3 &v1)
+{
+    rvector v;
+    v.col[0] = v1.a[0];
+    v.col[1] = v1.a[1];
+    v.col[2] = v1.a[2];
+    return v;
+}
+
+//! Fixed size matrix from ::matrix2d
+/*! Elements outside the rows and columns of the ::matrix2d are zero.
+*/
+template <size_t R, size_t C> inline fmatrix<R,C> fm_from_m2(const matrix2d &m1)
+{
+    static_assert(R <= 4 && C <= 4, "matrix2d is at most 4x4");
+    fmatrix<R,C> m = fm_zero<R,C>();
+    for (size_t i=0; i<R && i<m1.rows; ++i)
+    {
+        for (size_t j=0; j<C && j<m1.cols; ++j)
+        {
+            m.a[i][j] = m1.array[i][j];
+        }
+    }
+    return m;
+}
+
+//! ::matrix2d from fixed size matrix
+template <size_t R, size_t C> inline matrix2d m2_from_fm(const fmatrix<R,C> &m1)
+{
+    static_assert(R <= 4 && C <= 4, "matrix2d is at most 4x4");
+    matrix2d m = {R, C, {{0.}}};
+    for (size_t i=0; i<R; ++i)
+    {
+        for (size_t j=0; j<C; ++j)
+        {
+            m.array[i][j] = m1.a[i][j];
+        }
+    }
+    return m;
+}
+
+#endif
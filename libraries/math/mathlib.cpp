@@ -39,12 +39,53 @@
 //! \addtogroup mathlib_functions
 //! @{
 
+// Stream that the random numbers of this thread are drawn from, if not rand()
+static thread_local uint64_t *random_state = nullptr;
+
+// Next number of a SplitMix64 stream
+static uint64_t random_next(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+//! Seed a random number stream
+/*! Make the starting state of one of many independent streams of
+ * random numbers that all come from one seed, such as one stream for
+ * each simulated node.
+    \param seed Seed common to all the streams.
+    \param stream Number of the stream.
+    \return State to hand to ::random_stream.
+*/
+uint64_t random_seed(uint64_t seed, uint64_t stream)
+{
+    uint64_t state = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+    return random_next(state);
+}
+
+//! Draw random numbers from a stream
+/*! Have the random numbers of the calling thread, such as those of
+ * ::gaussian_random, drawn from the given stream, which is advanced
+ * as they are drawn. The same stream then gives the same numbers
+ * whichever thread draws them.
+    \param state Stream from ::random_seed, or nullptr to go back to
+    rand().
+*/
+void random_stream(uint64_t *state)
+{
+    random_state = state;
+}
+
 //! Normal Distribution random number
 /*! Random number generated using the Central Value Theorem to
     approximate a Gaussian distribution. Twelve random numbers between
     -1 and 1 are averaged to approximate the final random number. This
     will come from a distribution whose mean is 0 and variance is .5.
     The desired input parameters are then used to scale the output.
+    The numbers come from rand(), or from the stream set with
+    ::random_stream for the calling thread.
     \param mean Desired central value of the gaussian.
     \param stdev Desired Standard Deviation of the gaussian.
     \return Random number from desired distribution.
@@ -58,7 +99,14 @@ double gaussian_random(double mean, double stdev)
     trand = 0.;
     for (uint32_t i=0; i<12; ++i)
     {
-        trand += rand();
+        if (random_state != nullptr)
+        {
+            trand += (random_next(*random_state) >> 11) * (RAND_MAX / 9007199254740992.);
+        }
+        else
+        {
+            trand += rand();
+        }
     }
 
     trand = trand / (3. * RAND_MAX) - 2.;
@@ -728,82 +776,142 @@ void doubleto(double value, uint8_t *pointer, ByteOrder order)
 
 //! Initialize estimator
 /*! Setup the provided ::estimatorhandle so that it can be fed values
- * and provide estimates.
+ * and provide estimates. All the storage it will need is allocated here.
     \param estimate Pointer to an ::estimatorhandle.
     \param size The number of estimates to be averaged for the total estimate.
-    \param degree The degree of the polynomial fit for the estimator.
+    \param degree The degree of the polynomial fit for the estimator, no
+ * more than ESTIMATOR_MAXDEGREE.
+    \return Zero, or GENERAL_ERROR_OVERSIZE if the degree is too large, in
+ * which case the handle is left untouched.
 */
-void open_estimate(estimatorhandle *estimate, uint32_t size, uint32_t degree)
+int32_t open_estimate(estimatorhandle *estimate, uint32_t size, uint32_t degree)
 {
-    if (degree > 4) degree = 4;
+    if (degree > ESTIMATOR_MAXDEGREE)
+    {
+        return GENERAL_ERROR_OVERSIZE;
+    }
     estimate->degree = degree;
     if (size < degree) size = degree;
+    if (size < 1) size = 1;
     estimate->size = size;
-    estimate->r.resize(0);
+    estimate->count = 0;
+    estimate->index = 0;
+    estimate->xbase = estimate->ybase = 0.;
+    estimate->a.assign(size * (degree+2), 0.);
+    return 0;
 }
 
-//! Set estimator
-/*! Add a pair of independent and dependent values to the supplied
- * ::estimatorhandle. If more than degree+1 values have been accumulated, a
- * fit will be done for the new value. If more than size values have
- * been added, the oldest will be dropped.
-    \param estimate Pointer to an ::estimatorhandle.
-    \param independent Independent value.
-    \param dependent Dependent value.
-    \return Number of stored values.
-*/
-int16_t set_estimate(estimatorhandle *estimate, double independent, double dependent)
+// Weights that give the coefficients of the polynomial through n points at x from the values
+// at them: the coefficients of each Lagrange basis polynomial.
+static void estimate_weights(const double *x, uint32_t n, double w[ESTIMATOR_MAXDEGREE+1][ESTIMATOR_MAXDEGREE+1])
 {
-
-    if (estimate->r.size() == estimate->size && estimate->r[estimate->size-1].x.size() == estimate->degree+1)
+    for (uint32_t j=0; j<n; ++j)
     {
-        for (uint32_t i=0; i<estimate->size-1; ++i)
+        double p[ESTIMATOR_MAXDEGREE+1] = {1.};
+        double denominator = 1.;
+        uint32_t m = 0;
+        for (uint32_t k=0; k<n; ++k)
         {
-            estimate->r[i] = estimate->r[i+1];
+            if (k == j)
+            {
+                continue;
+            }
+            p[m+1] = p[m];
+            for (uint32_t i=m; i>0; --i)
+            {
+                p[i] = p[i-1] - x[k] * p[i];
+            }
+            p[0] *= -x[k];
+            ++m;
+            denominator *= x[j] - x[k];
         }
-        for (uint32_t i=0; i<estimate->degree; ++i)
+        for (uint32_t i=0; i<n; ++i)
         {
-            estimate->r[estimate->size-1].x[i] = estimate->r[estimate->size-1].x[i+1];
-            estimate->r[estimate->size-1].y[i] = estimate->r[estimate->size-1].y[i+1];
+            w[i][j] = p[i] / denominator;
         }
-        estimate->r[estimate->size-1].x[estimate->degree] = independent  - estimate->xbase;
-        estimate->r[estimate->size-1].y[estimate->degree] = dependent  - estimate->ybase;
-        estimate->r[estimate->size-1].a = polyfit(estimate->r[estimate->size-1].x,estimate->r[estimate->size-1].y);
     }
-    else
+}
+
+// Add a pair to the ring of the last degree+1
+static void estimate_push(estimatorhandle *estimate, double independent, double dependent)
+{
+    if (!estimate->count)
     {
-        if (estimate->r.size() > 0)
-        {
-            if (estimate->r.size() < estimate->size) estimate->r.resize(estimate->r.size()+1);
-            for (uint32_t i=0; i<estimate->r.size(); ++i)
-            {
-                if (estimate->r[i].x.size() < estimate->degree+1)
-                {
-                    estimate->r[i].x.push_back(independent - estimate->xbase);
-                    estimate->r[i].y.push_back(dependent - estimate->ybase);
-                }
-                if (estimate->r[i].x.size() == estimate->degree+1 && !estimate->r[i].a.size()) estimate->r[i].a = polyfit(estimate->r[i].x,estimate->r[i].y);
-            }
+        estimate->xbase = independent;
+        estimate->ybase = dependent;
+    }
+    uint32_t slot = estimate->count % (estimate->degree+1);
+    estimate->x[slot] = independent - estimate->xbase;
+    estimate->y[slot] = dependent - estimate->ybase;
+    ++estimate->count;
+}
 
-        }
-        else
+// Offsets of the pairs held from the newest, which each fit is about
+static void estimate_offsets(const estimatorhandle *estimate, double *dx)
+{
+    uint32_t newest = (estimate->count - 1) % (estimate->degree+1);
+    for (uint32_t j=0; j<=estimate->degree; ++j)
+    {
+        dx[j] = estimate->x[j] - estimate->x[newest];
+    }
+}
+
+// Fit the pairs held, with weights from estimate_weights, in place of the oldest fit in the ring
+static void estimate_fit(estimatorhandle *estimate, double w[ESTIMATOR_MAXDEGREE+1][ESTIMATOR_MAXDEGREE+1])
+{
+    uint32_t n = estimate->degree + 1;
+    double *fit = &estimate->a[estimate->index * (n+1)];
+
+    fit[0] = estimate->x[(estimate->count - 1) % n];
+    for (uint32_t i=0; i<n; ++i)
+    {
+        fit[i+1] = 0.;
+        for (uint32_t j=0; j<n; ++j)
         {
-            estimate->xbase = independent;
-            estimate->ybase = dependent;
-            estimate->r.resize(1);
-            estimate->r[0].x.push_back(independent - estimate->xbase);
-            estimate->r[0].y.push_back(dependent - estimate->ybase);
+            fit[i+1] += w[i][j] * estimate->y[j];
         }
     }
 
-    return (estimate->r.size()+estimate->r[estimate->r.size()-1].x.size());
+    if (++estimate->index == (int32_t)estimate->size)
+    {
+        estimate->index = 0;
+    }
+}
+
+//! Set estimator
+/*! Add a pair of independent and dependent values to the supplied
+ * ::estimatorhandle. Once degree+1 values have been accumulated, a
+ * fit will be done for each new value, replacing the oldest of the
+ * last size fits. The work done is the same for every value, and
+ * nothing is allocated.
+    \param estimate Pointer to an ::estimatorhandle.
+    \param independent Independent value.
+    \param dependent Dependent value.
+    \return Number of stored values.
+*/
+int16_t set_estimate(estimatorhandle *estimate, double independent, double dependent)
+{
+    double w[ESTIMATOR_MAXDEGREE+1][ESTIMATOR_MAXDEGREE+1];
+    double dx[ESTIMATOR_MAXDEGREE+1];
+
+    estimate_push(estimate, independent, dependent);
+    if (estimate->count > estimate->degree)
+    {
+        estimate_offsets(estimate, dx);
+        estimate_weights(dx, estimate->degree+1, w);
+        estimate_fit(estimate, w);
+    }
+
+    return (estimate->count < estimate->size+estimate->degree ? estimate->count : estimate->size+estimate->degree);
 }
 
 //! Get estimate
 /*! Return the best estimate for the supplied independent value.
  * Estimate will be returned as an ::estimatorstruc, containing the
  * value and likely error for the 0th, 1st and 2nd derivative of the
- * dependent value.
+ * dependent value: the mean and spread of the last size fits. Until
+ * there are size fits, the mean and spread of the values held are
+ * returned instead.
     \param estimate Pointer to an ::estimatorhandle.
     \param x Value of independent variable for estimate.
     \return ::estimatorstruc containing the estimate of the dependent
@@ -812,82 +920,151 @@ int16_t set_estimate(estimatorhandle *estimate, double independent, double depen
 estimatorstruc get_estimate(estimatorhandle *estimate, double x)
 {
     estimatorstruc result;
-    double tx;
+    uint32_t n = estimate->degree + 1;
 
     result.value[0] = result.value[1] = result.value[2] = 0.;
     result.error[0] = result.error[1] = result.error[2] = 0.;
-    if (!estimate->r.size())
+    if (!estimate->count)
     {
         return (result);
     }
 
-    x -= estimate->xbase;
-
-    if (estimate->r.size() == estimate->size && estimate->r[estimate->size-1].a.size() == estimate->degree+1)
+    if (estimate->count < estimate->size + estimate->degree)
     {
-        for (uint32_t i=0; i<estimate->size; i++)
+        uint32_t held = estimate->count < n ? estimate->count : n;
+        for (uint32_t i=0; i<held; ++i)
         {
-            tx = 1.;
-            for (uint32_t j=0; j<estimate->degree+1; j++)
-            {
-                switch (j)
-                {
-                case 0:
-                    estimate->r[i].value[0] = estimate->r[i].a[0];
-                    if (estimate->degree > 0) estimate->r[i].value[1] = estimate->r[i].a[1];
-                    if (estimate->degree > 1) estimate->r[i].value[2] = 2. * estimate->r[i].a[2];
-                    break;
-                default:
-                    tx *= x;
-                    estimate->r[i].value[0] += tx * estimate->r[i].a[j];
-                    if (estimate->degree > j) estimate->r[i].value[1] += tx * (j+1) * estimate->r[i].a[j+1];
-                    if (estimate->degree > j+1) estimate->r[i].value[2] += tx * (j+2) * (j+1) * estimate->r[i].a[j+2];
-                    break;
-                }
-            }
-
-            for (int j=0; j<3; ++j)
-            {
-                result.value[j] += estimate->r[i].value[j];
-                result.error[j] += (estimate->r[i].value[j]*estimate->r[i].value[j]);
-            }
-
+            result.value[0] += estimate->y[i];
+            result.error[0] += (estimate->y[i]*estimate->y[i]);
         }
-
-        for (int i=0; i<3; i++)
+        result.error[0] = result.error[0] - result.value[0]*result.value[0]/held;
+        if (result.error[0] < 0.) result.error[0] = 0.;
+        if (held > 1)
         {
-            result.error[i] = result.error[i] - result.value[i]*result.value[i]/(estimate->size);
-            if (result.error[i] < 0.) result.error[i] = 0.;
-            if (estimate->size > 1)
-            {
-                result.error[i] /= (estimate->size - 1);
-            }
-            result.error[i] = sqrt(result.error[i]);
-            result.value[i] /= (estimate->size);
+            result.error[0] /= held - 1;
         }
+        result.error[0] = sqrt(result.error[0]);
+        result.value[0] = result.value[0] / held + estimate->ybase;
+        return (result);
+    }
 
-        result.value[0] += estimate->ybase;
+    // Mean and spread of the value and its derivatives over the fits
+    x -= estimate->xbase;
+    for (uint32_t r=0; r<estimate->size; ++r)
+    {
+        const double *fit = &estimate->a[r * (n+1)];
+        double dx = x - fit[0];
+        double value[3] = {0., 0., 0.};
+        for (uint32_t i=n; i>0; --i)
+        {
+            value[2] = value[2] * dx + 2. * value[1];
+            value[1] = value[1] * dx + value[0];
+            value[0] = value[0] * dx + fit[i];
+        }
+        for (int j=0; j<3; ++j)
+        {
+            double delta = value[j] - result.value[j];
+            result.value[j] += delta / (r + 1);
+            result.error[j] += delta * (value[j] - result.value[j]);
+        }
     }
-    else
+
+    for (int j=0; j<3; ++j)
     {
-        for (uint32_t i=0; i<estimate->r[0].x.size(); ++i)
+        if (estimate->size > 1)
         {
-            result.value[0] += estimate->r[0].y[i];
-            result.error[0] += (estimate->r[0].y[i]*estimate->r[0].y[i]);
+            result.error[j] /= (estimate->size - 1);
         }
-        for (int i=0; i<3; ++i)
+        result.error[j] = sqrt(result.error[j]);
+    }
+
+    result.value[0] += estimate->ybase;
+    return (result);
+}
+
+//! Initialize estimators
+/*! Setup a number of ::estimatorhandle for channels that will be fed
+ * together, with set_estimates.
+    \param estimates Vector of ::estimatorhandle to set up.
+    \param channels The number of channels.
+    \param size The number of estimates to be averaged for the total estimate.
+    \param degree The degree of the polynomial fit for the estimator, no
+ * more than ESTIMATOR_MAXDEGREE.
+    \return Zero, or GENERAL_ERROR_OVERSIZE if the degree is too large, in
+ * which case the estimators are left untouched.
+*/
+int32_t open_estimates(std::vector<estimatorhandle> &estimates, uint32_t channels, uint32_t size, uint32_t degree)
+{
+    if (degree > ESTIMATOR_MAXDEGREE)
+    {
+        return GENERAL_ERROR_OVERSIZE;
+    }
+    estimates.resize(channels);
+    for (estimatorhandle &estimate : estimates)
+    {
+        open_estimate(&estimate, size, degree);
+    }
+    return 0;
+}
+
+//! Set estimators
+/*! Add a dependent value for each channel, all at the same independent
+ * value. The weights of the fit depend only on the independent values
+ * held, so they are worked out again only when a channel holds different
+ * ones from the channel before it, as it may if it has also been fed
+ * through set_estimate.
+    \param estimates Vector of ::estimatorhandle, one for each channel.
+    \param independent Independent value.
+    \param dependent Dependent value for each channel.
+    \return Number of channels updated.
+*/
+int16_t set_estimates(std::vector<estimatorhandle> &estimates, double independent, std::vector<double> &dependent)
+{
+    double w[ESTIMATOR_MAXDEGREE+1][ESTIMATOR_MAXDEGREE+1];
+    double dx[ESTIMATOR_MAXDEGREE+1];
+    double wdx[ESTIMATOR_MAXDEGREE+1];
+    uint32_t wdegree = ESTIMATOR_MAXDEGREE+1;
+    size_t count = estimates.size() < dependent.size() ? estimates.size() : dependent.size();
+
+    for (size_t i=0; i<count; ++i)
+    {
+        estimatorhandle *estimate = &estimates[i];
+        estimate_push(estimate, independent, dependent[i]);
+        if (estimate->count > estimate->degree)
         {
-            result.error[i] = result.error[i] - result.value[i]*result.value[i]/estimate->r[0].x.size();
-            if (estimate->r[0].x.size() > 1)
+            estimate_offsets(estimate, dx);
+            bool same = wdegree == estimate->degree;
+            for (uint32_t j=0; same && j<=estimate->degree; ++j)
             {
-                result.error[i] /= estimate->r[0].x.size() - 1;
+                same = dx[j] == wdx[j];
             }
-            result.error[i] = sqrt(result.error[i]);
-            result.value[i] /= estimate->r[0].x.size();
+            if (!same)
+            {
+                estimate_weights(dx, estimate->degree+1, w);
+                wdegree = estimate->degree;
+                memcpy(wdx, dx, sizeof(dx));
+            }
+            estimate_fit(estimate, w);
         }
     }
 
-    return (result);
+    return (count);
+}
+
+//! Get estimates
+/*! Return the best estimate for each channel at the supplied
+ * independent value, as for get_estimate.
+    \param estimates Vector of ::estimatorhandle, one for each channel.
+    \param independent Value of independent variable for estimates.
+    \param results Vector of ::estimatorstruc, set to the estimate for each channel.
+*/
+void get_estimates(std::vector<estimatorhandle> &estimates, double independent, std::vector<estimatorstruc> &results)
+{
+    results.resize(estimates.size());
+    for (size_t i=0; i<estimates.size(); ++i)
+    {
+        results[i] = get_estimate(&estimates[i], independent);
+    }
 }
 
 //! Perform N equation solution.
@@ -2080,19 +2257,11 @@ double fixprecision(double number, double prec)
 
 uint16_t calc_crc16ccitt(uint8_t *buf, int size)
 {
-    uint16_t crc = 0xffff;
-    uint8_t ch;
-
-    for (uint16_t i=0; i<size; i++)
+    if (size <= 0)
     {
-        ch = buf[i];
-        for (uint16_t j=0; j<8; j++)
-        {
-            crc = (crc >> 1)^(((ch^crc)&0x01)?0x8408:0);
-            ch >>= 1;
-        }
+        return (CRC16_INIT);
     }
-    return (crc);
+    return (crc16_update(CRC16_INIT, buf, size));
 }
 
 
@@ -113,6 +113,8 @@
 #include "matrix.h"
 #include "quaternion.h"
 #include "rotation.h"
+#include "quaternionbatch.h"
+#include "checksum.h"
 //#include "lsFit.h"
 
 #include <cmath>
@@ -254,21 +256,31 @@ struct estimatorstruc
     std::vector<double> y;
 };
 
+//! Highest degree of estimator fit
+#define ESTIMATOR_MAXDEGREE 4
+
 //! Estimator handle
-/*! Contains storage elements for a string of 2N dependent and
- * independent variables, plus polynomial coefficients for N
- * consecutive fits. This structure can then be used to either return
- * dependent values for an arbitrary independent value, or to update
- * the estimator with new pairs.
+/*! Contains storage elements for the last degree+1 dependent and
+ * independent variables, plus polynomial coefficients for the last N
+ * consecutive fits, kept in a ring. This structure can then be used to
+ * either return dependent values for an arbitrary independent value, or
+ * to update the estimator with new pairs, without reallocating.
 */
 struct estimatorhandle
 {
-    std::vector<estimatorstruc> r;
+    //! Next fit to replace in the ring
     int32_t index;
     uint32_t size;
     uint32_t degree;
     double xbase;
     double ybase;
+    //! Number of pairs given so far
+    uint32_t count;
+    //! Last degree+1 pairs, relative to xbase and ybase, in a ring
+    double x[ESTIMATOR_MAXDEGREE+1];
+    double y[ESTIMATOR_MAXDEGREE+1];
+    //! Last size fits, each the independent value it is about followed by degree+1 coefficients
+    std::vector<double> a;
 } ;
 
 //! @}
@@ -278,6 +290,8 @@ struct estimatorhandle
 //! @{
 
 double gaussian_random(double mean, double stdev);
+uint64_t random_seed(uint64_t seed, uint64_t stream);
+void random_stream(uint64_t *state);
 
 double distance_rv(rvector p0, rvector p1, rvector p2);
 //double distance_rv_1(rvector p0, rvector p1, rvector p2);
@@ -297,9 +311,12 @@ rvector rv_quaternion2axis(quaternion q);
 uvector rv_fitpoly(uvector x, uvector y, uint32_t order);
 std::vector<double> polyfit(std::vector<double> &x, std::vector<double> &y);
 void multisolve(std::vector< std::vector<double> > x, std::vector<double> y, std::vector<double>& a);
-void open_estimate(estimatorhandle *estimate, uint32_t size, uint32_t degree);
+int32_t open_estimate(estimatorhandle *estimate, uint32_t size, uint32_t degree);
 int16_t set_estimate(estimatorhandle *estimate, double independent, double dependent);
 estimatorstruc get_estimate(estimatorhandle *estimate, double independent);
+int32_t open_estimates(std::vector<estimatorhandle> &estimates, uint32_t channels, uint32_t size, uint32_t degree);
+int16_t set_estimates(std::vector<estimatorhandle> &estimates, double independent, std::vector<double> &dependent);
+void get_estimates(std::vector<estimatorhandle> &estimates, double independent, std::vector<estimatorstruc> &results);
 
 
 
@@ -1449,6 +1449,7 @@ matrix2d m2_from_rm(rmatrix matrix)
     matrix2d m2;
     int i, j;
 
+    m2.rows = m2.cols = 3;
     for (i=0; i<3; i++)
     {
         for (j=0; j<3; j++)
@@ -491,6 +491,39 @@ quaternion q_sub(quaternion a, quaternion b)
     return (c);
 }
 
+//! Spherical linear interpolation of two quaternions
+/*! Interpolate at a constant rate along the shorter arc between two unit
+ * quaternions. Quaternions too close to each other for the arc to be
+ * worked out precisely are interpolated linearly and normalized.
+        \param q1 Unit quaternion at t = 0.
+        \param q2 Unit quaternion at t = 1.
+        \param t Fraction of the way from q1 to q2.
+        eturn Interpolated quaternion.
+*/
+quaternion q_slerp(quaternion q1, quaternion q2, double t)
+{
+    double c = inner_q(q1, q2);
+    if (c < 0.)
+    {
+        q2 = q_smult(-1., q2);
+        c = -c;
+    }
+
+    quaternion q;
+    if (c > .9995)
+    {
+        q = q_add(q_smult(1. - t, q1), q_smult(t, q2));
+        q = q_smult(1. / length_q(q), q);
+    }
+    else
+    {
+        double theta = acos(c);
+        double s = sin(theta);
+        q = q_add(q_smult(sin((1. - t) * theta) / s, q1), q_smult(sin(t * theta) / s, q2));
+    }
+    return (q);
+}
+
 
 // TODO: explain
 void qrotate(double ipos[3], double rpos[3], double angle, double *opos)
@@ -117,6 +117,7 @@ quaternion q_mult(quaternion q1, quaternion q2);
 quaternion q_smult(double a, quaternion q);
 quaternion q_add(quaternion q1, quaternion q2);
 quaternion q_sub(quaternion q1, quaternion q2);
+quaternion q_slerp(quaternion q1, quaternion q2, double t);
 quaternion q_euler2quaternion(avector rpw);
 quaternion q_axis2quaternion_cv(cvector v);
 quaternion q_axis2quaternion_rv(rvector v);
@@ -0,0 +1,615 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+#include "quaternionbatch.h"
+
+#include <cmath>
+
+// The AVX2 kernels are built for their own target and only called when the processor
+// has AVX2 and FMA, so the rest of the library keeps its own target.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QBATCH_AVX2
+#include <immintrin.h>
+#define QBATCH_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+static_assert(sizeof(rvector) == 3 * sizeof(double), "rvector must be 3 packed doubles");
+static_assert(sizeof(quaternion) == 4 * sizeof(double), "quaternion must be 4 packed doubles");
+static_assert(sizeof(rmatrix) == 9 * sizeof(double), "rmatrix must be 9 packed doubles");
+
+// Whether the processor can run the AVX2 kernels
+static bool simd_supported()
+{
+#ifdef QBATCH_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+static bool use_simd = simd_supported();
+
+//! Use the AVX2 kernels
+/*! Turn the AVX2 kernels on or off for all of the batch quaternion
+ * functions. They are on to begin with, if the processor has them.
+    \param enable True to use them, if the processor has them.
+    \return True if they are now in use.
+*/
+bool q_batch_simd(bool enable)
+{
+    use_simd = enable && simd_supported();
+    return use_simd;
+}
+
+// Matrix that rotates a vector as rotate_q does, or transforms it as transform_q does. It is
+// worked out from q without normalizing, so that like q v q* it scales by the length squared.
+static void rotation_matrix(const quaternion &q, bool transform, double m[9])
+{
+    double ww = q.w * q.w;
+    double xx = q.d.x * q.d.x;
+    double yy = q.d.y * q.d.y;
+    double zz = q.d.z * q.d.z;
+    double xy = 2. * q.d.x * q.d.y;
+    double xz = 2. * q.d.x * q.d.z;
+    double yz = 2. * q.d.y * q.d.z;
+    double wx = 2. * q.w * q.d.x;
+    double wy = 2. * q.w * q.d.y;
+    double wz = 2. * q.w * q.d.z;
+    if (transform)
+    {
+        wx = -wx;
+        wy = -wy;
+        wz = -wz;
+    }
+
+    m[0] = ww + xx - yy - zz;
+    m[1] = xy - wz;
+    m[2] = xz + wy;
+    m[3] = xy + wz;
+    m[4] = ww - xx + yy - zz;
+    m[5] = yz - wx;
+    m[6] = xz - wy;
+    m[7] = yz + wx;
+    m[8] = ww - xx - yy + zz;
+}
+
+// q v q*, or q* v q for transform, as w^2 - |u|^2 times v, plus 2 (u.v) u, plus 2 w u x v
+static void rotate_one(const quaternion &q, double sign, const rvector &v, rvector &r)
+{
+    double c = q.w * q.w - (q.d.x * q.d.x + q.d.y * q.d.y + q.d.z * q.d.z);
+    double d = 2. * (q.d.x * v.col[0] + q.d.y * v.col[1] + q.d.z * v.col[2]);
+    double e = 2. * sign * q.w;
+    double x = c * v.col[0] + d * q.d.x + e * (q.d.y * v.col[2] - q.d.z * v.col[1]);
+    double y = c * v.col[1] + d * q.d.y + e * (q.d.z * v.col[0] - q.d.x * v.col[2]);
+    double z = c * v.col[2] + d * q.d.z + e * (q.d.x * v.col[1] - q.d.y * v.col[0]);
+    r.col[0] = x;
+    r.col[1] = y;
+    r.col[2] = z;
+}
+
+// Same as q_mult, with the result able to be either argument
+static void mult_one(const quaternion &q1, const quaternion &q2, quaternion &r)
+{
+    quaternion o;
+    o.d.x = q1.w * q2.d.x + q1.d.x * q2.w + q1.d.y * q2.d.z - q1.d.z * q2.d.y;
+    o.d.y = q1.w * q2.d.y + q1.d.y * q2.w + q1.d.z * q2.d.x - q1.d.x * q2.d.z;
+    o.d.z = q1.w * q2.d.z + q1.d.z * q2.w + q1.d.x * q2.d.y - q1.d.y * q2.d.x;
+    o.w = q1.w * q2.w - q1.d.x * q2.d.x - q1.d.y * q2.d.y - q1.d.z * q2.d.z;
+    r = o;
+}
+
+// Direction cosine matrix of q, normalized as rm_quaternion2dcm does
+static void dcm_one(const quaternion &q, rmatrix &m)
+{
+    double n = q.w * q.w + q.d.x * q.d.x + q.d.y * q.d.y + q.d.z * q.d.z;
+    double s = n > 0. ? 2. / n : 0.;
+    double xx = s * q.d.x * q.d.x;
+    double yy = s * q.d.y * q.d.y;
+    double zz = s * q.d.z * q.d.z;
+    double xy = s * q.d.x * q.d.y;
+    double xz = s * q.d.x * q.d.z;
+    double yz = s * q.d.y * q.d.z;
+    double xw = s * q.d.x * q.w;
+    double yw = s * q.d.y * q.w;
+    double zw = s * q.d.z * q.w;
+
+    m.row[0].col[0] = 1. - yy - zz;
+    m.row[0].col[1] = xy - zw;
+    m.row[0].col[2] = xz + yw;
+    m.row[1].col[0] = xy + zw;
+    m.row[1].col[1] = 1. - xx - zz;
+    m.row[1].col[2] = yz - xw;
+    m.row[2].col[0] = xz - yw;
+    m.row[2].col[1] = yz + xw;
+    m.row[2].col[2] = 1. - xx - yy;
+}
+
+// Weights of q1 and q2 in the interpolation of q_slerp
+static void slerp_weights(const quaternion &q1, const quaternion &q2, double t, double &a, double &b)
+{
+    double c = q1.d.x * q2.d.x + q1.d.y * q2.d.y + q1.d.z * q2.d.z + q1.w * q2.w;
+    double sign = 1.;
+    if (c < 0.)
+    {
+        sign = -1.;
+        c = -c;
+    }
+
+    if (c > .9995)
+    {
+        a = 1. - t;
+        b = sign * t;
+        // Length of a q1 + b q2, for unit q1 and q2
+        double length = sqrt(a * a + t * t + 2. * a * t * c);
+        a /= length;
+        b /= length;
+    }
+    else
+    {
+        double theta = acos(c);
+        double s = sin(theta);
+        a = sin((1. - t) * theta) / s;
+        b = sign * sin(t * theta) / s;
+    }
+}
+
+#ifdef QBATCH_AVX2
+
+// Four rvectors, from three registers of packed x y z x | y z x y | z x y z, to one register each
+// of x, y and z
+QBATCH_TARGET static inline void load_rvectors(const double *v, __m256d &x, __m256d &y, __m256d &z)
+{
+    __m256d a = _mm256_loadu_pd(v);
+    __m256d b = _mm256_loadu_pd(v + 4);
+    __m256d c = _mm256_loadu_pd(v + 8);
+    __m256d p = _mm256_permute2f128_pd(a, c, 0x30);
+    __m256d q = _mm256_permute2f128_pd(a, c, 0x21);
+    x = _mm256_blend_pd(_mm256_blend_pd(p, q, 0xa), b, 0x4);
+    y = _mm256_permute_pd(_mm256_blend_pd(p, b, 0x9), 0x5);
+    z = _mm256_blend_pd(_mm256_blend_pd(q, b, 0x2), p, 0x8);
+}
+
+// The reverse of load_rvectors
+QBATCH_TARGET static inline void store_rvectors(double *v, __m256d x, __m256d y, __m256d z)
+{
+    __m256d ys = _mm256_permute_pd(y, 0x5);
+    __m256d p = _mm256_blend_pd(_mm256_blend_pd(x, ys, 0x6), z, 0x8);
+    __m256d q = _mm256_blend_pd(z, x, 0xa);
+    __m256d b = _mm256_blend_pd(_mm256_blend_pd(ys, z, 0x2), x, 0x4);
+    _mm256_storeu_pd(v, _mm256_permute2f128_pd(p, q, 0x20));
+    _mm256_storeu_pd(v + 4, b);
+    _mm256_storeu_pd(v + 8, _mm256_permute2f128_pd(q, p, 0x31));
+}
+
+// Four quaternions, to one register each of x, y, z and w
+QBATCH_TARGET static inline void load_quaternions(const double *q, __m256d &x, __m256d &y, __m256d &z, __m256d &w)
+{
+    __m256d r0 = _mm256_loadu_pd(q);
+    __m256d r1 = _mm256_loadu_pd(q + 4);
+    __m256d r2 = _mm256_loadu_pd(q + 8);
+    __m256d r3 = _mm256_loadu_pd(q + 12);
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    x = _mm256_permute2f128_pd(t0, t2, 0x20);
+    y = _mm256_permute2f128_pd(t1, t3, 0x20);
+    z = _mm256_permute2f128_pd(t0, t2, 0x31);
+    w = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+// Matrix times each vector, four at a time. Returns how many were done.
+QBATCH_TARGET static size_t apply_matrix_avx2(const double m[9], const rvector *v, rvector *r, size_t count)
+{
+    __m256d m0 = _mm256_set1_pd(m[0]), m1 = _mm256_set1_pd(m[1]), m2 = _mm256_set1_pd(m[2]);
+    __m256d m3 = _mm256_set1_pd(m[3]), m4 = _mm256_set1_pd(m[4]), m5 = _mm256_set1_pd(m[5]);
+    __m256d m6 = _mm256_set1_pd(m[6]), m7 = _mm256_set1_pd(m[7]), m8 = _mm256_set1_pd(m[8]);
+    size_t i = 0;
+    for (; i+4<=count; i+=4)
+    {
+        __m256d x, y, z;
+        load_rvectors(v[i].col, x, y, z);
+        __m256d rx = _mm256_fmadd_pd(m2, z, _mm256_fmadd_pd(m1, y, _mm256_mul_pd(m0, x)));
+        __m256d ry = _mm256_fmadd_pd(m5, z, _mm256_fmadd_pd(m4, y, _mm256_mul_pd(m3, x)));
+        __m256d rz = _mm256_fmadd_pd(m8, z, _mm256_fmadd_pd(m7, y, _mm256_mul_pd(m6, x)));
+        store_rvectors(r[i].col, rx, ry, rz);
+    }
+    return i;
+}
+
+// rotate_one, four at a time. Returns how many were done.
+QBATCH_TARGET static size_t rotate_avx2(const quaternion *q, double sign, const rvector *v, rvector *r, size_t count)
+{
+    __m256d two = _mm256_set1_pd(2.);
+    __m256d twosign = _mm256_set1_pd(2. * sign);
+    size_t i = 0;
+    for (; i+4<=count; i+=4)
+    {
+        __m256d qx, qy, qz, qw, vx, vy, vz;
+        load_quaternions(&q[i].d.x, qx, qy, qz, qw);
+        load_rvectors(v[i].col, vx, vy, vz);
+        __m256d uu = _mm256_fmadd_pd(qz, qz, _mm256_fmadd_pd(qy, qy, _mm256_mul_pd(qx, qx)));
+        __m256d c = _mm256_fmsub_pd(qw, qw, uu);
+        __m256d d = _mm256_mul_pd(two, _mm256_fmadd_pd(qz, vz, _mm256_fmadd_pd(qy, vy, _mm256_mul_pd(qx, vx))));
+        __m256d e = _mm256_mul_pd(twosign, qw);
+        __m256d cx = _mm256_fmsub_pd(qy, vz, _mm256_mul_pd(qz, vy));
+        __m256d cy = _mm256_fmsub_pd(qz, vx, _mm256_mul_pd(qx, vz));
+        __m256d cz = _mm256_fmsub_pd(qx, vy, _mm256_mul_pd(qy, vx));
+        __m256d rx = _mm256_fmadd_pd(e, cx, _mm256_fmadd_pd(d, qx, _mm256_mul_pd(c, vx)));
+        __m256d ry = _mm256_fmadd_pd(e, cy, _mm256_fmadd_pd(d, qy, _mm256_mul_pd(c, vy)));
+        __m256d rz = _mm256_fmadd_pd(e, cz, _mm256_fmadd_pd(d, qz, _mm256_mul_pd(c, vz)));
+        store_rvectors(r[i].col, rx, ry, rz);
+    }
+    return i;
+}
+
+// One quaternion product, with q1 split into its elements and x, y and z already carrying the
+// signs of the permuted q2 they multiply. Lanes are x y z w.
+QBATCH_TARGET static inline __m256d product_avx2(__m256d x1, __m256d y1, __m256d z1, __m256d w1, __m256d q2)
+{
+    // w z y x, z w x y and y x w z of q2
+    __m256d o = _mm256_mul_pd(w1, q2);
+    o = _mm256_fmadd_pd(x1, _mm256_permute4x64_pd(q2, 0x1b), o);
+    o = _mm256_fmadd_pd(y1, _mm256_permute4x64_pd(q2, 0x4e), o);
+    return _mm256_fmadd_pd(z1, _mm256_permute_pd(q2, 0x5), o);
+}
+
+// Signs of x, y and z of q1 against the permuted q2 in product_avx2
+#define QBATCH_SIGNX _mm256_setr_pd(1., -1., 1., -1.)
+#define QBATCH_SIGNY _mm256_setr_pd(1., 1., -1., -1.)
+#define QBATCH_SIGNZ _mm256_setr_pd(-1., 1., 1., -1.)
+
+// One quaternion times each quaternion. Returns how many were done.
+QBATCH_TARGET static size_t mult_one_avx2(const quaternion &q1, const quaternion *q2, quaternion *r, size_t count)
+{
+    __m256d x1 = _mm256_mul_pd(_mm256_set1_pd(q1.d.x), QBATCH_SIGNX);
+    __m256d y1 = _mm256_mul_pd(_mm256_set1_pd(q1.d.y), QBATCH_SIGNY);
+    __m256d z1 = _mm256_mul_pd(_mm256_set1_pd(q1.d.z), QBATCH_SIGNZ);
+    __m256d w1 = _mm256_set1_pd(q1.w);
+    for (size_t i=0; i<count; ++i)
+    {
+        _mm256_storeu_pd(&r[i].d.x, product_avx2(x1, y1, z1, w1, _mm256_loadu_pd(&q2[i].d.x)));
+    }
+    return count;
+}
+
+// Each quaternion times each quaternion. Returns how many were done.
+QBATCH_TARGET static size_t mult_avx2(const quaternion *q1, const quaternion *q2, quaternion *r, size_t count)
+{
+    __m256d signx = QBATCH_SIGNX;
+    __m256d signy = QBATCH_SIGNY;
+    __m256d signz = QBATCH_SIGNZ;
+    for (size_t i=0; i<count; ++i)
+    {
+        __m256d a = _mm256_loadu_pd(&q1[i].d.x);
+        __m256d x1 = _mm256_mul_pd(_mm256_permute4x64_pd(a, 0x00), signx);
+        __m256d y1 = _mm256_mul_pd(_mm256_permute4x64_pd(a, 0x55), signy);
+        __m256d z1 = _mm256_mul_pd(_mm256_permute4x64_pd(a, 0xaa), signz);
+        __m256d w1 = _mm256_permute4x64_pd(a, 0xff);
+        _mm256_storeu_pd(&r[i].d.x, product_avx2(x1, y1, z1, w1, _mm256_loadu_pd(&q2[i].d.x)));
+    }
+    return count;
+}
+
+// Conjugate of each quaternion. Returns how many were done.
+QBATCH_TARGET static size_t conjugate_avx2(const quaternion *q, quaternion *r, size_t count)
+{
+    __m256d sign = _mm256_setr_pd(-0., -0., -0., 0.);
+    for (size_t i=0; i<count; ++i)
+    {
+        _mm256_storeu_pd(&r[i].d.x, _mm256_xor_pd(_mm256_loadu_pd(&q[i].d.x), sign));
+    }
+    return count;
+}
+
+// dcm_one, four at a time. Returns how many were done.
+QBATCH_TARGET static size_t dcm_avx2(const quaternion *q, rmatrix *m, size_t count)
+{
+    __m256d one = _mm256_set1_pd(1.);
+    __m256d two = _mm256_set1_pd(2.);
+    __m256d zero = _mm256_setzero_pd();
+    alignas(32) double e[9][4];
+    size_t i = 0;
+    for (; i+4<=count; i+=4)
+    {
+        __m256d x, y, z, w;
+        load_quaternions(&q[i].d.x, x, y, z, w);
+        __m256d n = _mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_fmadd_pd(x, x, _mm256_mul_pd(w, w))));
+        __m256d s = _mm256_and_pd(_mm256_div_pd(two, n), _mm256_cmp_pd(n, zero, _CMP_GT_OQ));
+        __m256d sx = _mm256_mul_pd(s, x);
+        __m256d sy = _mm256_mul_pd(s, y);
+        __m256d sz = _mm256_mul_pd(s, z);
+        __m256d xx = _mm256_mul_pd(sx, x);
+        __m256d yy = _mm256_mul_pd(sy, y);
+        __m256d zz = _mm256_mul_pd(sz, z);
+        __m256d xy = _mm256_mul_pd(sx, y);
+        __m256d xz = _mm256_mul_pd(sx, z);
+        __m256d yz = _mm256_mul_pd(sy, z);
+        __m256d xw = _mm256_mul_pd(sx, w);
+        __m256d yw = _mm256_mul_pd(sy, w);
+        __m256d zw = _mm256_mul_pd(sz, w);
+        _mm256_store_pd(e[0], _mm256_sub_pd(_mm256_sub_pd(one, yy), zz));
+        _mm256_store_pd(e[1], _mm256_sub_pd(xy, zw));
+        _mm256_store_pd(e[2], _mm256_add_pd(xz, yw));
+        _mm256_store_pd(e[3], _mm256_add_pd(xy, zw));
+        _mm256_store_pd(e[4], _mm256_sub_pd(_mm256_sub_pd(one, xx), zz));
+        _mm256_store_pd(e[5], _mm256_sub_pd(yz, xw));
+        _mm256_store_pd(e[6], _mm256_sub_pd(xz, yw));
+        _mm256_store_pd(e[7], _mm256_add_pd(yz, xw));
+        _mm256_store_pd(e[8], _mm256_sub_pd(_mm256_sub_pd(one, xx), yy));
+        for (size_t j=0; j<4; ++j)
+        {
+            double *r = m[i+j].row[0].col;
+            for (size_t k=0; k<9; ++k)
+            {
+                r[k] = e[k][j];
+            }
+        }
+    }
+    return i;
+}
+
+// a q1 + b q2 for each quaternion, with the weights already worked out. Returns how many were done.
+QBATCH_TARGET static size_t combine_avx2(const quaternion *q1, const quaternion *q2, const double *a, const double *b, quaternion *r, size_t count)
+{
+    for (size_t i=0; i<count; ++i)
+    {
+        __m256d o = _mm256_mul_pd(_mm256_set1_pd(b[i]), _mm256_loadu_pd(&q2[i].d.x));
+        _mm256_storeu_pd(&r[i].d.x, _mm256_fmadd_pd(_mm256_set1_pd(a[i]), _mm256_loadu_pd(&q1[i].d.x), o));
+    }
+    return count;
+}
+
+#endif
+
+// rotation_matrix times each vector
+static void apply_matrix(const double m[9], const rvector *v, rvector *r, size_t count)
+{
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = apply_matrix_avx2(m, v, r, count);
+    }
+#endif
+    for (; i<count; ++i)
+    {
+        double x = m[0] * v[i].col[0] + m[1] * v[i].col[1] + m[2] * v[i].col[2];
+        double y = m[3] * v[i].col[0] + m[4] * v[i].col[1] + m[5] * v[i].col[2];
+        double z = m[6] * v[i].col[0] + m[7] * v[i].col[1] + m[8] * v[i].col[2];
+        r[i].col[0] = x;
+        r[i].col[1] = y;
+        r[i].col[2] = z;
+    }
+}
+
+// rotate_one for each quaternion and vector
+static void rotate_each(const std::vector<quaternion> &q, double sign, const std::vector<rvector> &v, std::vector<rvector> &result)
+{
+    size_t count = q.size() < v.size() ? q.size() : v.size();
+    result.resize(count);
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = rotate_avx2(q.data(), sign, v.data(), result.data(), count);
+    }
+#endif
+    for (; i<count; ++i)
+    {
+        rotate_one(q[i], sign, v[i], result[i]);
+    }
+}
+
+//! Rotate row vectors using a quaternion
+/*! Rotate each row vector as ::rotate_q does, by the same quaternion.
+        \param q Quaternion representing the rotation.
+        \param v Row vectors to be rotated.
+        \param result Rotated row vectors, as many as in v.
+*/
+void rotate_q(quaternion q, const std::vector<rvector> &v, std::vector<rvector> &result)
+{
+    double m[9];
+    rotation_matrix(q, false, m);
+    result.resize(v.size());
+    apply_matrix(m, v.data(), result.data(), v.size());
+}
+
+//! Rotate row vectors using quaternions
+/*! Rotate each row vector as ::rotate_q does, by the quaternion of the
+ * same index.
+        \param q Quaternions representing the rotations.
+        \param v Row vectors to be rotated.
+        \param result Rotated row vectors.
+*/
+void rotate_q(const std::vector<quaternion> &q, const std::vector<rvector> &v, std::vector<rvector> &result)
+{
+    rotate_each(q, 1., v, result);
+}
+
+//! Transform row vectors using a quaternion
+/*! Transform each row vector as ::transform_q does, by the same
+ * quaternion.
+        \param q Quaternion representing the transformation.
+        \param v Row vectors to be transformed.
+        \param result Transformed row vectors, as many as in v.
+*/
+void transform_q(quaternion q, const std::vector<rvector> &v, std::vector<rvector> &result)
+{
+    double m[9];
+    rotation_matrix(q, true, m);
+    result.resize(v.size());
+    apply_matrix(m, v.data(), result.data(), v.size());
+}
+
+//! Transform row vectors using quaternions
+/*! Transform each row vector as ::transform_q does, by the quaternion of
+ * the same index.
+        \param q Quaternions representing the transformations.
+        \param v Row vectors to be transformed.
+        \param result Transformed row vectors.
+*/
+void transform_q(const std::vector<quaternion> &q, const std::vector<rvector> &v, std::vector<rvector> &result)
+{
+    rotate_each(q, -1., v, result);
+}
+
+//! Multiply quaternions by a quaternion
+/*! Left multiply each quaternion by the same quaternion, as ::q_mult does.
+        \param q1 Quaternion on the left.
+        \param q2 Quaternions on the right.
+        \param result Products, as many as in q2.
+*/
+void q_mult(quaternion q1, const std::vector<quaternion> &q2, std::vector<quaternion> &result)
+{
+    result.resize(q2.size());
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = mult_one_avx2(q1, q2.data(), result.data(), q2.size());
+    }
+#endif
+    for (; i<q2.size(); ++i)
+    {
+        mult_one(q1, q2[i], result[i]);
+    }
+}
+
+//! Multiply quaternions by quaternions
+/*! Multiply each pair of quaternions of the same index, as ::q_mult does.
+        \param q1 Quaternions on the left.
+        \param q2 Quaternions on the right.
+        \param result Products.
+*/
+void q_mult(const std::vector<quaternion> &q1, const std::vector<quaternion> &q2, std::vector<quaternion> &result)
+{
+    size_t count = q1.size() < q2.size() ? q1.size() : q2.size();
+    result.resize(count);
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = mult_avx2(q1.data(), q2.data(), result.data(), count);
+    }
+#endif
+    for (; i<count; ++i)
+    {
+        mult_one(q1[i], q2[i], result[i]);
+    }
+}
+
+//! Conjugate quaternions
+/*! Conjugate each quaternion, as ::q_conjugate does.
+        \param q Quaternions to conjugate.
+        \param result Conjugates, as many as in q.
+*/
+void q_conjugate(const std::vector<quaternion> &q, std::vector<quaternion> &result)
+{
+    result.resize(q.size());
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = conjugate_avx2(q.data(), result.data(), q.size());
+    }
+#endif
+    for (; i<q.size(); ++i)
+    {
+        result[i].d.x = -q[i].d.x;
+        result[i].d.y = -q[i].d.y;
+        result[i].d.z = -q[i].d.z;
+        result[i].w = q[i].w;
+    }
+}
+
+//! Quaternions to Direction Cosine Matrices
+/*! Convert each quaternion to a direction cosine matrix, as
+ * ::rm_quaternion2dcm does. Quaternions need not be normalized.
+        \param q Quaternions to convert.
+        \param result Direction cosine matrices, as many as in q.
+*/
+void rm_quaternion2dcm(const std::vector<quaternion> &q, std::vector<rmatrix> &result)
+{
+    result.resize(q.size());
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = dcm_avx2(q.data(), result.data(), q.size());
+    }
+#endif
+    for (; i<q.size(); ++i)
+    {
+        dcm_one(q[i], result[i]);
+    }
+}
+
+//! Spherical linear interpolation of quaternions
+/*! Interpolate each pair of quaternions of the same index, as
+ * ::q_slerp does. The angles are worked out one at a time; only the
+ * weighting of the pairs is done four at a time.
+        \param q1 Unit quaternions at t = 0.
+        \param q2 Unit quaternions at t = 1.
+        \param t Fractions of the way from q1 to q2.
+        \param result Interpolated quaternions.
+*/
+void q_slerp(const std::vector<quaternion> &q1, const std::vector<quaternion> &q2, const std::vector<double> &t, std::vector<quaternion> &result)
+{
+    size_t count = q1.size() < q2.size() ? q1.size() : q2.size();
+    if (t.size() < count)
+    {
+        count = t.size();
+    }
+    std::vector<double> a(count);
+    std::vector<double> b(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        slerp_weights(q1[i], q2[i], t[i], a[i], b[i]);
+    }
+
+    result.resize(count);
+    size_t i = 0;
+#ifdef QBATCH_AVX2
+    if (use_simd)
+    {
+        i = combine_avx2(q1.data(), q2.data(), a.data(), b.data(), result.data(), count);
+    }
+#endif
+    for (; i<count; ++i)
+    {
+        quaternion o;
+        o.d.x = a[i] * q1[i].d.x + b[i] * q2[i].d.x;
+        o.d.y = a[i] * q1[i].d.y + b[i] * q2[i].d.y;
+        o.d.z = a[i] * q1[i].d.z + b[i] * q2[i].d.z;
+        o.w = a[i] * q1[i].w + b[i] * q2[i].w;
+        result[i] = o;
+    }
+}
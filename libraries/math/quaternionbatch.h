@@ -0,0 +1,61 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+// dependencies: vector, matrix, quaternion
+#ifndef _MATH_QUATERNIONBATCH_H
+#define _MATH_QUATERNIONBATCH_H
+
+//! \file quaternionbatch.h
+//! \brief Quaternion operations over whole arrays
+//! Each function does what the function of the same name does for one
+//! element, for every element of its arrays. Where two arrays are taken
+//! element by element, the result is as long as the shorter. The result
+//! may be one of the arrays given. On x86 processors with AVX2 and FMA,
+//! four elements are done at a time; otherwise, or if turned off with
+//! ::q_batch_simd, they are done one at a time. The two agree to rounding.
+
+#include "support/configCosmos.h"
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+
+#include <vector>
+
+void rotate_q(quaternion q, const std::vector<rvector> &v, std::vector<rvector> &result);
+void rotate_q(const std::vector<quaternion> &q, const std::vector<rvector> &v, std::vector<rvector> &result);
+void transform_q(quaternion q, const std::vector<rvector> &v, std::vector<rvector> &result);
+void transform_q(const std::vector<quaternion> &q, const std::vector<rvector> &v, std::vector<rvector> &result);
+void q_mult(quaternion q1, const std::vector<quaternion> &q2, std::vector<quaternion> &result);
+void q_mult(const std::vector<quaternion> &q1, const std::vector<quaternion> &q2, std::vector<quaternion> &result);
+void q_conjugate(const std::vector<quaternion> &q, std::vector<quaternion> &result);
+void rm_quaternion2dcm(const std::vector<quaternion> &q, std::vector<rmatrix> &result);
+void q_slerp(const std::vector<quaternion> &q1, const std::vector<quaternion> &q2, const std::vector<double> &t, std::vector<quaternion> &result);
+bool q_batch_simd(bool enable);
+
+#endif
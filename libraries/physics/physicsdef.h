@@ -61,6 +61,13 @@
 
 #define MAXGJORDER 15
 
+//! Parts of each step given by the streaming gauss_jackson_propagate and dormand_prince_propagate
+#define GJ_FIELD_ECI 0x01
+#define GJ_FIELD_GEOC 0x02
+#define GJ_FIELD_GEOD 0x04
+#define GJ_FIELD_ICRF 0x08
+#define GJ_FIELD_ALL 0x0f
+
 #define GRAVITY_PGM2000A 1
 #define GRAVITY_EGM2008 2
 #define GRAVITY_PGM2000A_NORM 3
@@ -78,7 +85,8 @@
 */
 typedef struct
 {
-	locstruc sloc;
+	//! ECI acceleration at this step
+	rvector acc;
 	double a[MAXGJORDER+1];
 	double b[MAXGJORDER+1];
 	rvector s;
@@ -106,8 +114,67 @@ typedef struct
 	uint32_t order;
 	uint32_t order2;
     std::vector<gjstruc> step;
+    //! Complete location at the newest step
+    locstruc loc;
+    //! Complete locations of every step, only while starting
+    std::vector<locstruc> sloc;
 } gj_handle;
 
+//! Dormand-Prince integration handle
+/*! Holds the state of an adaptive step Dormand-Prince 5(4) integration of an orbit, an
+ * alternative to Gauss-Jackson for orbits where a fixed step does not suit.
+ */
+typedef struct
+{
+    //! Relative and absolute error allowed per step
+    double rtol;
+    double atol;
+    //! Step to try next, and the limits on its size, in seconds
+    double h;
+    double hmin;
+    double hmax;
+    //! Complete location at the last step, with its ECI acceleration
+    locstruc loc;
+    //! Start (MJD) and length (seconds) of the last step, and its interpolant
+    double utc0;
+    double hlast;
+    double dense[5][6];
+    //! Steps accepted and rejected, and calls to the force model
+    uint32_t steps;
+    uint32_t rejected;
+    uint32_t evaluations;
+} dp_handle;
+
+//! Gauss-Jackson propagation step
+/*! The parts of one step handed out by the streaming gauss_jackson_propagate, or by
+ * dormand_prince_propagate. Only those asked for with GJ_FIELD_* are filled in.
+*/
+typedef struct
+{
+    double utc;
+    cartpos eci;
+    cartpos geoc;
+    geoidpos geod;
+    qatt icrf;
+} gj_sample;
+
+struct cosmosdatastruc;
+
+//! Node stepped by simulate_nodes
+/*! One of many nodes whose physics and hardware are stepped together.
+ */
+typedef struct
+{
+    //! The node, with its physics and location
+    cosmosdatastruc *cdata;
+    //! Its orbit and attitude, from gauss_jackson_init
+    gj_handle gjh;
+    //! Its stream of random numbers, from random_seed
+    uint64_t random;
+    //! Steps taken by the last simulate_nodes
+    int32_t steps;
+} simnodestruc;
+
 //! Physics Simulation Structure
 /*! Holds parameters used specifically for the physical simulation of the
  * environment and hardware of a Node.
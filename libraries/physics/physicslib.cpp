@@ -31,15 +31,20 @@
 #include "support/timelib.h"
 #include "support/datalib.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #define MAXDEGREE 360
 #define ASTEP 1
 
 static double ftl[2*MAXDEGREE+1];
 static int cmodel = -1;
 static double coef[MAXDEGREE+1][MAXDEGREE+1][2];
-static double spmm[MAXDEGREE+1];
-static double lastx = 10.;
-static uint16_t lastm = 65535;
+static std::mutex gravity_mutex;
+static thread_local double spmm[MAXDEGREE+1];
+static thread_local double lastx = 10.;
+static thread_local uint16_t lastm = 65535;
 static double initialutc;
 static std::string orbitfile;
 static stkstruc stkhandle;
@@ -47,9 +52,12 @@ static stkstruc stkhandle;
 static locstruc sloc[MAXGJORDER+2];
 
 //! Data structures for spherical harmonic expansion
-/*! Coefficients for real and imaginary components of expansion. Of order and rank MAXDEGREE
+/*! Coefficients for real and imaginary components of expansion, in rows of ::harmonic_row. One
+ * buffer for each thread, so nodes can be simulated in parallel, kept on the heap and sized on
+ * first use to the rows the degree needs.
 */
-static double vc[MAXDEGREE+1][MAXDEGREE+1], wc[MAXDEGREE+1][MAXDEGREE+1];
+typedef double harmonic_row[MAXDEGREE+2];
+static thread_local std::vector<double> harmonic;
 
 //! Spherical harmonic  gravitational vector
 /*!
@@ -74,9 +82,11 @@ rvector gravity_accel(posstruc pos,int model,uint32_t degree)
     //double dc[5][4], ds[5][4];
     //static double co[5][4][2] = {{{-9999.}}};
 
-    // Zero out vc and wc
-    memset(vc,0,sizeof(vc));
-    memset(wc,0,sizeof(wc));
+    // Zero out the rows of vc and wc that are used, growing this thread's buffer if need be
+    size_t rows = degree + 2;
+    harmonic.assign(2 * rows * (MAXDEGREE+2), 0.);
+    harmonic_row *vc = reinterpret_cast<harmonic_row *>(harmonic.data());
+    harmonic_row *wc = vc + rows;
 
     // Load Params
     gravity_params(model);
@@ -704,6 +714,8 @@ int32_t gravity_params(int model)
     uint32_t dil, dim;
     double dummy1, dummy2;
 
+    std::lock_guard<std::mutex> lock(gravity_mutex);
+
     // Calculate factorial
     if (ftl[0] == 0.)
     {
@@ -935,6 +947,78 @@ void simulate_hardware(cosmosdatastruc &cdata, vector <locstruc> &locvec)
     }
 }
 
+//! Run a set of tasks across threads, handing out task indices as threads become free.
+static void simulate_run(size_t count, uint16_t threads, std::function<void(size_t)> task)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next++) < count)
+        {
+            task(index);
+        }
+    };
+
+    if (threads < 2)
+    {
+        worker();
+        return;
+    }
+
+    vector<thread> pool;
+    for (uint16_t i=0; i<threads; ++i)
+    {
+        pool.push_back(thread(worker));
+    }
+    for (thread &worker_thread : pool)
+    {
+        worker_thread.join();
+    }
+}
+
+//! Simulate many nodes
+/*! Step the orbit and attitude of each node to the indicated time, one Gauss-Jackson step at
+ * a time, simulating its hardware after each step, as agent_physics does for its one node. The
+ * nodes are stepped in parallel, each node by one thread at a time, handed out as threads
+ * become free. While a node is stepped, the random numbers of ::gaussian_random come from its
+ * own stream, so the results do not depend on the number of threads.
+    \param nodes Nodes to step, each set up with gauss_jackson_init.
+    \param mjd Time to step to.
+    \param threads Number of threads to use. 0 or 1 steps the nodes in the calling thread.
+    \param step Called for the node after each step and its hardware, with its random stream in
+    use, for models of the caller's own such as sensor noise. May be nullptr.
+    \return Total number of steps taken.
+*/
+int32_t simulate_nodes(vector<simnodestruc> &nodes, double mjd, uint16_t threads, std::function<void(simnodestruc &node)> step)
+{
+    std::atomic<int32_t> total(0);
+    simulate_run(nodes.size(), threads, [&](size_t index)
+    {
+        simnodestruc &node = nodes[index];
+        cosmosdatastruc &cdata = *node.cdata;
+        random_stream(&node.random);
+        node.steps = 0;
+        double chunks = floor(.5 + 86400. * (mjd - node.gjh.loc.utc) / cdata.physics.dt);
+        while (node.steps < chunks)
+        {
+            if (gauss_jackson_propagate(node.gjh, cdata.physics, cdata.node.loc, node.gjh.loc.utc + cdata.physics.dt / 86400., nullptr) < 1)
+            {
+                break;
+            }
+            simulate_hardware(cdata, cdata.node.loc);
+            if (step != nullptr)
+            {
+                step(node);
+            }
+            ++node.steps;
+        }
+        random_stream(nullptr);
+        total += node.steps;
+    });
+    return total;
+}
+
 //! Simulate Hardware data - single
 /*! Simulate the behavior of all the hardware in the indicated satellite, at the
  * indicated location, assuming a timestep of dt.
@@ -2194,6 +2278,7 @@ void gauss_jackson_setup(gj_handle &gjh, uint32_t order, double utc, double &dt)
     double test;
 
     gjh.step.resize(order+2);
+    gjh.sloc.resize(order+2);
     gjh.binom.resize(order+2);
     gjh.beta.resize(order+2);
     gjh.alpha.resize(order+2);
@@ -2318,6 +2403,19 @@ void gauss_jackson_setup(gj_handle &gjh, uint32_t order, double utc, double &dt)
     }
 }
 
+// Once converged, only the accelerations of the starting steps are needed for the sums, and the
+// complete location of the newest one to go on from.
+static void gauss_jackson_settle(gj_handle &gjh)
+{
+    for (uint32_t k=0; k<=gjh.order+1; ++k)
+    {
+        gjh.step[k].acc = gjh.sloc[k].pos.eci.a;
+    }
+    gjh.loc = gjh.sloc[gjh.order];
+    gjh.sloc.clear();
+    gjh.sloc.shrink_to_fit();
+}
+
 //! Initialize Gauss-Jackson orbit using Two Line Elements
 /*! Initializes Gauss-Jackson structures using starting time and position from a Two
  * Line Element set.
@@ -2390,45 +2488,46 @@ void gauss_jackson_init_tle(gj_handle &gjh, uint32_t order, int32_t mode, double
     att_accel(cdata.physics, loc);
     //	groundstations(cdata,&loc);
 
-    gjh.step[gjh.order2].sloc = loc;
+    gjh.sloc[gjh.order2] = loc;
 
     // Position at t0-dt
     for (i=gjh.order2-1; i<gjh.order2; --i)
     {
-        gjh.step[i].sloc = gjh.step[i+1].sloc;
-        gjh.step[i].sloc.utc -= dt / 86400.;
-		lines2eci(gjh.step[i].sloc.utc,cdata.tle,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i] = gjh.sloc[i+1];
+        gjh.sloc[i].utc -= dt / 86400.;
+		lines2eci(gjh.sloc[i].utc,cdata.tle,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
+        pos_eci(&gjh.sloc[i]);
 
-        gjh.step[i].sloc.att.lvlh = gjh.step[i+1].sloc.att.lvlh;
-        att_lvlh2icrf(&gjh.step[i].sloc);
+        gjh.sloc[i].att.lvlh = gjh.sloc[i+1].att.lvlh;
+        att_lvlh2icrf(&gjh.sloc[i]);
 
-        pos_accel(cdata.physics, gjh.step[i].sloc);
+        pos_accel(cdata.physics, gjh.sloc[i]);
         // Initialize hardware
-        hardware_init_eci(cdata.devspec,gjh.step[i].sloc);
-        att_accel(cdata.physics, gjh.step[i].sloc);
+        hardware_init_eci(cdata.devspec,gjh.sloc[i]);
+        att_accel(cdata.physics, gjh.sloc[i]);
     }
 
     for (i=gjh.order2+1; i<=gjh.order; i++)
     {
-        gjh.step[i].sloc = gjh.step[i-1].sloc;
-        gjh.step[i].sloc.utc += dt / 86400.;
-		lines2eci(gjh.step[i].sloc.utc,cdata.tle,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i] = gjh.sloc[i-1];
+        gjh.sloc[i].utc += dt / 86400.;
+		lines2eci(gjh.sloc[i].utc,cdata.tle,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
+        pos_eci(&gjh.sloc[i]);
 
-        gjh.step[i].sloc.att.lvlh = gjh.step[i-1].sloc.att.lvlh;
-        att_lvlh2icrf(&gjh.step[i].sloc);
+        gjh.sloc[i].att.lvlh = gjh.sloc[i-1].att.lvlh;
+        att_lvlh2icrf(&gjh.sloc[i]);
 
-        pos_accel(cdata.physics, gjh.step[i].sloc);
+        pos_accel(cdata.physics, gjh.sloc[i]);
         // Initialize hardware
-        hardware_init_eci(cdata.devspec,gjh.step[i].sloc);
-        att_accel(cdata.physics, gjh.step[i].sloc);
+        hardware_init_eci(cdata.devspec,gjh.sloc[i]);
+        att_accel(cdata.physics, gjh.sloc[i]);
     }
 
     loc = gauss_jackson_converge_orbit(gjh, cdata.physics);
     gauss_jackson_converge_hardware(gjh, cdata.physics);
+    gauss_jackson_settle(gjh);
 
     cdata.physics.mjdbase = loc.utc;
 
@@ -2462,7 +2561,7 @@ void gauss_jackson_init_eci(gj_handle &gjh, uint32_t order, int32_t mode, double
     physics.mode = mode;
 
     pos_clear(loc);
-    gjh.step[gjh.order+1].sloc = loc;
+    gjh.sloc[gjh.order+1] = loc;
     ipos.pass = iatt.pass = 0;
     loc.pos.eci = ipos;
     loc.pos.eci.pass++;
@@ -2516,16 +2615,16 @@ void gauss_jackson_init_eci(gj_handle &gjh, uint32_t order, int32_t mode, double
     //    simulate_hardware(cdata, loc);
     att_accel(physics, loc);
 
-    gjh.step[gjh.order2].sloc = loc;
+    gjh.sloc[gjh.order2] = loc;
 
     // Position at t0-dt
 	eci2kep(loc.pos.eci,kep);
-    //	kep2eci(&kep,&gjh.step[gjh.order2].sloc.pos.eci);
+    //	kep2eci(&kep,&gjh.sloc[gjh.order2].pos.eci);
     for (i=gjh.order2-1; i<gjh.order2; --i)
     {
-        gjh.step[i].sloc = gjh.step[i+1].sloc;
-        gjh.step[i].sloc.utc -= dt / 86400.;
-        kep.utc = gjh.step[i].sloc.att.icrf.utc = gjh.step[i].sloc.utc;
+        gjh.sloc[i] = gjh.sloc[i+1];
+        gjh.sloc[i].utc -= dt / 86400.;
+        kep.utc = gjh.sloc[i].att.icrf.utc = gjh.sloc[i].utc;
         kep.ma -= dt * kep.mm;
 
         uint16_t count = 0;
@@ -2534,30 +2633,30 @@ void gauss_jackson_init_eci(gj_handle &gjh, uint32_t order, int32_t mode, double
             dea = (kep.ea - kep.e * sin(kep.ea) - kep.ma) / (1. - kep.e * cos(kep.ea));
             kep.ea -= dea;
         } while (++count < 100 && fabs(dea) > .000001);
-		kep2eci(kep,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
+		kep2eci(kep,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
 
-        q1 = q_axis2quaternion_rv(rv_smult(-dt,gjh.step[i].sloc.att.icrf.v));
-        gjh.step[i].sloc.att.icrf.s = q_mult(q1,gjh.step[i].sloc.att.icrf.s);
-        normalize_q(&gjh.step[i].sloc.att.icrf.s);
+        q1 = q_axis2quaternion_rv(rv_smult(-dt,gjh.sloc[i].att.icrf.v));
+        gjh.sloc[i].att.icrf.s = q_mult(q1,gjh.sloc[i].att.icrf.s);
+        normalize_q(&gjh.sloc[i].att.icrf.s);
         // Calculate new v from da
-        gjh.step[i].sloc.att.icrf.v = rv_add(gjh.step[i].sloc.att.icrf.v,rv_smult(-dt,gjh.step[i].sloc.att.icrf.a));
-        //		gjh.step[i].sloc.att.icrf.utc -= dt/86400.;
-        //		att_icrf2lvlh(&gjh.step[i].sloc);
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i].att.icrf.v = rv_add(gjh.sloc[i].att.icrf.v,rv_smult(-dt,gjh.sloc[i].att.icrf.a));
+        //		gjh.sloc[i].att.icrf.utc -= dt/86400.;
+        //		att_icrf2lvlh(&gjh.sloc[i]);
+        pos_eci(&gjh.sloc[i]);
 
-        pos_accel(physics, gjh.step[i].sloc);
+        pos_accel(physics, gjh.sloc[i]);
         // Initialize hardware
-        //		hardware_init_eci(cdata.devspec,gjh.step[i].sloc);
-        att_accel(physics, gjh.step[i].sloc);
+        //		hardware_init_eci(cdata.devspec,gjh.sloc[i]);
+        att_accel(physics, gjh.sloc[i]);
     }
 
 	eci2kep(loc.pos.eci,kep);
     for (i=gjh.order2+1; i<=gjh.order; i++)
     {
-        gjh.step[i].sloc = gjh.step[i-1].sloc;
-        gjh.step[i].sloc.utc += dt / 86400.;
-        kep.utc = gjh.step[i].sloc.att.icrf.utc = gjh.step[i].sloc.utc;
+        gjh.sloc[i] = gjh.sloc[i-1];
+        gjh.sloc[i].utc += dt / 86400.;
+        kep.utc = gjh.sloc[i].att.icrf.utc = gjh.sloc[i].utc;
         kep.ma += dt * kep.mm;
 
         uint16_t count = 0;
@@ -2566,25 +2665,26 @@ void gauss_jackson_init_eci(gj_handle &gjh, uint32_t order, int32_t mode, double
             dea = (kep.ea - kep.e * sin(kep.ea) - kep.ma) / (1. - kep.e * cos(kep.ea));
             kep.ea -= dea;
         } while (++count < 100 && fabs(dea) > .000001);
-		kep2eci(kep,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
+		kep2eci(kep,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
 
-        q1 = q_axis2quaternion_rv(rv_smult(dt,gjh.step[i].sloc.att.icrf.v));
-        gjh.step[i].sloc.att.icrf.s = q_mult(q1,gjh.step[i].sloc.att.icrf.s);
-        normalize_q(&gjh.step[i].sloc.att.icrf.s);
+        q1 = q_axis2quaternion_rv(rv_smult(dt,gjh.sloc[i].att.icrf.v));
+        gjh.sloc[i].att.icrf.s = q_mult(q1,gjh.sloc[i].att.icrf.s);
+        normalize_q(&gjh.sloc[i].att.icrf.s);
         // Calculate new v from da
-        gjh.step[i].sloc.att.icrf.v = rv_add(gjh.step[i].sloc.att.icrf.v,rv_smult(dt,gjh.step[i].sloc.att.icrf.a));
-        //		gjh.step[i].sloc.att.icrf.utc += dt/86400.;
-        //		att_icrf2lvlh(&gjh.step[i].sloc);
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i].att.icrf.v = rv_add(gjh.sloc[i].att.icrf.v,rv_smult(dt,gjh.sloc[i].att.icrf.a));
+        //		gjh.sloc[i].att.icrf.utc += dt/86400.;
+        //		att_icrf2lvlh(&gjh.sloc[i]);
+        pos_eci(&gjh.sloc[i]);
 
-        pos_accel(physics, gjh.step[i].sloc);
+        pos_accel(physics, gjh.sloc[i]);
         // Initialize hardware
-        //		hardware_init_eci(cdata.devspec, gjh.step[i].sloc);
-        att_accel(physics, gjh.step[i].sloc);
+        //		hardware_init_eci(cdata.devspec, gjh.sloc[i]);
+        att_accel(physics, gjh.sloc[i]);
     }
     loc = gauss_jackson_converge_orbit(gjh, physics);
     gauss_jackson_converge_hardware(gjh, physics);
+    gauss_jackson_settle(gjh);
     physics.mjdbase = loc.utc;
 }
 
@@ -2598,7 +2698,7 @@ void gauss_jackson_init_stk(gj_handle &gjh, uint32_t order, int32_t mode, double
     physics.dtj = physics.dt/86400.;
 
     pos_clear(loc);
-    gjh.step[gjh.order+1].sloc = loc;
+    gjh.sloc[gjh.order+1] = loc;
 	stk2eci(utc,stk,loc.pos.eci);
     loc.att.icrf.utc = utc;
     loc.pos.eci.pass++;
@@ -2648,45 +2748,46 @@ void gauss_jackson_init_stk(gj_handle &gjh, uint32_t order, int32_t mode, double
     att_accel(physics, loc);
     //	groundstations(cdata,&loc);
 
-    gjh.step[gjh.order2].sloc = loc;
+    gjh.sloc[gjh.order2] = loc;
 
     // Position at t0-dt
     for (i=gjh.order2-1; i<gjh.order2; --i)
     {
-        gjh.step[i].sloc = gjh.step[i+1].sloc;
-        gjh.step[i].sloc.utc -= dt / 86400.;
-        gjh.step[i].sloc.att.icrf.utc = gjh.step[i].sloc.utc;
-		stk2eci(gjh.step[i].sloc.utc,stk,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i] = gjh.sloc[i+1];
+        gjh.sloc[i].utc -= dt / 86400.;
+        gjh.sloc[i].att.icrf.utc = gjh.sloc[i].utc;
+		stk2eci(gjh.sloc[i].utc,stk,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
+        pos_eci(&gjh.sloc[i]);
 
-        gjh.step[i].sloc.att.lvlh = gjh.step[i+1].sloc.att.lvlh;
-        att_lvlh2icrf(&gjh.step[i].sloc);
+        gjh.sloc[i].att.lvlh = gjh.sloc[i+1].att.lvlh;
+        att_lvlh2icrf(&gjh.sloc[i]);
 
         // Initialize hardware
-        //        hardware_init_eci(physics.devspec,gjh.step[i].sloc);
-        att_accel(physics, gjh.step[i].sloc);
+        //        hardware_init_eci(physics.devspec,gjh.sloc[i]);
+        att_accel(physics, gjh.sloc[i]);
     }
 
     for (i=gjh.order2+1; i<=gjh.order; i++)
     {
-        gjh.step[i].sloc = gjh.step[i-1].sloc;
-        gjh.step[i].sloc.utc += dt / 86400.;
-		stk2eci(gjh.step[i].sloc.utc,stk,gjh.step[i].sloc.pos.eci);
-        gjh.step[i].sloc.pos.eci.pass++;
-        pos_eci(&gjh.step[i].sloc);
+        gjh.sloc[i] = gjh.sloc[i-1];
+        gjh.sloc[i].utc += dt / 86400.;
+		stk2eci(gjh.sloc[i].utc,stk,gjh.sloc[i].pos.eci);
+        gjh.sloc[i].pos.eci.pass++;
+        pos_eci(&gjh.sloc[i]);
 
-        gjh.step[i].sloc.att.lvlh = gjh.step[i-1].sloc.att.lvlh;
-        gjh.step[i].sloc.att.lvlh.utc = gjh.step[i].sloc.utc;
-        att_lvlh2icrf(&gjh.step[i].sloc);
+        gjh.sloc[i].att.lvlh = gjh.sloc[i-1].att.lvlh;
+        gjh.sloc[i].att.lvlh.utc = gjh.sloc[i].utc;
+        att_lvlh2icrf(&gjh.sloc[i]);
 
         // Initialize hardware
-        //        hardware_init_eci(physics.devspec,gjh.step[i].sloc);
-        att_accel(physics, gjh.step[i].sloc);
+        //        hardware_init_eci(physics.devspec,gjh.sloc[i]);
+        att_accel(physics, gjh.sloc[i]);
     }
 
     loc = gauss_jackson_converge_orbit(gjh, physics);
     gauss_jackson_converge_hardware(gjh, physics);
+    gauss_jackson_settle(gjh);
     physics.mjdbase = loc.utc;
 }
 
@@ -2735,44 +2836,50 @@ locstruc gauss_jackson_converge_orbit(gj_handle &gjh, physicsstruc &physics)
     uint32_t c_cnt, cflag=0, k, n, i;
     rvector oldsa;
 
+    // Only possible while starting
+    if (gjh.sloc.size() < gjh.order+2)
+    {
+        return gjh.loc;
+    }
+
     c_cnt = 0;
     do
     {
-        gjh.step[gjh.order2].s.col[0] = gjh.step[gjh.order2].sloc.pos.eci.v.col[0]/gjh.dt;
-        gjh.step[gjh.order2].s.col[1] = gjh.step[gjh.order2].sloc.pos.eci.v.col[1]/gjh.dt;
-        gjh.step[gjh.order2].s.col[2] = gjh.step[gjh.order2].sloc.pos.eci.v.col[2]/gjh.dt;
+        gjh.step[gjh.order2].s.col[0] = gjh.sloc[gjh.order2].pos.eci.v.col[0]/gjh.dt;
+        gjh.step[gjh.order2].s.col[1] = gjh.sloc[gjh.order2].pos.eci.v.col[1]/gjh.dt;
+        gjh.step[gjh.order2].s.col[2] = gjh.sloc[gjh.order2].pos.eci.v.col[2]/gjh.dt;
         for (k=0; k<=gjh.order; k++)
         {
-            gjh.step[gjh.order2].s.col[0] -= gjh.step[gjh.order2].b[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-            gjh.step[gjh.order2].s.col[1] -= gjh.step[gjh.order2].b[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-            gjh.step[gjh.order2].s.col[2] -= gjh.step[gjh.order2].b[k] * gjh.step[k].sloc.pos.eci.a.col[2];
+            gjh.step[gjh.order2].s.col[0] -= gjh.step[gjh.order2].b[k] * gjh.sloc[k].pos.eci.a.col[0];
+            gjh.step[gjh.order2].s.col[1] -= gjh.step[gjh.order2].b[k] * gjh.sloc[k].pos.eci.a.col[1];
+            gjh.step[gjh.order2].s.col[2] -= gjh.step[gjh.order2].b[k] * gjh.sloc[k].pos.eci.a.col[2];
         }
         for (n=1; n<=gjh.order2; n++)
         {
-            gjh.step[gjh.order2+n].s.col[0] = gjh.step[gjh.order2+n-1].s.col[0] + (gjh.step[gjh.order2+n].sloc.pos.eci.a.col[0]+gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[0])/2;
-            gjh.step[gjh.order2+n].s.col[1] = gjh.step[gjh.order2+n-1].s.col[1] + (gjh.step[gjh.order2+n].sloc.pos.eci.a.col[1]+gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[1])/2;
-            gjh.step[gjh.order2+n].s.col[2] = gjh.step[gjh.order2+n-1].s.col[2] + (gjh.step[gjh.order2+n].sloc.pos.eci.a.col[2]+gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[2])/2;
-            gjh.step[gjh.order2-n].s.col[0] = gjh.step[gjh.order2-n+1].s.col[0] - (gjh.step[gjh.order2-n].sloc.pos.eci.a.col[0]+gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[0])/2;
-            gjh.step[gjh.order2-n].s.col[1] = gjh.step[gjh.order2-n+1].s.col[1] - (gjh.step[gjh.order2-n].sloc.pos.eci.a.col[1]+gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[1])/2;
-            gjh.step[gjh.order2-n].s.col[2] = gjh.step[gjh.order2-n+1].s.col[2] - (gjh.step[gjh.order2-n].sloc.pos.eci.a.col[2]+gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[2])/2;
+            gjh.step[gjh.order2+n].s.col[0] = gjh.step[gjh.order2+n-1].s.col[0] + (gjh.sloc[gjh.order2+n].pos.eci.a.col[0]+gjh.sloc[gjh.order2+n-1].pos.eci.a.col[0])/2;
+            gjh.step[gjh.order2+n].s.col[1] = gjh.step[gjh.order2+n-1].s.col[1] + (gjh.sloc[gjh.order2+n].pos.eci.a.col[1]+gjh.sloc[gjh.order2+n-1].pos.eci.a.col[1])/2;
+            gjh.step[gjh.order2+n].s.col[2] = gjh.step[gjh.order2+n-1].s.col[2] + (gjh.sloc[gjh.order2+n].pos.eci.a.col[2]+gjh.sloc[gjh.order2+n-1].pos.eci.a.col[2])/2;
+            gjh.step[gjh.order2-n].s.col[0] = gjh.step[gjh.order2-n+1].s.col[0] - (gjh.sloc[gjh.order2-n].pos.eci.a.col[0]+gjh.sloc[gjh.order2-n+1].pos.eci.a.col[0])/2;
+            gjh.step[gjh.order2-n].s.col[1] = gjh.step[gjh.order2-n+1].s.col[1] - (gjh.sloc[gjh.order2-n].pos.eci.a.col[1]+gjh.sloc[gjh.order2-n+1].pos.eci.a.col[1])/2;
+            gjh.step[gjh.order2-n].s.col[2] = gjh.step[gjh.order2-n+1].s.col[2] - (gjh.sloc[gjh.order2-n].pos.eci.a.col[2]+gjh.sloc[gjh.order2-n+1].pos.eci.a.col[2])/2;
         }
-        gjh.step[gjh.order2].ss.col[0] = gjh.step[gjh.order2].sloc.pos.eci.s.col[0]/gjh.dtsq;
-        gjh.step[gjh.order2].ss.col[1] = gjh.step[gjh.order2].sloc.pos.eci.s.col[1]/gjh.dtsq;
-        gjh.step[gjh.order2].ss.col[2] = gjh.step[gjh.order2].sloc.pos.eci.s.col[2]/gjh.dtsq;
+        gjh.step[gjh.order2].ss.col[0] = gjh.sloc[gjh.order2].pos.eci.s.col[0]/gjh.dtsq;
+        gjh.step[gjh.order2].ss.col[1] = gjh.sloc[gjh.order2].pos.eci.s.col[1]/gjh.dtsq;
+        gjh.step[gjh.order2].ss.col[2] = gjh.sloc[gjh.order2].pos.eci.s.col[2]/gjh.dtsq;
         for (k=0; k<=gjh.order; k++)
         {
-            gjh.step[gjh.order2].ss.col[0] -= gjh.step[gjh.order2].a[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-            gjh.step[gjh.order2].ss.col[1] -= gjh.step[gjh.order2].a[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-            gjh.step[gjh.order2].ss.col[2] -= gjh.step[gjh.order2].a[k] * gjh.step[k].sloc.pos.eci.a.col[2];
+            gjh.step[gjh.order2].ss.col[0] -= gjh.step[gjh.order2].a[k] * gjh.sloc[k].pos.eci.a.col[0];
+            gjh.step[gjh.order2].ss.col[1] -= gjh.step[gjh.order2].a[k] * gjh.sloc[k].pos.eci.a.col[1];
+            gjh.step[gjh.order2].ss.col[2] -= gjh.step[gjh.order2].a[k] * gjh.sloc[k].pos.eci.a.col[2];
         }
         for (n=1; n<=gjh.order2; n++)
         {
-            gjh.step[gjh.order2+n].ss.col[0] = gjh.step[gjh.order2+n-1].ss.col[0] + gjh.step[gjh.order2+n-1].s.col[0] + (gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[0])/2;
-            gjh.step[gjh.order2+n].ss.col[1] = gjh.step[gjh.order2+n-1].ss.col[1] + gjh.step[gjh.order2+n-1].s.col[1] + (gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[1])/2;
-            gjh.step[gjh.order2+n].ss.col[2] = gjh.step[gjh.order2+n-1].ss.col[2] + gjh.step[gjh.order2+n-1].s.col[2] + (gjh.step[gjh.order2+n-1].sloc.pos.eci.a.col[2])/2;
-            gjh.step[gjh.order2-n].ss.col[0] = gjh.step[gjh.order2-n+1].ss.col[0] - gjh.step[gjh.order2-n+1].s.col[0] + (gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[0])/2;
-            gjh.step[gjh.order2-n].ss.col[1] = gjh.step[gjh.order2-n+1].ss.col[1] - gjh.step[gjh.order2-n+1].s.col[1] + (gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[1])/2;
-            gjh.step[gjh.order2-n].ss.col[2] = gjh.step[gjh.order2-n+1].ss.col[2] - gjh.step[gjh.order2-n+1].s.col[2] + (gjh.step[gjh.order2-n+1].sloc.pos.eci.a.col[2])/2;
+            gjh.step[gjh.order2+n].ss.col[0] = gjh.step[gjh.order2+n-1].ss.col[0] + gjh.step[gjh.order2+n-1].s.col[0] + (gjh.sloc[gjh.order2+n-1].pos.eci.a.col[0])/2;
+            gjh.step[gjh.order2+n].ss.col[1] = gjh.step[gjh.order2+n-1].ss.col[1] + gjh.step[gjh.order2+n-1].s.col[1] + (gjh.sloc[gjh.order2+n-1].pos.eci.a.col[1])/2;
+            gjh.step[gjh.order2+n].ss.col[2] = gjh.step[gjh.order2+n-1].ss.col[2] + gjh.step[gjh.order2+n-1].s.col[2] + (gjh.sloc[gjh.order2+n-1].pos.eci.a.col[2])/2;
+            gjh.step[gjh.order2-n].ss.col[0] = gjh.step[gjh.order2-n+1].ss.col[0] - gjh.step[gjh.order2-n+1].s.col[0] + (gjh.sloc[gjh.order2-n+1].pos.eci.a.col[0])/2;
+            gjh.step[gjh.order2-n].ss.col[1] = gjh.step[gjh.order2-n+1].ss.col[1] - gjh.step[gjh.order2-n+1].s.col[1] + (gjh.sloc[gjh.order2-n+1].pos.eci.a.col[1])/2;
+            gjh.step[gjh.order2-n].ss.col[2] = gjh.step[gjh.order2-n+1].ss.col[2] - gjh.step[gjh.order2-n+1].s.col[2] + (gjh.sloc[gjh.order2-n+1].pos.eci.a.col[2])/2;
         }
 
         for (n=0; n<=gjh.order; n++)
@@ -2782,12 +2889,12 @@ locstruc gauss_jackson_converge_orbit(gj_handle &gjh, physicsstruc &physics)
             gjh.step[n].sb = gjh.step[n].sa = rv_zero();
             for (k=0; k<=gjh.order; k++)
             {
-                gjh.step[n].sb.col[0] += gjh.step[n].b[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-                gjh.step[n].sa.col[0] += gjh.step[n].a[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-                gjh.step[n].sb.col[1] += gjh.step[n].b[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-                gjh.step[n].sa.col[1] += gjh.step[n].a[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-                gjh.step[n].sb.col[2] += gjh.step[n].b[k] * gjh.step[k].sloc.pos.eci.a.col[2];
-                gjh.step[n].sa.col[2] += gjh.step[n].a[k] * gjh.step[k].sloc.pos.eci.a.col[2];
+                gjh.step[n].sb.col[0] += gjh.step[n].b[k] * gjh.sloc[k].pos.eci.a.col[0];
+                gjh.step[n].sa.col[0] += gjh.step[n].a[k] * gjh.sloc[k].pos.eci.a.col[0];
+                gjh.step[n].sb.col[1] += gjh.step[n].b[k] * gjh.sloc[k].pos.eci.a.col[1];
+                gjh.step[n].sa.col[1] += gjh.step[n].a[k] * gjh.sloc[k].pos.eci.a.col[1];
+                gjh.step[n].sb.col[2] += gjh.step[n].b[k] * gjh.sloc[k].pos.eci.a.col[2];
+                gjh.step[n].sa.col[2] += gjh.step[n].a[k] * gjh.sloc[k].pos.eci.a.col[2];
             }
         }
 
@@ -2798,55 +2905,55 @@ locstruc gauss_jackson_converge_orbit(gj_handle &gjh, physicsstruc &physics)
                 cflag = 0;
 
                 // Save current acceleration for comparison with next iteration
-                oldsa.col[0] = gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[0];
-                oldsa.col[1] = gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[1];
-                oldsa.col[2] = gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[2];
+                oldsa.col[0] = gjh.sloc[gjh.order2+i*n].pos.eci.a.col[0];
+                oldsa.col[1] = gjh.sloc[gjh.order2+i*n].pos.eci.a.col[1];
+                oldsa.col[2] = gjh.sloc[gjh.order2+i*n].pos.eci.a.col[2];
 
                 // Calculate new probable position and velocity
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.v.col[0] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[0] + gjh.step[gjh.order2+i*n].sb.col[0]);
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.v.col[1] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[1] + gjh.step[gjh.order2+i*n].sb.col[1]);
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.v.col[2] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[2] + gjh.step[gjh.order2+i*n].sb.col[2]);
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.s.col[0] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[0] + gjh.step[gjh.order2+i*n].sa.col[0]);
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.s.col[1] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[1] + gjh.step[gjh.order2+i*n].sa.col[1]);
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.s.col[2] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[2] + gjh.step[gjh.order2+i*n].sa.col[2]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.v.col[0] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[0] + gjh.step[gjh.order2+i*n].sb.col[0]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.v.col[1] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[1] + gjh.step[gjh.order2+i*n].sb.col[1]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.v.col[2] = gjh.dt * (gjh.step[gjh.order2+i*n].s.col[2] + gjh.step[gjh.order2+i*n].sb.col[2]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.s.col[0] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[0] + gjh.step[gjh.order2+i*n].sa.col[0]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.s.col[1] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[1] + gjh.step[gjh.order2+i*n].sa.col[1]);
+                gjh.sloc[gjh.order2+i*n].pos.eci.s.col[2] = gjh.dtsq * (gjh.step[gjh.order2+i*n].ss.col[2] + gjh.step[gjh.order2+i*n].sa.col[2]);
 
                 // Perform conversions between different systems
-                gjh.step[gjh.order2+i*n].sloc.pos.eci.pass++;
-                pos_eci(&gjh.step[gjh.order2+i*n].sloc);
-                att_icrf2lvlh(&gjh.step[gjh.order2+i*n].sloc);
-                //		eci2earth(&gjh.step[gjh.order2+i*n].sloc.pos,&gjh.step[gjh.order2+i*n].sloc.att);
+                gjh.sloc[gjh.order2+i*n].pos.eci.pass++;
+                pos_eci(&gjh.sloc[gjh.order2+i*n]);
+                att_icrf2lvlh(&gjh.sloc[gjh.order2+i*n]);
+                //		eci2earth(&gjh.sloc[gjh.order2+i*n].pos,&gjh.sloc[gjh.order2+i*n].att);
 
                 // Calculate acceleration at new position
-                pos_accel(physics, gjh.step[gjh.order2+i*n].sloc);
-                //				hardware_init_eci(cdata.devspec,gjh.step[gjh.order2+i*n].sloc);
+                pos_accel(physics, gjh.sloc[gjh.order2+i*n]);
+                //				hardware_init_eci(cdata.devspec,gjh.sloc[gjh.order2+i*n]);
 
                 // Compare acceleration at new position to previous iteration
-                if (fabs(oldsa.col[0]-gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[0])>1e-14 || fabs(oldsa.col[1]-gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[1])>1e-14 || fabs(oldsa.col[2]-gjh.step[gjh.order2+i*n].sloc.pos.eci.a.col[2])>1e-14)
+                if (fabs(oldsa.col[0]-gjh.sloc[gjh.order2+i*n].pos.eci.a.col[0])>1e-14 || fabs(oldsa.col[1]-gjh.sloc[gjh.order2+i*n].pos.eci.a.col[1])>1e-14 || fabs(oldsa.col[2]-gjh.sloc[gjh.order2+i*n].pos.eci.a.col[2])>1e-14)
                     cflag = 1;
             }
         }
         c_cnt++;
     } while (c_cnt<10 && cflag);
 
-    return gjh.step[gjh.order].sloc;
+    return gjh.sloc[gjh.order];
 }
 
 void gauss_jackson_converge_hardware(gj_handle &gjh, physicsstruc &physics)
 {
-    for (uint16_t i=0; i<=gjh.order; ++i)
+    for (uint16_t i=0; i<=gjh.order && i<gjh.sloc.size(); ++i)
     {
-        //		simulate_hardware(cdata, gjh.step[i].sloc);
-        att_accel(physics, gjh.step[i].sloc);
+        //		simulate_hardware(cdata, gjh.sloc[i]);
+        att_accel(physics, gjh.sloc[i]);
     }
 }
 
-vector <locstruc> gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double tomjd)
+// Move a converged Gauss-Jackson integration on one step of dtuse seconds. Only the ECI
+// acceleration of each step in the history is needed for the sums; the complete location is
+// kept once, in gjh.loc, and updated in place.
+static void gauss_jackson_advance(gj_handle &gjh, physicsstruc &physics, double dtuse)
 {
-    uint32_t i,chunks , astep;
+    uint32_t astep;
     uint32_t j, k;
-    //	static quaternion qs[2]={{{0.,0.,0.},0.}};
-    //	static rvector alpha[2] = {{{0.,0.,0.}}};
-    //	static rvector omega[2] = {{{0.,0.,0.}}};
     quaternion q1, dsq, q2;
     dem_pixel val;
     rvector normal, unitv, unitx, unitp, unitp1, unitp2;
@@ -2854,256 +2961,659 @@ vector <locstruc> gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics,
     double angle;
     uvector utemp;
     double dtsave;
-    double dtuse;
     rmatrix tskew;
     uvector tvector1;
     matrix2d tmatrix2;
     rvector tvector;
+
+    // Time and attitude of the step being moved on from
+    double utc = gjh.loc.utc;
+    qatt icrf = gjh.loc.att.icrf;
+
+    gjh.loc.pos.eci.utc = gjh.loc.utc = utc + (dtuse)/86400.;
+
+    // Calculate S(order/2+1)
+    gjh.step[gjh.order+1].ss.col[0] = gjh.step[gjh.order].ss.col[0] + gjh.step[gjh.order].s.col[0] + gjh.step[gjh.order].acc.col[0]/2.;
+    gjh.step[gjh.order+1].ss.col[1] = gjh.step[gjh.order].ss.col[1] + gjh.step[gjh.order].s.col[1] + gjh.step[gjh.order].acc.col[1]/2.;
+    gjh.step[gjh.order+1].ss.col[2] = gjh.step[gjh.order].ss.col[2] + gjh.step[gjh.order].s.col[2] + gjh.step[gjh.order].acc.col[2]/2.;
+
+    // Calculate Sum(order/2+1) for a and b
+    gjh.step[gjh.order+1].sb = gjh.step[gjh.order+1].sa = rv_zero();
+    for (k=0; k<=gjh.order; k++)
+    {
+        gjh.step[gjh.order+1].sb.col[0] += gjh.step[gjh.order+1].b[k] * gjh.step[k].acc.col[0];
+        gjh.step[gjh.order+1].sa.col[0] += gjh.step[gjh.order+1].a[k] * gjh.step[k].acc.col[0];
+        gjh.step[gjh.order+1].sb.col[1] += gjh.step[gjh.order+1].b[k] * gjh.step[k].acc.col[1];
+        gjh.step[gjh.order+1].sa.col[1] += gjh.step[gjh.order+1].a[k] * gjh.step[k].acc.col[1];
+        gjh.step[gjh.order+1].sb.col[2] += gjh.step[gjh.order+1].b[k] * gjh.step[k].acc.col[2];
+        gjh.step[gjh.order+1].sa.col[2] += gjh.step[gjh.order+1].a[k] * gjh.step[k].acc.col[2];
+    }
+
+    // Calculate pos.v(order/2+1)
+    gjh.loc.pos.eci.v.col[0] = gjh.dt * (gjh.step[gjh.order].s.col[0] + gjh.step[gjh.order].acc.col[0]/2. + gjh.step[gjh.order+1].sb.col[0]);
+    gjh.loc.pos.eci.v.col[1] = gjh.dt * (gjh.step[gjh.order].s.col[1] + gjh.step[gjh.order].acc.col[1]/2. + gjh.step[gjh.order+1].sb.col[1]);
+    gjh.loc.pos.eci.v.col[2] = gjh.dt * (gjh.step[gjh.order].s.col[2] + gjh.step[gjh.order].acc.col[2]/2. + gjh.step[gjh.order+1].sb.col[2]);
+
+    // Calculate pos.s(order/2+1)
+    gjh.loc.pos.eci.s.col[0] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[0] + gjh.step[gjh.order+1].sa.col[0]);
+    gjh.loc.pos.eci.s.col[1] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[1] + gjh.step[gjh.order+1].sa.col[1]);
+    gjh.loc.pos.eci.s.col[2] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[2] + gjh.step[gjh.order+1].sa.col[2]);
+    gjh.loc.pos.eci.pass++;
+    pos_eci(&gjh.loc);
+
+    // Calculate att.s(order/2+1) + hardware
+    gjh.loc.att.icrf = icrf;
+    gjh.loc.att.icrf.utc = utc;
+    switch (physics.mode)
+    {
+    case 0:
+        // Calculate att.v(order/2+1)
+        astep = 1 + (length_rv(gjh.loc.att.icrf.v) * dtuse) / .01;
+        if (astep > 1000)
+        {
+            astep = 1000;
+        }
+        dtsave = dtuse;
+        dtuse /= astep;
+        gjh.loc.utc = utc;
+        //				simulate_hardware(cdata, gjh.loc);
+        att_accel(physics, gjh.loc);
+        for (k=0; k<astep; k++)
+        {
+            tvector = transform_q(gjh.loc.att.icrf.s,rv_smult(dtuse,gjh.loc.att.icrf.v));
+            tskew = rm_skew(tvector);
+            tmatrix2.rows = tmatrix2.cols = 4;
+            for (int l=0; l<3; ++l)
+            {
+                tmatrix2.array[3][l] = -tvector.col[l];
+                tmatrix2.array[l][3] = tvector.col[l];
+                for (int m=0; m<3; m++)
+                {
+                    tmatrix2.array[l][m] = -tskew.row[l].col[m];
+                }
+            }
+            tmatrix2.array[3][3] = 0.;
+            tvector1.m1.cols = 4;
+            tvector1.q = gjh.loc.att.icrf.s;
+            tvector1.m1 = m1_smult(.5,m1_mmult(tmatrix2,tvector1.m1));
+            gjh.loc.att.icrf.s = q_add(gjh.loc.att.icrf.s,tvector1.q);
+
+            //					q1 = q_axis2quaternion_rv(rv_smult(dtuse,gjh.loc.att.icrf.v));
+            //					gjh.loc.att.icrf.s = q_mult(q1,gjh.loc.att.icrf.s);
+            normalize_q(&gjh.loc.att.icrf.s);
+
+            // Calculate new v from da
+            gjh.loc.att.icrf.v = rv_add(gjh.loc.att.icrf.v,rv_smult(dtuse,gjh.loc.att.icrf.a));
+            gjh.loc.utc += (dtuse)/86400.;
+            ++gjh.loc.att.icrf.pass;
+            att_icrf(&gjh.loc);
+        }
+        dtuse = dtsave;
+        break;
+    case 1:
+        // Force LVLH
+        gjh.loc.att.lvlh.utc = gjh.loc.utc;
+        gjh.loc.att.lvlh.s = q_eye();
+        gjh.loc.att.lvlh.v = rv_zero();
+        att_lvlh2icrf(&gjh.loc);
+        break;
+    case 2:
+        // Force surface normal (rover)
+        gjh.loc.att.topo.v = gjh.loc.att.topo.a = rv_zero();
+        switch (gjh.loc.pos.extra.closest)
+        {
+        case COSMOS_EARTH:
+        default:
+            val = map_dem_pixel(COSMOS_EARTH,gjh.loc.pos.geod.s.lon,gjh.loc.pos.geod.s.lat,1./REARTHM);
+            for (j=0; j<3; j++)
+            {
+                normal.col[j] = val.nmap[j];
+            }
+            unitv = rv_zero();
+            unitv.col[0] = gjh.loc.pos.geod.v.lon / cos(gjh.loc.pos.geod.s.lat);
+            unitv.col[1] = gjh.loc.pos.geod.v.lat;
+            break;
+        case COSMOS_MOON:
+            val = map_dem_pixel(COSMOS_MOON,gjh.loc.pos.selg.s.lon,gjh.loc.pos.selg.s.lat,1./RMOONM);
+            for (j=0; j<3; j++)
+            {
+                normal.col[j] = -val.nmap[j];
+            }
+            unitv = rv_zero();
+            unitv.col[0] = gjh.loc.pos.selg.v.lon / cos(gjh.loc.pos.selg.s.lat);
+            unitv.col[1] = gjh.loc.pos.selg.v.lat;
+            break;
+        }
+        q1 = q_change_between_rv(rv_unitz(),normal);
+        unitx = rv_cross(normal,rv_unity());
+        unitx = transform_q(q1,unitx);
+        q2 = q_change_between_rv(unitx,unitv);
+        //		gjh.loc.att.topo.s = q_mult(q2,q1);
+        gjh.loc.att.topo.s = q1;
+        gjh.loc.att.topo.utc = gjh.loc.pos.utc+1.e8;
+        gjh.loc.att.topo.pass++;
+        att_topo(&gjh.loc);
+        break;
+    case 3:
+        gjh.loc.att.icrf.utc = gjh.loc.utc;
+        q1 = gjh.loc.att.icrf.s;
+        gjh.loc.att.icrf.s = q_change_between_rv(physics.thrust,rv_unitz());
+        dsq = q_sub(gjh.loc.att.icrf.s,q1);
+        angle = 2. * atan(length_q(dsq)/2.);
+        q2 = q_smult(1./cos(angle),gjh.loc.att.icrf.s);
+        dsq = q_sub(q2,q1);
+        utemp.q = q_smult(2.,q_mult(q_conjugate(q1),dsq));
+        gjh.loc.att.icrf.v = utemp.r;
+        att_icrf2lvlh(&gjh.loc);
+        break;
+    case 4:
+        gjh.loc.att.selc.utc = gjh.loc.utc;
+        unitp1.col[0] += .1*(gjh.loc.pos.selg.v.lon-unitp1.col[0]);
+        unitp1.col[1] += .1*(gjh.loc.pos.selg.v.lat-unitp1.col[1]);
+        unitp1.col[2] =  0.;
+        if (length_rv(unitp1) < 1e-9)
+            unitp1 = lunitp1;
+        else
+            lunitp1 = unitp1;
+        q1 = q_change_between_rv(rv_unitx(),unitp1);
+        val = map_dem_pixel(COSMOS_MOON,gjh.loc.pos.selg.s.lon,gjh.loc.pos.selg.s.lat,.0003);
+        unitp2.col[0] += .1*(val.nmap[0]-unitp2.col[0]);
+        unitp2.col[1] += .1*(val.nmap[1]-unitp2.col[1]);
+        unitp2.col[2] += .1*(val.nmap[2]-unitp2.col[2]);
+        q2 = q_change_between_rv(transform_q(q1,rv_unitz()),unitp2);
+        gjh.loc.att.selc.s = q_conjugate(q_mult(q2,q1));
+        gjh.loc.att.selc.v = rv_zero();
+        att_selc2icrf(&gjh.loc);
+        break;
+    case 5:
+        gjh.loc.att.geoc.utc = gjh.loc.utc;
+        angle = 2.*acos(gjh.loc.att.geoc.s.w);
+        gjh.loc.att.geoc.s = q_change_around_z(angle+.2*D2PI*dtuse);
+        gjh.loc.att.geoc.v = rv_smult(.2*D2PI,rv_unitz());
+        att_geoc2icrf(&gjh.loc);
+        att_planec2lvlh(&gjh.loc);
+        break;
+    case 6:
+    case 7:
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+        //				gjh.loc.att.icrf.s = q_change_between_rv(cdata.piece[physics.mode-2].normal,rv_smult(-1.,gjh.loc.pos.icrf.s));
+        gjh.loc.att.icrf.v = rv_zero();
+        att_icrf2lvlh(&gjh.loc);
+        break;
+    case 12:
+        angle = (1440.*(gjh.loc.utc - initialutc) - (int)(1440.*(gjh.loc.utc - initialutc))) * 2.*DPI;
+        unitx = unitp =  rv_zero();
+        unitx.col[0] = 1.;
+        unitp.col[0] = cos(angle);
+        unitp.col[1] = sin(angle);
+        gjh.loc.att.lvlh.s = q_change_between_rv(unitp,unitx);
+        gjh.loc.att.lvlh.v = rv_zero();
+        gjh.loc.att.lvlh.v.col[2] = 2.*DPI/1440.;
+        att_lvlh2icrf(&gjh.loc);
+        break;
+    }
+    //		simulate_hardware(cdata, gjh.loc);
+    att_accel(physics, gjh.loc);
+    // Perform positional and attitude accelerations at new position
+    pos_accel(physics, gjh.loc);
+
+    // Calculate s(order/2+1)
+    gjh.step[gjh.order+1].s.col[0] = gjh.step[gjh.order].s.col[0] + (gjh.step[gjh.order].acc.col[0]+gjh.loc.pos.eci.a.col[0])/2.;
+    gjh.step[gjh.order+1].s.col[1] = gjh.step[gjh.order].s.col[1] + (gjh.step[gjh.order].acc.col[1]+gjh.loc.pos.eci.a.col[1])/2.;
+    gjh.step[gjh.order+1].s.col[2] = gjh.step[gjh.order].s.col[2] + (gjh.step[gjh.order].acc.col[2]+gjh.loc.pos.eci.a.col[2])/2.;
+
+    // Shift the history over 1
+    gjh.step[gjh.order+1].acc = gjh.loc.pos.eci.a;
+    for (j=0; j<=gjh.order; j++)
+    {
+        gjh.step[j].acc = gjh.step[j+1].acc;
+        gjh.step[j].s = gjh.step[j+1].s;
+        gjh.step[j].ss = gjh.step[j+1].ss;
+    }
+}
+
+//! Propagate Gauss-Jackson integration
+/*! Move a Gauss-Jackson integration, started with one of the gauss_jackson_init functions, on to
+ * the given time, in at most 100000 steps. Propagation stops early if the altitude falls below
+ * 100 m.
+    \param gjh Reference to ::gj_handle for Gauss-Jackson integration.
+    \param physics Reference to ::physicsstruc to use.
+    \param loc Reference to ::locstruc, set to the last step.
+    \param tomjd Time to propagate to, in Modified Julian Days.
+    \return Vector of ::locstruc, the starting one and then every step.
+*/
+vector <locstruc> gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double tomjd)
+{
+    uint32_t i, chunks;
     vector <locstruc> locvec;
 
     // Initial location
     locvec.push_back(loc);
 
     // Don't bother if too low
-    if (gjh.step[gjh.order].sloc.pos.geod.s.h < 100.)
+    if (gjh.loc.pos.geod.s.h < 100.)
     {
         return locvec;
     }
-    //	if (qs[0].w == 0.)
-    //	{
-    //		qs[0] = qs[1] = loc.att.icrf.s;
-    //		alpha[0] = alpha[1] = loc.att.icrf.a;
-    //		omega[0] = omega[1] = loc.att.icrf.v;
-    //	}
     // Return immediately if we are trying to propagate earlier but dt is positive or vice versa
-    if ((tomjd < gjh.step[gjh.order].sloc.utc && physics.dt > 0.) || (tomjd > gjh.step[gjh.order].sloc.utc && physics.dt < 0.))
+    if ((tomjd < gjh.loc.utc && physics.dt > 0.) || (tomjd > gjh.loc.utc && physics.dt < 0.))
     {
         return locvec;
     }
-    chunks = (uint32_t)(.5 + 86400.*(tomjd - gjh.step[gjh.order].sloc.utc)/physics.dt);
+    chunks = (uint32_t)(.5 + 86400.*(tomjd - gjh.loc.utc)/physics.dt);
     if (chunks > 100000)
     {
         chunks = 100000;
-//        dtuse = 86400.*(tomjd - gjh.step[gjh.order].sloc.utc) / 100000;
     }
-//    else
-//    {
-        dtuse = physics.dt;
-//    }
 
     for (i=0; i<chunks; i++)
     {
-        if (gjh.step[gjh.order].sloc.pos.geod.s.h < 100.)
+        if (gjh.loc.pos.geod.s.h < 100.)
         {
             break;
         }
+        gauss_jackson_advance(gjh, physics, physics.dt);
 
-        gjh.step[gjh.order+1].sloc.pos.eci.utc = gjh.step[gjh.order+1].sloc.utc = gjh.step[gjh.order].sloc.utc + (dtuse)/86400.;
+        // Add latest calculation
+        locvec.push_back(gjh.loc);
+    }
 
-        // Calculate S(order/2+1)
-        gjh.step[gjh.order+1].ss.col[0] = gjh.step[gjh.order].ss.col[0] + gjh.step[gjh.order].s.col[0] + gjh.step[gjh.order].sloc.pos.eci.a.col[0]/2.;
-        gjh.step[gjh.order+1].ss.col[1] = gjh.step[gjh.order].ss.col[1] + gjh.step[gjh.order].s.col[1] + gjh.step[gjh.order].sloc.pos.eci.a.col[1]/2.;
-        gjh.step[gjh.order+1].ss.col[2] = gjh.step[gjh.order].ss.col[2] + gjh.step[gjh.order].s.col[2] + gjh.step[gjh.order].sloc.pos.eci.a.col[2]/2.;
+    loc = gjh.loc;
+    return locvec;
+}
 
-        // Calculate Sum(order/2+1) for a and b
-        gjh.step[gjh.order+1].sb = gjh.step[gjh.order+1].sa = rv_zero();
-        for (k=0; k<=gjh.order; k++)
+// Copy the parts of a location asked for in fields in to a ::gj_sample
+static void fill_sample(const locstruc &loc, uint16_t fields, gj_sample &sample)
+{
+    sample.utc = loc.utc;
+    if (fields & GJ_FIELD_ECI)
+    {
+        sample.eci = loc.pos.eci;
+    }
+    if (fields & GJ_FIELD_GEOC)
+    {
+        sample.geoc = loc.pos.geoc;
+    }
+    if (fields & GJ_FIELD_GEOD)
+    {
+        sample.geod = loc.pos.geod;
+    }
+    if (fields & GJ_FIELD_ICRF)
+    {
+        sample.icrf = loc.att.icrf;
+    }
+}
+
+//! Propagate Gauss-Jackson integration, step by step
+/*! Move a Gauss-Jackson integration, started with one of the gauss_jackson_init functions, on to
+ * the given time, handing each step to a function as it is made rather than keeping them. Only
+ * the parts of each step asked for in fields are filled in the ::gj_sample. There is no limit on
+ * the number of steps. Propagation stops early if the altitude falls below 100 m.
+    \param gjh Reference to ::gj_handle for Gauss-Jackson integration.
+    \param physics Reference to ::physicsstruc to use.
+    \param loc Reference to ::locstruc, set to the last step.
+    \param tomjd Time to propagate to, in Modified Julian Days.
+    \param output Function to call with each step after the starting one.
+    \param fields Mask of GJ_FIELD_* values, for the parts of each step to give.
+    \return Number of steps made.
+*/
+int32_t gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double tomjd, std::function<void(const gj_sample &sample)> output, uint16_t fields)
+{
+    int32_t steps = 0;
+    gj_sample sample;
+
+    if (gjh.loc.pos.geod.s.h < 100.)
+    {
+        return 0;
+    }
+    if ((tomjd < gjh.loc.utc && physics.dt > 0.) || (tomjd > gjh.loc.utc && physics.dt < 0.))
+    {
+        return 0;
+    }
+    double chunks = floor(.5 + 86400.*(tomjd - gjh.loc.utc)/physics.dt);
+
+    while (steps < chunks)
+    {
+        if (gjh.loc.pos.geod.s.h < 100.)
         {
-            gjh.step[gjh.order+1].sb.col[0] += gjh.step[gjh.order+1].b[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-            gjh.step[gjh.order+1].sa.col[0] += gjh.step[gjh.order+1].a[k] * gjh.step[k].sloc.pos.eci.a.col[0];
-            gjh.step[gjh.order+1].sb.col[1] += gjh.step[gjh.order+1].b[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-            gjh.step[gjh.order+1].sa.col[1] += gjh.step[gjh.order+1].a[k] * gjh.step[k].sloc.pos.eci.a.col[1];
-            gjh.step[gjh.order+1].sb.col[2] += gjh.step[gjh.order+1].b[k] * gjh.step[k].sloc.pos.eci.a.col[2];
-            gjh.step[gjh.order+1].sa.col[2] += gjh.step[gjh.order+1].a[k] * gjh.step[k].sloc.pos.eci.a.col[2];
+            break;
         }
+        gauss_jackson_advance(gjh, physics, physics.dt);
+        ++steps;
+
+        if (output)
+        {
+            fill_sample(gjh.loc, fields, sample);
+            output(sample);
+        }
+    }
+
+    loc = gjh.loc;
+    return steps;
+}
+
+// Dormand-Prince 5(4) tableau: nodes, stages, error weights (fifth less fourth order) and the
+// weights of the fourth order dense output, as given by Hairer and Wanner.
+static const double dp_c[7] = {0., 1./5., 3./10., 4./5., 8./9., 1., 1.};
+static const double dp_a[7][6] = {
+    {0., 0., 0., 0., 0., 0.},
+    {1./5., 0., 0., 0., 0., 0.},
+    {3./40., 9./40., 0., 0., 0., 0.},
+    {44./45., -56./15., 32./9., 0., 0., 0.},
+    {19372./6561., -25360./2187., 64448./6561., -212./729., 0., 0.},
+    {9017./3168., -355./33., 46732./5247., 49./176., -5103./18656., 0.},
+    {35./384., 0., 500./1113., 125./192., -2187./6784., 11./84.}
+};
+static const double dp_e[7] = {71./57600., 0., -71./16695., 71./1920., -17253./339200., 22./525., -1./40.};
+static const double dp_d[7] = {-12715105075./11282082432., 0., 87487479700./32700410799., -10690763975./1880347072., 701980252875./199316789632., -1453857185./822651844., 69997945./29380423.};
+
+// Derivative of the ECI state y (position, velocity) at utc, from the force model of pos_accel.
+// work is any complete location; it is left converted to the state.
+static int32_t dormand_prince_derivative(dp_handle &dph, physicsstruc &physics, locstruc &work, double utc, const double y[6], double dy[6])
+{
+    int32_t iretn;
+
+    work.utc = work.pos.eci.utc = utc;
+    for (uint16_t i=0; i<3; ++i)
+    {
+        work.pos.eci.s.col[i] = y[i];
+        work.pos.eci.v.col[i] = y[i+3];
+    }
+    work.pos.eci.pass++;
+    iretn = pos_eci(&work);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    iretn = pos_accel(physics, work);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    ++dph.evaluations;
 
-        // Calculate pos.v(order/2+1)
-        gjh.step[gjh.order+1].sloc.pos.eci.v.col[0] = gjh.dt * (gjh.step[gjh.order].s.col[0] + gjh.step[gjh.order].sloc.pos.eci.a.col[0]/2. + gjh.step[gjh.order+1].sb.col[0]);
-        gjh.step[gjh.order+1].sloc.pos.eci.v.col[1] = gjh.dt * (gjh.step[gjh.order].s.col[1] + gjh.step[gjh.order].sloc.pos.eci.a.col[1]/2. + gjh.step[gjh.order+1].sb.col[1]);
-        gjh.step[gjh.order+1].sloc.pos.eci.v.col[2] = gjh.dt * (gjh.step[gjh.order].s.col[2] + gjh.step[gjh.order].sloc.pos.eci.a.col[2]/2. + gjh.step[gjh.order+1].sb.col[2]);
+    for (uint16_t i=0; i<3; ++i)
+    {
+        dy[i] = y[i+3];
+        dy[i+3] = work.pos.eci.a.col[i];
+    }
+    return 0;
+}
 
-        // Calculate pos.s(order/2+1)
-        gjh.step[gjh.order+1].sloc.pos.eci.s.col[0] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[0] + gjh.step[gjh.order+1].sa.col[0]);
-        gjh.step[gjh.order+1].sloc.pos.eci.s.col[1] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[1] + gjh.step[gjh.order+1].sa.col[1]);
-        gjh.step[gjh.order+1].sloc.pos.eci.s.col[2] = gjh.dtsq * (gjh.step[gjh.order+1].ss.col[2] + gjh.step[gjh.order+1].sa.col[2]);
-        gjh.step[gjh.order+1].sloc.pos.eci.pass++;
-        pos_eci(&gjh.step[gjh.order+1].sloc);
+//! Initialize Dormand-Prince integration
+/*! Start an adaptive step Dormand-Prince 5(4) integration of the orbit from the given location,
+ * using the same force model as Gauss-Jackson. Each step is sized so that the estimated error in
+ * each part of the ECI position and velocity stays below atol + rtol times its size. The limits
+ * on step size, dph.hmin and dph.hmax, may be changed afterwards.
+    \param dph Reference to ::dp_handle for Dormand-Prince integration.
+    \param physics Reference to ::physicsstruc to use.
+    \param loc Starting location. The ECI position and time must be set.
+    \param dt First step to try, in seconds. Negative to propagate backwards.
+    \param rtol Relative error allowed per step.
+    \param atol Absolute error allowed per step, in meters and meters per second.
+    \return Zero, or negative error.
+*/
+int32_t dormand_prince_init(dp_handle &dph, physicsstruc &physics, locstruc &loc, double dt, double rtol, double atol)
+{
+    int32_t iretn;
 
-        // Calculate att.s(order/2+1) + hardware
-        gjh.step[gjh.order+1].sloc.att.icrf = gjh.step[gjh.order].sloc.att.icrf;
-        gjh.step[gjh.order+1].sloc.att.icrf.utc = gjh.step[gjh.order].sloc.utc;
-        switch (physics.mode)
+    dph.rtol = rtol;
+    dph.atol = atol;
+    dph.h = dt;
+    dph.hmin = 1e-3;
+    dph.hmax = 3600.;
+    dph.hlast = 0.;
+    dph.steps = 0;
+    dph.rejected = 0;
+    dph.evaluations = 0;
+
+    dph.loc = loc;
+    dph.loc.pos.eci.pass++;
+    iretn = pos_eci(&dph.loc);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    att_accel(physics, dph.loc);
+    iretn = pos_accel(physics, dph.loc);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    ++dph.evaluations;
+    dph.utc0 = dph.loc.utc;
+    return 0;
+}
+
+//! Take a Dormand-Prince step
+/*! Move a Dormand-Prince integration on by one accepted step, of at most hlimit seconds. Steps
+ * whose estimated error is too large are retried with a smaller size. The size tried next is
+ * taken from the error of this one.
+    \param dph Reference to ::dp_handle for Dormand-Prince integration.
+    \param physics Reference to ::physicsstruc to use.
+    \param hlimit Longest step to take, in seconds, with the sign of the direction.
+    \return Zero, or negative error.
+*/
+int32_t dormand_prince_step(dp_handle &dph, physicsstruc &physics, double hlimit)
+{
+    int32_t iretn;
+    double y0[6], y1[6], yt[6], k[7][6];
+    double utc0 = dph.loc.utc;
+    locstruc work = dph.loc;
+
+    for (uint16_t i=0; i<3; ++i)
+    {
+        y0[i] = dph.loc.pos.eci.s.col[i];
+        y0[i+3] = k[0][i] = dph.loc.pos.eci.v.col[i];
+        k[0][i+3] = dph.loc.pos.eci.a.col[i];
+    }
+
+    while (true)
+    {
+        double h = copysign(dph.h, hlimit);
+        bool clipped = false;
+        if (fabs(h) >= fabs(hlimit))
         {
-        case 0:
-            // Calculate att.v(order/2+1)
-            astep = 1 + (length_rv(gjh.step[gjh.order+1].sloc.att.icrf.v) * dtuse) / .01;
-            if (astep > 1000)
-            {
-                astep = 1000;
-            }
-            dtsave = dtuse;
-            dtuse /= astep;
-            gjh.step[gjh.order+1].sloc.utc = gjh.step[gjh.order].sloc.utc;
-            //				simulate_hardware(cdata, gjh.step[gjh.order+1].sloc);
-            att_accel(physics, gjh.step[gjh.order+1].sloc);
-            for (k=0; k<astep; k++)
+            h = hlimit;
+            clipped = true;
+        }
+
+        // Stages. The last is at the new state, and is reused as the first of the next step.
+        for (uint16_t s=1; s<7; ++s)
+        {
+            for (uint16_t i=0; i<6; ++i)
             {
-                tvector = transform_q(gjh.step[gjh.order+1].sloc.att.icrf.s,rv_smult(dtuse,gjh.step[gjh.order+1].sloc.att.icrf.v));
-                tskew = rm_skew(tvector);
-                tmatrix2.rows = tmatrix2.cols = 4;
-                for (int l=0; l<3; ++l)
+                yt[i] = y0[i];
+                for (uint16_t j=0; j<s; ++j)
                 {
-                    tmatrix2.array[3][l] = -tvector.col[l];
-                    tmatrix2.array[l][3] = tvector.col[l];
-                    for (int m=0; m<3; m++)
-                    {
-                        tmatrix2.array[l][m] = -tskew.row[l].col[m];
-                    }
+                    yt[i] += h * dp_a[s][j] * k[j][i];
                 }
-                tmatrix2.array[3][3] = 0.;
-                tvector1.m1.cols = 4;
-                tvector1.q = gjh.step[gjh.order+1].sloc.att.icrf.s;
-                tvector1.m1 = m1_smult(.5,m1_mmult(tmatrix2,tvector1.m1));
-                gjh.step[gjh.order+1].sloc.att.icrf.s = q_add(gjh.step[gjh.order+1].sloc.att.icrf.s,tvector1.q);
-
-                //					q1 = q_axis2quaternion_rv(rv_smult(dtuse,gjh.step[gjh.order+1].sloc.att.icrf.v));
-                //					gjh.step[gjh.order+1].sloc.att.icrf.s = q_mult(q1,gjh.step[gjh.order+1].sloc.att.icrf.s);
-                normalize_q(&gjh.step[gjh.order+1].sloc.att.icrf.s);
-
-                // Calculate new v from da
-                gjh.step[gjh.order+1].sloc.att.icrf.v = rv_add(gjh.step[gjh.order+1].sloc.att.icrf.v,rv_smult(dtuse,gjh.step[gjh.order+1].sloc.att.icrf.a));
-                gjh.step[gjh.order+1].sloc.utc += (dtuse)/86400.;
-                ++gjh.step[gjh.order+1].sloc.att.icrf.pass;
-                att_icrf(&gjh.step[gjh.order+1].sloc);
             }
-            dtuse = dtsave;
-            break;
-        case 1:
-            // Force LVLH
-            gjh.step[gjh.order+1].sloc.att.lvlh.utc = gjh.step[gjh.order+1].sloc.utc;
-            gjh.step[gjh.order+1].sloc.att.lvlh.s = q_eye();
-            gjh.step[gjh.order+1].sloc.att.lvlh.v = rv_zero();
-            att_lvlh2icrf(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 2:
-            // Force surface normal (rover)
-            gjh.step[gjh.order+1].sloc.att.topo.v = gjh.step[gjh.order+1].sloc.att.topo.a = rv_zero();
-            switch (gjh.step[gjh.order+1].sloc.pos.extra.closest)
+            iretn = dormand_prince_derivative(dph, physics, work, utc0 + dp_c[s] * h / 86400., yt, k[s]);
+            if (iretn < 0)
             {
-            case COSMOS_EARTH:
-            default:
-                val = map_dem_pixel(COSMOS_EARTH,gjh.step[gjh.order+1].sloc.pos.geod.s.lon,gjh.step[gjh.order+1].sloc.pos.geod.s.lat,1./REARTHM);
-                for (j=0; j<3; j++)
-                {
-                    normal.col[j] = val.nmap[j];
-                }
-                unitv = rv_zero();
-                unitv.col[0] = gjh.step[gjh.order+1].sloc.pos.geod.v.lon / cos(gjh.step[gjh.order+1].sloc.pos.geod.s.lat);
-                unitv.col[1] = gjh.step[gjh.order+1].sloc.pos.geod.v.lat;
-                break;
-            case COSMOS_MOON:
-                val = map_dem_pixel(COSMOS_MOON,gjh.step[gjh.order+1].sloc.pos.selg.s.lon,gjh.step[gjh.order+1].sloc.pos.selg.s.lat,1./RMOONM);
-                for (j=0; j<3; j++)
+                return iretn;
+            }
+        }
+        memcpy(y1, yt, sizeof(y1));
+
+        // Root mean square of the error relative to what is allowed
+        double err = 0.;
+        for (uint16_t i=0; i<6; ++i)
+        {
+            double ei = 0.;
+            for (uint16_t j=0; j<7; ++j)
+            {
+                ei += dp_e[j] * k[j][i];
+            }
+            ei = h * ei / (dph.atol + dph.rtol * fmax(fabs(y0[i]), fabs(y1[i])));
+            err += ei * ei;
+        }
+        err = sqrt(err / 6.);
+        double factor = err > 0. ? .9 * pow(err, -.2) : 5.;
+
+        if (err <= 1.)
+        {
+            // Accepted: keep what is needed for dense output
+            for (uint16_t i=0; i<6; ++i)
+            {
+                double ydiff = y1[i] - y0[i];
+                double bspl = h * k[0][i] - ydiff;
+                dph.dense[0][i] = y0[i];
+                dph.dense[1][i] = ydiff;
+                dph.dense[2][i] = bspl;
+                dph.dense[3][i] = ydiff - h * k[6][i] - bspl;
+                dph.dense[4][i] = 0.;
+                for (uint16_t j=0; j<7; ++j)
                 {
-                    normal.col[j] = -val.nmap[j];
+                    dph.dense[4][i] += h * dp_d[j] * k[j][i];
                 }
-                unitv = rv_zero();
-                unitv.col[0] = gjh.step[gjh.order+1].sloc.pos.selg.v.lon / cos(gjh.step[gjh.order+1].sloc.pos.selg.s.lat);
-                unitv.col[1] = gjh.step[gjh.order+1].sloc.pos.selg.v.lat;
-                break;
             }
-            q1 = q_change_between_rv(rv_unitz(),normal);
-            unitx = rv_cross(normal,rv_unity());
-            unitx = transform_q(q1,unitx);
-            q2 = q_change_between_rv(unitx,unitv);
-            //		gjh.step[gjh.order+1].sloc.att.topo.s = q_mult(q2,q1);
-            gjh.step[gjh.order+1].sloc.att.topo.s = q1;
-            gjh.step[gjh.order+1].sloc.att.topo.utc = gjh.step[gjh.order+1].sloc.pos.utc+1.e8;
-            gjh.step[gjh.order+1].sloc.att.topo.pass++;
-            att_topo(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 3:
-            gjh.step[gjh.order+1].sloc.att.icrf.utc = gjh.step[gjh.order+1].sloc.utc;
-            q1 = gjh.step[gjh.order+1].sloc.att.icrf.s;
-            gjh.step[gjh.order+1].sloc.att.icrf.s = q_change_between_rv(physics.thrust,rv_unitz());
-            dsq = q_sub(gjh.step[gjh.order+1].sloc.att.icrf.s,q1);
-            angle = 2. * atan(length_q(dsq)/2.);
-            q2 = q_smult(1./cos(angle),gjh.step[gjh.order+1].sloc.att.icrf.s);
-            dsq = q_sub(q2,q1);
-            utemp.q = q_smult(2.,q_mult(q_conjugate(q1),dsq));
-            gjh.step[gjh.order+1].sloc.att.icrf.v = utemp.r;
-            att_icrf2lvlh(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 4:
-            gjh.step[gjh.order+1].sloc.att.selc.utc = gjh.step[gjh.order+1].sloc.utc;
-            unitp1.col[0] += .1*(gjh.step[gjh.order+1].sloc.pos.selg.v.lon-unitp1.col[0]);
-            unitp1.col[1] += .1*(gjh.step[gjh.order+1].sloc.pos.selg.v.lat-unitp1.col[1]);
-            unitp1.col[2] =  0.;
-            if (length_rv(unitp1) < 1e-9)
-                unitp1 = lunitp1;
-            else
-                lunitp1 = unitp1;
-            q1 = q_change_between_rv(rv_unitx(),unitp1);
-            val = map_dem_pixel(COSMOS_MOON,gjh.step[gjh.order+1].sloc.pos.selg.s.lon,gjh.step[gjh.order+1].sloc.pos.selg.s.lat,.0003);
-            unitp2.col[0] += .1*(val.nmap[0]-unitp2.col[0]);
-            unitp2.col[1] += .1*(val.nmap[1]-unitp2.col[1]);
-            unitp2.col[2] += .1*(val.nmap[2]-unitp2.col[2]);
-            q2 = q_change_between_rv(transform_q(q1,rv_unitz()),unitp2);
-            gjh.step[gjh.order+1].sloc.att.selc.s = q_conjugate(q_mult(q2,q1));
-            gjh.step[gjh.order+1].sloc.att.selc.v = rv_zero();
-            att_selc2icrf(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 5:
-            gjh.step[gjh.order+1].sloc.att.geoc.utc = gjh.step[gjh.order+1].sloc.utc;
-            angle = 2.*acos(gjh.step[gjh.order+1].sloc.att.geoc.s.w);
-            gjh.step[gjh.order+1].sloc.att.geoc.s = q_change_around_z(angle+.2*D2PI*dtuse);
-            gjh.step[gjh.order+1].sloc.att.geoc.v = rv_smult(.2*D2PI,rv_unitz());
-            att_geoc2icrf(&gjh.step[gjh.order+1].sloc);
-            att_planec2lvlh(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 6:
-        case 7:
-        case 8:
-        case 9:
-        case 10:
-        case 11:
-            //				gjh.step[gjh.order+1].sloc.att.icrf.s = q_change_between_rv(cdata.piece[physics.mode-2].normal,rv_smult(-1.,gjh.step[gjh.order+1].sloc.pos.icrf.s));
-            gjh.step[gjh.order+1].sloc.att.icrf.v = rv_zero();
-            att_icrf2lvlh(&gjh.step[gjh.order+1].sloc);
-            break;
-        case 12:
-            angle = (1440.*(gjh.step[gjh.order+1].sloc.utc - initialutc) - (int)(1440.*(gjh.step[gjh.order+1].sloc.utc - initialutc))) * 2.*DPI;
-            unitx = unitp =  rv_zero();
-            unitx.col[0] = 1.;
-            unitp.col[0] = cos(angle);
-            unitp.col[1] = sin(angle);
-            gjh.step[gjh.order+1].sloc.att.lvlh.s = q_change_between_rv(unitp,unitx);
-            gjh.step[gjh.order+1].sloc.att.lvlh.v = rv_zero();
-            gjh.step[gjh.order+1].sloc.att.lvlh.v.col[2] = 2.*DPI/1440.;
-            att_lvlh2icrf(&gjh.step[gjh.order+1].sloc);
-            break;
+            dph.utc0 = utc0;
+            dph.hlast = h;
+
+            // Position from the last stage, attitude turned at its rate over the step
+            dph.loc.utc = work.utc;
+            dph.loc.pos = work.pos;
+            quaternion q1 = q_axis2quaternion_rv(rv_smult(h, dph.loc.att.icrf.v));
+            dph.loc.att.icrf.s = q_mult(q1, dph.loc.att.icrf.s);
+            normalize_q(&dph.loc.att.icrf.s);
+            dph.loc.att.icrf.v = rv_add(dph.loc.att.icrf.v, rv_smult(h, dph.loc.att.icrf.a));
+            dph.loc.att.icrf.utc = dph.loc.utc;
+            dph.loc.att.icrf.pass++;
+            att_icrf(&dph.loc);
+            att_accel(physics, dph.loc);
+            ++dph.steps;
+
+            // A step cut short to land on a time says nothing about the next one
+            double hnext = h * fmin(factor, 5.);
+            if (!clipped || fabs(hnext) > fabs(dph.h))
+            {
+                dph.h = fabs(hnext) > dph.hmax ? copysign(dph.hmax, h) : hnext;
+            }
+            return 0;
+        }
+
+        ++dph.rejected;
+        dph.h = h * fmax(factor, .2);
+        if (fabs(dph.h) < dph.hmin)
+        {
+            return MATH_ERROR_DP_STEPSIZE;
         }
-        //		simulate_hardware(cdata, gjh.step[gjh.order+1].sloc);
-        att_accel(physics, gjh.step[gjh.order+1].sloc);
-        // Perform positional and attitude accelerations at new position
-        pos_accel(physics, gjh.step[gjh.order+1].sloc);
+    }
+}
 
-        // Calculate s(order/2+1)
-        gjh.step[gjh.order+1].s.col[0] = gjh.step[gjh.order].s.col[0] + (gjh.step[gjh.order].sloc.pos.eci.a.col[0]+gjh.step[gjh.order+1].sloc.pos.eci.a.col[0])/2.;
-        gjh.step[gjh.order+1].s.col[1] = gjh.step[gjh.order].s.col[1] + (gjh.step[gjh.order].sloc.pos.eci.a.col[1]+gjh.step[gjh.order+1].sloc.pos.eci.a.col[1])/2.;
-        gjh.step[gjh.order+1].s.col[2] = gjh.step[gjh.order].s.col[2] + (gjh.step[gjh.order].sloc.pos.eci.a.col[2]+gjh.step[gjh.order+1].sloc.pos.eci.a.col[2])/2.;
+//! Dormand-Prince dense output
+/*! Find the ECI position and velocity at any time within the last step taken, from the fourth
+ * order interpolant of the step, without further calls to the force model.
+    \param dph Reference to ::dp_handle for Dormand-Prince integration.
+    \param utc Time, in Modified Julian Days.
+    \param eci Reference to ::cartpos to set.
+    \return Zero, or negative error.
+*/
+int32_t dormand_prince_dense(const dp_handle &dph, double utc, cartpos &eci)
+{
+    if (dph.hlast == 0.)
+    {
+        return MATH_ERROR_DP_OUTOFRANGE;
+    }
+    double theta = 86400. * (utc - dph.utc0) / dph.hlast;
+    if (theta < -1e-9 || theta > 1. + 1e-9)
+    {
+        return MATH_ERROR_DP_OUTOFRANGE;
+    }
 
-        // Shift everything over 1
-        for (j=0; j<=gjh.order; j++)
-            gjh.step[j] = gjh.step[j+1];
+    double theta1 = 1. - theta;
+    double y[6];
+    for (uint16_t i=0; i<6; ++i)
+    {
+        y[i] = dph.dense[0][i] + theta * (dph.dense[1][i] + theta1 * (dph.dense[2][i] + theta * (dph.dense[3][i] + theta1 * dph.dense[4][i])));
+    }
+    eci.utc = utc;
+    for (uint16_t i=0; i<3; ++i)
+    {
+        eci.s.col[i] = y[i];
+        eci.v.col[i] = y[i+3];
+    }
+    eci.a = rv_zero();
+    return 0;
+}
 
-        // Add latest calculation
-        locvec.push_back(gjh.step[gjh.order].sloc);
+//! Propagate Dormand-Prince integration
+/*! Move a Dormand-Prince integration, started with dormand_prince_init, on to the given time,
+ * handing results to a function as it goes, in the same way as the streaming
+ * gauss_jackson_propagate. With no interval, each step is given as it is made; otherwise a result
+ * is given every interval seconds from the start, from the dense output of the steps. Only the
+ * parts asked for in fields are filled in the ::gj_sample. Propagation stops early if the
+ * altitude falls below 100 m.
+    \param dph Reference to ::dp_handle for Dormand-Prince integration.
+    \param physics Reference to ::physicsstruc to use.
+    \param loc Reference to ::locstruc, set to the last step.
+    \param tomjd Time to propagate to, in Modified Julian Days.
+    \param output Function to call with each result.
+    \param fields Mask of GJ_FIELD_* values, for the parts of each result to give.
+    \param interval Seconds between results, or zero for every step.
+    \return Number of steps made, or negative error.
+*/
+int32_t dormand_prince_propagate(dp_handle &dph, physicsstruc &physics, locstruc &loc, double tomjd, std::function<void(const gj_sample &sample)> output, uint16_t fields, double interval)
+{
+    int32_t iretn;
+    int32_t steps = 0;
+    gj_sample sample;
+    locstruc tloc;
+    double direction = dph.h < 0. ? -1. : 1.;
+    double startutc = dph.loc.utc;
+    uint32_t count = 1;
+    double nextutc = startutc + direction * count * fabs(interval) / 86400.;
+
+    while ((tomjd - dph.loc.utc) * direction > 0. && dph.loc.pos.geod.s.h >= 100.)
+    {
+        iretn = dormand_prince_step(dph, physics, 86400. * (tomjd - dph.loc.utc));
+        if (iretn < 0)
+        {
+            loc = dph.loc;
+            return iretn;
+        }
+        ++steps;
+
+        if (!output)
+        {
+            continue;
+        }
+        if (interval == 0.)
+        {
+            fill_sample(dph.loc, fields, sample);
+            output(sample);
+            continue;
+        }
 
+        // Results between steps come from the interpolant of the last one
+        while ((dph.loc.utc - nextutc) * direction >= 0.)
+        {
+            if (fields & (GJ_FIELD_GEOC | GJ_FIELD_GEOD))
+            {
+                tloc.pos = dph.loc.pos;
+            }
+            tloc.utc = nextutc;
+            dormand_prince_dense(dph, nextutc, tloc.pos.eci);
+            if (fields & (GJ_FIELD_GEOC | GJ_FIELD_GEOD))
+            {
+                tloc.pos.eci.pass++;
+                pos_eci(&tloc);
+            }
+            tloc.att.icrf = dph.loc.att.icrf;
+            fill_sample(tloc, fields, sample);
+            output(sample);
+            ++count;
+            nextutc = startutc + direction * count * fabs(interval) / 86400.;
+        }
     }
 
-    loc = gjh.step[gjh.order].sloc;
-    return locvec;
+    loc = dph.loc;
+    return steps;
 }
 
 //! Initialize orbit from orbital data
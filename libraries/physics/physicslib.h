@@ -94,6 +94,7 @@
 #include <cmath>
 #include <time.h>
 #include <errno.h>
+#include <functional>
 
 //! \ingroup physicslib
 //! \defgroup physicslib_functions Physics Library functions
@@ -122,6 +123,8 @@ svector groundstation(locstruc &satellite, locstruc &groundstation);
 //! Simulate all devices
 void simulate_hardware(cosmosdatastruc &cdata, locstruc &loc);
 void simulate_hardware(cosmosdatastruc &cdata, vector <locstruc> &locvec);
+//! Step many nodes in parallel
+int32_t simulate_nodes(vector<simnodestruc> &nodes, double mjd, uint16_t threads, std::function<void(simnodestruc &node)> step=nullptr);
 //! Initialize IMU simulation
 void initialize_imu(uint16_t index, devspecstruc &devspec, locstruc &loc);
 //! Simulated IMU values
@@ -150,6 +153,11 @@ void gauss_jackson_init(gj_handle &gjh, uint32_t order, int32_t mode, double dt,
 locstruc gauss_jackson_converge_orbit(gj_handle &gjh, physicsstruc &physics);
 void gauss_jackson_converge_hardware(gj_handle &gjh, physicsstruc &physics);
 vector<locstruc> gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double mjd);
+int32_t gauss_jackson_propagate(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double mjd, std::function<void(const gj_sample &sample)> output, uint16_t fields=GJ_FIELD_ECI);
+int32_t dormand_prince_init(dp_handle &dph, physicsstruc &physics, locstruc &loc, double dt, double rtol=1e-10, double atol=1e-3);
+int32_t dormand_prince_step(dp_handle &dph, physicsstruc &physics, double hlimit);
+int32_t dormand_prince_dense(const dp_handle &dph, double mjd, cartpos &eci);
+int32_t dormand_prince_propagate(dp_handle &dph, physicsstruc &physics, locstruc &loc, double mjd, std::function<void(const gj_sample &sample)> output, uint16_t fields=GJ_FIELD_ECI, double interval=0.);
 //! Load TLE's from file
 int orbit_propagate(cosmosdatastruc &root, double mjd);
 int orbit_init(int32_t mode, double dt, double mjd, std::string ofile, cosmosdatastruc &root);
@@ -0,0 +1,509 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+/*! \file contactlib.cpp
+*	\brief Contact window library source file
+*/
+
+#include "support/contactlib.h"
+#include "support/timelib.h"
+#include "support/jsonlib.h"
+#include "support/datalib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+//! \addtogroup contactlib_functions
+//! @{
+
+//! Earth orientation at one coarse step
+struct contactframe
+{
+    double utc;
+    double gmst;
+    rmatrix pw;
+};
+
+//! Ground site with everything the search needs precomputed
+struct contactsite
+{
+    //! Geocentric position
+    rvector geoc;
+    //! Unit vector along geocentric position
+    rvector up;
+    //! Geocentric to Topocentric rotation
+    rmatrix g2t;
+    //! Minimum elevation
+    double minelev;
+};
+
+//! Run a set of tasks across threads, handing out task indices as threads become free.
+static void contact_run(size_t count, uint16_t threads, std::function<void(size_t)> task)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next++) < count)
+        {
+            task(index);
+        }
+    };
+
+    if (threads < 2)
+    {
+        worker();
+        return;
+    }
+
+    vector<thread> pool;
+    for (uint16_t i=0; i<threads; ++i)
+    {
+        pool.push_back(thread(worker));
+    }
+    for (thread &worker_thread : pool)
+    {
+        worker_thread.join();
+    }
+}
+
+//! Geocentric position of a satellite at any time within the search. The nearest earlier
+//! frame supplies polar motion, and sidereal time is advanced from it, so nothing here
+//! touches non reentrant state.
+static rvector contact_geoc(const sgp4struc &sat, const vector<contactframe> &frame, double coarse, double utc)
+{
+    cartpos teme;
+    sgp4_propagate(sat, utc, teme);
+
+    double findex = floor(86400. * (utc - frame[0].utc) / coarse);
+    size_t k = findex < 0. ? 0 : (size_t)findex;
+    if (k >= frame.size())
+    {
+        k = frame.size() - 1;
+    }
+    double gmst = frame[k].gmst + CONVERT_EARTH_SIDEREAL_RATE * 86400. * (utc - frame[k].utc);
+    return rv_mmult(frame[k].pw, rv_mmult(rm_change_around_z(-gmst), teme.s));
+}
+
+//! Elevation and azimuth of a Geocentric position seen from a site.
+static double contact_elev(const contactsite &site, rvector geoc, float *az=nullptr)
+{
+    rvector topo = rv_mmult(site.g2t, rv_sub(geoc, site.geoc));
+    if (az != nullptr)
+    {
+        *az = (float)atan2(topo.col[0], topo.col[1]);
+    }
+    return atan2(topo.col[2], sqrt(topo.col[0]*topo.col[0] + topo.col[1]*topo.col[1]));
+}
+
+//! Find contacts between one satellite and one site.
+static void contact_pair(const sgp4struc &sat, const vector<rvector> &satgeoc, double rmax, double rate, const contactsite &site, const vector<contactframe> &frame, double coarse, double utcend, vector<contactstruc> &contact)
+{
+    auto f = [&](double utc) -> double
+    {
+        return contact_elev(site, contact_geoc(sat, frame, coarse, utc)) - site.minelev;
+    };
+
+    // Widest angle from zenith at which the satellite could be visible
+    double minelev = site.minelev - CONTACT_VERTICAL_MARGIN;
+    double carg = length_rv(site.geoc) * cos(minelev) / rmax;
+    if (carg >= 1.)
+    {
+        return;
+    }
+    double lambda = acos(carg) - minelev;
+
+    vector<double> theta(frame.size());
+    for (size_t k=0; k<frame.size(); ++k)
+    {
+        double cth = dot_rv(satgeoc[k], site.up) / length_rv(satgeoc[k]);
+        theta[k] = acos(cth > 1. ? 1. : (cth < -1. ? -1. : cth));
+    }
+
+    size_t k = 0;
+    while (k + 1 < frame.size())
+    {
+        // Skip intervals the satellite cannot reach the visibility cone in
+        double dt = 86400. * (frame[k+1].utc - frame[k].utc);
+        if ((theta[k] + theta[k+1] - rate * dt) / 2. > lambda)
+        {
+            ++k;
+            continue;
+        }
+
+        // Gather the run of intervals that could not be ruled out
+        size_t kend = k + 1;
+        while (kend + 1 < frame.size())
+        {
+            dt = 86400. * (frame[kend+1].utc - frame[kend].utc);
+            if ((theta[kend] + theta[kend+1] - rate * dt) / 2. > lambda)
+            {
+                break;
+            }
+            ++kend;
+        }
+        double ta = frame[k].utc;
+        double tb = kend + 1 == frame.size() ? utcend : frame[kend].utc;
+        if (tb > utcend)
+        {
+            tb = utcend;
+        }
+        k = kend;
+
+        // Sample finely
+        size_t n = (size_t)ceil(86400. * (tb - ta) / CONTACT_FINE_STEP);
+        if (n < 2)
+        {
+            n = 2;
+        }
+        vector<double> ts(n+1);
+        vector<double> fs(n+1);
+        for (size_t j=0; j<=n; ++j)
+        {
+            ts[j] = ta + j * (tb - ta) / n;
+            fs[j] = f(ts[j]);
+        }
+
+        double lastrise = -1.;
+        for (size_t j=0; j<=n; ++j)
+        {
+            // Local maxima of the samples
+            if ((j > 0 && fs[j] < fs[j-1]) || (j < n && fs[j] <= fs[j+1]))
+            {
+                continue;
+            }
+
+            // Golden section search for the peak
+            const double gr = (sqrt(5.) - 1.) / 2.;
+            double a = ts[j > 0 ? j-1 : 0];
+            double b = ts[j < n ? j+1 : n];
+            double c = b - gr * (b - a);
+            double d = a + gr * (b - a);
+            double fc = f(c);
+            double fd = f(d);
+            while (86400. * (b - a) > CONTACT_PEAK_TOLERANCE)
+            {
+                if (fc > fd)
+                {
+                    b = d;
+                    d = c;
+                    fd = fc;
+                    c = b - gr * (b - a);
+                    fc = f(c);
+                }
+                else
+                {
+                    a = c;
+                    c = d;
+                    fc = fd;
+                    d = a + gr * (b - a);
+                    fd = f(d);
+                }
+            }
+            double tp = (a + b) / 2.;
+            double fp = f(tp);
+            if (fs[j] > fp)
+            {
+                tp = ts[j];
+                fp = fs[j];
+            }
+            if (fp <= 0.)
+            {
+                continue;
+            }
+
+            contactstruc ncontact;
+            ncontact.utcpeak = tp;
+            ncontact.elpeak = (float)(fp + site.minelev);
+
+            // Rise: bisect from the last sample below the horizon before the peak
+            ncontact.utcrise = ta;
+            for (size_t l=j+1; l>0; --l)
+            {
+                if (ts[l-1] < tp && fs[l-1] <= 0.)
+                {
+                    double lo = ts[l-1];
+                    double hi = tp;
+                    while (86400. * (hi - lo) > CONTACT_TIME_TOLERANCE)
+                    {
+                        double mid = (lo + hi) / 2.;
+                        if (f(mid) > 0.)
+                        {
+                            hi = mid;
+                        }
+                        else
+                        {
+                            lo = mid;
+                        }
+                    }
+                    ncontact.utcrise = hi;
+                    break;
+                }
+                if (l-1 == 0)
+                {
+                    break;
+                }
+            }
+
+            // Two maxima in one pass give the same rise
+            if (lastrise >= 0. && 86400. * fabs(ncontact.utcrise - lastrise) < CONTACT_TIME_TOLERANCE)
+            {
+                if (ncontact.elpeak > contact.back().elpeak)
+                {
+                    contact.back().utcpeak = ncontact.utcpeak;
+                    contact.back().elpeak = ncontact.elpeak;
+                }
+                continue;
+            }
+            lastrise = ncontact.utcrise;
+
+            // Set: bisect to the first sample below the horizon after the peak
+            ncontact.utcset = tb;
+            for (size_t u=(j > 0 ? j-1 : 0); u<=n; ++u)
+            {
+                if (ts[u] > tp && fs[u] <= 0.)
+                {
+                    double lo = tp;
+                    double hi = ts[u];
+                    while (86400. * (hi - lo) > CONTACT_TIME_TOLERANCE)
+                    {
+                        double mid = (lo + hi) / 2.;
+                        if (f(mid) > 0.)
+                        {
+                            lo = mid;
+                        }
+                        else
+                        {
+                            hi = mid;
+                        }
+                    }
+                    ncontact.utcset = lo;
+                    break;
+                }
+            }
+
+            contact_elev(site, contact_geoc(sat, frame, coarse, ncontact.utcrise), &ncontact.azrise);
+            contact_elev(site, contact_geoc(sat, frame, coarse, ncontact.utcset), &ncontact.azset);
+            contact.push_back(ncontact);
+        }
+    }
+}
+
+//! Find contact windows
+/*! Find every window in which each satellite is above the minimum elevation of each site,
+ * between the requested times. See \ref contactlib for the method.
+    \param sat Satellites, as ::sgp4struc initialized with ::sgp4_init.
+    \param site Ground sites.
+    \param utcbegin Start of search, UTC in Modified Julian Days.
+    \param utcend End of search, UTC in Modified Julian Days.
+    \param contact Vector of ::contactstruc to be filled, sorted by rise time.
+    \param threads Number of threads to use.
+    \param coarse Coarse search step, in seconds.
+    \return Number of contacts found, or negative error.
+*/
+int32_t contact_find(const vector<sgp4struc> &sat, const vector<contactsitestruc> &site, double utcbegin, double utcend, vector<contactstruc> &contact, uint16_t threads, double coarse)
+{
+    contact.clear();
+
+    if (!std::isfinite(utcbegin) || !std::isfinite(utcend) || utcend <= utcbegin)
+    {
+        return CONVERT_ERROR_UTC;
+    }
+    if (coarse <= 0.)
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+
+    // Earth orientation at each coarse step, calculated here because it is not reentrant
+    vector<contactframe> frame;
+    for (double utc=utcbegin; ; utc+=coarse/86400.)
+    {
+        if (utc > utcend)
+        {
+            utc = utcend;
+        }
+        contactframe nframe;
+        nframe.utc = utc;
+        nframe.gmst = utc2gmst1982(utc);
+        pef2itrs(utc, &nframe.pw);
+        frame.push_back(nframe);
+        if (utc >= utcend)
+        {
+            break;
+        }
+    }
+
+    vector<contactsite> csite(site.size());
+    for (size_t j=0; j<site.size(); ++j)
+    {
+        geoidpos geod;
+        cartpos geoc;
+        geod.s = site[j].geod;
+        geod.v = geod.a = {0., 0., 0.};
+        geod2geoc(geod, geoc);
+        csite[j].geoc = geoc.s;
+        csite[j].up = rv_normal(geoc.s);
+        double clon = cos(site[j].geod.lon);
+        double slon = sin(site[j].geod.lon);
+        double clat = cos(site[j].geod.lat);
+        double slat = sin(site[j].geod.lat);
+        csite[j].g2t.row[0] = {{-slon, clon, 0.}};
+        csite[j].g2t.row[1] = {{-slat*clon, -slat*slon, clat}};
+        csite[j].g2t.row[2] = {{clat*clon, clat*slon, slat}};
+        csite[j].minelev = site[j].minelev;
+    }
+
+    // Satellite positions at each coarse step, and bounds on radius and angular rate
+    vector<vector<rvector>> satgeoc(sat.size());
+    vector<double> rmax(sat.size());
+    vector<double> rate(sat.size());
+    contact_run(sat.size(), threads, [&](size_t i)
+    {
+        satgeoc[i].resize(frame.size());
+        for (size_t k=0; k<frame.size(); ++k)
+        {
+            satgeoc[i][k] = contact_geoc(sat[i], frame, coarse, frame[k].utc);
+        }
+        double a = REARTHM * sat[i].aodp;
+        double rp = a * (1. - sat[i].e);
+        rmax[i] = 1.05 * a * (1. + sat[i].e);
+        rate[i] = 1.2 * sqrt(GM * (1. + sat[i].e) / (rp * rp * rp)) + CONVERT_EARTH_SIDEREAL_RATE;
+    });
+
+    // Every satellite against every site
+    vector<vector<contactstruc>> pcontact(sat.size() * site.size());
+    contact_run(pcontact.size(), threads, [&](size_t p)
+    {
+        size_t i = p / site.size();
+        size_t j = p % site.size();
+        contact_pair(sat[i], satgeoc[i], rmax[i], rate[i], csite[j], frame, coarse, utcend, pcontact[p]);
+        for (contactstruc &ncontact : pcontact[p])
+        {
+            ncontact.satidx = i;
+            ncontact.siteidx = j;
+        }
+    });
+
+    for (vector<contactstruc> &pc : pcontact)
+    {
+        contact.insert(contact.end(), pc.begin(), pc.end());
+    }
+    std::sort(contact.begin(), contact.end(), [](const contactstruc &a, const contactstruc &b)
+    {
+        return a.utcrise < b.utcrise;
+    });
+
+    return contact.size();
+}
+
+//! Contact windows as events
+/*! Turn each contact window in to a rise (::EVENT_TYPE_GS), peak (::EVENT_TYPE_GSMAX) and set
+ * (::EVENT_TYPE_GS with ::EVENT_FLAG_EXIT) ::shorteventstruc. The satellite is the node of the
+ * event and the site its name and data. The events can be copied to the namespace, or logged
+ * with ::contact_log_events.
+    \param contact Contact windows from ::contact_find.
+    \param satname Names of the satellites, in the order given to ::contact_find.
+    \param sitename Names of the sites, in the order given to ::contact_find.
+    \param event Vector of ::shorteventstruc to be filled, sorted by time.
+    \return Number of events, or negative error.
+*/
+int32_t contact_events(const vector<contactstruc> &contact, const vector<string> &satname, const vector<string> &sitename, vector<shorteventstruc> &event)
+{
+    event.clear();
+    for (const contactstruc &ncontact : contact)
+    {
+        if (ncontact.satidx >= satname.size() || ncontact.siteidx >= sitename.size())
+        {
+            return GENERAL_ERROR_INPUT;
+        }
+
+        shorteventstruc nevent;
+        memset(&nevent, 0, sizeof(shorteventstruc));
+        strncpy(nevent.node, satname[ncontact.satidx].c_str(), COSMOS_MAX_NAME);
+        strncpy(nevent.name, sitename[ncontact.siteidx].c_str(), COSMOS_MAX_NAME);
+        strncpy(nevent.data, sitename[ncontact.siteidx].c_str(), COSMOS_MAX_NAME);
+
+        nevent.utc = ncontact.utcrise;
+        nevent.type = EVENT_TYPE_GS;
+        nevent.flag = EVENT_FLAG_PAIR;
+        nevent.value = ncontact.azrise;
+        nevent.ctime = 86400. * (ncontact.utcset - ncontact.utcrise);
+        event.push_back(nevent);
+
+        nevent.utc = ncontact.utcpeak;
+        nevent.type = EVENT_TYPE_GSMAX;
+        nevent.flag = 0;
+        nevent.value = ncontact.elpeak;
+        nevent.ctime = 0.;
+        event.push_back(nevent);
+
+        nevent.utc = ncontact.utcset;
+        nevent.type = EVENT_TYPE_GS;
+        nevent.flag = EVENT_FLAG_PAIR | EVENT_FLAG_EXIT;
+        nevent.value = ncontact.azset;
+        event.push_back(nevent);
+    }
+    std::sort(event.begin(), event.end(), [](const shorteventstruc &a, const shorteventstruc &b)
+    {
+        return a.utc < b.utc;
+    });
+
+    return event.size();
+}
+
+//! Log contact events
+/*! Write events from ::contact_events to the event log of each one's satellite with
+ * ::log_write, as agents log the events they find: each is copied in to the event of the
+ * ::cosmosdatastruc and written out with ::json_of_event.
+    \param event Events from ::contact_events.
+    \param logdate Date for the log files, as for ::log_write.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    \param cdata Reference to ::cosmosdatastruc to use. Its event is overwritten.
+    \return Number of events logged, or negative error.
+*/
+int32_t contact_log_events(const vector<shorteventstruc> &event, double logdate, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
+{
+    if (cdata.event.empty())
+    {
+        return JSON_ERROR_NOJMAP;
+    }
+
+    string jstring;
+    for (const shorteventstruc &nevent : event)
+    {
+        memcpy(&cdata.event[0].s, &nevent, sizeof(shorteventstruc));
+        cdata.event[0].l.condition[0] = 0;
+        log_write(nevent.node, DATA_LOG_TYPE_EVENT, logdate, json_of_event(jstring, cmeta, cdata));
+    }
+
+    return event.size();
+}
+
+//! @}
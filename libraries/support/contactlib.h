@@ -0,0 +1,125 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+/*! \file contactlib.h
+*	\brief Contact window library header file
+*/
+
+//! \ingroup support
+//! \defgroup contactlib Contact window library
+//! Visibility windows between satellites and ground sites.
+//!
+//! Finds every interval during which each of a set of satellites is above the minimum elevation
+//! of each of a set of ground sites. Satellites are given as ::sgp4struc records, initialized with
+//! ::sgp4_init, and sites as Geodetic locations.
+//!
+//! The search first steps through time at a coarse interval. For each satellite and site, the
+//! angle between the satellite and the site zenith, together with a bound on how fast that angle
+//! can change, is used to rule out whole intervals in which the satellite cannot reach the visibility
+//! cone. Only the remaining intervals are sampled finely, and the rise, peak and set of each contact
+//! are then found by root finding and golden section search. Satellite and site pairs are processed
+//! in parallel.
+//!
+//! The results can be turned in to ::shorteventstruc for the namespace with ::contact_events, and
+//! written to the event log of each satellite with ::contact_log_events.
+
+#ifndef _CONTACTLIB_H
+#define _CONTACTLIB_H 1
+
+#include "support/configCosmos.h"
+#include "support/convertlib.h"
+#include "support/jsondef.h"
+
+//! \ingroup contactlib
+//! \defgroup contactlib_constants Contact window constants
+//! @{
+
+//! Default coarse search step, in seconds
+#define CONTACT_COARSE_STEP 120.
+//! Fine search step inside intervals that could not be ruled out, in seconds
+#define CONTACT_FINE_STEP 10.
+//! Tolerance for rise and set times, in seconds
+#define CONTACT_TIME_TOLERANCE .1
+//! Tolerance for peak time, in seconds
+#define CONTACT_PEAK_TOLERANCE 1.
+//! Allowance for the difference between Geodetic and Geocentric vertical, in radians
+#define CONTACT_VERTICAL_MARGIN .01
+
+//! @}
+
+//! \ingroup contactlib
+//! \defgroup contactlib_typedefs Contact window typedefs
+//! @{
+
+//! Ground site for contact search
+struct contactsitestruc
+{
+    //! Geodetic location of site
+    gvector geod;
+    //! Minimum elevation for contact, in radians
+    float minelev;
+};
+
+//! Contact window
+/*! One interval during which a satellite is above the minimum elevation of a site. Windows that
+ * are already open at the start, or still open at the end, of the search are cut at those times.
+*/
+struct contactstruc
+{
+    //! Index of satellite in the list given to ::contact_find
+    uint32_t satidx;
+    //! Index of site in the list given to ::contact_find
+    uint32_t siteidx;
+    //! Time of rise, UTC in Modified Julian Days
+    double utcrise;
+    //! Time of peak elevation, UTC in Modified Julian Days
+    double utcpeak;
+    //! Time of set, UTC in Modified Julian Days
+    double utcset;
+    //! Peak elevation, in radians
+    float elpeak;
+    //! Azimuth at rise, in radians
+    float azrise;
+    //! Azimuth at set, in radians
+    float azset;
+};
+
+//! @}
+
+//! \ingroup contactlib
+//! \defgroup contactlib_functions Contact window functions
+//! @{
+
+int32_t contact_find(const vector<sgp4struc> &sat, const vector<contactsitestruc> &site, double utcbegin, double utcend, vector<contactstruc> &contact, uint16_t threads=1, double coarse=CONTACT_COARSE_STEP);
+int32_t contact_events(const vector<contactstruc> &contact, const vector<string> &satname, const vector<string> &sitename, vector<shorteventstruc> &event);
+int32_t contact_log_events(const vector<shorteventstruc> &event, double logdate, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
+
+//! @}
+
+#endif
@@ -105,6 +105,14 @@
 #define SGP4_XKMPER 6378.135
 #define SGP4_AE 1.
 
+// Batch conversion parameters
+//! Smallest number of elements given to one thread in a batch conversion
+#define CONVERT_BATCH_MIN_SLICE 1024
+//! Seconds between full Earth orientation calculations in batch ECI to GEOC conversion
+#define CONVERT_BATCH_EOP_INTERVAL 60.
+//! Rate of the Earth's rotation relative to the equinox, in radians per second
+#define CONVERT_EARTH_SIDEREAL_RATE 7.292115855e-5
+
 // JPL Planetary Ephemeris stuff
 #define JPL_MERCURY 1
 #define JPL_VENUS 2
@@ -456,6 +464,57 @@ struct tlestruc
 	uint32_t orbit;
 };
 
+//! SGP4 record
+/*! The elements of a ::tlestruc, together with all of the constants SGP4
+ * derives from them, so that one initialization can be used for any number
+ * of propagations. Filled in by ::sgp4_init.
+*/
+struct sgp4struc
+{
+	//! Epoch of the elements, UTC in Modified Julian Days
+	double utc;
+	//! Satellite number
+	uint16_t snumber;
+	//! Set if perigee is below 220 km and the simplified equations are used
+	uint16_t isimp;
+	// Elements
+	double bstar;
+	double i;
+	double raan;
+	double e;
+	double ap;
+	double ma;
+	// Derived constants
+	double xnodp;
+	double aodp;
+	double cosio;
+	double sinio;
+	double x3thm1;
+	double x7thm1;
+	double ximth2;
+	double eta;
+	double c1;
+	double c4;
+	double c5;
+	double xmdot;
+	double omgdot;
+	double xnodot;
+	double omgcof;
+	double xmcof;
+	double xnodcf;
+	double t2cof;
+	double xlcof;
+	double aycof;
+	double delmo;
+	double sinmo;
+	double d2;
+	double d3;
+	double d4;
+	double t3cof;
+	double t4cof;
+	double t5cof;
+};
+
 //! STK positions structure
 /*! Structure for holding an array of position structures generated by STK.
 	\see ::cposstruc
@@ -43,9 +43,12 @@
 #endif // UNUSED_VARIABLE_LOCALDEF
 
 #include <iostream>
+#include <functional>
 
 uint16_t tlecount;
 
+static void eci2kep_sun(cartpos &eci, rvector rsun, kepstruc &kep);
+
 //! \addtogroup convertlib_functions
 //! @{
 
@@ -2174,6 +2177,23 @@ void true2teme(double ep0, rmatrix *rm)
 	*rm = rm_change_around_z(-eeq);
 }
 
+//! TEME to GCRF rotation matrix
+/*! Single rotation matrix combining all of the steps ::tle2eci uses to take a
+ * TEME position to GCRF: Equation of Equinoxes, Nutation, Precession and Bias.
+	\param utc Epoch, UTC in MJD
+	\param rm pointer to rotation matrix
+*/
+void teme2gcrf(double utc, rmatrix *rm)
+{
+	rmatrix sm, nm, pm, bm;
+
+	teme2true(utc, &sm);
+	true2mean(utc, &nm);
+	mean2j2000(utc, &pm);
+	j20002gcrf(&bm);
+	*rm = rm_mmult(bm, rm_mmult(pm, rm_mmult(nm, sm)));
+}
+
 void true2pef(double utc, rmatrix *rm)
 {
 	double gast = utc2gast(utc);
@@ -2197,8 +2217,8 @@ void pef2itrs(double utc, rmatrix *rm)
 
 void itrs2pef(double utc, rmatrix *rm)
 {
-	static rmatrix orm;
-	static double outc = 0.;
+	static thread_local rmatrix orm;
+	static thread_local double outc = 0.;
 
 	if (utc == outc)
 	{
@@ -2222,8 +2242,8 @@ void itrs2pef(double utc, rmatrix *rm)
 */
 void mean2true(double ep0, rmatrix *pm)
 {
-	static rmatrix opm;
-	static double oep0 = 0.;
+	static thread_local rmatrix opm;
+	static thread_local double oep0 = 0.;
 
 	if (ep0 == oep0)
 	{
@@ -2247,8 +2267,8 @@ void mean2true(double ep0, rmatrix *pm)
 */
 void true2mean(double ep0, rmatrix *pm)
 {
-	static rmatrix opm;
-	static double oep0 = 0.;
+	static thread_local rmatrix opm;
+	static thread_local double oep0 = 0.;
 //	double nuts[4], jt;
 	double eps;
 	double cdp, sdp, ce, se, cde, sde;
@@ -2299,8 +2319,8 @@ void mean2j2000(double ep0, rmatrix *pm)
 {
 //	double t0, t, tas2r, w, zeta, z, theta;
 //	double ca, sa, cb, sb, cg, sg;
-	static rmatrix opm;
-	static double oep0 = 0.;
+	static thread_local rmatrix opm;
+	static thread_local double oep0 = 0.;
 
 	if (ep0 == oep0)
 	{
@@ -2358,8 +2378,8 @@ void mean2j2000(double ep0, rmatrix *pm)
 */
 void itrs2gcrf(double utc, rmatrix *rnp, rmatrix *rm, rmatrix *drm, rmatrix *ddrm)
 {
-	static rmatrix orm, odrm, oddrm, ornp;
-	static double outc = 0.;
+	static thread_local rmatrix orm, odrm, oddrm, ornp;
+	static thread_local double outc = 0.;
 
 	if (utc == outc)
 	{
@@ -2394,10 +2414,10 @@ void gcrf2itrs(double utc, rmatrix *rnp, rmatrix *rm, rmatrix *drm, rmatrix *ddr
 	double ut1;
 	rmatrix nrm[3], ndrm, nddrm;
 	rmatrix pm, nm, sm, pw = {{{{0.}}}};
-	static rmatrix bm = {{{{1.,-0.000273e-8,9.740996e-8}},{{0.000273e-8,1.,1.324146e-8}},{{-9.740996e-8,-1.324146e-8,1.}}}};
-	static rmatrix orm, odrm, oddrm, ornp;
-	static double outc = 0.;
-	static double realsec = 0.;
+	rmatrix bm;
+	static thread_local rmatrix orm, odrm, oddrm, ornp;
+	static thread_local double outc = 0.;
+	static thread_local double realsec = 0.;
 	int i;
 
     if (!std::isfinite(utc))
@@ -2512,8 +2532,8 @@ void j20002mean(double ep1, rmatrix *pm)
 {
 	double t, tas2r, w, zeta, z, theta;
 	double ca, sa, cb, sb, cg, sg;
-	static rmatrix opm;
-	static double oep1 = 0.;
+	static thread_local rmatrix opm;
+	static thread_local double oep1 = 0.;
 
 	if (ep1 == oep1)
 	{
@@ -2658,11 +2678,28 @@ void kep2eci(kepstruc &kep, cartpos &eci)
 }
 
 void eci2kep(cartpos &eci,kepstruc &kep)
+{
+	rvector rsun = {{0.}};
+	cartpos earthpos;
+
+	jplpos(JPL_EARTH,JPL_SUN_BARY,utc2tt(eci.utc),&earthpos);
+	rsun = earthpos.s;
+	normalize_rv(rsun);
+	eci2kep_sun(eci, rsun, kep);
+}
+
+//! ECI to Keplerian with known Sun direction
+/*! Core of ::eci2kep, with the unit vector from the Earth to the Sun supplied
+ * by the caller so that no ephemeris lookup is needed. Reentrant.
+	\param eci Source ECI position.
+	\param rsun Unit vector from Earth to Sun at the time of eci.
+	\param kep Destination Keplerian elements.
+*/
+static void eci2kep_sun(cartpos &eci, rvector rsun, kepstruc &kep)
 {
 	double magr, magv, magn, sme, rdotv, temp;
 	double c1, hk, magh;
-	rvector nbar = {{0.}}, ebar = {{0.}}, rsun = {{0.}}, hsat = {{0.}};
-	cartpos earthpos;
+	rvector nbar = {{0.}}, ebar = {{0.}}, hsat = {{0.}};
 
 	kep.utc = eci.utc;
 
@@ -2679,9 +2716,6 @@ void eci2kep(cartpos &eci,kepstruc &kep)
 		kep.fa = acos(length_rv(kep.h)/(magr*magv));
 	kep.eta = magv*magv/2. - GM/magr;
 	magh = length_rv(kep.h);
-	jplpos(JPL_EARTH,JPL_SUN_BARY,utc2tt(eci.utc),&earthpos);
-	rsun = earthpos.s;
-	normalize_rv(rsun);
 	hsat = kep.h;
 	normalize_rv(hsat);
 	kep.beta = asin(dot_rv(rsun,hsat));
@@ -2809,7 +2843,7 @@ void topo2azel(rvector tpos, float *az, float *el)
 	*/
 int lines2eci(double utc, std::vector<tlestruc>lines, cartpos &eci)
 {
-	static uint16_t lindex=0;
+	static thread_local uint16_t lindex=0;
 	int32_t iretn;
 
 	if (utc >= lines[lindex].utc)
@@ -2830,160 +2864,177 @@ int lines2eci(double utc, std::vector<tlestruc>lines, cartpos &eci)
 	return (iretn);
 }
 
-/**
-* SGP4 propagator algoritm
-* @param utc Specified time as Modified Julian Date
-* @param tle Two Line Element structure, given as pointer to a ::tlestruc
-* @param pos_teme result from SGP4 algorithm is a cartesian state given in TEME frame, as pointer to a ::cartpos
+//! Initialize SGP4 record
+/*! Derive all of the constants that SGP4 needs for one Two Line Element, so that
+ * they do not need to be recalculated for each propagation.
+	\param tle Two Line Element to initialize from.
+	\param sat ::sgp4struc to be filled in.
+	\return Zero, or negative error.
 */
-int sgp4(double utc, tlestruc tle, cartpos &pos_teme)
+int32_t sgp4_init(const tlestruc &tle, sgp4struc &sat)
+{
+    double temp, temp1, temp2, temp3;
+    double a1, ao, c2, c3, coef, coef1, theta4, c1sq;
+    double theta2, betao2, betao, delo, del1, s4, qoms24, x1m5th, xhdot1;
+    double perige, eosq, pinvsq, tsi, etasq, eeta, psisq, g;
+
+    if (tle.mm <= 0. || !std::isfinite(tle.mm) || !std::isfinite(tle.utc))
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+
+    sat.utc = tle.utc;
+    sat.snumber = tle.snumber;
+    sat.bstar = tle.bstar;
+    sat.i = tle.i;
+    sat.raan = tle.raan;
+    sat.e = tle.e;
+    sat.ap = tle.ap;
+    sat.ma = tle.ma;
+
+    // RECOVER ORIGINAL MEAN MOTION ( xnodp ) AND SEMIMAJOR AXIS (aodp)
+    // FROM INPUT ELEMENTS
+    a1=pow((SGP4_XKE/ tle.mm ),SGP4_TOTHRD);
+    sat.cosio = cos(tle.i);
+    theta2=sat.cosio * sat.cosio;
+    sat.x3thm1 =3.*theta2-1.;
+    eosq = tle.e * tle.e;
+    betao2=1.- eosq;
+    betao=sqrt(betao2);
+    del1=1.5*SGP4_CK2*sat.x3thm1 /(a1*a1*betao*betao2);
+    ao=a1*(1.-del1*(.5*SGP4_TOTHRD+del1*(1.+134./81.*del1)));
+    delo=1.5*SGP4_CK2*sat.x3thm1 /(ao*ao*betao*betao2);
+    sat.xnodp = tle.mm /(1.+delo);
+    sat.aodp=ao/(1.-delo);
+    // INITIALIZATION
+    // FOR PERIGEE LESS THAN 220 KILOMETERS, THE isimp FLAG IS SET AND
+    // THE EQUATIONS ARE TRUNCATED TO LINEAR VARIATION IN sqrt A AND
+    // QUADRATIC VARIATION IN MEAN ANOMALY. ALSO, THE c3 TERM, THE
+    // DELTA alpha TERM, AND THE DELTA M TERM ARE DROPPED.
+    sat.isimp=0;
+    if((sat.aodp*(1.- tle.e)/SGP4_AE) < (220./SGP4_XKMPER+SGP4_AE))
+        sat.isimp=1;
+    // FOR PERIGEE BELOW 156 KM, THE VALUES OF
+    // S AND SGP4_QOMS2T ARE ALTERED
+    s4=SGP4_S;
+    qoms24=SGP4_QOMS2T;
+    perige=(sat.aodp*(1.- tle.e )-SGP4_AE)*SGP4_XKMPER;
+    if(perige < 156.)
+    {
+        s4=perige-78.;
+        if(perige <= 98.)
+        {
+            s4=20.;
+            qoms24=pow(((120.-s4)*SGP4_AE/SGP4_XKMPER),4.);
+            s4=s4/SGP4_XKMPER+SGP4_AE;
+        }
+    }
+    pinvsq = 1./(sat.aodp*sat.aodp*betao2*betao2);
+    tsi =1./(sat.aodp-s4);
+    sat.eta=sat.aodp* tle.e * tsi;
+    etasq=sat.eta*sat.eta;
+    eeta= tle.e *sat.eta;
+    psisq=fabs(1.-etasq);
+    coef=qoms24*pow(tsi,4.);
+    coef1=coef/pow(psisq,3.5);
+    c2=coef1* sat.xnodp *(sat.aodp*(1.+1.5*etasq+eeta*(4.+etasq))+.75* SGP4_CK2*tsi/psisq*sat.x3thm1 *(8.+3.*etasq*(8.+etasq)));
+    sat.c1 = tle.bstar *c2;
+    sat.sinio =sin( tle.i );
+    g =-SGP4_XJ3/SGP4_CK2*pow(SGP4_AE,3.);
+    c3 =coef*tsi*g* sat.xnodp *SGP4_AE*sat.sinio / tle.e;
+    sat.ximth2 =1.-theta2;
+    sat.c4 =2.* sat.xnodp *coef1*sat.aodp*betao2*(sat.eta* (2.+.5*etasq)+ tle.e *(.5+2.*etasq)-2.*SGP4_CK2*tsi/ (sat.aodp*psisq)*(-3.*sat.x3thm1 *(1.-2.*eeta+etasq* (1.5-.5*eeta))+.75*sat.ximth2*(2.*etasq-eeta* (1.+etasq))*cos(2.* tle.ap )));
+    sat.c5 =2.*coef1*sat.aodp*betao2*(1.+2.75*(etasq+eeta)+eeta*etasq);
+    theta4 =theta2*theta2;
+    temp1 =3.*SGP4_CK2*pinvsq* sat.xnodp;
+    temp2 = temp1*SGP4_CK2*pinvsq;
+    temp3 =1.25*SGP4_CK4*pinvsq*pinvsq* sat.xnodp;
+    sat.xmdot = sat.xnodp +.5* temp1*betao*sat.x3thm1 +.0625* temp2*betao* (13.-78.*theta2+137.*theta4);
+    x1m5th =1.-5.*theta2;
+    sat.omgdot =-.5* temp1*x1m5th+.0625* temp2*(7.-114.*theta2+ 395.*theta4)+ temp3*(3.-36.*theta2+49.*theta4);
+    xhdot1 =- temp1*sat.cosio;
+    sat.xnodot =xhdot1+(.5* temp2*(4.-19.*theta2)+2.* temp3*(3.- 7.*theta2))*sat.cosio;
+    sat.omgcof = tle.bstar *c3*cos( tle.ap );
+    sat.xmcof =-SGP4_TOTHRD*coef* tle.bstar *SGP4_AE/eeta;
+    sat.xnodcf =3.5*betao2*xhdot1*sat.c1;
+    sat.t2cof =1.5*sat.c1;
+    sat.xlcof =.125*g*sat.sinio *(3.+5.*sat.cosio )/(1.+sat.cosio );
+    sat.aycof =.25*g*sat.sinio;
+    sat.delmo =pow((1.+sat.eta*cos( tle.ma )),3.);
+    sat.sinmo =sin( tle.ma );
+    sat.x7thm1 =7.*theta2-1.;
+    sat.d2 = sat.d3 = sat.d4 = sat.t3cof = sat.t4cof = sat.t5cof = 0.;
+    if(sat.isimp != 1)
+    {
+        c1sq=sat.c1*sat.c1;
+        sat.d2=4.*sat.aodp*tsi*c1sq;
+        temp =sat.d2*tsi*sat.c1/3.;
+        sat.d3=(17.*sat.aodp+s4)* temp;
+        sat.d4=.5* temp *sat.aodp*tsi*(221.*sat.aodp+31.*s4)*sat.c1;
+        sat.t3cof=sat.d2+2.*c1sq;
+        sat.t4cof=.25*(3.*sat.d3+sat.c1*(12.*sat.d2+10.*c1sq));
+        sat.t5cof=.2*(3.*sat.d4+12.*sat.c1*sat.d3+6.*sat.d2*sat.d2+15.*c1sq*( 2.*sat.d2+c1sq));
+    }
+
+    return 0;
+}
+
+//! Propagate SGP4 record
+/*! Calculate the TEME position of a satellite from its precomputed ::sgp4struc.
+ * Uses no static state, so may be called from multiple threads.
+	\param sat ::sgp4struc initialized with ::sgp4_init.
+	\param utc Specified time as Modified Julian Date
+	\param pos_teme Resulting cartesian state in TEME frame.
+	\return Zero, or negative error.
+*/
+int32_t sgp4_propagate(const sgp4struc &sat, double utc, cartpos &pos_teme)
 {
-    //	rmatrix pm = {{{{0.}}}};
-    //	static int lsnumber=-99;
-    static double c1=0.;
-    static double cosio=0. ,x3thm1=0. , xnodp=0. ,aodp=0.,isimp=0.,eta=0.,sinio=0. ,ximth2=0.,c4=0.,c5=0.;
-    static double xmdot=0.,omgdot=0., xnodot=0.,omgcof=0.,xmcof=0., xnodcf=0.,t2cof=0.,xlcof=0.,aycof=0.;
     int i;
     double temp, temp1, temp2, temp3, temp4, temp5, temp6;
     double tempa, tempe, templ;
-    double ao, a1, c2, c3, coef, coef1, theta4, c1sq;
-    double theta2, betao2, betao, delo, del1, s4, qoms24, x1m5th, xhdot1;
-    double perige, eosq, pinvsq, tsi, etasq, eeta, psisq, g, xmdf;
+    double xmdf;
     double tsince, omgadf, alpha, xnoddf, xmp, tsq, xnode, delomg, delm;
     double tcube, tfour, a, e, xl, beta, axn, xn, xll, ayn, capu, aynl;
     double xlt, sinepw, cosepw, epw, ecose, esine,  pl, r, elsq;
     double rdot, rfdot, cosu, sinu, u, sin2u, cos2u, uk, rk, ux, uy, uz;
     double vx, vy, vz, xinck, rdotk, rfdotk, sinuk, cosuk, sinik, cosik, xnodek;
-    double xmx, xmy, sinnok, cosnok;
-    //	locstruc loc;
-    static double lutc=0.;
-    static uint16_t lsnumber=0;
-
-    static double delmo,sinmo,x7thm1,d2,d3,d4,t3cof,t4cof,t5cof, betal;
-
-    if (tle.utc != lutc || tle.snumber != lsnumber)
-    {
-        // RECOVER ORIGINAL MEAN MOTION ( xnodp ) AND SEMIMAJOR AXIS (aodp)
-        // FROM INPUT ELEMENTS
-        a1=pow((SGP4_XKE/ tle.mm ),SGP4_TOTHRD);
-        cosio = cos(tle.i);
-        theta2=cosio * cosio;
-        x3thm1 =3.*theta2-1.;
-        eosq = tle.e * tle.e;
-        betao2=1.- eosq;
-        betao=sqrt(betao2);
-        del1=1.5*SGP4_CK2*x3thm1 /(a1*a1*betao*betao2);
-        ao=a1*(1.-del1*(.5*SGP4_TOTHRD+del1*(1.+134./81.*del1)));
-        delo=1.5*SGP4_CK2*x3thm1 /(ao*ao*betao*betao2);
-        xnodp = tle.mm /(1.+delo);
-        aodp=ao/(1.-delo);
-        // INITIALIZATION
-        // FOR PERIGEE LESS THAN 220 KILOMETERS, THE isimp FLAG IS SET AND
-        // THE EQUATIONS ARE TRUNCATED TO LINEAR VARIATION IN sqrt A AND
-        // QUADRATIC VARIATION IN MEAN ANOMALY. ALSO, THE c3 TERM, THE
-        // DELTA alpha TERM, AND THE DELTA M TERM ARE DROPPED.
-        isimp=0;
-        if((aodp*(1.- tle.e)/SGP4_AE) < (220./SGP4_XKMPER+SGP4_AE))
-            isimp=1;
-        // FOR PERIGEE BELOW 156 KM, THE VALUES OF
-        // S AND SGP4_QOMS2T ARE ALTERED
-        s4=SGP4_S;
-        qoms24=SGP4_QOMS2T;
-        perige=(aodp*(1.- tle.e )-SGP4_AE)*SGP4_XKMPER;
-        if(perige < 156.)
-        {
-            s4=perige-78.;
-            if(perige <= 98.)
-            {
-                s4=20.;
-                qoms24=pow(((120.-s4)*SGP4_AE/SGP4_XKMPER),4.);
-                s4=s4/SGP4_XKMPER+SGP4_AE;
-            }
-        }
-        pinvsq = 1./(aodp*aodp*betao2*betao2);
-        tsi =1./(aodp-s4);
-        eta=aodp* tle.e * tsi;
-        etasq=eta*eta;
-        eeta= tle.e *eta;
-        psisq=fabs(1.-etasq);
-        coef=qoms24*pow(tsi,4.);
-        coef1=coef/pow(psisq,3.5);
-        c2=coef1* xnodp *(aodp*(1.+1.5*etasq+eeta*(4.+etasq))+.75* SGP4_CK2*tsi/psisq*x3thm1 *(8.+3.*etasq*(8.+etasq)));
-        c1 = tle.bstar *c2;
-        sinio =sin( tle.i );
-        g =-SGP4_XJ3/SGP4_CK2*pow(SGP4_AE,3.);
-        c3 =coef*tsi*g* xnodp *SGP4_AE*sinio / tle.e;
-        ximth2 =1.-theta2;
-        c4 =2.* xnodp *coef1*aodp*betao2*(eta* (2.+.5*etasq)+ tle.e *(.5+2.*etasq)-2.*SGP4_CK2*tsi/ (aodp*psisq)*(-3.*x3thm1 *(1.-2.*eeta+etasq* (1.5-.5*eeta))+.75*ximth2*(2.*etasq-eeta* (1.+etasq))*cos(2.* tle.ap )));
-        c5 =2.*coef1*aodp*betao2*(1.+2.75*(etasq+eeta)+eeta*etasq);
-        theta4 =theta2*theta2;
-        temp1 =3.*SGP4_CK2*pinvsq* xnodp;
-        temp2 = temp1*SGP4_CK2*pinvsq;
-        temp3 =1.25*SGP4_CK4*pinvsq*pinvsq* xnodp;
-        xmdot = xnodp +.5* temp1*betao*x3thm1 +.0625* temp2*betao* (13.-78.*theta2+137.*theta4);
-        x1m5th =1.-5.*theta2;
-        omgdot =-.5* temp1*x1m5th+.0625* temp2*(7.-114.*theta2+ 395.*theta4)+ temp3*(3.-36.*theta2+49.*theta4);
-        xhdot1 =- temp1*cosio;
-        xnodot =xhdot1+(.5* temp2*(4.-19.*theta2)+2.* temp3*(3.- 7.*theta2))*cosio;
-        omgcof = tle.bstar *c3*cos( tle.ap );
-        xmcof =-SGP4_TOTHRD*coef* tle.bstar *SGP4_AE/eeta;
-        xnodcf =3.5*betao2*xhdot1*c1;
-        t2cof =1.5*c1;
-        xlcof =.125*g*sinio *(3.+5.*cosio )/(1.+cosio );
-        aycof =.25*g*sinio;
-        delmo =pow((1.+eta*cos( tle.ma )),3.);
-        sinmo =sin( tle.ma );
-        x7thm1 =7.*theta2-1.;
-        if(isimp != 1)
-        {
-            c1sq=c1*c1;
-            d2=4.*aodp*tsi*c1sq;
-            temp =d2*tsi*c1/3.;
-            d3=(17.*aodp+s4)* temp;
-            d4=.5* temp *aodp*tsi*(221.*aodp+31.*s4)*c1;
-            t3cof=d2+2.*c1sq;
-            t4cof=.25*(3.*d3+c1*(12.*d2+10.*c1sq));
-            t5cof=.2*(3.*d4+12.*c1*d3+6.*d2*d2+15.*c1sq*( 2.*d2+c1sq));
-        }
-        lsnumber = tle.snumber;
-        lutc = tle.utc;
-    }
+    double xmx, xmy, sinnok, cosnok, betal;
 
     // UPDATE FOR SECULAR GRAVITY AND ATMOSPHERIC DRAG
-    tsince = (utc - tle.utc) * 1440.;
-    xmdf = tle.ma +xmdot*tsince;
-    omgadf= tle.ap +omgdot*tsince;
-    xnoddf= tle.raan + xnodot*tsince;
+    tsince = (utc - sat.utc) * 1440.;
+    xmdf = sat.ma +sat.xmdot*tsince;
+    omgadf= sat.ap +sat.omgdot*tsince;
+    xnoddf= sat.raan + sat.xnodot*tsince;
     alpha=omgadf;
     xmp = xmdf;
     tsq=tsince*tsince;
-    xnode= xnoddf+ xnodcf*tsq;
-    tempa=1.-c1*tsince;
-    tempe= tle.bstar *c4*tsince;
-    templ=t2cof*tsq;
-    if(isimp != 1)
+    xnode= xnoddf+ sat.xnodcf*tsq;
+    tempa=1.-sat.c1*tsince;
+    tempe= sat.bstar *sat.c4*tsince;
+    templ=sat.t2cof*tsq;
+    if(sat.isimp != 1)
     {
-        delomg=omgcof*tsince;
-        delm=xmcof*(pow((1.+eta*cos( xmdf )),3.)-delmo);
+        delomg=sat.omgcof*tsince;
+        delm=sat.xmcof*(pow((1.+sat.eta*cos( xmdf )),3.)-sat.delmo);
         temp =delomg+delm;
         xmp = xmdf + temp;
         alpha=omgadf- temp;
         tcube=tsq*tsince;
         tfour=tsince*tcube;
-        tempa = tempa-d2*tsq-d3*tcube-d4*tfour;
-        tempe = tempe+ tle.bstar *c5*(sin( xmp )-sinmo);
-        templ = templ+t3cof*tcube+ tfour*(t4cof+tsince*t5cof);
+        tempa = tempa-sat.d2*tsq-sat.d3*tcube-sat.d4*tfour;
+        tempe = tempe+ sat.bstar *sat.c5*(sin( xmp )-sat.sinmo);
+        templ = templ+sat.t3cof*tcube+ tfour*(sat.t4cof+tsince*sat.t5cof);
     }
-    a =aodp* tempa * tempa;
-    e = tle.e - tempe;
-    xl= xmp +alpha+ xnode+ xnodp * templ;
+    a =sat.aodp* tempa * tempa;
+    e = sat.e - tempe;
+    xl= xmp +alpha+ xnode+ sat.xnodp * templ;
     beta=sqrt(1.-e*e);
     xn=SGP4_XKE/pow(a,1.5);
     // LONG PERIOD PERIODICS
     axn=e*cos(alpha);
     temp =1./(a*beta*beta);
-    xll= temp *xlcof*axn;
-    aynl= temp *aycof;
+    xll= temp *sat.xlcof*axn;
+    aynl= temp *sat.aycof;
     xlt=xl+xll;
     ayn=e*sin(alpha)+aynl;
     // SOLVE KEplERS EQUATION;
@@ -3024,12 +3075,12 @@ int sgp4(double utc, tlestruc tle, cartpos &pos_teme)
     temp1=SGP4_CK2* temp;
     temp2= temp1* temp;
     // UPDATE FOR SHORT PERIODICS;
-    rk =r*(1.-1.5* temp2*betal*x3thm1 )+.5* temp1*ximth2* cos2u;
-    uk=u-.25* temp2*x7thm1*sin2u;
-    xnodek= xnode+1.5* temp2*cosio *sin2u;
-    xinck= tle.i +1.5* temp2*cosio *sinio * cos2u;
-    rdotk=rdot-xn* temp1*ximth2*sin2u;
-    rfdotk=rfdot+xn* temp1*(ximth2* cos2u +1.5*x3thm1 );
+    rk =r*(1.-1.5* temp2*betal*sat.x3thm1 )+.5* temp1*sat.ximth2* cos2u;
+    uk=u-.25* temp2*sat.x7thm1*sin2u;
+    xnodek= xnode+1.5* temp2*sat.cosio *sin2u;
+    xinck= sat.i +1.5* temp2*sat.cosio *sat.sinio * cos2u;
+    rdotk=rdot-xn* temp1*sat.ximth2*sin2u;
+    rfdotk=rfdot+xn* temp1*(sat.ximth2* cos2u +1.5*sat.x3thm1 );
     // ORIENTATION VECTORS;
     sinuk =sin(uk);
     cosuk=cos(uk);
@@ -3054,6 +3105,92 @@ int sgp4(double utc, tlestruc tle, cartpos &pos_teme)
 	pos_teme.v.col[0] =REARTHM * (rdotk*ux+rfdotk*vx) / 60.;
 	pos_teme.v.col[1] =REARTHM * (rdotk*uy+rfdotk*vy) / 60.;
 	pos_teme.v.col[2] =REARTHM * (rdotk*uz+rfdotk*vz) / 60.;
+	pos_teme.utc = utc;
+
+    return 0;
+}
+
+/**
+* SGP4 propagator algoritm
+* @param utc Specified time as Modified Julian Date
+* @param tle Two Line Element structure, given as pointer to a ::tlestruc
+* @param pos_teme result from SGP4 algorithm is a cartesian state given in TEME frame, as pointer to a ::cartpos
+*/
+int sgp4(double utc, tlestruc tle, cartpos &pos_teme)
+{
+    static thread_local sgp4struc sat;
+    static thread_local double lutc=0.;
+    static thread_local uint16_t lsnumber=0;
+
+    if (tle.utc != lutc || tle.snumber != lsnumber)
+    {
+        sgp4_init(tle, sat);
+        lsnumber = tle.snumber;
+        lutc = tle.utc;
+    }
+
+    sgp4_propagate(sat, utc, pos_teme);
+    return 0;
+}
+
+//! Initialize SGP4 records
+/*! Apply ::sgp4_init to a whole set of Two Line Elements, such as those read
+ * with ::load_lines_multi.
+	\param tle Vector of Two Line Elements.
+	\param sat Vector of ::sgp4struc, resized to match.
+	\return Zero, or the first negative error.
+*/
+int32_t sgp4_init(const std::vector<tlestruc> &tle, std::vector<sgp4struc> &sat)
+{
+    sat.resize(tle.size());
+    for (size_t i=0; i<tle.size(); ++i)
+    {
+        int32_t iretn = sgp4_init(tle[i], sat[i]);
+        if (iretn < 0)
+        {
+            return iretn;
+        }
+    }
+    return 0;
+}
+
+//! Batch SGP4 propagation
+/*! Propagate many satellites to many times, returning ECI (GCRF) positions as
+ * ::tle2eci would. The TEME to GCRF rotation is calculated once per time, in
+ * the calling thread, and the satellites are then divided among the threads.
+	\param sat Vector of ::sgp4struc, initialized with ::sgp4_init.
+	\param utc Vector of times, UTC in Modified Julian Days.
+	\param eci Resulting positions, resized to sat.size() * utc.size(). The position
+	of satellite i at time j is at i * utc.size() + j.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t sgp4_batch(const std::vector<sgp4struc> &sat, const std::vector<double> &utc, std::vector<cartpos> &eci, uint16_t threads)
+{
+    std::vector<rmatrix> t2g(utc.size());
+    for (size_t j=0; j<utc.size(); ++j)
+    {
+        if (!std::isfinite(utc[j]))
+        {
+            return CONVERT_ERROR_UTC;
+        }
+        teme2gcrf(utc[j], &t2g[j]);
+    }
+
+    eci.resize(sat.size() * utc.size());
+    convert_batch_run(sat.size(), threads, [&](size_t start, size_t end)
+    {
+        for (size_t i=start; i<end; ++i)
+        {
+            cartpos *out = &eci[i * utc.size()];
+            for (size_t j=0; j<utc.size(); ++j)
+            {
+                sgp4_propagate(sat[i], utc[j], out[j]);
+                out[j].s = rv_mmult(t2g[j], out[j].s);
+                out[j].v = rv_mmult(t2g[j], out[j].v);
+            }
+        }
+    });
 
     return 0;
 }
@@ -3521,6 +3658,369 @@ int stk2eci(double utc, stkstruc &stk, cartpos &eci)
 	return 0;
 }
 
+//! Run a batch conversion over a range of elements
+/*! Divide the elements [0, count) in to contiguous slices and apply the kernel to
+ * each slice, either in the calling thread or in a set of worker threads.
+	\param count Number of elements.
+	\param threads Number of threads to split the work across. 0 or 1 runs in the calling thread.
+	\param kernel Function taking the first index, and one past the last index, of a slice.
+*/
+void convert_batch_run(size_t count, uint16_t threads, std::function<void(size_t, size_t)> kernel)
+{
+	if (threads < 2 || count < CONVERT_BATCH_MIN_SLICE * 2)
+	{
+		kernel(0, count);
+		return;
+	}
+
+	size_t slice = (count + threads - 1) / threads;
+	if (slice < CONVERT_BATCH_MIN_SLICE)
+	{
+		slice = CONVERT_BATCH_MIN_SLICE;
+	}
+
+	std::vector<std::thread> workers;
+	for (size_t start=0; start<count; start+=slice)
+	{
+		size_t end = start + slice < count ? start + slice : count;
+		workers.push_back(std::thread(kernel, start, end));
+	}
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+//! Batch GEOC to GEOD
+/*! Convert arrays of Geocentric positions to Geodetic positions. Arrays are in
+ * Structure of Arrays form so that the inner loop can be vectorized. Rather than
+ * the iteration of ::geoc2geod, Bowring's closed form solution is used, with
+ * height calculated in a form that remains valid at the poles. This agrees with
+ * ::geoc2geod to about a centimeter, the convergence tolerance of ::geoc2geod.
+	\param count Number of positions.
+	\param x Geocentric X in meters.
+	\param y Geocentric Y in meters.
+	\param z Geocentric Z in meters.
+	\param lat Resulting Geodetic latitude in radians.
+	\param lon Resulting Geodetic longitude in radians.
+	\param h Resulting Geodetic height in meters.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t geoc2geod_batch(size_t count, const double *x, const double *y, const double *z, double *lat, double *lon, double *h, uint16_t threads)
+{
+	if (x == nullptr || y == nullptr || z == nullptr || lat == nullptr || lon == nullptr || h == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	convert_batch_run(count, threads, [=](size_t start, size_t end)
+	{
+		// e2 (square of first eccentricity), ep2 (square of second eccentricity)
+		const double e2 = (1. - FRATIO2);
+		const double ep2 = e2 / FRATIO2;
+		const double b = REARTHM * FRATIO;
+		for (size_t i=start; i<end; ++i)
+		{
+			double p = sqrt(x[i]*x[i] + y[i]*y[i]);
+			double u = atan2(z[i] * REARTHM, p * b);
+			double su = sin(u);
+			double cu = cos(u);
+			double phi = atan2(z[i] + ep2 * b * su * su * su, p - e2 * REARTHM * cu * cu * cu);
+			double st = sin(phi);
+			double ct = cos(phi);
+			lon[i] = atan2(y[i], x[i]);
+			lat[i] = phi;
+			h[i] = p * ct + z[i] * st - REARTHM * sqrt(1. - e2 * st * st);
+		}
+	});
+
+	return 0;
+}
+
+//! Batch GEOD to GEOC
+/*! Convert arrays of Geodetic positions to Geocentric positions. Equivalent to
+ * the position part of ::geod2geoc.
+	\param count Number of positions.
+	\param lat Geodetic latitude in radians.
+	\param lon Geodetic longitude in radians.
+	\param h Geodetic height in meters.
+	\param x Resulting Geocentric X in meters.
+	\param y Resulting Geocentric Y in meters.
+	\param z Resulting Geocentric Z in meters.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t geod2geoc_batch(size_t count, const double *lat, const double *lon, const double *h, double *x, double *y, double *z, uint16_t threads)
+{
+	if (lat == nullptr || lon == nullptr || h == nullptr || x == nullptr || y == nullptr || z == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	convert_batch_run(count, threads, [=](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			double ct = cos(lat[i]);
+			double st = sin(lat[i]);
+			double c = 1./sqrt(ct * ct + FRATIO2 * st * st);
+			double r = (REARTHM * c + h[i]) * ct;
+			x[i] = r * cos(lon[i]);
+			y[i] = r * sin(lon[i]);
+			z[i] = (REARTHM * FRATIO2 * c + h[i]) * st;
+		}
+	});
+
+	return 0;
+}
+
+//! Batch ECI to GEOC
+/*! Rotate arrays of Earth Centered Inertial positions, and optionally
+ * velocities, in to the Geocentric frame. The full Earth orientation (::gcrf2itrs)
+ * is only calculated every ::CONVERT_BATCH_EOP_INTERVAL seconds, in the calling
+ * thread (it is not reentrant). In between, precession, nutation and polar
+ * motion are held fixed and only the sidereal rotation is advanced, which is
+ * good to a few millimeters at orbital distances. The rotations are then
+ * applied to the elements in parallel.
+	\param count Number of positions.
+	\param utc Time of each position, UTC in Modified Julian Days.
+	\param sx ECI X position in meters.
+	\param sy ECI Y position in meters.
+	\param sz ECI Z position in meters.
+	\param vx ECI X velocity in meters per second, or nullptr.
+	\param vy ECI Y velocity in meters per second, or nullptr.
+	\param vz ECI Z velocity in meters per second, or nullptr.
+	\param gsx Resulting GEOC X position in meters.
+	\param gsy Resulting GEOC Y position in meters.
+	\param gsz Resulting GEOC Z position in meters.
+	\param gvx Resulting GEOC X velocity in meters per second, or nullptr.
+	\param gvy Resulting GEOC Y velocity in meters per second, or nullptr.
+	\param gvz Resulting GEOC Z velocity in meters per second, or nullptr.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t pos_eci2geoc_batch(size_t count, const double *utc, const double *sx, const double *sy, const double *sz, const double *vx, const double *vy, const double *vz, double *gsx, double *gsy, double *gsz, double *gvx, double *gvy, double *gvz, uint16_t threads)
+{
+	if (utc == nullptr || sx == nullptr || sy == nullptr || sz == nullptr || gsx == nullptr || gsy == nullptr || gsz == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	bool dovel = vx != nullptr && vy != nullptr && vz != nullptr && gvx != nullptr && gvy != nullptr && gvz != nullptr;
+
+	// One set of matrices per distinct time
+	std::vector<rmatrix> j2e;
+	std::vector<rmatrix> dj2e;
+	std::vector<uint32_t> midx(count);
+	rmatrix rnp, pw, rm, drm, ddrm;
+	double anchorutc = 0.;
+	double anchorgast = 0.;
+	double lastutc = 0.;
+	for (size_t i=0; i<count; ++i)
+	{
+		if (!std::isfinite(utc[i]) || utc[i] <= 0.)
+		{
+			return CONVERT_ERROR_UTC;
+		}
+		if (j2e.empty() || utc[i] != lastutc)
+		{
+			double dt = 86400. * (utc[i] - anchorutc);
+			if (j2e.empty() || fabs(dt) > CONVERT_BATCH_EOP_INTERVAL)
+			{
+				gcrf2itrs(utc[i], &rnp, &rm, &drm, &ddrm);
+				pef2itrs(utc[i], &pw);
+				anchorgast = utc2gast(utc[i]);
+				anchorutc = utc[i];
+			}
+			else
+			{
+				double gast = anchorgast + CONVERT_EARTH_SIDEREAL_RATE * dt;
+				rm = rm_mmult(pw, rm_mmult(rm_change_around_z(-gast), rnp));
+				rmatrix rmp = rm_mmult(pw, rm_mmult(rm_change_around_z(-gast - CONVERT_EARTH_SIDEREAL_RATE), rnp));
+				rmatrix rmm = rm_mmult(pw, rm_mmult(rm_change_around_z(-gast + CONVERT_EARTH_SIDEREAL_RATE), rnp));
+				drm = rm_smult(.5, rm_sub(rmp, rmm));
+			}
+			j2e.push_back(rm);
+			dj2e.push_back(drm);
+			lastutc = utc[i];
+		}
+		midx[i] = j2e.size() - 1;
+	}
+
+	convert_batch_run(count, threads, [&](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			const rmatrix &m = j2e[midx[i]];
+			gsx[i] = m.row[0].col[0]*sx[i] + m.row[0].col[1]*sy[i] + m.row[0].col[2]*sz[i];
+			gsy[i] = m.row[1].col[0]*sx[i] + m.row[1].col[1]*sy[i] + m.row[1].col[2]*sz[i];
+			gsz[i] = m.row[2].col[0]*sx[i] + m.row[2].col[1]*sy[i] + m.row[2].col[2]*sz[i];
+		}
+		if (dovel)
+		{
+			for (size_t i=start; i<end; ++i)
+			{
+				const rmatrix &m = j2e[midx[i]];
+				const rmatrix &dm = dj2e[midx[i]];
+				gvx[i] = m.row[0].col[0]*vx[i] + m.row[0].col[1]*vy[i] + m.row[0].col[2]*vz[i] + dm.row[0].col[0]*sx[i] + dm.row[0].col[1]*sy[i] + dm.row[0].col[2]*sz[i];
+				gvy[i] = m.row[1].col[0]*vx[i] + m.row[1].col[1]*vy[i] + m.row[1].col[2]*vz[i] + dm.row[1].col[0]*sx[i] + dm.row[1].col[1]*sy[i] + dm.row[1].col[2]*sz[i];
+				gvz[i] = m.row[2].col[0]*vx[i] + m.row[2].col[1]*vy[i] + m.row[2].col[2]*vz[i] + dm.row[2].col[0]*sx[i] + dm.row[2].col[1]*sy[i] + dm.row[2].col[2]*sz[i];
+			}
+		}
+	});
+
+	return 0;
+}
+
+//! Batch Geocentric to Topocentric
+/*! Calculate the Topocentric positions of many Targets with respect to a single
+ * Source. The Source rotation and position are calculated once.
+	\param source Geodetic location of Source.
+	\param count Number of Targets.
+	\param x Geocentric X of Targets in meters.
+	\param y Geocentric Y of Targets in meters.
+	\param z Geocentric Z of Targets in meters.
+	\param tx Resulting Topocentric East in meters.
+	\param ty Resulting Topocentric North in meters.
+	\param tz Resulting Topocentric Up in meters.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t geoc2topo_batch(gvector source, size_t count, const double *x, const double *y, const double *z, double *tx, double *ty, double *tz, uint16_t threads)
+{
+	if (x == nullptr || y == nullptr || z == nullptr || tx == nullptr || ty == nullptr || tz == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	double clon = cos(source.lon);
+	double slon = sin(source.lon);
+	double clat = cos(source.lat);
+	double slat = sin(source.lat);
+
+	double c = 1./sqrt(clat * clat + FRATIO2 * slat * slat);
+	double r = (REARTHM * c + source.h) * clat;
+	double x0 = r * clon;
+	double y0 = r * slon;
+	double z0 = (REARTHM * FRATIO2 * c + source.h) * slat;
+
+	convert_batch_run(count, threads, [=](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			double dx = x[i] - x0;
+			double dy = y[i] - y0;
+			double dz = z[i] - z0;
+			tx[i] = -slon*dx + clon*dy;
+			ty[i] = -slat*clon*dx - slat*slon*dy + clat*dz;
+			tz[i] = clat*clon*dx + clat*slon*dy + slat*dz;
+		}
+	});
+
+	return 0;
+}
+
+//! Batch Topocentric to Azimuth and Elevation
+/*! Convert arrays of Topocentric positions to Azimuth and Elevation, as in ::topo2azel.
+	\param count Number of positions.
+	\param tx Topocentric East in meters.
+	\param ty Topocentric North in meters.
+	\param tz Topocentric Up in meters.
+	\param az Resulting Azimuth in radians.
+	\param el Resulting Elevation in radians.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t topo2azel_batch(size_t count, const double *tx, const double *ty, const double *tz, float *az, float *el, uint16_t threads)
+{
+	if (tx == nullptr || ty == nullptr || tz == nullptr || az == nullptr || el == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	convert_batch_run(count, threads, [=](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			az[i] = (float)(atan2(tx[i], ty[i]));
+			el[i] = (float)(atan2(tz[i], sqrt(tx[i]*tx[i] + ty[i]*ty[i])));
+		}
+	});
+
+	return 0;
+}
+
+//! Batch Keplerian to ECI
+/*! Apply ::kep2eci to a vector of Keplerian elements.
+	\param kep Source Keplerian elements. Mean motion and period are updated, as in ::kep2eci.
+	\param eci Resulting ECI positions, resized to match.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t kep2eci_batch(std::vector<kepstruc> &kep, std::vector<cartpos> &eci, uint16_t threads)
+{
+	eci.resize(kep.size());
+
+	convert_batch_run(kep.size(), threads, [&](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			kep2eci(kep[i], eci[i]);
+		}
+	});
+
+	return 0;
+}
+
+//! Batch ECI to Keplerian
+/*! Apply ::eci2kep to a vector of ECI positions. The Sun direction is looked up
+ * once for each distinct time, in the calling thread (the ephemeris is not
+ * reentrant), and the elements are then calculated in parallel.
+	\param eci Source ECI positions.
+	\param kep Resulting Keplerian elements, resized to match.
+	\param threads Number of threads to use.
+	\return Zero, or negative error.
+*/
+int32_t eci2kep_batch(std::vector<cartpos> &eci, std::vector<kepstruc> &kep, uint16_t threads)
+{
+	kep.resize(eci.size());
+
+	std::vector<rvector> rsun;
+	std::vector<uint32_t> sidx(eci.size());
+	double lastutc = 0.;
+	for (size_t i=0; i<eci.size(); ++i)
+	{
+		if (!std::isfinite(eci[i].utc))
+		{
+			return CONVERT_ERROR_UTC;
+		}
+		if (rsun.empty() || eci[i].utc != lastutc)
+		{
+			cartpos earthpos;
+			int32_t iretn = jplpos(JPL_EARTH, JPL_SUN_BARY, utc2tt(eci[i].utc), &earthpos);
+			if (iretn < 0)
+			{
+				return iretn;
+			}
+			normalize_rv(earthpos.s);
+			rsun.push_back(earthpos.s);
+			lastutc = eci[i].utc;
+		}
+		sidx[i] = rsun.size() - 1;
+	}
+
+	convert_batch_run(eci.size(), threads, [&](size_t start, size_t end)
+	{
+		for (size_t i=start; i<end; ++i)
+		{
+			eci2kep_sun(eci[i], rsun[sidx[i]], kep[i]);
+		}
+	});
+
+	return 0;
+}
+
 std::ostream& operator << (std::ostream& out, const cartpos& a)
 {
 	out << a.utc << "\t" << a.s << "\t" << a.v << "\t" << a.a << "\t" << a.pass;
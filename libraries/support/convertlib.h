@@ -60,6 +60,7 @@
 
 #include "math/mathlib.h"
 #include "support/convertdef.h"
+#include <functional>
 
 //#include <fcntl.h>
 //#include <cmath>
@@ -143,6 +144,7 @@ void gcrf2j2000(rmatrix *rm);
 void j20002gcrf(rmatrix *rm);
 void teme2true(double ep0, rmatrix *rm);
 void true2teme(double ep0, rmatrix *rm);
+void teme2gcrf(double utc, rmatrix *rm);
 void mean2mean(double ep0, double ep1, rmatrix *pm);
 void geoc2topo(gvector gs, rvector geoc, rvector &topo);
 void topo2azel(rvector tpos, float *az, float *el);
@@ -150,12 +152,24 @@ int lines2eci(double mjd, std::vector<tlestruc> tle, cartpos &eci);
 int tle2eci(double mjd, tlestruc tle, cartpos &eci);
 int32_t eci2tle(double utc, cartpos eci, tlestruc &tle);
 int sgp4(double utc, tlestruc tle, cartpos &pos_teme);
+int32_t sgp4_init(const tlestruc &tle, sgp4struc &sat);
+int32_t sgp4_init(const std::vector<tlestruc> &tle, std::vector<sgp4struc> &sat);
+int32_t sgp4_propagate(const sgp4struc &sat, double utc, cartpos &pos_teme);
+int32_t sgp4_batch(const std::vector<sgp4struc> &sat, const std::vector<double> &utc, std::vector<cartpos> &eci, uint16_t threads=1);
 tlestruc get_line(uint16_t index, std::vector<tlestruc> tle);
 int32_t load_lines(std::string fname, std::vector<tlestruc>& tle);
 int32_t load_lines_multi(std::string fname, std::vector<tlestruc>& tle);
 int32_t loadTLE(char *fname, tlestruc &tle);
 int32_t load_stk(std::string filename, stkstruc &stkdata);
 int stk2eci(double utc, stkstruc &stk, cartpos &eci);
+void convert_batch_run(size_t count, uint16_t threads, std::function<void(size_t, size_t)> kernel);
+int32_t geoc2geod_batch(size_t count, const double *x, const double *y, const double *z, double *lat, double *lon, double *h, uint16_t threads=1);
+int32_t geod2geoc_batch(size_t count, const double *lat, const double *lon, const double *h, double *x, double *y, double *z, uint16_t threads=1);
+int32_t pos_eci2geoc_batch(size_t count, const double *utc, const double *sx, const double *sy, const double *sz, const double *vx, const double *vy, const double *vz, double *gsx, double *gsy, double *gsz, double *gvx, double *gvy, double *gvz, uint16_t threads=1);
+int32_t geoc2topo_batch(gvector source, size_t count, const double *x, const double *y, const double *z, double *tx, double *ty, double *tz, uint16_t threads=1);
+int32_t topo2azel_batch(size_t count, const double *tx, const double *ty, const double *tz, float *az, float *el, uint16_t threads=1);
+int32_t kep2eci_batch(std::vector<kepstruc> &kep, std::vector<cartpos> &eci, uint16_t threads=1);
+int32_t eci2kep_batch(std::vector<cartpos> &eci, std::vector<kepstruc> &kep, uint16_t threads=1);
 
 //! @}
 
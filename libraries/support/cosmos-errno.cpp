@@ -182,6 +182,9 @@ string cosmos_error_string(int32_t cosmos_errno)
         case JSON_ERROR_NAN:
             error_string = "JSON_ERROR_NAN";
             break;
+        case JSON_ERROR_IMAGE:
+            error_string = "JSON_ERROR_IMAGE";
+            break;
         case SLIP_ERROR_CRC:
             error_string = "SLIP_ERROR_CRC";
             break;
@@ -224,6 +227,12 @@ string cosmos_error_string(int32_t cosmos_errno)
         case MATH_ERROR_GJ_OUTOFRANGE:
             error_string = "MATH_ERROR_GJ_OUTOFRANGE";
             break;
+        case MATH_ERROR_DP_STEPSIZE:
+            error_string = "MATH_ERROR_DP_STEPSIZE";
+            break;
+        case MATH_ERROR_DP_OUTOFRANGE:
+            error_string = "MATH_ERROR_DP_OUTOFRANGE";
+            break;
         case AGENT_ERROR_SERVER_RUNNING:
             error_string = "Agent Server was running in another instance";
             break;
@@ -461,6 +470,9 @@ string cosmos_error_string(int32_t cosmos_errno)
         case TRANSFER_ERROR_NODE:
             error_string = "TRANSFER_ERROR_NODE";
             break;
+        case TRANSFER_ERROR_FEC:
+            error_string = "TRANSFER_ERROR_FEC";
+            break;
         case SOCKET_ERROR_CS:
             error_string = "SOCKET_ERROR_CS";
             break;
@@ -96,6 +96,7 @@
 #define JSON_ERROR_SCAN -257
 #define JSON_ERROR_JSTRING -258
 #define JSON_ERROR_NAN	-259
+#define JSON_ERROR_IMAGE -260
 
 #define SLIP_ERROR_CRC -261
 #define SLIP_ERROR_PACKING -262
@@ -114,6 +115,8 @@
 
 #define MATH_ERROR_GJ_UNDEFINED -281
 #define MATH_ERROR_GJ_OUTOFRANGE -282
+#define MATH_ERROR_DP_STEPSIZE -283
+#define MATH_ERROR_DP_OUTOFRANGE -284
 
 #define AGENT_ERROR_LCM_CREATE -291
 #define AGENT_ERROR_LCM_SUBSCRIBE -292
@@ -221,6 +224,7 @@
 #define TRANSFER_ERROR_QUEUEFULL -472
 #define TRANSFER_ERROR_INDEX -473
 #define TRANSFER_ERROR_NODE -474
+#define TRANSFER_ERROR_FEC -475
 
 #define SOCKET_ERROR_CS -481
 #define SOCKET_ERROR_PROTOCOL -482
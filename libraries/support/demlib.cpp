@@ -38,12 +38,17 @@
 //#include <dirent.h>
 //#endif
 #include <sys/stat.h>
+#if !defined(COSMOS_WIN_OS)
+#include <sys/mman.h>
+#endif
 
 map_dem_body *bodies[20] = {NULL};
 char bodynames[20][15] = {"mercury","venus","earth","mars","jupiter","saturn","uranus","neptune","pluto","moon","sun","near","","","","","","","",""};
 static uint32_t maxalloc=300000000L, totalloc=0;
 //static sem_t *bsem,tsem;
 static std::mutex bsem;
+// DEMs are memory mapped unless turned off with map_dem_mmap
+static bool usemmap = true;
 // running: 0 = uninitialized, 1 = ready, 2 = insufficient memory
 static int running = 0;
 
@@ -152,6 +157,45 @@ void map_dem_cache(int body, int num)
 	bsem.unlock();
 }
 
+//! Close DEM body
+/*! Release all memory and memory maps held for a planetary body. No other thread may be
+ * reading from the body.
+	\param body ::map_dem_body returned by ::map_dem_open.
+*/
+void map_dem_close(map_dem_body *body)
+{
+	if (body == NULL)
+		return;
+
+//	sem_wait(bsem);
+	bsem.lock();
+	for (uint16_t m=0; m<MAX_DEM_BODIES; m++)
+	{
+		if (bodies[m] == body)
+			bodies[m] = NULL;
+	}
+	for (uint16_t i=0; i<body->demcount; i++)
+	{
+		map_dem_dem *sdem = &body->dems[i];
+		if (sdem->pixel.size())
+		{
+			uint32_t dalloc = sdem->ycount*(sizeof(dem_pixel *) + sdem->xcount*sizeof(dem_pixel));
+			totalloc = totalloc >= dalloc ? totalloc - dalloc : 0;
+			std::vector< std::vector<dem_pixel> >().swap(sdem->pixel);
+		}
+#if !defined(COSMOS_WIN_OS)
+		const dem_pixel *map = sdem->map.load();
+		if (map != nullptr)
+		{
+			munmap((void *)map, sdem->mapsize);
+		}
+#endif
+	}
+//	sem_post(bsem);
+	bsem.unlock();
+	free(body);
+}
+
 map_dem_body *map_dem_open(int bodynum)
 {
 	int maxcount=0;
@@ -341,44 +385,19 @@ double map_dem_alt(int body, double lon, double lat, double res)
 	return (pixel.alt);
 }
 
-//! Height in DEM
-/*! If the Lat:Lon is within one of the provided DEM's, return the
- * data for that pixel.
-    \param body Integer value of planetary body. See \ref convertlib_constants for values.
-	\param lon Longitude in readians.
+//! Find DEM for location
+/*! Search the DEM index of a body for the DEM covering the requested location at the
+ * requested resolution.
+	\param body Planetary body.
+	\param lon Longitude in radians.
 	\param lat Latitude in radians.
 	\param res Best resolution required, in radians.
-	\return ::dem_pixel for that location.
+	\return Index of DEM, or -1 if none covers the location.
 */
-dem_pixel map_dem_pixel(int body, double lon, double lat, double res)
+static int32_t map_dem_find(map_dem_body *body, double lon, double lat, double res)
 {
-	dem_pixel pixel={0., {0., 0., 1.}};
-	double decrow, deccol, cutc;
-	int32_t erow, ecol, dci, cidx, cbdy;
-	uint32_t drow, dcol;
-	uint32_t i, j, dsize, m;
-	map_dem_dem *sdem;
-	FILE *fp;
-
-	// running: 0 = uninitialized, 1 = ready, 2 = insufficient memory
-	if (running == 2)
-		return (pixel);
-
-	if (bodies[body-1] == NULL)
-	{
-		if (map_dem_open(body) == NULL)
-			return (pixel);
-	}
-
-	if (std::isnan(lat) || std::isnan(lon) || lat<-DPI2 || lat>DPI || lon<-DPI || lon>DPI)
-		return (pixel);
-
-	if (bodies[body-1] == NULL)
-		return (pixel);
-
-	sdem = NULL;
-
-	// First: Find which DEM we need
+	int32_t erow, ecol, dci;
+	uint32_t i, j;
 
 	ecol = (int32_t)(400.*(lon + DPI)/D2PI);
 	if (ecol < 0)
@@ -394,102 +413,272 @@ dem_pixel map_dem_pixel(int body, double lon, double lat, double res)
 
 	dci = -1;
 	// Search the appropriate demindex for a DEM that fits our needs.
-	for (i=0; i<bodies[body-1]->demindexc[erow][ecol]; i++)
+	for (i=0; i<body->demindexc[erow][ecol]; i++)
 	{
-		j = bodies[body-1]->demindexi[erow][ecol][i];
-		if (lon >= bodies[body-1]->dems[j].lonul-1e-13 && lon <= bodies[body-1]->dems[j].lonlr+1e-13 && lat >=
-		bodies[body-1]->dems[j].latlr-1e-13 && lat <= bodies[body-1]->dems[j].latul+1e-13)
+		j = body->demindexi[erow][ecol][i];
+		if (lon >= body->dems[j].lonul-1e-13 && lon <= body->dems[j].lonlr+1e-13 && lat >=
+		body->dems[j].latlr-1e-13 && lat <= body->dems[j].latul+1e-13)
 		{
 			if (dci < 0)
 				dci = j;
-			if (res/bodies[body-1]->dems[j].psize >= 2.)
+			if (res/body->dems[j].psize >= 2.)
 				break;
 			dci = j;
 		}
 	}
 
-	// Check whether the DEM is already loaded and load if necessary
-//	sem_wait(bsem);
-	bsem.lock();
-	sdem = &bodies[body-1]->dems[dci];
-//	if (sdem->pixel == NULL)
-	if (sdem->pixel.size() == 0)
+	return dci;
+}
+
+//! Memory map DEM
+/*! Map the file for a DEM in to memory, if it is not already. A DEM stays mapped until
+ * its body is closed, so once this succeeds the pixels can be read without locking.
+	\param body Planetary body.
+	\param sdem DEM within that body.
+	\return Pointer to first pixel, or NULL if the DEM can not be mapped.
+*/
+static const dem_pixel *map_dem_map(map_dem_body *body, map_dem_dem *sdem)
+{
+	const dem_pixel *map = sdem->map.load(std::memory_order_acquire);
+	if (map != nullptr || !usemmap || sdem->nomap.load(std::memory_order_relaxed))
+	{
+		return map;
+	}
+
+#if defined(COSMOS_WIN_OS)
+	sdem->nomap = true;
+	return nullptr;
+#else
+	std::lock_guard<std::mutex> lock(bsem);
+	map = sdem->map.load(std::memory_order_relaxed);
+	if (map != nullptr || sdem->nomap)
+	{
+		return map;
+	}
+
+	std::string fname;
+	if (get_cosmosresources(fname) < 0)
+	{
+		sdem->nomap = true;
+		return nullptr;
+	}
+	fname += "/mapping/";
+	fname += body->name;
+	fname += "/";
+	fname += sdem->name;
+
+	// Short files are left to the reading code, which handles them
+	size_t msize = (size_t)sdem->ycount * sdem->xcount * sizeof(dem_pixel);
+	struct stat st;
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < msize || msize == 0)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		sdem->nomap = true;
+		return nullptr;
+	}
+	void *addr = mmap(nullptr, msize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+	{
+		sdem->nomap = true;
+		return nullptr;
+	}
+	sdem->mapsize = msize;
+	map = (const dem_pixel *)addr;
+	sdem->map.store(map, std::memory_order_release);
+	return map;
+#endif
+}
+
+//! Load DEM
+/*! Read the file for a DEM in to memory, first releasing the oldest loaded DEMs if this
+ * would take memory use beyond its limit. Must be called with the cache locked.
+	\param body Planetary body.
+	\param sdem DEM within that body.
+	\return True if the pixels are available.
+*/
+static bool map_dem_load(map_dem_body *body, map_dem_dem *sdem)
+{
+	int32_t cidx, cbdy;
+	uint32_t i, dsize, m;
+	double cutc;
+	FILE *fp;
+
+	if (sdem->pixel.size())
 	{
-		dsize = sdem->ycount*(sizeof(dem_pixel *) + sdem->xcount*sizeof(dem_pixel));
-		while (totalloc + dsize > maxalloc)
+		return true;
+	}
+
+	dsize = sdem->ycount*(sizeof(dem_pixel *) + sdem->xcount*sizeof(dem_pixel));
+	while (totalloc + dsize > maxalloc)
+	{
+		cbdy = cidx = -1;
+		cutc = currentmjd(0.);
+		for (m=0; m<MAX_DEM_BODIES; m++)
 		{
-			cbdy = cidx = -1;
-			cutc = currentmjd(0.);
-			for (m=0; m<MAX_DEM_BODIES; m++)
+			if (bodies[m])
 			{
-				if (bodies[m])
+				for (i=0; i<bodies[m]->demcount; i++)
 				{
-					for (i=0; i<bodies[m]->demcount; i++)
+//					if (bodies[m]->dems[i].pixel)
+					if (bodies[m]->dems[i].pixel.size())
 					{
-//						if (bodies[m]->dems[i].pixel)
-						if (bodies[m]->dems[i].pixel.size())
+						if (bodies[m]->dems[i].utc < cutc)
 						{
-							if (bodies[m]->dems[i].utc < cutc)
-							{
-								cidx = i;
-								cbdy = m;
-								cutc = bodies[m]->dems[i].utc;
-							}
+							cidx = i;
+							cbdy = m;
+							cutc = bodies[m]->dems[i].utc;
 						}
 					}
-					if (cidx >= 0)
-					{
-						bodies[cbdy]->dems[cidx].pixel.clear();
-						totalloc -= bodies[cbdy]->dems[cidx].ycount*(sizeof(dem_pixel *) + bodies[cbdy]->dems[cidx].xcount*sizeof(dem_pixel));
-						bodies[cbdy]->dems[cidx].utc = 0.;
-						if (totalloc + dsize <= maxalloc)
-							break;
-					}
+				}
+				if (cidx >= 0)
+				{
+					bodies[cbdy]->dems[cidx].pixel.clear();
+					totalloc -= bodies[cbdy]->dems[cidx].ycount*(sizeof(dem_pixel *) + bodies[cbdy]->dems[cidx].xcount*sizeof(dem_pixel));
+					bodies[cbdy]->dems[cidx].utc = 0.;
+					if (totalloc + dsize <= maxalloc)
+						break;
 				}
 			}
 		}
-		std::string fname;
-		int32_t iretn = get_cosmosresources(fname);
-		if (iretn < 0)
+		if (cidx < 0)
 		{
-			errno = -iretn;
-			return pixel;
+			break;
 		}
-		fname += "/mapping/";
-		fname += bodies[body-1]->name;
-		fname += "/";
-		fname += sdem->name;
-		fp = fopen(fname.c_str(),"rb");
-		sdem->pixel.resize(sdem->ycount);
-		if (sdem->pixel.size() != sdem->ycount)
+	}
+	std::string fname;
+	int32_t iretn = get_cosmosresources(fname);
+	if (iretn < 0)
+	{
+		errno = -iretn;
+		return false;
+	}
+	fname += "/mapping/";
+	fname += body->name;
+	fname += "/";
+	fname += sdem->name;
+	if ((fp = fopen(fname.c_str(),"rb")) == NULL)
+	{
+		return false;
+	}
+	sdem->pixel.resize(sdem->ycount);
+	if (sdem->pixel.size() != sdem->ycount)
+	{
+		maxalloc = (uint32_t)(.9 * maxalloc);
+		fclose(fp);
+		return false;
+	}
+	for (i=0; i<sdem->ycount; i++)
+	{
+		sdem->pixel[i].resize(sdem->xcount);
+		if (sdem->pixel[i].size() != sdem->xcount)
 		{
+			sdem->pixel.clear();
 			maxalloc = (uint32_t)(.9 * maxalloc);
-			return (pixel);
+			fclose(fp);
+			return false;
 		}
-		for (i=0; i<sdem->ycount; i++)
+		size_t count = fread(sdem->pixel[i].data(),sizeof(dem_pixel),sdem->xcount,fp);
+		if (!count)
 		{
-			sdem->pixel[i].resize(sdem->xcount);
-			if (sdem->pixel[i].size() != sdem->xcount)
-			{
-				sdem->pixel.clear();
-				maxalloc = (uint32_t)(.9 * maxalloc);
-				return (pixel);
-			}
-			size_t count = fread(sdem->pixel[i].data(),sizeof(dem_pixel),sdem->xcount,fp);
-			if (!count)
-			{
-				break;
-			}
+			break;
 		}
-		sdem->utc = currentmjd(0.);
-		totalloc += dsize;
-		if (maxalloc < totalloc + 2 * dsize)
-		{
-			maxalloc += 2 * dsize;
+	}
+	sdem->utc = currentmjd(0.);
+	totalloc += dsize;
+	if (maxalloc < totalloc + 2 * dsize)
+	{
+		maxalloc += 2 * dsize;
 
-		}
-		fclose(fp);
 	}
+	fclose(fp);
+	return true;
+}
+
+//! Read DEM pixel
+/*! Return a single pixel from a DEM, from the memory map if there is one and otherwise
+ * from the cache, loading it if necessary.
+	\param body Planetary body.
+	\param sdem DEM within that body.
+	\param drow Row of pixel.
+	\param dcol Column of pixel.
+	\return ::dem_pixel, unscaled.
+*/
+static dem_pixel map_dem_read(map_dem_body *body, map_dem_dem *sdem, uint32_t drow, uint32_t dcol)
+{
+	dem_pixel pixel={0., {0., 0., 1.}};
+
+	const dem_pixel *map = map_dem_map(body, sdem);
+	if (map != nullptr)
+	{
+		return map[(size_t)drow * sdem->xcount + dcol];
+	}
+
+//	sem_wait(bsem);
+	bsem.lock();
+	if (map_dem_load(body, sdem))
+	{
+		pixel = sdem->pixel[drow][dcol];
+	}
+//	sem_post(bsem);
+	bsem.unlock();
+	return pixel;
+}
+
+//! Turn DEM memory mapping on or off
+/*! DEMs are memory mapped by default where the platform allows. Turning mapping off makes
+ * DEMs that are not yet mapped use the in memory cache instead. DEMs that are already mapped
+ * stay mapped.
+	\param enable True to memory map DEMs.
+	\return Zero.
+*/
+int32_t map_dem_mmap(bool enable)
+{
+	usemmap = enable;
+	return 0;
+}
+
+//! Height in DEM
+/*! If the Lat:Lon is within one of the provided DEM's, return the
+ * data for that pixel.
+    \param body Integer value of planetary body. See \ref convertlib_constants for values.
+	\param lon Longitude in readians.
+	\param lat Latitude in radians.
+	\param res Best resolution required, in radians.
+	\return ::dem_pixel for that location.
+*/
+dem_pixel map_dem_pixel(int body, double lon, double lat, double res)
+{
+	dem_pixel pixel={0., {0., 0., 1.}};
+	double decrow, deccol;
+	int32_t dci;
+	uint32_t drow, dcol;
+	map_dem_dem *sdem;
+
+	// running: 0 = uninitialized, 1 = ready, 2 = insufficient memory
+	if (running == 2)
+		return (pixel);
+
+	if (bodies[body-1] == NULL)
+	{
+		if (map_dem_open(body) == NULL)
+			return (pixel);
+	}
+
+	if (std::isnan(lat) || std::isnan(lon) || lat<-DPI2 || lat>DPI || lon<-DPI || lon>DPI)
+		return (pixel);
+
+	if (bodies[body-1] == NULL)
+		return (pixel);
+
+	// First: Find which DEM we need
+	if ((dci = map_dem_find(bodies[body-1], lon, lat, res)) < 0)
+		return (pixel);
+	sdem = &bodies[body-1]->dems[dci];
 
 	decrow = ((sdem->latul - lat) /sdem->psize) - .5;
 	if (decrow < 0.)
@@ -506,15 +695,202 @@ dem_pixel map_dem_pixel(int body, double lon, double lat, double res)
 	if (dcol >= sdem->xcount)
 		dcol = sdem->xcount - 1;
 
-	pixel = sdem->pixel[drow][dcol];
-//	sem_post(bsem);
-	bsem.unlock();
+	// Then: Read it, loading if necessary
+	pixel = map_dem_read(bodies[body-1], sdem, drow, dcol);
 	pixel.alt = (float)(pixel.alt * bodies[body-1]->vscale);
 	pixel.nmap[2] = (float)(pixel.nmap[2] * bodies[body-1]->htov);
 
 	return (pixel);
 }
 
+//! Bilinear pixel in DEM
+/*! Interpolate between the four pixel centers surrounding a location. Locations beyond the
+ * outermost centers of the DEM take the edge values.
+	\param body Planetary body.
+	\param sdem DEM within that body.
+	\param lon Longitude in radians.
+	\param lat Latitude in radians.
+	\return ::dem_pixel, unscaled.
+*/
+static dem_pixel map_dem_bilinear(map_dem_body *body, map_dem_dem *sdem, double lon, double lat)
+{
+	dem_pixel pixel={0., {0., 0., 1.}};
+	dem_pixel corner[4];
+	double frow, fcol, wrow, wcol, weight[4];
+	uint32_t drow, dcol, drow1, dcol1;
+
+	frow = ((sdem->latul - lat) /sdem->psize) - .5;
+	if (frow < 0.)
+		frow = 0.;
+	if (frow > sdem->ycount - 1)
+		frow = sdem->ycount - 1;
+	fcol = ((lon - sdem->lonul) /sdem->psize) - .5;
+	if (fcol < 0.)
+		fcol = 0.;
+	if (fcol > sdem->xcount - 1)
+		fcol = sdem->xcount - 1;
+
+	drow = (uint32_t)frow;
+	dcol = (uint32_t)fcol;
+	drow1 = drow + 1 < sdem->ycount ? drow + 1 : drow;
+	dcol1 = dcol + 1 < sdem->xcount ? dcol + 1 : dcol;
+	wrow = frow - drow;
+	wcol = fcol - dcol;
+
+	const dem_pixel *map = map_dem_map(body, sdem);
+	if (map != nullptr)
+	{
+		corner[0] = map[(size_t)drow * sdem->xcount + dcol];
+		corner[1] = map[(size_t)drow * sdem->xcount + dcol1];
+		corner[2] = map[(size_t)drow1 * sdem->xcount + dcol];
+		corner[3] = map[(size_t)drow1 * sdem->xcount + dcol1];
+	}
+	else
+	{
+		corner[0] = map_dem_read(body, sdem, drow, dcol);
+		corner[1] = map_dem_read(body, sdem, drow, dcol1);
+		corner[2] = map_dem_read(body, sdem, drow1, dcol);
+		corner[3] = map_dem_read(body, sdem, drow1, dcol1);
+	}
+
+	weight[0] = (1. - wrow) * (1. - wcol);
+	weight[1] = (1. - wrow) * wcol;
+	weight[2] = wrow * (1. - wcol);
+	weight[3] = wrow * wcol;
+
+	double alt = 0., nmap[3] = {0., 0., 0.};
+	for (uint16_t i=0; i<4; ++i)
+	{
+		alt += weight[i] * corner[i].alt;
+		nmap[0] += weight[i] * corner[i].nmap[0];
+		nmap[1] += weight[i] * corner[i].nmap[1];
+		nmap[2] += weight[i] * corner[i].nmap[2];
+	}
+	double norm = sqrt(nmap[0]*nmap[0] + nmap[1]*nmap[1] + nmap[2]*nmap[2]);
+	if (norm > 0.)
+	{
+		pixel.nmap[0] = (float)(nmap[0] / norm);
+		pixel.nmap[1] = (float)(nmap[1] / norm);
+		pixel.nmap[2] = (float)(nmap[2] / norm);
+	}
+	pixel.alt = (float)alt;
+
+	return pixel;
+}
+
+//! Heights in DEM for many locations
+/*! Look up an array of locations at once, optionally interpolating between pixels. The
+ * DEM index is searched per location, so locations may span several DEMs, but interpolation
+ * does not cross from one DEM in to the next. Locations outside every
+ * DEM get the same default as ::map_dem_pixel. Once the needed DEMs are mapped, no lock
+ * is taken, so the work spreads cleanly across threads.
+    \param body Integer value of planetary body. See \ref convertlib_constants for values.
+	\param count Number of locations.
+	\param lon Array of Longitudes in radians.
+	\param lat Array of Latitudes in radians.
+	\param res Best resolution required, in radians.
+	\param pixel Array of ::dem_pixel to be filled.
+	\param bilinear True to interpolate between pixel centers, false for the same pixel
+	::map_dem_pixel would return.
+	\param threads Number of threads to use.
+	\return Number of locations, or negative error.
+*/
+int32_t map_dem_pixel_batch(int body, size_t count, const double *lon, const double *lat, double res, dem_pixel *pixel, bool bilinear, uint16_t threads)
+{
+	if (lon == nullptr || lat == nullptr || pixel == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+	if (body < 1 || body > MAX_DEM_BODIES)
+	{
+		return MAP_DEM_ERROR_BODY;
+	}
+	if (bodies[body-1] == NULL && map_dem_open(body) == NULL)
+	{
+		return DEM_ERROR_NOTFOUND;
+	}
+	map_dem_body *dbody = bodies[body-1];
+
+	auto kernel = [=](size_t begin, size_t end)
+	{
+		for (size_t i=begin; i<end; ++i)
+		{
+			if (!bilinear)
+			{
+				pixel[i] = map_dem_pixel(body, lon[i], lat[i], res);
+				continue;
+			}
+
+			pixel[i] = {0., {0., 0., 1.}};
+			if (std::isnan(lat[i]) || std::isnan(lon[i]) || lat[i]<-DPI2 || lat[i]>DPI || lon[i]<-DPI || lon[i]>DPI)
+			{
+				continue;
+			}
+			int32_t dci = map_dem_find(dbody, lon[i], lat[i], res);
+			if (dci < 0)
+			{
+				continue;
+			}
+			pixel[i] = map_dem_bilinear(dbody, &dbody->dems[dci], lon[i], lat[i]);
+			pixel[i].alt = (float)(pixel[i].alt * dbody->vscale);
+			pixel[i].nmap[2] = (float)(pixel[i].nmap[2] * dbody->htov);
+		}
+	};
+
+	if (threads < 2 || count < 2 * (size_t)threads)
+	{
+		kernel(0, count);
+	}
+	else
+	{
+		vector<thread> pool;
+		size_t slice = (count + threads - 1) / threads;
+		for (size_t begin=0; begin<count; begin+=slice)
+		{
+			pool.push_back(thread(kernel, begin, begin + slice < count ? begin + slice : count));
+		}
+		for (thread &worker : pool)
+		{
+			worker.join();
+		}
+	}
+
+	return (int32_t)count;
+}
+
+//! Altitudes in DEM for many locations
+/*! As ::map_dem_pixel_batch, returning only the altitude.
+    \param body Integer value of planetary body. See \ref convertlib_constants for values.
+	\param count Number of locations.
+	\param lon Array of Longitudes in radians.
+	\param lat Array of Latitudes in radians.
+	\param res Best resolution required, in radians.
+	\param alt Array of altitudes to be filled, in meters.
+	\param bilinear True to interpolate between pixel centers.
+	\param threads Number of threads to use.
+	\return Number of locations, or negative error.
+*/
+int32_t map_dem_alt_batch(int body, size_t count, const double *lon, const double *lat, double res, float *alt, bool bilinear, uint16_t threads)
+{
+	if (alt == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	vector<dem_pixel> pixel(count);
+	int32_t iretn = map_dem_pixel_batch(body, count, lon, lat, res, pixel.data(), bilinear, threads);
+	if (iretn < 0)
+	{
+		return iretn;
+	}
+	for (size_t i=0; i<count; ++i)
+	{
+		alt[i] = pixel[i].alt;
+	}
+
+	return iretn;
+}
+
 int map_dem_tilt(int body, double lon, double lat, double scalekm, dem_pixel *pixel)
 {
 	double tiltrho;
@@ -44,17 +44,23 @@
 //! DEMs are stored as floating point numbers in groups of 4; representing altitude in meters, and a
 //! Normal (NMAP) in x, y, and z. DEMs for each planetary body are stored at different resolutions, allowing
 //! for a minimum of overhead. Only the DEMs required for the desired location and resolution are loaded.
-//! Memory use is limited by recycling the oldest accessed DEMs and reclaiming their memory.
+//! On POSIX systems each DEM file is memory mapped the first time it is needed, leaving residency to
+//! the page cache, and lookups into mapped DEMs take no lock. Elsewhere, or when mapping is turned off
+//! with ::map_dem_mmap, DEMs are read in to memory and memory use is limited by recycling the oldest
+//! loaded DEMs and reclaiming their memory.
 //!
 //! General usage involves first first opening the DEM system for a given body through ::map_dem_open. This
 //! This will return a handle that can be used for all subsequent DEM calls for that body. See \ref demlib_planets
 //! for the constants for the various planets. Once a planetary body is open calls to ::map_dem_pixel will return
-//! the DEM value for the requested Latitude and Longitude, at the requested resolution.
+//! the DEM value for the requested Latitude and Longitude, at the requested resolution. Arrays of locations
+//! can be looked up at once, with optional bilinear interpolation, through ::map_dem_pixel_batch and
+//! ::map_dem_alt_batch.
 
 #ifndef MAP_DEM_H
 #define MAP_DEM_H
 
 #include "support/configCosmos.h"
+#include <atomic>
 
 //! \ingroup demlib
 //! \defgroup demlib_constants DEM library constants
@@ -104,6 +110,12 @@ typedef struct
 	double dlat;
 //	dem_pixel **pixel;
 	std::vector< std::vector<dem_pixel> > pixel;
+	//! Memory mapped pixels, row by row, once mapped
+	std::atomic<const dem_pixel *> map;
+	//! Size of mapping in bytes
+	size_t mapsize;
+	//! Set if the DEM file could not be mapped
+	std::atomic<bool> nomap;
 } map_dem_dem;
 
 //! Planetary body support structure
@@ -140,6 +152,9 @@ dem_pixel map_dem_pixel(int body, double lon, double lat, double res);
 dem_pixel map_dem_pixel(int body,double lon, double lat, double res);
 double map_dem_alt(int body, double lon, double lat, double res);
 int map_dem_init();
+int32_t map_dem_mmap(bool enable);
+int32_t map_dem_pixel_batch(int body, size_t count, const double *lon, const double *lat, double res, dem_pixel *pixel, bool bilinear=true, uint16_t threads=1);
+int32_t map_dem_alt_batch(int body, size_t count, const double *lon, const double *lat, double res, float *alt, bool bilinear=true, uint16_t threads=1);
 //! @}
 
 #endif
@@ -122,7 +122,7 @@ int32_t jplnut(double utc, double nuts[])
 */
 int32_t jplpos(long from, long to, double utc, cartpos *pos)
 {
-	static double pvec[3][6];
+	double pvec[3][6];
 
 	pos->s = pos->v = pos->a = rv_zero();
 
@@ -172,6 +172,7 @@ int32_t jplpos(long from, long to, double utc, cartpos *pos)
 
 int32_t jplopen()
 {
+	std::lock_guard<std::mutex> lock(eph_mutex);
 	if (jplephem == NULL)
 	{
 		std::string fname;
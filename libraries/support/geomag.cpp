@@ -88,15 +88,403 @@ char geomag_introduction(float epochlowlim);
 static int initialized = 0;
 static char fname[100];
 
+//! Model file for year
+/*! Name of the World Magnetic Model coefficient file in the resources folder covering the
+ * requested year.
+	\param year Time in decimal years.
+	\param fname Full path of file.
+	\return Zero, or negative error.
+*/
+static int32_t geomag_filename(double year, string &fname)
+{
+	char tname[100];
+	int32_t iretn = get_cosmosresources(fname);
+	if (iretn < 0)
+	{
+		return iretn;
+	}
+	sprintf(tname, "/general/wmm_%04d.cof", 5 * (int)(year/5.));
+	fname += tname;
+	return 0;
+}
+
+//! Load World Magnetic Model
+/*! Read the spherical harmonic coefficients from a WMM coefficient file and convert them from
+ * Schmidt normalized to unnormalized form. The time adjusted coefficients are set to the epoch
+ * of the model.
+	\param fname Path of coefficient file.
+	\param model ::geomagstruc to be filled.
+	\return Zero, or negative error.
+*/
+int32_t geomag_load(string fname, geomagstruc &model)
+{
+	FILE *wmmdat;
+	char c_str[81];
+	double snorm[(GEOMAG_MAX_DEGREE+1)*(GEOMAG_MAX_DEGREE+1)];
+
+	if ((wmmdat=fopen(fname.c_str(),"r")) == NULL)
+	{
+		return GEOMAG_ERROR_NOTFOUND;
+	}
+
+	memset(&model, 0, sizeof(geomagstruc));
+	model.maxdeg = GEOMAG_MAX_DEGREE;
+	if (fgets(c_str, 80, wmmdat) == NULL || sscanf(c_str, "%lf%19s", &model.epoch, model.name) < 1)
+	{
+		fclose(wmmdat);
+		return GEOMAG_ERROR_NOTFOUND;
+	}
+
+	/* READ WORLD MAGNETIC MODEL SPHERICAL HARMONIC COEFFICIENTS */
+	while (fgets(c_str, 80, wmmdat) != NULL)
+	{
+		int in, im;
+		double gnm, hnm, dgnm, dhnm;
+
+		/* CHECK FOR LAST LINE IN FILE */
+		if (strncmp(c_str, "9999", 4) == 0)
+		{
+			break;
+		}
+		if (sscanf(c_str,"%d%d%lf%lf%lf%lf",&in,&im,&gnm,&hnm,&dgnm,&dhnm) != 6 || in < 1 || in > GEOMAG_MAX_DEGREE || im < 0 || im > in)
+		{
+			continue;
+		}
+		model.c[im][in] = gnm;
+		model.cd[im][in] = dgnm;
+		if (im != 0)
+		{
+			model.c[in][im-1] = hnm;
+			model.cd[in][im-1] = dhnm;
+		}
+	}
+	fclose(wmmdat);
+
+	/* CONVERT SCHMIDT NORMALIZED GAUSS COEFFICIENTS TO UNNORMALIZED */
+	snorm[0] = 1.;
+	for (int n=1; n<=model.maxdeg; n++)
+	{
+		snorm[n] = snorm[n-1]*(2*n-1)/n;
+		double j = 2.;
+		for (int m=0; m<=n; m++)
+		{
+			model.k[m][n] = (double)((n-1)*(n-1)-m*m)/((2*n-1)*(2*n-3));
+			if (m > 0)
+			{
+				snorm[n+m*(GEOMAG_MAX_DEGREE+1)] = snorm[n+(m-1)*(GEOMAG_MAX_DEGREE+1)]*sqrt((n-m+1)*j/(n+m));
+				j = 1.;
+				model.c[n][m-1] *= snorm[n+m*(GEOMAG_MAX_DEGREE+1)];
+				model.cd[n][m-1] *= snorm[n+m*(GEOMAG_MAX_DEGREE+1)];
+			}
+			model.c[m][n] *= snorm[n+m*(GEOMAG_MAX_DEGREE+1)];
+			model.cd[m][n] *= snorm[n+m*(GEOMAG_MAX_DEGREE+1)];
+		}
+		model.fn[n] = n+1;
+		model.fm[n] = n;
+	}
+	model.k[1][1] = 0.;
+
+	model.year = model.epoch;
+	memcpy(model.tc, model.c, sizeof(model.c));
+
+	return 0;
+}
+
+//! Load World Magnetic Model for year
+/*! Load the model file in the resources folder covering the requested year, and adjust its
+ * coefficients to that year.
+	\param year Time in decimal years.
+	\param model ::geomagstruc to be filled.
+	\return Zero, or negative error.
+*/
+int32_t geomag_load(double year, geomagstruc &model)
+{
+	string fname;
+	int32_t iretn = geomag_filename(year, fname);
+	if (iretn < 0)
+	{
+		return iretn;
+	}
+	iretn = geomag_load(fname, model);
+	if (iretn < 0)
+	{
+		return iretn;
+	}
+	return geomag_year(model, year);
+}
+
+//! Set model year
+/*! Adjust the Gauss coefficients of a model for secular variation to the requested year.
+ * Nothing is recalculated if the model is already at that year.
+	\param model ::geomagstruc loaded with ::geomag_load.
+	\param year Time in decimal years.
+	\return Zero, or ::GEOMAG_ERROR_OUTOFRANGE if the year is outside the life of the model.
+*/
+int32_t geomag_year(geomagstruc &model, double year)
+{
+	double dt = year - model.epoch;
+	if (dt < 0. || dt > GEOMAG_MAX_SPAN)
+	{
+		return GEOMAG_ERROR_OUTOFRANGE;
+	}
+	if (year == model.year)
+	{
+		return 0;
+	}
+
+	for (int n=1; n<=model.maxdeg; n++)
+	{
+		for (int m=0; m<=n; m++)
+		{
+			model.tc[m][n] = model.c[m][n]+dt*model.cd[m][n];
+			if (m != 0)
+			{
+				model.tc[n][m-1] = model.c[n][m-1]+dt*model.cd[n][m-1];
+			}
+		}
+	}
+	model.year = year;
+
+	return 0;
+}
+
+//! Magnetic field from model
+/*! Evaluate a World Magnetic Model at the year it was last set to. The model is only read,
+ * so any number of threads may evaluate the same model at once.
+	\param model ::geomagstruc loaded with ::geomag_load.
+	\param pos Geodetic position (lon, lat, alt) in (rad, rad, meters).
+	\param comp Magnetic field x, y, z components in Topocentric System, in Tesla.
+	\return Zero, or negative error.
+*/
+int32_t geomag_field(const geomagstruc &model, gvector pos, rvector *comp)
+{
+	const double a = 6378.137;
+	const double b = 6356.7523142;
+	const double re = 6371.2;
+	const double a2 = a*a;
+	const double b2 = b*b;
+	const double c2 = a2-b2;
+	const double a4 = a2*a2;
+	const double c4 = a4-b2*b2;
+	double p[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+	double dp[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+	double sp[GEOMAG_MAX_DEGREE+1], cp[GEOMAG_MAX_DEGREE+1], pp[GEOMAG_MAX_DEGREE+1];
+
+	if (comp == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	double alt = pos.h/1000.;
+	double srlon = sin(pos.lon);
+	double srlat = sin(pos.lat);
+	double crlon = cos(pos.lon);
+	double crlat = cos(pos.lat);
+	double srlat2 = srlat*srlat;
+	double crlat2 = crlat*crlat;
+	sp[0] = 0.;
+	cp[0] = pp[0] = p[0][0] = 1.;
+	dp[0][0] = 0.;
+	sp[1] = srlon;
+	cp[1] = crlon;
+
+	/* CONVERT FROM GEODETIC COORDS. TO SPHERICAL COORDS. */
+	double q = sqrt(a2-c2*srlat2);
+	double q1 = alt*q;
+	double q2 = ((q1+a2)/(q1+b2))*((q1+a2)/(q1+b2));
+	double ct = srlat/sqrt(q2*crlat2+srlat2);
+	double st = sqrt(1.-(ct*ct));
+	double r = sqrt((alt*alt)+2.*q1+(a4-c4*srlat2)/(q*q));
+	double d = sqrt(a2*crlat2+b2*srlat2);
+	double ca = (alt+d)/r;
+	double sa = c2*crlat*srlat/(r*d);
+
+	for (int m=2; m<=model.maxdeg; m++)
+	{
+		sp[m] = sp[1]*cp[m-1]+cp[1]*sp[m-1];
+		cp[m] = cp[1]*cp[m-1]-sp[1]*sp[m-1];
+	}
+
+	double aor = re/r;
+	double ar = aor*aor;
+	double br = 0., bt = 0., bp = 0., bpp = 0.;
+	for (int n=1; n<=model.maxdeg; n++)
+	{
+		ar = ar*aor;
+		for (int m=0; m<=n; m++)
+		{
+			/*
+   COMPUTE UNNORMALIZED ASSOCIATED LEGENDRE POLYNOMIALS
+   AND DERIVATIVES VIA RECURSION RELATIONS
+*/
+			if (n == m)
+			{
+				p[m][n] = st*p[m-1][n-1];
+				dp[m][n] = st*dp[m-1][n-1]+ct*p[m-1][n-1];
+			}
+			else if (m == n-1)
+			{
+				p[m][n] = ct*p[m][n-1];
+				dp[m][n] = ct*dp[m][n-1]-st*p[m][n-1];
+			}
+			else
+			{
+				p[m][n] = ct*p[m][n-1]-model.k[m][n]*p[m][n-2];
+				dp[m][n] = ct*dp[m][n-1]-st*p[m][n-1]-model.k[m][n]*dp[m][n-2];
+			}
+
+			/*
+	ACCUMULATE TERMS OF THE SPHERICAL HARMONIC EXPANSIONS
+*/
+			double par = ar*p[m][n];
+			double temp1, temp2;
+			if (m == 0)
+			{
+				temp1 = model.tc[m][n]*cp[m];
+				temp2 = model.tc[m][n]*sp[m];
+			}
+			else
+			{
+				temp1 = model.tc[m][n]*cp[m]+model.tc[n][m-1]*sp[m];
+				temp2 = model.tc[m][n]*sp[m]-model.tc[n][m-1]*cp[m];
+			}
+			bt = bt-ar*temp1*dp[m][n];
+			bp += (model.fm[m]*temp2*par);
+			br += (model.fn[n]*temp1*par);
+
+			/*
+	SPECIAL CASE:  NORTH/SOUTH GEOGRAPHIC POLES
+*/
+			if (st == 0. && m == 1)
+			{
+				if (n == 1) pp[n] = pp[n-1];
+				else pp[n] = ct*pp[n-1]-model.k[m][n]*pp[n-2];
+				bpp += (model.fm[m]*temp2*ar*pp[n]);
+			}
+		}
+	}
+	if (st == 0.) bp = bpp;
+	else bp /= st;
+
+	/*
+	ROTATE MAGNETIC VECTOR COMPONENTS FROM SPHERICAL TO
+	GEODETIC COORDINATES
+*/
+	comp->col[0] = (-bt*ca-br*sa)*1e-9;
+	comp->col[1] = bp*1e-9;
+	comp->col[2] = (bt*sa-br*ca)*1e-9;
+
+	return 0;
+}
+
+//! Magnetic field at many positions
+/*! Set the model to the requested year once, then evaluate it at an array of positions,
+ * spread across threads.
+	\param model ::geomagstruc loaded with ::geomag_load.
+	\param year Time in decimal years.
+	\param count Number of positions.
+	\param pos Array of Geodetic positions (lon, lat, alt) in (rad, rad, meters).
+	\param comp Array of magnetic field x, y, z components in Topocentric System, in Tesla.
+	\param threads Number of threads to use.
+	\return Number of positions, or negative error.
+*/
+int32_t geomag_batch(geomagstruc &model, double year, size_t count, const gvector *pos, rvector *comp, uint16_t threads)
+{
+	if (pos == nullptr || comp == nullptr)
+	{
+		return GENERAL_ERROR_NULLPOINTER;
+	}
+
+	int32_t iretn = geomag_year(model, year);
+	if (iretn < 0)
+	{
+		return iretn;
+	}
+
+	const geomagstruc &cmodel = model;
+	auto kernel = [&](size_t begin, size_t end)
+	{
+		for (size_t i=begin; i<end; ++i)
+		{
+			geomag_field(cmodel, pos[i], &comp[i]);
+		}
+	};
+
+	if (threads < 2 || count < 2 * (size_t)threads)
+	{
+		kernel(0, count);
+	}
+	else
+	{
+		vector<thread> pool;
+		size_t slice = (count + threads - 1) / threads;
+		for (size_t begin=0; begin<count; begin+=slice)
+		{
+			pool.push_back(thread(kernel, begin, begin + slice < count ? begin + slice : count));
+		}
+		for (thread &worker : pool)
+		{
+			worker.join();
+		}
+	}
+
+	return (int32_t)count;
+}
 
 //! Main function to compute the magnetic field from the
 //! World Magnetic Model
-/*! Input: Position, time | output: Mag Field
+/*! Input: Position, time | output: Mag Field. The model file for the requested time is
+ * loaded when first needed and kept. If a later time needs a file that can not be found, the
+ * model already loaded continues to be used for as long as it is valid. Safe to call from
+ * several threads, though calls are serialized; use ::geomag_field for parallel work.
         \param pos geodetic position (lon, lat, alt) in (rad, rad, meters)
         \param time in decimal year, ex. use mjd2year(currentmjd())
         \param comp are the magnetic field x,y,z components in Topocentric System
 */
 int32_t geomag_front(gvector pos, double time, rvector *comp)
+{
+	static geomagstruc model;
+	static int loaded = -1;
+	static int tried = -1;
+	static std::mutex mtx;
+	int32_t iretn;
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	int itime = 5 * (int)(time/5.);
+	if (itime != loaded && itime != tried)
+	{
+		string wname;
+		geomagstruc nmodel;
+		tried = itime;
+		if ((iretn=geomag_filename(time, wname)) == 0 && (iretn=geomag_load(wname, nmodel)) == 0)
+		{
+			model = nmodel;
+			loaded = itime;
+		}
+		else if (loaded < 0)
+		{
+			return iretn;
+		}
+	}
+
+	if ((iretn=geomag_year(model, time)) < 0)
+	{
+		comp->col[0] = comp->col[1] = comp->col[2] = 0.;
+		return iretn;
+	}
+
+	return geomag_field(model, pos, comp);
+}
+
+//! Original NGDC driver
+/*! Magnetic field through the original, single threaded NGDC routine, which loads the model
+ * file for the first time it is given and then keeps it. Kept as a reference for ::geomag_field.
+        \param pos geodetic position (lon, lat, alt) in (rad, rad, meters)
+        \param time in decimal year, ex. use mjd2year(currentmjd())
+        \param comp are the magnetic field x,y,z components in Topocentric System
+*/
+int32_t geomag_front_ngdc(gvector pos, double time, rvector *comp)
 {
 	static int maxdeg, itime;
 	static float alt,  dec, dip, ti, gv, bx, by, bz;
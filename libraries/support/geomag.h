@@ -40,16 +40,72 @@
 //! Front end for calculating the World Magnetic Model provided by the National
 //! Geophysical Data Center. Requires an appropriate model file for the requested datae range in resources/general.
 //! COSMOS currently provides wmm_2005_cof, wmm_2010_cof and wmm_2015_cof.
+//!
+//! ::geomag_front is the simple entry point, finding and loading the model file itself. Where the field is
+//! needed often, or from several threads, load a ::geomagstruc once with ::geomag_load and evaluate it with
+//! ::geomag_field or ::geomag_batch. A ::geomagstruc holds no state that changes during evaluation, so each
+//! thread can share it, or keep its own copy for a different epoch.
 
 #include "support/configCosmos.h"
 
 #include "math/mathlib.h"
 
+//! \ingroup geomag
+//! \defgroup geomag_constants World Magnetic Model constants
+//! @{
+
+//! Highest degree and order of the model
+#define GEOMAG_MAX_DEGREE 12
+//! Years beyond the model epoch that it may be used for
+#define GEOMAG_MAX_SPAN 15.
+
+//! @}
+
+//! \ingroup geomag
+//! \defgroup geomag_typedefs World Magnetic Model typedefs
+//! @{
+
+//! World Magnetic Model
+/*! Spherical harmonic coefficients of one model file, converted from Schmidt normalized to
+ * unnormalized form, and the Gauss coefficients adjusted to the year last set with ::geomag_year.
+*/
+struct geomagstruc
+{
+	//! Model name from the file header
+	char name[20];
+	//! Epoch of the model, in decimal years
+	double epoch;
+	//! Degree and order in use
+	uint16_t maxdeg;
+	//! Main field coefficients
+	double c[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+	//! Secular variation coefficients
+	double cd[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+	//! Legendre recursion constants
+	double k[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+	//! Radial multipliers, n+1
+	double fn[GEOMAG_MAX_DEGREE+1];
+	//! Order multipliers, m
+	double fm[GEOMAG_MAX_DEGREE+1];
+	//! Year the time adjusted coefficients are for, in decimal years
+	double year;
+	//! Time adjusted coefficients
+	double tc[GEOMAG_MAX_DEGREE+1][GEOMAG_MAX_DEGREE+1];
+};
+
+//! @}
+
 //! \ingroup geomag
 //! \defgroup geomag_functions World Magnetic Model function declarations
 //! @{
 
 int32_t geomag_front(gvector pos, double year, rvector *comp);
+int32_t geomag_front_ngdc(gvector pos, double year, rvector *comp);
+int32_t geomag_load(string fname, geomagstruc &model);
+int32_t geomag_load(double year, geomagstruc &model);
+int32_t geomag_year(geomagstruc &model, double year);
+int32_t geomag_field(const geomagstruc &model, gvector pos, rvector *comp);
+int32_t geomag_batch(geomagstruc &model, double year, size_t count, const gvector *pos, rvector *comp, uint16_t threads=1);
 
 //! @}
 
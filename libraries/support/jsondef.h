@@ -383,10 +383,16 @@ enum
 #define COSMOS_MAX_NAME 40
 //! Maximum value of JSON HASH
 #define JSON_MAX_HASH (COSMOS_MAX_NAME*37)
+//! Number of ::jsonentry in each block of ::cosmosmetastruc::jentry
+#define JSON_ENTRY_BLOCK 4096
 //! Maximum JSON buffer
 #define JSTRINGMAXBUFFER (AGENTMAXBUFFER-2)
 //! Maximum number of ::cosmosstruc elements
 #define MAX_COSMOSSTRUC 20
+//! Name of the Namespace image in the Node directory
+#define JSON_IMAGE_NAME "namespace.img"
+//! Version of the Namespace image layout
+#define JSON_IMAGE_VERSION 3
 
 //! Entire ::cosmosstruc
 //#define JSON_MAP_ALL 0
@@ -620,38 +626,54 @@ struct jsonnode
 
 //! JSON map offset entry
 /*! Single entry in a JSON offset map. Ties together a single JSON name and a offset
- * to a single object, along with its data type.
- * - index: Index of this entry in the ::cosmosstruc::jmap.
- * - data: Offset to appropriate storage for this data type.
+ * to a single object, along with its data type. Only what every lookup, parse and output
+ * needs is kept here, so that entries pack in to ::cosmosmetastruc::jentry; the rest is in
+ * the matching ::jsoninfo.
+ * - index: Index of this entry in ::cosmosmetastruc::jentry and ::cosmosmetastruc::jinfo.
+ * - name: Offset of the name in ::cosmosmetastruc::jname. Use ::json_name_of.
 */
 struct jsonentry
 {
-    //! Enabled?
-    bool enabled;
+    //! offset to data storage
+    ptrdiff_t offset;
+    //! size of data storage
+    uint32_t size;
+    //! Offset of name in ::cosmosmetastruc::jname
+    uint32_t name;
+    //! ::cosmosmetastruc::version at which the value was last seen to change, or 0 if not yet checked
+    uint32_t version = 0;
+    //! Index of entry
+    uint32_t index;
+    //! Length of name
+    uint16_t name_size;
     //! JSON Data Type
     uint16_t type;
     //! JSON Data Group
     uint16_t group;
-    //! Name of entry
-    string name;
-    //! offset to data storage
-    ptrdiff_t offset;
-    //! size of data storage
-    size_t size;
-    //! vector of actual data
-    vector <uint8_t> data;
+    //! Enabled?
+    bool enabled = false;
+};
+
+//! JSON map entry information
+/*! The parts of a ::jsonentry that are seldom looked at, kept apart in
+ * ::cosmosmetastruc::jinfo at the same index.
+*/
+struct jsoninfo
+{
     //! Index to JSON Unit Type
-    uint16_t unit_index;
+    uint16_t unit_index = 0;
     //! Index to alert condition in Data Dictionary
-    uint16_t alert_index;
+    uint16_t alert_index = 0;
     //! Index to alarm condition in Data Dictionary
-    uint16_t alarm_index;
+    uint16_t alarm_index = 0;
     //! Index to maximum condition in Data Dictionary
-    uint16_t maximum_index;
+    uint16_t maximum_index = 0;
     //! Index to minimum condition in Data Dictionary
-    uint16_t minimum_index;
+    uint16_t minimum_index = 0;
     //! Index to subsystem
-    uint16_t subsystem;
+    uint16_t subsystem = 0;
+    //! Offset in ::cosmosmetastruc::jshadow of the slot for the value as last checked by ::json_of_table_since, or UINT32_MAX for aliases and equations
+    uint32_t data = UINT32_MAX;
 };
 
 //! JSON handle
@@ -999,6 +1021,14 @@ struct targetstruc
     double close;
     float min;
     locstruc loc;
+    //! Target is static (fixed to the Earth): its location is only brought up to date when it changes
+    uint16_t fixed = 0;
+    //! Position pass of ::loc for which the Topocentric values below were found
+    uint32_t pass = 0;
+    //! Geocentric to Topocentric rotation at the Target
+    rmatrix g2t;
+    //! Geocentric position of the Target on the geoid, as used by ::geoc2topo
+    rvector site;
 };
 
 //! Port structure
@@ -1804,8 +1834,19 @@ struct cosmosmetastruc
     string node;
     //! Whether JSON map has been created.
     uint16_t jmapped;
-    //! JSON Namespace Map matrix.
-    vector<vector<jsonentry> > jmap;
+    //! JSON Namespace Map matrix: for each hash, the index of each entry in ::jentry.
+    vector<vector<uint32_t> > jmap;
+    //! JSON Namespace entries, in blocks of ::JSON_ENTRY_BLOCK that are never reallocated, so
+    //! pointers to entries stay good as more are added.
+    vector<vector<jsonentry> > jentry;
+    //! Information for each entry in ::jentry.
+    vector<jsoninfo> jinfo;
+    //! Names of the entries in ::jentry, each once, each ended by a NUL.
+    string jname;
+    //! Copies of values as last checked by ::json_of_table_since.
+    vector<uint8_t> jshadow;
+    //! The ::cosmosdatastruc that ::jshadow holds copies from.
+    const cosmosdatastruc *jshadow_of = nullptr;
     //! JSON Equation Map matrix.
     vector<vector<jsonequation> > emap;
     //! JSON Unit Map matrix: first level is for type, second level is for variant.
@@ -1814,6 +1855,8 @@ struct cosmosmetastruc
     vector<equationstruc> equation;
     //! Array of Aliases
     vector<aliasstruc> alias;
+    //! Count of changes seen in Namespace values, for ::jsonentry::version
+    uint32_t version = 0;
 };
 
 //! JSON Name Space structure
@@ -1833,6 +1876,36 @@ struct cosmosstruc
     jsonnode json;
 };
 
+//! JSON Name Space snapshot
+/*! Triple buffering for the parts of a ::cosmosdatastruc that incoming messages update: the node
+ * and its devices. A writer parses in to its own working ::cosmosdatastruc and publishes it with
+ * ::json_snapshot_publish; a reader takes the latest complete version in to its own
+ * ::cosmosdatastruc with ::json_snapshot_acquire. Buffers change hands by index and vector swaps,
+ * so the lock is never held for a copy of the device list, and the reader never sees an update
+ * half applied. Values the reader sets are queued with ::json_snapshot_set for the writer to
+ * take in to its working copy with ::json_snapshot_take, and are applied again on acquiring
+ * any version published before they were taken, so they are never overwritten.
+*/
+struct json_snapshot
+{
+    std::mutex lock;
+    //! Writer's spare, and most recently published, copies of the node and devices
+    nodestruc node[2];
+    vector<devicestruc> device[2];
+    //! Index of the writer's spare
+    uint16_t back = 0;
+    //! Index of the most recently published
+    uint16_t middle = 1;
+    //! Published but not yet acquired
+    bool fresh = false;
+    //! Count of publications
+    uint32_t version = 0;
+    //! Values set by the reader, as JSON, not yet taken by the writer
+    vector<string> pending;
+    //! Values taken by the writer, but not yet published
+    vector<string> taken;
+};
+
 //! @}
 
 #endif
@@ -41,6 +41,11 @@
 #include <iostream>
 #include <limits>
 #include <fstream>
+#include <type_traits>
+#if defined(COSMOS_LINUX_OS) || defined(COSMOS_MAC_OS)
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 
 vector <string> device_type_string;
 //{
@@ -541,7 +546,7 @@ void json_destroy(cosmosstruc *cinfo)
     \return The hash, as an unsigned 16 bit number.
 */
 
-uint16_t json_hash(string hstring)
+uint16_t json_hash(const string &hstring)
 {
     uint16_t hashval;
 
@@ -556,6 +561,52 @@ uint16_t json_hash(string hstring)
     return (hashval % JSON_MAX_HASH);
 }
 
+//! Namespace entry by index
+/*! Find an entry in the blocks of ::cosmosmetastruc::jentry.
+    \param index Index of the entry, as kept in ::cosmosmetastruc::jmap.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    
+eturn Pointer to the ::jsonentry.
+*/
+jsonentry *json_entry_at(uint32_t index, cosmosmetastruc &cmeta)
+{
+    return &cmeta.jentry[index / JSON_ENTRY_BLOCK][index % JSON_ENTRY_BLOCK];
+}
+
+//! Name of Namespace entry
+/*! Names are kept once each in ::cosmosmetastruc::jname. The pointer is good until the next
+ * entry is added.
+    \param entry Pointer to a valid ::jsonentry.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    
+eturn Name of the entry, ended by a NUL.
+*/
+const char *json_name_of(const jsonentry *entry, const cosmosmetastruc &cmeta)
+{
+    return &cmeta.jname[entry->name];
+}
+
+//! Information for Namespace entry
+/*! Find the ::jsoninfo kept apart for an entry.
+    \param entry Pointer to a valid ::jsonentry.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    
+eturn Pointer to the ::jsoninfo.
+*/
+jsoninfo *json_info_of(const jsonentry *entry, cosmosmetastruc &cmeta)
+{
+    return &cmeta.jinfo[entry->index];
+}
+
+// Held while kept copies and versions change, in any Namespace
+static std::mutex jshadow_mutex;
+
+// Whether a Namespace entry has the given name
+static inline bool json_name_is(const jsonentry *entry, const string &name, const cosmosmetastruc &cmeta)
+{
+    return entry->name_size == name.size() && !memcmp(&cmeta.jname[entry->name], name.data(), name.size());
+}
+
 //! Enter an alias into the JSON Namespace.
 /*! See if the provided name is in the Namespace. If so, add an entry
  * for the provided alias that points to the same location.
@@ -574,7 +625,6 @@ int32_t json_addentry(string alias, string value, cosmosmetastruc &cmeta)
     if ((iretn = json_name_map(alias, cmeta, handle)))
     {
         jsonentry tentry;
-        tentry.name = alias;
         aliasstruc talias;
         talias.name = alias;
         // If it begins with ( then it is an equation, otherwise treat as name
@@ -598,7 +648,7 @@ int32_t json_addentry(string alias, string value, cosmosmetastruc &cmeta)
             }
             // Add new alias
             talias.handle = handle;
-            talias.type = cmeta.jmap[handle.hash][handle.index].type;
+            talias.type = json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta)->type;
             break;
         }
         // Place it in the Alias vector and point to it in the map
@@ -607,7 +657,7 @@ int32_t json_addentry(string alias, string value, cosmosmetastruc &cmeta)
         tentry.group = JSON_STRUCT_ALIAS;
         tentry.offset = cmeta.alias.size() - 1;
         tentry.size = COSMOS_SIZEOF(aliasstruc);
-        iretn = json_addentry(tentry, cmeta);
+        iretn = json_addentry(alias, tentry, jsoninfo(), cmeta);
         if (iretn < 0)
         {
             return iretn;
@@ -617,22 +667,63 @@ int32_t json_addentry(string alias, string value, cosmosmetastruc &cmeta)
 }
 
 //! Enter an entry into the JSON Namespace.
-/*! Enters a ::jsonentry in the JSON Data Name Space.
-    \param entry The entry to be entered.
+/*! Enters a ::jsonentry in the JSON Data Name Space. The entry goes at the end of
+ * ::cosmosmetastruc::jentry, its information at the end of ::cosmosmetastruc::jinfo, and its
+ * name in to ::cosmosmetastruc::jname, unless an entry of that name is already there. Unless it
+ * is an alias or equation, a slot the size of its value is added to ::cosmosmetastruc::jshadow.
+    \param name Name of the entry.
+    \param entry The entry to be entered. Name and index are filled in.
+    \param info Information for the entry.
     \param cmeta Reference to ::cosmosmetastruc to use.
     \return The current number of entries, if successful, negative error if the entry could not be
     added.
 */
-int32_t json_addentry(jsonentry entry, cosmosmetastruc &cmeta)
+int32_t json_addentry(string name, jsonentry entry, jsoninfo info, cosmosmetastruc &cmeta)
 {
-    uint16_t hash = json_hash(entry.name);
-    size_t csize = cmeta.jmap[hash].size();
-    cmeta.jmap[hash].push_back(entry);
-    if (cmeta.jmap[hash].size() != csize+1)
+    if (name.size() > UINT16_MAX)
     {
-        return JSON_ERROR_NOENTRY;
+        return JSON_ERROR_NAME_LENGTH;
     }
 
+    uint16_t hash = json_hash(name);
+    entry.name = cmeta.jname.size();
+    entry.name_size = name.size();
+    for (uint32_t index : cmeta.jmap[hash])
+    {
+        jsonentry *tentry = json_entry_at(index, cmeta);
+        if (json_name_is(tentry, name, cmeta))
+        {
+            entry.name = tentry->name;
+            break;
+        }
+    }
+    if (entry.name == cmeta.jname.size())
+    {
+        cmeta.jname.append(name);
+        cmeta.jname.push_back('\0');
+    }
+
+    // Set aside a slot for the copy of the value kept by json_of_table_since, now, so that
+    // checking for changes never moves the copies of other entries
+    entry.version = 0;
+    info.data = UINT32_MAX;
+    if (entry.group != JSON_STRUCT_ALIAS && entry.group != JSON_STRUCT_EQUATION)
+    {
+        std::lock_guard<std::mutex> locker(jshadow_mutex);
+        info.data = cmeta.jshadow.size();
+        cmeta.jshadow.resize(cmeta.jshadow.size() + entry.size);
+    }
+
+    entry.index = cmeta.jinfo.size();
+    if (entry.index % JSON_ENTRY_BLOCK == 0)
+    {
+        cmeta.jentry.push_back(vector<jsonentry>());
+        cmeta.jentry.back().reserve(JSON_ENTRY_BLOCK);
+    }
+    cmeta.jentry.back().push_back(entry);
+    cmeta.jinfo.push_back(info);
+    cmeta.jmap[hash].push_back(entry.index);
+
     ++cmeta.jmapped;
 
     return (cmeta.jmapped);
@@ -658,6 +749,7 @@ int32_t json_addentry(jsonentry entry, cosmosmetastruc &cmeta)
 int32_t json_addentry(string name, uint16_t d1, uint16_t d2, ptrdiff_t offset, size_t size, uint16_t type, uint16_t group, cosmosmetastruc &cmeta, uint16_t unit)
 {
     jsonentry tentry;
+    jsoninfo tinfo;
     char ename[COSMOS_MAX_NAME+1];
 
     // Determine extended name
@@ -668,18 +760,13 @@ int32_t json_addentry(string name, uint16_t d1, uint16_t d2, ptrdiff_t offset, s
         sprintf(&ename[strlen(ename)],"_%03u",d2);
 
     // Populate the entry
-    tentry.alarm_index = 0;
-    tentry.alert_index = 0;
-    tentry.maximum_index = 0;
-    tentry.minimum_index = 0;
-    tentry.unit_index = unit;
+    tinfo.unit_index = unit;
     tentry.type = type;
     tentry.group = group;
-    tentry.name = ename;
     tentry.offset = offset;
     tentry.size = size;
 
-    return json_addentry(tentry, cmeta);
+    return json_addentry(ename, tentry, tinfo, cmeta);
 }
 
 //! Toggle the enable state of an entry in the JSON Namespace map.
@@ -815,7 +902,7 @@ int32_t json_out_handle(string &jstring, jsonhandle handle, cosmosmetastruc &cme
     if (!cmeta.jmapped)
         return (JSON_ERROR_NOJMAP);
 
-    iretn = json_out_entry(jstring, &cmeta.jmap[handle.hash][handle.index], cmeta, cdata);
+    iretn = json_out_entry(jstring, json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta), cmeta, cdata);
 
     return (iretn);
 }
@@ -840,7 +927,7 @@ int32_t json_out_entry(string &jstring, jsonentry* entry, cosmosmetastruc &cmeta
         return (iretn);
 
     data = json_ptr_of_offset(entry->offset, entry->group, cmeta, cdata);
-    if ((iretn=json_out_value(jstring, entry->name, data, entry->type, cmeta, cdata)) != 0)
+    if ((iretn=json_out_value(jstring, string(json_name_of(entry, cmeta), entry->name_size), data, entry->type, cmeta, cdata)) != 0)
         return (iretn);
 
     if ((iretn=json_out_character(jstring,'}')) != 0)
@@ -1031,8 +1118,8 @@ int32_t json_out_type(string &jstring, uint8_t *data, uint16_t type, cosmosmetas
             break;
         default:
         {
-            jsonentry *eptr = &cmeta.jmap[aptr->handle.hash][aptr->handle.index];
-            if ((iretn=json_out_type(jstring, eptr->data.data(), eptr->type, cmeta, cdata)) != 0)
+            jsonentry *eptr = json_entry_at(cmeta.jmap[aptr->handle.hash][aptr->handle.index], cmeta);
+            if ((iretn=json_out_type(jstring, json_ptr_of_offset(eptr->offset, eptr->group, cmeta, cdata), eptr->type, cmeta, cdata)) != 0)
             {
                 return iretn;
             }
@@ -2325,7 +2412,7 @@ int32_t json_out(string &jstring, string token, cosmosmetastruc &cmeta, cosmosda
 
     for (h.index=0; h.index<cmeta.jmap[h.hash].size(); ++h.index)
         //		if (!strcmp(token.c_str(), cmeta.jmap[h.hash][h.index].name))
-        if (token == cmeta.jmap[h.hash][h.index].name)
+        if (json_name_is(json_entry_at(cmeta.jmap[h.hash][h.index], cmeta), token, cmeta))
         {
             return (json_out_handle(jstring, h, cmeta, cdata));
         }
@@ -2390,7 +2477,7 @@ int32_t json_out_wildcard(string &jstring, string wildcard, cosmosmetastruc &cme
     {
         for (h.index=0; h.index<cmeta.jmap[h.hash].size(); ++h.index)
         {
-            if (string_cmp(wildcard.c_str(), cmeta.jmap[h.hash][h.index].name.c_str()))
+            if (string_cmp(wildcard.c_str(), json_name_of(json_entry_at(cmeta.jmap[h.hash][h.index], cmeta), cmeta)))
             {
                 iretn = json_out_handle(jstring, h, cmeta, cdata);
             }
@@ -2511,7 +2598,6 @@ int32_t json_table_of_list(vector<jsonentry*> &table, string tokens, cosmosmetas
 */
 jsonentry *json_entry_of(uint8_t *ptr, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
 {
-    uint16_t n, m;
     uint16_t group = UINT16_MAX;
     ptrdiff_t offset;
 
@@ -2559,13 +2645,13 @@ jsonentry *json_entry_of(uint8_t *ptr, cosmosmetastruc &cmeta, cosmosdatastruc &
     if (offset == -1)
         return ((jsonentry *)NULL);
 
-    for (m=0; m<cmeta.jmap.size(); m++)
+    for (vector<jsonentry> &block : cmeta.jentry)
     {
-        for (n=0; n<cmeta.jmap[m].size(); n++)
+        for (jsonentry &entry : block)
         {
-            if (cmeta.jmap[m][n].group == group && cmeta.jmap[m][n].offset == offset)
+            if (entry.group == group && entry.offset == offset)
             {
-                return ((jsonentry *)&cmeta.jmap[m][n]);
+                return (&entry);
             }
         }
     }
@@ -2579,7 +2665,7 @@ jsonentry *json_entry_of(uint8_t *ptr, cosmosmetastruc &cmeta, cosmosdatastruc &
     \param cmeta Reference to ::cosmosmetastruc to use.
  \return Pointer to the ::jsonentry for the token, or NULL.
 */
-jsonentry *json_entry_of(string token, cosmosmetastruc &cmeta)
+jsonentry *json_entry_of(const string &token, cosmosmetastruc &cmeta)
 {
     int16_t hash;
     uint16_t n;
@@ -2594,9 +2680,9 @@ jsonentry *json_entry_of(string token, cosmosmetastruc &cmeta)
 
     for (n=0; n<cmeta.jmap[hash].size(); n++)
     {
-        if (token == cmeta.jmap[hash][n].name)
+        if (json_name_is(json_entry_at(cmeta.jmap[hash][n], cmeta), token, cmeta))
         {
-            return ((jsonentry *)&cmeta.jmap[hash][n]);
+            return ((jsonentry *)json_entry_at(cmeta.jmap[hash][n], cmeta));
         }
     }
     return ((jsonentry *)NULL);
@@ -2635,7 +2721,7 @@ jsonentry *json_entry_of(jsonhandle handle, cosmosmetastruc &cmeta)
 
     if (cmeta.jmap[handle.hash].size() > handle.index)
     {
-        return ((jsonentry *)&cmeta.jmap[handle.hash][handle.index]);
+        return ((jsonentry *)json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta));
     }
     return ((jsonentry *)nullptr);
 }
@@ -2743,7 +2829,7 @@ int32_t json_get_int(jsonhandle &handle, cosmosmetastruc &cmeta, cosmosdatastruc
         return 0;
     }
 
-    value = json_get_int(&cmeta.jmap[handle.hash][handle.index], cmeta, cdata);
+    value = json_get_int(json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta), cmeta, cdata);
     return value;
 }
 
@@ -2907,7 +2993,7 @@ uint32_t json_get_uint(jsonhandle &handle, cosmosmetastruc &cmeta, cosmosdatastr
         return 0;
     }
 
-    value = json_get_uint(&cmeta.jmap[handle.hash][handle.index], cmeta, cdata);
+    value = json_get_uint(json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta), cmeta, cdata);
     return value;
 }
 
@@ -3096,7 +3182,7 @@ double json_get_double(jsonhandle &handle, cosmosmetastruc &cmeta, cosmosdatastr
         return 0.;
     }
 
-    value = json_get_double(&cmeta.jmap[handle.hash][handle.index], cmeta, cdata);
+    value = json_get_double(json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta), cmeta, cdata);
     return value;
 }
 
@@ -3827,7 +3913,7 @@ double json_equation(jsonequation *ptr, cosmosmetastruc &cmeta, cosmosdatastruc
             a[i] = json_equation(&cmeta.emap[ptr->operand[i].data.hash][ptr->operand[i].data.index], cmeta, cdata);
             break;
         case JSON_OPERAND_NAME:
-            a[i] = json_get_double(&cmeta.jmap[ptr->operand[i].data.hash][ptr->operand[i].data.index], cmeta, cdata);
+            a[i] = json_get_double(json_entry_at(cmeta.jmap[ptr->operand[i].data.hash][ptr->operand[i].data.index], cmeta), cmeta, cdata);
             break;
         }
     }
@@ -4160,7 +4246,7 @@ int32_t json_tokenize_namedobject(const char* &ptr, cosmosmetastruc &cmeta, json
 
     // See if there is a match in the ::jsonmap.
     for (index=0; index<cmeta.jmap[hash].size(); ++index)	{
-        if (ostring == cmeta.jmap[hash][index].name)
+        if (json_name_is(json_entry_at(cmeta.jmap[hash][index], cmeta), ostring, cmeta))
         {
             break;
         }
@@ -4353,8 +4439,10 @@ int32_t json_parse_namedobject(const char* &ptr, cosmosmetastruc &cmeta, cosmosd
     hash = json_hash(ostring);
 
     // See if there is a match in the ::jsonmap.
+    jsonentry *entry = nullptr;
     for (n=0; n<cmeta.jmap[hash].size(); ++n)	{
-        if (ostring == cmeta.jmap[hash][n].name)
+        entry = json_entry_at(cmeta.jmap[hash][n], cmeta);
+        if (json_name_is(entry, ostring, cmeta))
         {
             break;
         }
@@ -4395,7 +4483,7 @@ int32_t json_parse_namedobject(const char* &ptr, cosmosmetastruc &cmeta, cosmosd
             else
                 return (iretn);
         }
-        if ((iretn = json_parse_value(ptr,cmeta.jmap[hash][n].type,cmeta.jmap[hash][n].offset,cmeta.jmap[hash][n].group, cmeta, cdata)) < 0)
+        if ((iretn = json_parse_value(ptr,entry->type,entry->offset,entry->group, cmeta, cdata)) < 0)
         {
             if (iretn != JSON_ERROR_EOS)
             {
@@ -4415,7 +4503,7 @@ int32_t json_parse_namedobject(const char* &ptr, cosmosmetastruc &cmeta, cosmosd
     json_skip_white(ptr);
     if (iretn == 0)
     {
-        cmeta.jmap[hash][n].enabled = true;
+        entry->enabled = true;
     }
     return (iretn);
 }
@@ -4884,6 +4972,34 @@ int32_t json_set_number(double val, uint16_t type, ptrdiff_t offset, uint16_t gr
     return (iretn);
 }
 
+// Compare an entry with the copy kept in its slot the last time it was checked. If it differs, or
+// it has not been checked yet (version 0), keep the new value and move the entry to the next
+// Namespace version. Aliases and equations have no slot, as they have no value of their own to
+// keep, so always count as changed. Slots are set aside by json_addentry, so this never grows
+// cmeta.jshadow. Only called by json_of_table_since, with jshadow_mutex held.
+static bool json_mark_change(jsonentry *entry, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
+{
+    jsoninfo *info = json_info_of(entry, cmeta);
+    if (info->data == UINT32_MAX)
+    {
+        entry->version = ++cmeta.version;
+        return true;
+    }
+
+    uint8_t *data = json_ptr_of_offset(entry->offset, entry->group, cmeta, cdata);
+    if (data == nullptr)
+    {
+        return false;
+    }
+    if (entry->version && !memcmp(&cmeta.jshadow[info->data], data, entry->size))
+    {
+        return false;
+    }
+    memcpy(&cmeta.jshadow[info->data], data, entry->size);
+    entry->version = ++cmeta.version;
+    return true;
+}
+
 int32_t json_parse_value(const char* &ptr, uint16_t type, ptrdiff_t offset, uint16_t group, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
 {
     string input;
@@ -6022,6 +6138,34 @@ int32_t json_pushdevspec(uint16_t cidx, cosmosdatastruc &cdata)
     return 0;
 }
 
+//! Place planetary Node
+/*! Nodes that are the Sun, Moon or Mars are placed where the ephemeris has them now.
+ * \param cinfo Pointer to cinfo ::cosmosstruc.
+ */
+static void json_setup_planet(cosmosstruc *cinfo)
+{
+    if (cinfo->pdata.node.type == NODE_TYPE_SUN)
+    {
+        jplpos(JPL_EARTH, JPL_SUN, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
+        cinfo->pdata.node.loc.pos.eci.pass++;
+        pos_eci(&cinfo->pdata.node.loc);
+    }
+
+    if (cinfo->pdata.node.type == NODE_TYPE_MOON)
+    {
+        jplpos(JPL_EARTH, JPL_MOON, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
+        cinfo->pdata.node.loc.pos.eci.pass++;
+        pos_eci(&cinfo->pdata.node.loc);
+    }
+
+    if (cinfo->pdata.node.type == NODE_TYPE_MARS)
+    {
+        jplpos(JPL_EARTH, JPL_MARS, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
+        cinfo->pdata.node.loc.pos.eci.pass++;
+        pos_eci(&cinfo->pdata.node.loc);
+    }
+}
+
 //! Setup JSON Namespace using Node description JSON
 /*! Create an entry in the JSON mapping tables between each name in the Name Space and the
  * \ref cosmosstruc. Load descriptive information from a structure of JSON descriptions.
@@ -6230,30 +6374,13 @@ int32_t json_setup_node(jsonnode json, cosmosstruc *cinfo, bool create_flag)
             }
         }
 
+        // Few entries are added after this, so give back what was taken for growth
+        cinfo->meta.jinfo.shrink_to_fit();
+        cinfo->meta.jname.shrink_to_fit();
     }
 
     cinfo->json = json;
-
-    if (cinfo->pdata.node.type == NODE_TYPE_SUN)
-    {
-        jplpos(JPL_EARTH, JPL_SUN, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
-        cinfo->pdata.node.loc.pos.eci.pass++;
-        pos_eci(&cinfo->pdata.node.loc);
-    }
-
-    if (cinfo->pdata.node.type == NODE_TYPE_MOON)
-    {
-        jplpos(JPL_EARTH, JPL_MOON, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
-        cinfo->pdata.node.loc.pos.eci.pass++;
-        pos_eci(&cinfo->pdata.node.loc);
-    }
-
-    if (cinfo->pdata.node.type == NODE_TYPE_MARS)
-    {
-        jplpos(JPL_EARTH, JPL_MARS, currentmjd(cinfo->pdata.node.utcoffset), &cinfo->pdata.node.loc.pos.eci);
-        cinfo->pdata.node.loc.pos.eci.pass++;
-        pos_eci(&cinfo->pdata.node.loc);
-    }
+    json_setup_planet(cinfo);
 
     if (dump_flag && !nodepath.empty())
     {
@@ -6266,10 +6393,12 @@ int32_t json_setup_node(jsonnode json, cosmosstruc *cinfo, bool create_flag)
 //! Setup JSON Namespace using file.
 /*! Create an entry in the JSON mapping tables between each name in the Name Space and the
  * \ref cosmosstruc. Load descriptive information from files in a Node directory of the goven name.
+ * If the Node directory holds a Namespace image made from the same description, the Namespace is
+ * loaded from that instead with ::json_load_image, and only the state is parsed. Otherwise the
+ * Namespace is set up from the description and a new image is saved for next time.
  *	\param node Name and/or path of node directory. If name, then a path will be created
  * based on nodedir setting. If path, then name will be extracted from the end.
  *	\param cinfo Pointer to cinfo ::cosmosstruc.
- * \param create_flag Whether or not to create node directory if it doesn't already exist.
     \return 0, or a negative ::error
 */
 int32_t json_setup_node(string node, cosmosstruc *cinfo)
@@ -6287,15 +6416,516 @@ int32_t json_setup_node(string node, cosmosstruc *cinfo)
         return iretn;
     }
 
+    string image = json_image_path(node);
+    uint64_t key = json_image_key(json);
+    if (!image.empty() && json_load_image(image, key, cinfo) >= 0)
+    {
+        if (!json.state.empty())
+        {
+            if ((iretn = json_parse(json.state, cinfo->meta, cinfo->pdata)) < 0 && iretn != JSON_ERROR_EOS)
+            {
+                return (iretn);
+            }
+            loc_update(&cinfo->pdata.node.loc);
+        }
+        if (!json.utcstart.empty())
+        {
+            if ((iretn = json_parse(json.utcstart, cinfo->meta, cinfo->pdata)) < 0 && iretn != JSON_ERROR_EOS)
+            {
+                return (iretn);
+            }
+        }
+        cinfo->json = json;
+        json_setup_planet(cinfo);
+        return 0;
+    }
+
     iretn = json_setup_node(json, cinfo);
     if (iretn < 0)
     {
         return iretn;
     }
 
+    // The image is only a cache, so a Node directory that can not be written is not an error
+    if (!image.empty())
+    {
+        json_save_image(image, key, cinfo);
+    }
+
     return 0;
 }
 
+//! Namespace image file
+/*! The name of the Namespace image kept in a Node directory.
+ *	\param node Name and/or path of node directory, as for ::json_load_node.
+ *	\return Path of the image, or empty if there is no Node directory.
+*/
+string json_image_path(string node)
+{
+    string nodepath;
+    if (node.rfind('/') == string::npos)
+    {
+        nodepath = get_nodedir(node);
+    }
+    else
+    {
+        nodepath = node;
+    }
+    if (nodepath.empty())
+    {
+        return nodepath;
+    }
+    return nodepath + "/" + JSON_IMAGE_NAME;
+}
+
+//! Namespace image key
+/*! A 64 bit FNV-1a style hash of the parts of a Node description that go in to a Namespace image, along
+ * with the image version and the time this library was built, so that an image is remade whenever
+ * the description, or the code that sets up the Namespace, changes. The state vector and start
+ * time are left out, as they are parsed fresh each time.
+ *	\param json ::jsonnode holding the description.
+ *	\return Key.
+*/
+uint64_t json_image_key(jsonnode &json)
+{
+    uint64_t key = 14695981039346656037ULL;
+    string build = string(__DATE__) + " " + __TIME__ + " " + std::to_string(JSON_IMAGE_VERSION);
+    for (const string *part : {&build, &json.node, &json.pieces, &json.devgen, &json.devspec, &json.ports, &json.targets, &json.aliases})
+    {
+        // Length first, so that text moving between parts changes the key
+        key = (key ^ part->size()) * 1099511628211ULL;
+        // Eight bytes at a time, as the descriptions of large Nodes run to megabytes
+        size_t i = 0;
+        for (; i+8<=part->size(); i+=8)
+        {
+            uint64_t word;
+            memcpy(&word, part->data() + i, 8);
+            key = (key ^ word) * 1099511628211ULL;
+            key ^= key >> 29;
+        }
+        for (; i<part->size(); ++i)
+        {
+            key = (key ^ (unsigned char)(*part)[i]) * 1099511628211ULL;
+        }
+    }
+    return key;
+}
+
+//! Namespace image header
+struct json_image_header
+{
+    char magic[8];
+    uint32_t version;
+    //! Sizes of the structures copied as they are, to catch a change of layout
+    uint32_t sizes[10];
+    uint64_t key;
+    //! Size of the whole image
+    uint64_t size;
+};
+
+static const char json_image_magic[8] = {'C', 'O', 'S', 'M', 'O', 'S', 'N', 'S'};
+
+static void json_image_sizes(uint32_t sizes[10])
+{
+    sizes[0] = sizeof(nodestruc);
+    sizes[1] = sizeof(physicsstruc);
+    sizes[2] = sizeof(piecestruc);
+    sizes[3] = sizeof(devicestruc);
+    sizes[4] = sizeof(portstruc);
+    sizes[5] = sizeof(targetstruc);
+    sizes[6] = sizeof(jsonoperand);
+    sizes[7] = sizeof(jsonhandle);
+    sizes[8] = sizeof(jsonentry);
+    sizes[9] = sizeof(jsoninfo);
+}
+
+static void json_image_put(string &image, const void *data, size_t size)
+{
+    image.append((const char *)data, size);
+}
+
+template <class T> static void json_image_put(string &image, const T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Namespace image values must be plain data");
+    json_image_put(image, &value, sizeof(T));
+}
+
+static void json_image_put(string &image, const string &value)
+{
+    json_image_put(image, (uint32_t)value.size());
+    json_image_put(image, value.data(), value.size());
+}
+
+template <class T> static void json_image_put(string &image, const vector<T> &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Namespace image values must be plain data");
+    json_image_put(image, (uint32_t)value.size());
+    json_image_put(image, value.data(), value.size() * sizeof(T));
+}
+
+//! Cursor through a Namespace image being loaded
+struct json_image_reader
+{
+    const uint8_t *ptr;
+    const uint8_t *end;
+};
+
+static bool json_image_get(json_image_reader &reader, void *data, size_t size)
+{
+    if ((size_t)(reader.end - reader.ptr) < size)
+    {
+        return false;
+    }
+    memcpy(data, reader.ptr, size);
+    reader.ptr += size;
+    return true;
+}
+
+template <class T> static bool json_image_get(json_image_reader &reader, T &value)
+{
+    return json_image_get(reader, &value, sizeof(T));
+}
+
+static bool json_image_get(json_image_reader &reader, string &value)
+{
+    uint32_t size;
+    if (!json_image_get(reader, size) || (size_t)(reader.end - reader.ptr) < size)
+    {
+        return false;
+    }
+    value.assign((const char *)reader.ptr, size);
+    reader.ptr += size;
+    return true;
+}
+
+template <class T> static bool json_image_get(json_image_reader &reader, vector<T> &value)
+{
+    uint32_t size;
+    if (!json_image_get(reader, size) || (size_t)(reader.end - reader.ptr) / sizeof(T) < size)
+    {
+        return false;
+    }
+    value.resize(size);
+    return json_image_get(reader, value.data(), size * sizeof(T));
+}
+
+//! Save Namespace image
+/*! Write everything that ::json_setup_node builds from a Node description (the Namespace map,
+ * equations, aliases, and the Node, pieces, devices, ports and targets) to a binary image, for
+ * ::json_load_image to read back. The image is written to a temporary file and renamed in to
+ * place, so that Agents starting together never see part of one.
+ *	\param filename Path of the image.
+ *	\param key Key of the description, from ::json_image_key.
+ *	\param cinfo Pointer to cinfo ::cosmosstruc that has been set up.
+ *	\return Size of the image, or negative error.
+*/
+int32_t json_save_image(string filename, uint64_t key, cosmosstruc *cinfo)
+{
+    if (cinfo == nullptr || !cinfo->meta.jmapped)
+    {
+        return JSON_ERROR_NOJMAP;
+    }
+
+    string image;
+    json_image_header header;
+    memcpy(header.magic, json_image_magic, sizeof(header.magic));
+    header.version = JSON_IMAGE_VERSION;
+    json_image_sizes(header.sizes);
+    header.key = key;
+    header.size = 0;
+    json_image_put(image, header);
+
+    json_image_put(image, cinfo->meta.jmapped);
+    json_image_put(image, cinfo->meta.version);
+    json_image_put(image, cinfo->meta.node);
+
+    // Namespace entries, their information, names and kept values are plain data
+    json_image_put(image, (uint32_t)cinfo->meta.jinfo.size());
+    for (vector<jsonentry> &block : cinfo->meta.jentry)
+    {
+        json_image_put(image, block.data(), block.size() * sizeof(jsonentry));
+    }
+    json_image_put(image, cinfo->meta.jinfo);
+    json_image_put(image, cinfo->meta.jname);
+    json_image_put(image, cinfo->meta.jshadow);
+
+    // Namespace map, by hash, skipping empty buckets
+    uint32_t count = 0;
+    for (vector<uint32_t> &bucket : cinfo->meta.jmap)
+    {
+        count += bucket.size() != 0;
+    }
+    json_image_put(image, count);
+    for (uint16_t hash=0; hash<cinfo->meta.jmap.size(); ++hash)
+    {
+        if (cinfo->meta.jmap[hash].empty())
+        {
+            continue;
+        }
+        json_image_put(image, hash);
+        json_image_put(image, cinfo->meta.jmap[hash]);
+    }
+
+    // Equation map, the same way
+    count = 0;
+    for (vector<jsonequation> &bucket : cinfo->meta.emap)
+    {
+        count += bucket.size() != 0;
+    }
+    json_image_put(image, count);
+    for (uint16_t hash=0; hash<cinfo->meta.emap.size(); ++hash)
+    {
+        if (cinfo->meta.emap[hash].empty())
+        {
+            continue;
+        }
+        json_image_put(image, hash);
+        json_image_put(image, (uint32_t)cinfo->meta.emap[hash].size());
+        for (jsonequation &equation : cinfo->meta.emap[hash])
+        {
+            json_image_put(image, string(equation.text));
+            json_image_put(image, equation.unit_index);
+            json_image_put(image, equation.operation);
+            json_image_put(image, equation.operand);
+        }
+    }
+
+    json_image_put(image, (uint32_t)cinfo->meta.equation.size());
+    for (equationstruc &equation : cinfo->meta.equation)
+    {
+        json_image_put(image, equation.name);
+        json_image_put(image, equation.value);
+    }
+    json_image_put(image, (uint32_t)cinfo->meta.alias.size());
+    for (aliasstruc &alias : cinfo->meta.alias)
+    {
+        json_image_put(image, alias.name);
+        json_image_put(image, alias.handle);
+        json_image_put(image, alias.type);
+    }
+
+    json_image_put(image, cinfo->pdata.node);
+    json_image_put(image, cinfo->pdata.physics);
+    json_image_put(image, cinfo->pdata.piece);
+    json_image_put(image, cinfo->pdata.device);
+    json_image_put(image, cinfo->pdata.port);
+    json_image_put(image, cinfo->pdata.target);
+
+    header.size = image.size();
+    memcpy(&image[0], &header, sizeof(header));
+
+    string tname = filename + "." + std::to_string(getpid());
+    FILE *fp = fopen(tname.c_str(), "wb");
+    if (fp == nullptr)
+    {
+        return -errno;
+    }
+    if (fwrite(image.data(), image.size(), 1, fp) != 1)
+    {
+        int32_t iretn = -errno;
+        fclose(fp);
+        remove(tname.c_str());
+        return iretn;
+    }
+    fclose(fp);
+    if (rename(tname.c_str(), filename.c_str()) != 0)
+    {
+        int32_t iretn = -errno;
+        remove(tname.c_str());
+        return iretn;
+    }
+    return image.size();
+}
+
+//! Read Namespace image
+/*! Parse an image already in memory in to the parts of a ::cosmosstruc. Nothing is changed
+ * unless the whole image is good.
+*/
+static int32_t json_read_image(const uint8_t *data, size_t size, uint64_t key, cosmosstruc *cinfo)
+{
+    json_image_header header;
+    uint32_t sizes[10];
+    json_image_sizes(sizes);
+    json_image_reader reader = {data, data + size};
+    if (!json_image_get(reader, header) || memcmp(header.magic, json_image_magic, sizeof(header.magic)) || header.version != JSON_IMAGE_VERSION || memcmp(header.sizes, sizes, sizeof(sizes)) || header.key != key || header.size != size)
+    {
+        return JSON_ERROR_IMAGE;
+    }
+
+    cosmosmetastruc meta;
+    meta.jmap.resize(JSON_MAX_HASH);
+    meta.emap.resize(JSON_MAX_HASH);
+    cosmosdatastruc cdata;
+    uint32_t count;
+    bool good = json_image_get(reader, meta.jmapped) && json_image_get(reader, meta.version) && json_image_get(reader, meta.node) && json_image_get(reader, count);
+
+    // Entries go back in to blocks, then each is checked against the rest of the map
+    good = good && (size_t)(reader.end - reader.ptr) / sizeof(jsonentry) >= count;
+    for (uint32_t i=0; good && i<count; i+=JSON_ENTRY_BLOCK)
+    {
+        uint32_t entries = count - i < JSON_ENTRY_BLOCK ? count - i : JSON_ENTRY_BLOCK;
+        meta.jentry.push_back(vector<jsonentry>());
+        meta.jentry.back().reserve(JSON_ENTRY_BLOCK);
+        meta.jentry.back().resize(entries);
+        good = json_image_get(reader, meta.jentry.back().data(), entries * sizeof(jsonentry));
+    }
+    good = good && json_image_get(reader, meta.jinfo) && json_image_get(reader, meta.jname) && json_image_get(reader, meta.jshadow) && meta.jinfo.size() == count;
+    for (uint32_t i=0; good && i<count; ++i)
+    {
+        jsonentry *entry = json_entry_at(i, meta);
+        uint32_t data = meta.jinfo[i].data;
+        bool slot = entry->group != JSON_STRUCT_ALIAS && entry->group != JSON_STRUCT_EQUATION;
+        good = entry->index == i && (size_t)entry->name + entry->name_size < meta.jname.size() && (slot ? data != UINT32_MAX && (size_t)data + entry->size <= meta.jshadow.size() : data == UINT32_MAX);
+    }
+
+    good = good && json_image_get(reader, count);
+    for (uint32_t i=0; good && i<count; ++i)
+    {
+        uint16_t hash;
+        good = json_image_get(reader, hash) && hash < meta.jmap.size() && json_image_get(reader, meta.jmap[hash]);
+        for (uint32_t j=0; good && j<meta.jmap[hash].size(); ++j)
+        {
+            good = meta.jmap[hash][j] < meta.jinfo.size();
+        }
+    }
+
+    good = good && json_image_get(reader, count);
+    for (uint32_t i=0; good && i<count; ++i)
+    {
+        uint16_t hash;
+        uint32_t equations;
+        good = json_image_get(reader, hash) && hash < meta.emap.size() && json_image_get(reader, equations);
+        for (uint32_t j=0; good && j<equations; ++j)
+        {
+            jsonequation equation;
+            string text;
+            good = json_image_get(reader, text) && json_image_get(reader, equation.unit_index) && json_image_get(reader, equation.operation) && json_image_get(reader, equation.operand);
+            if (good)
+            {
+                equation.text = (char *)calloc(1, text.size()+1);
+                memcpy(equation.text, text.data(), text.size());
+                meta.emap[hash].push_back(equation);
+            }
+        }
+    }
+
+    good = good && json_image_get(reader, count);
+    for (uint32_t i=0; good && i<count; ++i)
+    {
+        equationstruc equation;
+        good = json_image_get(reader, equation.name) && json_image_get(reader, equation.value);
+        meta.equation.push_back(equation);
+    }
+    good = good && json_image_get(reader, count);
+    for (uint32_t i=0; good && i<count; ++i)
+    {
+        aliasstruc alias;
+        good = json_image_get(reader, alias.name) && json_image_get(reader, alias.handle) && json_image_get(reader, alias.type);
+        meta.alias.push_back(alias);
+    }
+
+    good = good && json_image_get(reader, cdata.node) && json_image_get(reader, cdata.physics) && json_image_get(reader, cdata.piece) && json_image_get(reader, cdata.device) && json_image_get(reader, cdata.port) && json_image_get(reader, cdata.target) && reader.ptr == reader.end;
+
+    if (!good || cdata.device.size() != cdata.node.device_cnt)
+    {
+        for (vector<jsonequation> &bucket : meta.emap)
+        {
+            for (jsonequation &equation : bucket)
+            {
+                free(equation.text);
+            }
+        }
+        return JSON_ERROR_IMAGE;
+    }
+
+    for (vector<jsonequation> &bucket : cinfo->meta.emap)
+    {
+        for (jsonequation &equation : bucket)
+        {
+            free(equation.text);
+        }
+    }
+    std::lock_guard<std::mutex> locker(jshadow_mutex);
+    cinfo->meta.jmapped = meta.jmapped;
+    cinfo->meta.version = meta.version;
+    cinfo->meta.node = meta.node;
+    cinfo->meta.jmap.swap(meta.jmap);
+    cinfo->meta.jentry.swap(meta.jentry);
+    cinfo->meta.jinfo.swap(meta.jinfo);
+    cinfo->meta.jname.swap(meta.jname);
+    cinfo->meta.jshadow.swap(meta.jshadow);
+    cinfo->meta.jshadow_of = nullptr;
+    cinfo->meta.emap.swap(meta.emap);
+    cinfo->meta.equation.swap(meta.equation);
+    cinfo->meta.alias.swap(meta.alias);
+
+    cinfo->pdata.node = cdata.node;
+    cinfo->pdata.physics = cdata.physics;
+    cinfo->pdata.piece.swap(cdata.piece);
+    cinfo->pdata.device.swap(cdata.device);
+    cinfo->pdata.port.swap(cdata.port);
+    cinfo->pdata.target.swap(cdata.target);
+    for (uint16_t i=0; i<cinfo->pdata.device.size(); ++i)
+    {
+        json_pushdevspec(i, cinfo->pdata);
+    }
+    return size;
+}
+
+//! Load Namespace image
+/*! Load a Namespace saved by ::json_save_image in to a ::cosmosstruc fresh from ::json_create,
+ * leaving it as ::json_setup_node would from the same description, apart from the state vector
+ * and start time. The image is mapped rather than read where the system allows.
+ *	\param filename Path of the image.
+ *	\param key Key the image must have been made with, from ::json_image_key.
+ *	\param cinfo Pointer to cinfo ::cosmosstruc to load in to.
+ *	\return Size of the image, or negative error. ::JSON_ERROR_IMAGE if the image is for a
+ * different description or build, or is damaged.
+*/
+int32_t json_load_image(string filename, uint64_t key, cosmosstruc *cinfo)
+{
+    if (cinfo == nullptr || !cinfo->meta.jmapped)
+    {
+        return JSON_ERROR_NOJMAP;
+    }
+    if (cinfo->pdata.device.size())
+    {
+        return JSON_ERROR_IMAGE;
+    }
+
+    int32_t iretn;
+#if defined(COSMOS_LINUX_OS) || defined(COSMOS_MAC_OS)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+    struct stat fstat;
+    if (::fstat(fd, &fstat) != 0 || fstat.st_size < (off_t)sizeof(json_image_header))
+    {
+        close(fd);
+        return JSON_ERROR_IMAGE;
+    }
+    void *data = mmap(nullptr, fstat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -errno;
+    }
+    iretn = json_read_image((const uint8_t *)data, fstat.st_size, key, cinfo);
+    munmap(data, fstat.st_size);
+#else
+    ifstream ifs(filename, std::ios::binary);
+    if (!ifs.is_open())
+    {
+        return -errno;
+    }
+    string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    iretn = json_read_image((const uint8_t *)data.data(), data.size(), key, cinfo);
+#endif
+    return iretn;
+}
+
 //! Save Node entries to disk
 /*! Create all of the initialization files that represent the Node in the provided
  * ::cosmosstruc.
@@ -6378,7 +7008,7 @@ int32_t json_dump_node(cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
         }
         for (aliasstruc &alias : cmeta.alias)
         {
-            fprintf(file, "%s %s\n", alias.name.c_str(), cmeta.jmap[alias.handle.hash][alias.handle.index].name.c_str());
+            fprintf(file, "%s %s\n", alias.name.c_str(), json_name_of(json_entry_at(cmeta.jmap[alias.handle.hash][alias.handle.index], cmeta), cmeta));
         }
         for (equationstruc &equation : cmeta.equation)
         {
@@ -7563,6 +8193,53 @@ const char *json_of_table(string &jstring, vector<jsonentry*> table, cosmosmetas
     return jstring.data();
 }
 
+//! Create JSON stream of changes from entries
+/*! As for ::json_of_table, but only for entries whose values have changed since the given
+ * Namespace version. Each entry's value is compared with the copy kept in
+ * ::cosmosmetastruc::jshadow when it was last checked here, however it was written. The version
+ * is then moved on, ready for the next call. Setting it to zero gives every entry in the table.
+ * The copies follow one ::cosmosdatastruc: if called for a different one, they start again and
+ * every entry counts as changed. Other threads may parse in to either ::cosmosdatastruc
+ * meanwhile; only calls to this share the copies, and they take turns.
+    \param jstring Reference to string to hold the end result.
+    \param table Vector of pointers to entries from ::jsonmap.
+    \param version Namespace version last sent, updated to the current version.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    \param cdata Reference to ::cosmosdatastruc to use.
+    \return Pointer to the string.
+*/
+const char *json_of_table_since(string &jstring, vector<jsonentry*> &table, uint32_t &version, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
+{
+    jstring.clear();
+    std::lock_guard<std::mutex> locker(jshadow_mutex);
+    if (cmeta.jshadow_of != &cdata)
+    {
+        cmeta.jshadow_of = &cdata;
+        for (vector<jsonentry> &block : cmeta.jentry)
+        {
+            for (jsonentry &entry : block)
+            {
+                entry.version = 0;
+            }
+        }
+        version = 0;
+    }
+    for (jsonentry *entry: table)
+    {
+        if (entry != NULL)
+        {
+            json_mark_change(entry, cmeta, cdata);
+            if (entry->version > version)
+            {
+                json_out_entry(jstring, entry, cmeta, cdata);
+            }
+        }
+    }
+    version = cmeta.version;
+
+    return jstring.data();
+}
+
 //! Create JSON Track string
 /*! Generate a JSON stream showing the variables stored in an ::nodestruc.
     \param jstring Pointer to a string large enough to hold the end result.
@@ -8010,12 +8687,12 @@ string json_list_of_all(cosmosmetastruc &cmeta)
     string result;
 
     result = "{";
-    for (vector<jsonentry> entryrow : cmeta.jmap)
+    for (vector<uint32_t> &bucket : cmeta.jmap)
     {
-        for (jsonentry entry : entryrow)
+        for (uint32_t index : bucket)
         {
             char tempstring[200];
-            sprintf(tempstring, "\"%s\",", entry.name.c_str());
+            sprintf(tempstring, "\"%s\",", json_name_of(json_entry_at(index, cmeta), cmeta));
             result += tempstring;
         }
     }
@@ -8931,9 +9608,9 @@ void json_test(cosmosmetastruc &cmeta)
     {
         for (j=0; j<cmeta.jmap[i].size(); ++j)
         {
-            hash = json_hash(cmeta.jmap[i][j].name);
+            hash = json_hash(json_name_of(json_entry_at(cmeta.jmap[i][j], cmeta), cmeta));
 
-            printf("%s %d %d %ld\n", cmeta.jmap[i][j].name.c_str(),i,j,hash);
+            printf("%s %d %d %ld\n", json_name_of(json_entry_at(cmeta.jmap[i][j], cmeta), cmeta),i,j,hash);
 
             hashcount[hash]++;
         }
@@ -8949,7 +9626,7 @@ void json_test(cosmosmetastruc &cmeta)
     \param handle Pointer to ::jsonhandle of name.
     \return Zero, or negative error number.
 */
-int32_t json_name_map(string name, cosmosmetastruc &cmeta, jsonhandle &handle)
+int32_t json_name_map(const string &name, cosmosmetastruc &cmeta, jsonhandle &handle)
 {
 
     if (!cmeta.jmapped)
@@ -8961,7 +9638,7 @@ int32_t json_name_map(string name, cosmosmetastruc &cmeta, jsonhandle &handle)
     handle.hash = json_hash(name);
 
     for (handle.index=0; handle.index<cmeta.jmap[handle.hash].size(); ++handle.index)
-        if (name == cmeta.jmap[handle.hash][handle.index].name)
+        if (json_name_is(json_entry_at(cmeta.jmap[handle.hash][handle.index], cmeta), name, cmeta))
         {
             return 0;
         }
@@ -9086,7 +9763,19 @@ int32_t json_clone(cosmosdatastruc &cdata1, cosmosdatastruc &cdata2)
 {
 
     cdata2 = cdata1;
-    for (uint16_t i=0; i<cdata2.node.device_cnt; ++i)
+    json_relink_devspec(cdata2);
+    return 0;
+}
+
+//! Relink specific devices
+/*! Point the entries in ::devspecstruc back at the devices of the same ::cosmosdatastruc, after
+ * the device vector has been copied or swapped in from elsewhere.
+    \param cdata2 ::cosmosdatastruc to relink.
+    \return Zero, or negative error.
+*/
+int32_t json_relink_devspec(cosmosdatastruc &cdata2)
+{
+    for (uint16_t i=0; i<cdata2.node.device_cnt && i<cdata2.device.size(); ++i)
     {
         switch(cdata2.device[i].all.gen.type)
         {
@@ -9181,6 +9870,123 @@ int32_t json_clone(cosmosdatastruc &cdata1, cosmosdatastruc &cdata2)
     return 0;
 }
 
+//! Initialize Namespace snapshot
+/*! Fill every buffer of a ::json_snapshot from a ::cosmosdatastruc, so that the first
+ * ::json_snapshot_publish and ::json_snapshot_acquire only ever copy in to buffers that are
+ * already the right size.
+    \param snap ::json_snapshot to initialize.
+    \param cdata ::cosmosdatastruc to start from.
+    \return Zero, or negative error.
+*/
+int32_t json_snapshot_init(json_snapshot &snap, cosmosdatastruc &cdata)
+{
+    std::lock_guard<std::mutex> locker(snap.lock);
+    for (uint16_t i=0; i<2; ++i)
+    {
+        snap.node[i] = cdata.node;
+        snap.device[i] = cdata.device;
+    }
+    snap.back = 0;
+    snap.middle = 1;
+    snap.fresh = false;
+    snap.version = 0;
+    snap.pending.clear();
+    snap.taken.clear();
+    return 0;
+}
+
+//! Publish Namespace snapshot
+/*! Copy the node and devices of the writer's working ::cosmosdatastruc in to the spare buffer,
+ * then swap it with the published buffer. The copy is made without the lock; only the swap is
+ * made with it. Values taken with ::json_snapshot_take are published along with it.
+    \param snap ::json_snapshot to publish to.
+    \param cdata Writer's working ::cosmosdatastruc.
+    \return Version published.
+*/
+uint32_t json_snapshot_publish(json_snapshot &snap, cosmosdatastruc &cdata)
+{
+    snap.node[snap.back] = cdata.node;
+    snap.device[snap.back] = cdata.device;
+
+    std::lock_guard<std::mutex> locker(snap.lock);
+    std::swap(snap.back, snap.middle);
+    snap.fresh = true;
+    snap.taken.clear();
+    return ++snap.version;
+}
+
+//! Acquire Namespace snapshot
+/*! If a newer version has been published, take it in to the reader's ::cosmosdatastruc. The
+ * device vector is swapped rather than copied, leaving the reader's old one for the writer to
+ * reuse, and the specific device pointers are relinked. Values set with ::json_snapshot_set
+ * that the version does not yet hold are then parsed in to it again. Nothing else in the
+ * reader's ::cosmosdatastruc is touched.
+    \param snap ::json_snapshot to acquire from.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    \param cdata Reader's ::cosmosdatastruc.
+    \return 1 if a newer version was taken, otherwise 0.
+*/
+int32_t json_snapshot_acquire(json_snapshot &snap, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
+{
+    vector<string> values;
+    {
+        std::lock_guard<std::mutex> locker(snap.lock);
+        if (!snap.fresh)
+        {
+            return 0;
+        }
+        cdata.node = snap.node[snap.middle];
+        cdata.device.swap(snap.device[snap.middle]);
+        snap.fresh = false;
+        values = snap.taken;
+        values.insert(values.end(), snap.pending.begin(), snap.pending.end());
+    }
+    json_relink_devspec(cdata);
+    for (string &value : values)
+    {
+        json_parse(value, cmeta, cdata);
+    }
+    return 1;
+}
+
+//! Set Namespace snapshot values
+/*! Queue values that the reader has set in its own ::cosmosdatastruc, for the writer to take
+ * in to its working copy with ::json_snapshot_take. Until a version holding them is published,
+ * ::json_snapshot_acquire applies them again to each version it takes.
+    \param snap ::json_snapshot the reader acquires from.
+    \param json JSON of the values set, as for ::json_parse.
+    \return Number of values waiting to be taken.
+*/
+int32_t json_snapshot_set(json_snapshot &snap, const string &json)
+{
+    std::lock_guard<std::mutex> locker(snap.lock);
+    snap.pending.push_back(json);
+    return snap.pending.size();
+}
+
+//! Take Namespace snapshot values
+/*! Parse the values queued by the reader with ::json_snapshot_set in to the writer's working
+ * ::cosmosdatastruc, to be published with it by the next ::json_snapshot_publish.
+    \param snap ::json_snapshot to take from.
+    \param cmeta Reference to ::cosmosmetastruc to use.
+    \param cdata Writer's working ::cosmosdatastruc.
+    \return Number of values taken.
+*/
+int32_t json_snapshot_take(json_snapshot &snap, cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
+{
+    vector<string> values;
+    {
+        std::lock_guard<std::mutex> locker(snap.lock);
+        values.swap(snap.pending);
+        snap.taken.insert(snap.taken.end(), values.begin(), values.end());
+    }
+    for (string &value : values)
+    {
+        json_parse(value, cmeta, cdata);
+    }
+    return values.size();
+}
+
 uint32_t json_get_name_list_count(cosmosmetastruc &cmeta)
 {
     if (cmeta.jmapped == false) return 0;
@@ -9709,6 +10515,7 @@ int32_t load_target(cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
             json_addentry("target_loc",count, UINT16_MAX, (ptrdiff_t)offsetof(targetstruc,loc)+count*sizeof(targetstruc),COSMOS_SIZEOF(locstruc), (uint16_t)JSON_TYPE_LOC, (uint16_t)JSON_STRUCT_TARGET, cmeta);
             json_addentry("target_loc_pos_geod",count, UINT16_MAX, (ptrdiff_t)offsetof(targetstruc,loc.pos.geod)+count*sizeof(targetstruc),COSMOS_SIZEOF(geoidpos), (uint16_t)JSON_TYPE_POS_GEOD, (uint16_t)JSON_STRUCT_TARGET, cmeta);
             json_addentry("target_loc_pos_eci",count, UINT16_MAX, (ptrdiff_t)offsetof(targetstruc,loc.pos.eci)+count*sizeof(targetstruc),COSMOS_SIZEOF(cartpos), (uint16_t)JSON_TYPE_POS_ECI, (uint16_t)JSON_STRUCT_TARGET, cmeta);
+            json_addentry("target_fixed",count, UINT16_MAX, (ptrdiff_t)offsetof(targetstruc,fixed)+count*sizeof(targetstruc), COSMOS_SIZEOF(uint16_t), (uint16_t)JSON_TYPE_UINT16, (uint16_t)JSON_STRUCT_TARGET, cmeta);
             if (json_parse(inb, cmeta, cdata) >= 0)
             {
                 if (cdata.target[count].loc.utc == 0.)
@@ -9728,36 +10535,119 @@ int32_t load_target(cosmosmetastruc &cmeta, cosmosdatastruc &cdata)
         return 0;
 }
 
+//! Latest position pass
+/*! The highest of the pass counts of the position frames in a ::locstruc. This increases whenever
+ * any of the frames is set.
+    \param loc ::locstruc to check.
+    \return Latest pass.
+*/
+static uint32_t target_pass(const locstruc &loc)
+{
+    uint32_t pass = loc.pos.icrf.pass;
+    for (uint32_t frame : {loc.pos.eci.pass, loc.pos.sci.pass, loc.pos.geoc.pass, loc.pos.selc.pass, loc.pos.geod.pass, loc.pos.geos.pass, loc.pos.selg.pass})
+    {
+        if (frame > pass)
+        {
+            pass = frame;
+        }
+    }
+    return pass;
+}
+
+//! Refresh Target location
+/*! Bring the location of a Target up to date with ::loc_update, and find the Topocentric frame at
+ * the Target. Static Targets (::targetstruc::fixed) are only refreshed when their location has
+ * been set since the last time.
+    \param target ::targetstruc to refresh.
+*/
+static void target_refresh(targetstruc &target)
+{
+    if (target.fixed && target.pass != 0 && target.pass == target_pass(target.loc))
+    {
+        return;
+    }
+
+    loc_update(&target.loc);
+    target.pass = target_pass(target.loc);
+
+    // As in geoc2topo, with the Target as source
+    gvector geod = target.loc.pos.geod.s;
+    double clon = cos(geod.lon);
+    double slon = sin(geod.lon);
+    double clat = cos(geod.lat);
+    double slat = sin(geod.lat);
+    target.g2t.row[0].col[0] = -slon;
+    target.g2t.row[0].col[1] = clon;
+    target.g2t.row[0].col[2] = 0.;
+    target.g2t.row[1].col[0] = -slat*clon;
+    target.g2t.row[1].col[1] = -slat*slon;
+    target.g2t.row[1].col[2] = clat;
+    target.g2t.row[2].col[0] = clat*clon;
+    target.g2t.row[2].col[1] = clat*slon;
+    target.g2t.row[2].col[2] = slat;
+
+    double c = 1./sqrt(clat * clat + FRATIO2 * slat * slat);
+    double r = (REARTHM * c + geod.h) * clat;
+    target.site.col[0] = r * clon;
+    target.site.col[1] = r * slon;
+    target.site.col[2] = (REARTHM * FRATIO2 * c + geod.h) * slat;
+}
+
 //! Update Track list
 /*! For each entry in the Track list, calculate the azimuth, elevation and range to and
- *from the current base location.
+ *from the current base location. Static Targets keep their location and Topocentric frame
+ * from the last call unless they have been changed. Views from the base are found for all
+ * Targets at once, in the one Topocentric frame of the base.
     \param cdata Reference to ::cosmosdatastruc to use.
+    \param threads Number of threads to split the Targets across.
  *	\return 0, otherwise negative error.
  */
-int32_t update_target(cosmosdatastruc &cdata)
+int32_t update_target(cosmosdatastruc &cdata, uint16_t threads)
 {
-    rvector topo, dv, ds;
-    for (uint32_t i=0; i<cdata.target.size(); ++i)
-    {
-        loc_update(&cdata.target[i].loc);
-        geoc2topo(cdata.target[i].loc.pos.geod.s,cdata.node.loc.pos.geoc.s,topo);
-        topo2azel(topo,&cdata.target[i].azto,&cdata.target[i].elto);
-        geoc2topo(cdata.node.loc.pos.geod.s,cdata.target[i].loc.pos.geoc.s,topo);
-        topo2azel(topo,&cdata.target[i].azfrom,&cdata.target[i].elfrom);
-        ds = rv_sub(cdata.target[i].loc.pos.geoc.s,cdata.node.loc.pos.geoc.s);
-        cdata.target[i].range = length_rv(ds);
-        dv = rv_sub(cdata.target[i].loc.pos.geoc.v,cdata.node.loc.pos.geoc.v);
-        cdata.target[i].close = length_rv(rv_sub(ds,dv)) - length_rv(ds);
-    }
-    //	for (uint32_t i=0; i<cdata.target.size(); ++i)
-    //	{
-    //		cdata.target[i].azto = NAN;
-    //		cdata.target[i].elto = NAN;
-    //		cdata.target[i].azfrom = NAN;
-    //		cdata.target[i].elfrom = NAN;
-    //		cdata.target[i].range = NAN;
-    //		cdata.target[i].close = NAN;
-    //	}
+    size_t count = cdata.target.size();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    vector<double> x(count), y(count), z(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        target_refresh(cdata.target[i]);
+        x[i] = cdata.target[i].loc.pos.geoc.s.col[0];
+        y[i] = cdata.target[i].loc.pos.geoc.s.col[1];
+        z[i] = cdata.target[i].loc.pos.geoc.s.col[2];
+    }
+
+    vector<double> tx(count), ty(count), tz(count);
+    vector<float> az(count), el(count);
+    int32_t iretn = geoc2topo_batch(cdata.node.loc.pos.geod.s, count, x.data(), y.data(), z.data(), tx.data(), ty.data(), tz.data(), threads);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    iretn = topo2azel_batch(count, tx.data(), ty.data(), tz.data(), az.data(), el.data(), threads);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+
+    rvector nodes = cdata.node.loc.pos.geoc.s;
+    rvector nodev = cdata.node.loc.pos.geoc.v;
+    convert_batch_run(count, threads, [&](size_t start, size_t end)
+    {
+        for (size_t i=start; i<end; ++i)
+        {
+            targetstruc &target = cdata.target[i];
+            target.azfrom = az[i];
+            target.elfrom = el[i];
+            topo2azel(rv_mmult(target.g2t, rv_sub(nodes, target.site)), &target.azto, &target.elto);
+            rvector ds = rv_sub(target.loc.pos.geoc.s, nodes);
+            target.range = length_rv(ds);
+            rvector dv = rv_sub(target.loc.pos.geoc.v, nodev);
+            target.close = length_rv(rv_sub(ds,dv)) - length_rv(ds);
+        }
+    });
     return 0;
 }
 
@@ -9765,9 +10655,8 @@ int32_t update_target(locstruc source, targetstruc &target)
 {
     rvector topo, dv, ds;
 
-    loc_update(&target.loc);
-    geoc2topo(target.loc.pos.geod.s, source.pos.geoc.s,topo);
-    topo2azel(topo, &target.azto, &target.elto);
+    target_refresh(target);
+    topo2azel(rv_mmult(target.g2t, rv_sub(source.pos.geoc.s, target.site)), &target.azto, &target.elto);
     geoc2topo(source.pos.geod.s, target.loc.pos.geoc.s, topo);
     topo2azel(topo, &target.azfrom, &target.elfrom);
     ds = rv_sub(target.loc.pos.geoc.s, source.pos.geoc.s);
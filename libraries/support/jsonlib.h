@@ -123,12 +123,18 @@ using std::numeric_limits;
 cosmosstruc *json_create();
 int32_t json_clone(cosmosstruc *cinfo);
 int32_t json_clone(cosmosdatastruc &cdata1, cosmosdatastruc &cdata2);
+int32_t json_relink_devspec(cosmosdatastruc &cdata2);
+int32_t json_snapshot_init(json_snapshot &snap, cosmosdatastruc &cdata);
+uint32_t json_snapshot_publish(json_snapshot &snap, cosmosdatastruc &cdata);
+int32_t json_snapshot_acquire(json_snapshot &snap, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
+int32_t json_snapshot_set(json_snapshot &snap, const string &json);
+int32_t json_snapshot_take(json_snapshot &snap, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 void json_destroy(cosmosstruc *cinfo);
 int32_t json_pushdevspec(uint16_t cidx, cosmosdatastruc &cdata);
 
 //uint16_t json_addequation(const char *text, cosmosmetastruc &cmeta, cosmosdatastruc &cdata, uint16_t unit);
 int32_t json_addentry(string name, string value, cosmosmetastruc &cmeta);
-int32_t json_addentry(jsonentry entry, cosmosmetastruc &cmeta);
+int32_t json_addentry(string name, jsonentry entry, jsoninfo info, cosmosmetastruc &cmeta);
 int32_t json_addentry(string name, uint16_t d1, uint16_t d2, ptrdiff_t offset, size_t size, uint16_t type, uint16_t group, cosmosmetastruc &cmeta, uint16_t unit);
 int32_t json_addentry(string name, uint16_t d1, uint16_t d2, ptrdiff_t offset, size_t size, uint16_t type, uint16_t group, cosmosmetastruc &cmeta);
 int32_t json_toggleentry(string name, uint16_t d1, uint16_t d2, cosmosmetastruc &cmeta, bool state);
@@ -147,8 +153,11 @@ size_t json_count_total(cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 
 uint8_t *json_ptr_of_offset(ptrdiff_t offset, uint16_t group, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 jsonentry *json_entry_of(uint8_t *ptr, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
-jsonentry *json_entry_of(string token, cosmosmetastruc &cmeta);
+jsonentry *json_entry_of(const string &token, cosmosmetastruc &cmeta);
 jsonentry *json_entry_of(jsonhandle handle, cosmosmetastruc &cmeta);
+jsonentry *json_entry_at(uint32_t index, cosmosmetastruc &cmeta);
+const char *json_name_of(const jsonentry *entry, const cosmosmetastruc &cmeta);
+jsoninfo *json_info_of(const jsonentry *entry, cosmosmetastruc &cmeta);
 jsonequation *json_equation_of(jsonhandle handle, cosmosmetastruc &cmeta);
 int32_t json_table_of_list(vector<jsonentry*> &entry, string tokens, cosmosmetastruc &cmeta);
 uint16_t json_type_of_name(string token, cosmosmetastruc &cmeta);
@@ -266,10 +275,15 @@ int32_t json_setup_node(jsonnode json, cosmosstruc *cinfo, bool create_flag = fa
 int32_t json_setup_node(string node, cosmosstruc *cinfo);
 int32_t json_load_node(string node, jsonnode &json);
 int32_t json_dump_node(cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
+string json_image_path(string node);
+uint64_t json_image_key(jsonnode &json);
+int32_t json_save_image(string filename, uint64_t key, cosmosstruc *cinfo);
+int32_t json_load_image(string filename, uint64_t key, cosmosstruc *cinfo);
 
 const char *json_of_wildcard(string &jstring, string wildcard, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 const char *json_of_list(string &jstring, string tokens, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 const char *json_of_table(string &jstring,vector<jsonentry*> entries,cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
+const char *json_of_table_since(string &jstring, vector<jsonentry*> &table, uint32_t &version, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 const char *json_of_node(string &jstring, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 const char *json_of_agent(string &jstring, cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
 const char *json_of_target(string &jstring, cosmosmetastruc &cmeta, cosmosdatastruc &cdata, uint16_t num);
@@ -299,11 +313,11 @@ const char *json_ports(string &jstring, cosmosmetastruc &cmeta, cosmosdatastruc
 
 void json_test(cosmosmetastruc &cmeta);
 
-uint16_t json_hash(string hstring);
+uint16_t json_hash(const string &hstring);
 //uint16_t json_hash2(const char *string);
 //json_name *json_get_name_list();
 uint32_t json_get_name_list_count(cosmosmetastruc &cmeta);
-int32_t json_name_map(string name, cosmosmetastruc &cmeta, jsonhandle &handle);
+int32_t json_name_map(const string &name, cosmosmetastruc &cmeta, jsonhandle &handle);
 int32_t json_equation_map(string equation, cosmosmetastruc &cmeta, jsonhandle *handle);
 
 bool json_static(char* json_extended_name);
@@ -315,7 +329,7 @@ void create_databases(cosmosdatastruc &cdata);
 //void load_databases(char *name, uint16_t type, cosmosdatastruc &cdata);
 size_t load_dictionary(vector<shorteventstruc> &dict, cosmosmetastruc &cmeta, cosmosdatastruc &cdata, const char *file);
 int32_t load_target(cosmosmetastruc &cmeta, cosmosdatastruc &cdata);
-int32_t update_target(cosmosdatastruc &cdata);
+int32_t update_target(cosmosdatastruc &cdata, uint16_t threads=1);
 int32_t update_target(locstruc source, targetstruc &target);
 size_t calc_events(vector<shorteventstruc> &dictionary, cosmosmetastruc &cmeta, cosmosdatastruc &cdata, vector<shorteventstruc> &events);
 
@@ -32,6 +32,7 @@
 */
 
 #include "support/sliplib.h"
+#include "math/checksum.h"
 #include <stdio.h>
 
 //! \addtogroup sliplib_functions
@@ -111,9 +112,14 @@ int32_t slip_decode(uint8_t *sbuf, uint16_t ssize, uint8_t *rbuf, uint16_t rsize
 	uint16_t i, j, ch;
 
 	i = j = 0;
+	// Skip the FEND that opens the packet
+	if (ssize && sbuf[0] == SLIP_FEND)
+	{
+		j = 1;
+	}
 	do
 	{
-		if (j > ssize-3)
+		if (j >= ssize)
 			return (SLIP_ERROR_PACKING);
 		ch = sbuf[j++];
 		if (i < rsize)
@@ -121,7 +127,7 @@ int32_t slip_decode(uint8_t *sbuf, uint16_t ssize, uint8_t *rbuf, uint16_t rsize
 			switch (ch)
 			{
 			case SLIP_FESC:
-                if (j > ssize-3)
+				if (j >= ssize)
 					return (SLIP_ERROR_PACKING);
 				ch = sbuf[j++];
 				switch (ch)
@@ -156,6 +162,11 @@ int32_t slip_decode(slip_t &sbuf, slip_t &rbuf)
     rbuf.clear();
 
     j = 0;
+    // Skip the FEND that opens the packet
+    if (sbuf.size() && sbuf[0] == SLIP_FEND)
+    {
+        j = 1;
+    }
     do
     {
         if (j > sbuf.size()-3)
@@ -312,37 +323,16 @@ int32_t slip_pack(slip_t &rbuf, slip_t &sbuf)
 */
 uint16_t slip_calc_crc(uint8_t *buf, uint16_t size)
 {
-	uint16_t crc = 0xffff;
-	uint8_t ch;
-	int i, j;
-
-	for (i=0; i<size; ++i)
-	{
-		ch = buf[i];
-		for (j=0; j<8; j++)
-		{
-			crc = (crc >> 1)^(((ch^crc)&0x01)?0x8408:0);
-			ch >>= 1;
-		}
-	}
-	return (crc);
+	return (crc16_update(CRC16_INIT, buf, size));
 }
 
 uint16_t slip_calc_crc(slip_t &buf)
 {
-    uint16_t crc = 0xffff;
-    uint8_t ch;
-
-    for (size_t i=0; i<buf.size()-2; ++i)
+    if (buf.size() < 2)
     {
-        ch = buf[i];
-        for (size_t j=0; j<8; ++j)
-        {
-            crc = (crc >> 1)^(((ch^crc)&0x01)?0x8408:0);
-            ch >>= 1;
-        }
+        return (CRC16_INIT);
     }
-    return (crc);
+    return (crc16_update(CRC16_INIT, buf.data(), buf.size()-2));
 }
 
 //! Get CRC from SLIP buffer
@@ -396,4 +386,252 @@ uint16_t slip_set_crc(slip_t &buf)
     return (crc);
 }
 
+// States of the framer: looking for the start of a frame, in a frame, after an escape,
+// and reading the CRC that follows a COSMOS SLIP packet
+#define SLIP_STATE_HUNT 0
+#define SLIP_STATE_DATA 1
+#define SLIP_STATE_ESCAPE 2
+#define SLIP_STATE_CRC1 3
+#define SLIP_STATE_CRC2 4
+
+// CRC-16/X.25 register left by a frame followed by its good frame check sequence
+#define SLIP_FCS_GOOD 0xf0b8
+
+//! Set up SLIP framer
+/*! Allocate room in a ::slip_framer for count decoded frames of up to maxlen bytes each,
+ * and start it looking for a frame. This is the only allocation; frames are decoded in
+ * place from then on.
+	\param framer ::slip_framer to set up.
+	\param mode Framing: ::SLIP_FRAMER_COSMOS, ::SLIP_FRAMER_RAW or ::SLIP_FRAMER_FCS.
+	\param count Most complete frames held before more are dropped.
+	\param maxlen Largest decoded frame, including any frame check sequence.
+	\return Zero or negative error.
+*/
+int32_t slip_framer_init(slip_framer &framer, uint16_t mode, size_t count, size_t maxlen)
+{
+    if (count == 0 || maxlen == 0 || mode > SLIP_FRAMER_FCS)
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+    framer = slip_framer();
+    framer.mode = mode;
+    framer.maxlen = maxlen;
+    framer.storage.resize((count + 1) * maxlen);
+    framer.lengths.resize(count + 1);
+    return 0;
+}
+
+// Buffer of the frame in progress
+static uint8_t *slip_framer_buffer(slip_framer &framer)
+{
+    return &framer.storage[((framer.first + framer.held + framer.ready) % framer.lengths.size()) * framer.maxlen];
+}
+
+// Check the frame in progress and, if it is good and there is room, make it ready
+static void slip_framer_finish(slip_framer &framer)
+{
+    bool good = true;
+    switch (framer.mode)
+    {
+    case SLIP_FRAMER_COSMOS:
+        {
+            uint16_t crc;
+            memcpy(&crc, framer.trailer, 2);
+            good = crc == framer.crc;
+        }
+        break;
+    case SLIP_FRAMER_FCS:
+        good = framer.length >= 2 && framer.crc == SLIP_FCS_GOOD;
+        if (good)
+        {
+            framer.length -= 2;
+        }
+        break;
+    }
+
+    if (!good)
+    {
+        ++framer.crcerrors;
+    }
+    else if (framer.held + framer.ready < framer.lengths.size() - 1)
+    {
+        framer.lengths[(framer.first + framer.held + framer.ready) % framer.lengths.size()] = framer.length;
+        ++framer.ready;
+        ++framer.frames;
+    }
+    else
+    {
+        ++framer.drops;
+    }
+    framer.length = 0;
+    framer.crc = CRC16_INIT;
+}
+
+//! Feed bytes to SLIP framer
+/*! Decode as much of a stream of SLIP frames as has arrived, in a piece of any size. Frames
+ * may start and end anywhere in it, and be split across any number of calls. Complete
+ * frames with a good CRC are kept for ::slip_framer_next. Frames with a bad CRC or a bad
+ * escape, longer than the buffers, or arriving when all buffers are in use, are counted
+ * and dropped, and the framer looks for the start of the next one.
+	\param framer ::slip_framer set up by ::slip_framer_init.
+	\param data Bytes as received.
+	\param size Number of bytes.
+	\return Number of complete frames ready, or negative error.
+*/
+int32_t slip_framer_feed(slip_framer &framer, const uint8_t *data, size_t size)
+{
+    if (framer.lengths.empty())
+    {
+        return SLIP_ERROR_BUFFER;
+    }
+
+    const uint8_t *end = data + size;
+    // Start of the encoded bytes not yet in the CRC of a COSMOS SLIP packet
+    const uint8_t *mark = data;
+    uint8_t *frame = slip_framer_buffer(framer);
+    while (data < end)
+    {
+        switch (framer.state)
+        {
+        case SLIP_STATE_HUNT:
+            data = (const uint8_t *)memchr(data, SLIP_FEND, end - data);
+            if (data == nullptr)
+            {
+                data = end;
+                break;
+            }
+            mark = data++;
+            framer.length = 0;
+            framer.crc = CRC16_INIT;
+            framer.state = SLIP_STATE_DATA;
+            break;
+        case SLIP_STATE_DATA:
+            {
+                // Plain bytes are copied a run at a time, as far as there is room
+                const uint8_t *stop = data + (framer.maxlen - framer.length);
+                if (stop > end)
+                {
+                    stop = end;
+                }
+                uint8_t *out = frame + framer.length;
+                while (data < stop && *data != SLIP_FEND && *data != SLIP_FESC)
+                {
+                    *out++ = *data++;
+                }
+                if (framer.mode == SLIP_FRAMER_FCS)
+                {
+                    framer.crc = crc16_update(framer.crc, frame + framer.length, out - (frame + framer.length));
+                }
+                framer.length = out - frame;
+                if (data == end)
+                {
+                    break;
+                }
+                if (*data != SLIP_FEND && *data != SLIP_FESC)
+                {
+                    ++framer.overruns;
+                    framer.state = SLIP_STATE_HUNT;
+                    break;
+                }
+                if (*data++ == SLIP_FESC)
+                {
+                    framer.state = SLIP_STATE_ESCAPE;
+                }
+                else if (framer.length == 0)
+                {
+                    // Nothing since the last FEND, so this one starts the frame
+                    mark = data - 1;
+                    framer.crc = CRC16_INIT;
+                }
+                else if (framer.mode == SLIP_FRAMER_COSMOS)
+                {
+                    framer.crc = crc16_update(framer.crc, mark, data - mark);
+                    framer.state = SLIP_STATE_CRC1;
+                }
+                else
+                {
+                    // The closing FEND also opens the next frame
+                    slip_framer_finish(framer);
+                    frame = slip_framer_buffer(framer);
+                }
+            }
+            break;
+        case SLIP_STATE_ESCAPE:
+            {
+                uint8_t ch = *data++;
+                switch (ch)
+                {
+                case SLIP_TFEND:
+                    ch = SLIP_FEND;
+                    break;
+                case SLIP_TFESC:
+                    ch = SLIP_FESC;
+                    break;
+                default:
+                    ++framer.escapeerrors;
+                    framer.state = SLIP_STATE_HUNT;
+                    continue;
+                }
+                if (framer.length == framer.maxlen)
+                {
+                    ++framer.overruns;
+                    framer.state = SLIP_STATE_HUNT;
+                    continue;
+                }
+                frame[framer.length++] = ch;
+                if (framer.mode == SLIP_FRAMER_FCS)
+                {
+                    framer.crc = crc16_update(framer.crc, &ch, 1);
+                }
+                framer.state = SLIP_STATE_DATA;
+            }
+            break;
+        case SLIP_STATE_CRC1:
+            framer.trailer[0] = *data++;
+            framer.state = SLIP_STATE_CRC2;
+            break;
+        case SLIP_STATE_CRC2:
+            framer.trailer[1] = *data++;
+            slip_framer_finish(framer);
+            frame = slip_framer_buffer(framer);
+            framer.state = SLIP_STATE_HUNT;
+            break;
+        }
+    }
+
+    if (framer.mode == SLIP_FRAMER_COSMOS && (framer.state == SLIP_STATE_DATA || framer.state == SLIP_STATE_ESCAPE))
+    {
+        framer.crc = crc16_update(framer.crc, mark, end - mark);
+    }
+    return framer.ready;
+}
+
+//! Next frame from SLIP framer
+/*! Hand out the oldest complete frame in place, releasing the one handed out before.
+ * The frame stays in place, untouched by ::slip_framer_feed, until the next call.
+	\param framer ::slip_framer fed by ::slip_framer_feed.
+	\param data Set to the start of the decoded frame.
+	\return Length of the frame, without any CRC, zero if none is ready, or negative error.
+*/
+int32_t slip_framer_next(slip_framer &framer, uint8_t *&data)
+{
+    if (framer.lengths.empty())
+    {
+        return SLIP_ERROR_BUFFER;
+    }
+    if (framer.held)
+    {
+        framer.held = false;
+        framer.first = (framer.first + 1) % framer.lengths.size();
+    }
+    if (framer.ready == 0)
+    {
+        return 0;
+    }
+    --framer.ready;
+    framer.held = true;
+    data = &framer.storage[framer.first * framer.maxlen];
+    return framer.lengths[framer.first];
+}
+
 //! @}
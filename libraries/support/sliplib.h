@@ -75,12 +75,53 @@
 //! CRC-16-CCITT Reversed Reciprocal
 #define CRC16CCITTRR 0x8810
 
+//! Framing for ::slip_framer: COSMOS SLIP packets, each followed by its 16 bit CRC
+#define SLIP_FRAMER_COSMOS 0
+//! Framing for ::slip_framer: plain SLIP or KISS frames, with no CRC
+#define SLIP_FRAMER_RAW 1
+//! Framing for ::slip_framer: frames that end in an AX.25 (CRC-16/X.25) frame check sequence
+#define SLIP_FRAMER_FCS 2
+
 //! @}
 
 //! \ingroup sliplib
 //! \defgroup sliplib_definitions COSMOS SLIP support definitions
 //! @{
 typedef vector <uint8_t> slip_t;
+
+//! SLIP Framer
+//! Decoder for a stream of SLIP frames that may arrive in pieces of any size. Bytes are
+//! decoded, and their CRC worked out, as they are given to ::slip_framer_feed, straight
+//! into a ring of preallocated frame buffers, from which ::slip_framer_next hands out
+//! complete frames in place.
+struct slip_framer
+{
+	// Framing: SLIP_FRAMER_COSMOS, SLIP_FRAMER_RAW or SLIP_FRAMER_FCS
+	uint16_t mode = SLIP_FRAMER_COSMOS;
+	// Size of each frame buffer
+	size_t maxlen = 0;
+	// Frame buffers, maxlen bytes apart, one more than can be held for the frame in progress
+	vector<uint8_t> storage;
+	// Length of each complete frame
+	vector<uint32_t> lengths;
+	// Buffer of the oldest frame not yet released
+	size_t first = 0;
+	// Complete frames waiting to be handed out
+	size_t ready = 0;
+	// Whether the frame at first has been handed out, and is still in use
+	bool held = false;
+	// Decoder state, bytes and CRC of the frame in progress
+	uint8_t state = 0;
+	uint32_t length = 0;
+	uint16_t crc = 0;
+	uint8_t trailer[2];
+	// Frames completed, and frames lost to bad CRCs, bad escapes, overlong frames and a full ring
+	uint32_t frames = 0;
+	uint32_t crcerrors = 0;
+	uint32_t escapeerrors = 0;
+	uint32_t overruns = 0;
+	uint32_t drops = 0;
+};
 //! @}
 
 
@@ -104,6 +145,9 @@ int32_t slip_encode(slip_t &rbuf, slip_t &sbuf);
 uint16_t slip_calc_crc(slip_t &buf);
 uint16_t slip_get_crc(slip_t &buf);
 uint16_t slip_set_crc(slip_t &buf);
+int32_t slip_framer_init(slip_framer &framer, uint16_t mode, size_t count, size_t maxlen);
+int32_t slip_framer_feed(slip_framer &framer, const uint8_t *data, size_t size);
+int32_t slip_framer_next(slip_framer &framer, uint8_t *&data);
 
 //! @}
 
@@ -329,10 +329,7 @@ uint16_t socket_calc_udp_checksum(std::vector<uint8_t> packet)
     uint16_t udpl = (bytes[24]*256U + bytes[25]) - 8;
     if (udpl)
     {
-        for (uint16_t i=0; i<udpl/2; ++i)
-        {
-            csum32 += ints[14+i];
-        }
+        csum32 += checksum_sum16(0, &bytes[28], udpl & ~1);
 
         if (2*(udpl/2) != udpl)
         {
@@ -670,6 +667,226 @@ int32_t socket_sendto(socket_channel &channel, vector<uint8_t> &buffer, int flag
     return nbytes;
 }
 
+// Make room in a batch for slots datagrams
+static void socket_batch_resize(socket_batch &batch, size_t slots)
+{
+    batch.storage.resize(slots * batch.maxlen);
+    batch.lengths.resize(slots);
+    batch.addrs.resize(slots);
+#ifdef COSMOS_LINUX_OS
+    if (batch.headers.size() < slots)
+    {
+        batch.headers.resize(slots);
+        batch.iovecs.resize(slots);
+    }
+#endif
+}
+
+//! Set up batch buffers
+/*! Allocate room in a ::socket_batch for receiving two datagrams of up to maxlen bytes, or
+ * one if count is one. A call that fills the room shows that datagrams are queuing, so
+ * ::socket_recvbatch then doubles it, up to count datagrams. Storage only grows on channels
+ * where datagrams arrive faster than they are taken.
+    \param batch ::socket_batch to set up.
+    \param count Most datagrams moved per system call.
+    \param maxlen Largest datagram to be received.
+    \return Zero or negative error.
+*/
+int32_t socket_batch_init(socket_batch &batch, size_t count, size_t maxlen)
+{
+    if (count == 0 || maxlen == 0)
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+    batch.maxlen = maxlen;
+    batch.limit = count;
+    batch.lengths.clear();
+    batch.count = 0;
+    batch.next = 0;
+    socket_batch_resize(batch, count < 2 ? count : 2);
+    return 0;
+}
+
+//! Receive a batch of datagrams
+/*! Wait, as set for the channel, for at least one datagram, then take as many more as are
+ * already waiting, up to the room in the batch, with one recvmmsg call. If the last call
+ * filled the batch, its room is first doubled, up to the limit it was set up with. Any packets
+ * not yet handed out by ::socket_recvfrom are discarded. Where recvmmsg is not available, a
+ * single datagram is received.
+    \param channel ::socket_channel to receive on.
+    \param batch ::socket_batch set up by ::socket_batch_init.
+    \param flags Flags for recvmmsg.
+    \return Number of datagrams received, or negative error.
+*/
+int32_t socket_recvbatch(socket_channel &channel, socket_batch &batch, int flags)
+{
+    if (batch.lengths.empty())
+    {
+        // Not set up, so allow for the largest possible datagram
+        int32_t iretn = socket_batch_init(batch, SOCKET_BATCH_COUNT, 65535);
+        if (iretn < 0)
+        {
+            return iretn;
+        }
+    }
+
+#ifdef COSMOS_LINUX_OS
+    // Datagrams are arriving faster than they are taken, so take more at a time
+    if (batch.count == batch.lengths.size() && batch.count < batch.limit)
+    {
+        socket_batch_resize(batch, batch.count * 2 < batch.limit ? batch.count * 2 : batch.limit);
+    }
+#endif
+    batch.count = 0;
+    batch.next = 0;
+
+#ifdef COSMOS_LINUX_OS
+    for (size_t i=0; i<batch.lengths.size(); ++i)
+    {
+        batch.iovecs[i].iov_base = &batch.storage[i * batch.maxlen];
+        batch.iovecs[i].iov_len = batch.maxlen;
+        batch.headers[i].msg_hdr.msg_name = &batch.addrs[i];
+        batch.headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        batch.headers[i].msg_hdr.msg_iov = &batch.iovecs[i];
+        batch.headers[i].msg_hdr.msg_iovlen = 1;
+        batch.headers[i].msg_hdr.msg_control = nullptr;
+        batch.headers[i].msg_hdr.msg_controllen = 0;
+        batch.headers[i].msg_hdr.msg_flags = 0;
+    }
+    int32_t count = recvmmsg(channel.cudp, batch.headers.data(), batch.lengths.size(), flags | MSG_WAITFORONE, nullptr);
+    if (count < 0)
+    {
+        return -errno;
+    }
+    for (int32_t i=0; i<count; ++i)
+    {
+        batch.lengths[i] = batch.headers[i].msg_len;
+    }
+#else
+    socklen_t addrlen = sizeof(struct sockaddr_in);
+    int32_t nbytes = recvfrom(channel.cudp, (char *)batch.storage.data(), batch.maxlen, flags, (struct sockaddr *)&batch.addrs[0], &addrlen);
+    if (nbytes < 0)
+    {
+        return -errno;
+    }
+    int32_t count = 1;
+    batch.lengths[0] = nbytes;
+#endif
+    batch.count = count;
+    return count;
+}
+
+//! Receive next datagram from a batch
+/*! Hand out the next datagram held in the batch, receiving a new batch with
+ * ::socket_recvbatch first if all have been handed out. The channel address is set to the
+ * sender's, as for the single datagram ::socket_recvfrom.
+    \param channel ::socket_channel to receive on.
+    \param batch ::socket_batch holding received datagrams.
+    \param data Set to the start of the datagram, which stays valid until the next call.
+    \param flags Flags for recvmmsg.
+    \return Length of the datagram, or negative error.
+*/
+int32_t socket_recvfrom(socket_channel &channel, socket_batch &batch, uint8_t *&data, int flags)
+{
+    if (batch.next >= batch.count)
+    {
+        int32_t iretn = socket_recvbatch(channel, batch, flags);
+        if (iretn <= 0)
+        {
+            return iretn < 0 ? iretn : -EAGAIN;
+        }
+    }
+    size_t i = batch.next++;
+    data = &batch.storage[i * batch.maxlen];
+    channel.caddr = batch.addrs[i];
+    channel.addrlen = sizeof(struct sockaddr_in);
+    inet_ntop(channel.caddr.sin_family, &channel.caddr.sin_addr, channel.address, sizeof(channel.address));
+    return batch.lengths[i];
+}
+
+//! Receive next datagram from a batch in to a vector
+/*! As ::socket_recvfrom, but copy the datagram in to buffer.
+    \param channel ::socket_channel to receive on.
+    \param batch ::socket_batch holding received datagrams.
+    \param buffer Vector to hold the datagram.
+    \param flags Flags for recvmmsg.
+    \return Length of the datagram, or negative error.
+*/
+int32_t socket_recvfrom(socket_channel &channel, socket_batch &batch, vector<uint8_t> &buffer, int flags)
+{
+    uint8_t *data;
+    int32_t nbytes = socket_recvfrom(channel, batch, data, flags);
+    if (nbytes >= 0)
+    {
+        buffer.assign(data, data + nbytes);
+    }
+    return nbytes;
+}
+
+//! Send a batch of datagrams
+/*! Send the first count buffers to the channel address with as few sendmmsg calls as
+ * possible. Where sendmmsg is not available, each is sent with sendto.
+    \param channel ::socket_channel to send on.
+    \param batch ::socket_batch used for its message headers.
+    \param buffers Datagrams to send.
+    \param count Number of buffers to send.
+    \param flags Flags for sendmmsg.
+    \return Number of datagrams sent, or negative error if none were.
+*/
+int32_t socket_sendto(socket_channel &channel, socket_batch &batch, vector<vector<uint8_t>> &buffers, size_t count, int flags)
+{
+    if (count > buffers.size())
+    {
+        count = buffers.size();
+    }
+    size_t sent = 0;
+#ifdef COSMOS_LINUX_OS
+    if (batch.headers.size() < count)
+    {
+        batch.headers.resize(count);
+        batch.iovecs.resize(count);
+    }
+    for (size_t i=0; i<count; ++i)
+    {
+        batch.iovecs[i].iov_base = buffers[i].data();
+        batch.iovecs[i].iov_len = buffers[i].size();
+        batch.headers[i].msg_hdr.msg_name = &channel.caddr;
+        batch.headers[i].msg_hdr.msg_namelen = channel.addrlen;
+        batch.headers[i].msg_hdr.msg_iov = &batch.iovecs[i];
+        batch.headers[i].msg_hdr.msg_iovlen = 1;
+        batch.headers[i].msg_hdr.msg_control = nullptr;
+        batch.headers[i].msg_hdr.msg_controllen = 0;
+        batch.headers[i].msg_hdr.msg_flags = 0;
+    }
+    while (sent < count)
+    {
+        int32_t iretn = sendmmsg(channel.cudp, &batch.headers[sent], count - sent, flags);
+        if (iretn <= 0)
+        {
+            if (sent == 0)
+            {
+                return -errno;
+            }
+            break;
+        }
+        sent += iretn;
+    }
+#else
+    for (; sent<count; ++sent)
+    {
+        if (sendto(channel.cudp, (char *)buffers[sent].data(), buffers[sent].size(), flags, (struct sockaddr *)&channel.caddr, (socklen_t)channel.addrlen) < 0)
+        {
+            if (sent == 0)
+            {
+                return -errno;
+            }
+            break;
+        }
+    }
+#endif
+    return sent;
+}
+
 
 //! Open UDP socket
 /*! Open a UDP socket and configure it for the specified use. Various
@@ -104,6 +104,9 @@ enum class NetworkType : std::uint16_t
 
 #define SOCKET_BUFFER_LENGTH 512  //Max length of buffer
 
+//! Default most datagrams moved per system call by the batched functions
+#define SOCKET_BATCH_COUNT 32
+
 //! @}
 
 //! \ingroup socketlib
@@ -138,6 +141,33 @@ struct socket_channel
 	char name[COSMOS_MAX_NAME+1];
 };
 
+//! Socket Batch
+//! Buffers for moving several datagrams with one system call. Filled by ::socket_recvbatch,
+//! which starts with room for two datagrams and doubles it, up to limit, each time a call
+//! fills every buffer. Also used as scratch by the batched ::socket_sendto.
+struct socket_batch
+{
+	// Size of each packet buffer
+	size_t maxlen = 0;
+	// Most packet buffers
+	size_t limit = 0;
+	// Packet buffers, maxlen bytes apart
+	vector<uint8_t> storage;
+	// Length of each received packet
+	vector<uint32_t> lengths;
+	// Source address of each received packet
+	vector<struct sockaddr_in> addrs;
+	// Packets received by the last system call
+	size_t count = 0;
+	// Next received packet to hand out
+	size_t next = 0;
+#ifdef COSMOS_LINUX_OS
+	// Message headers for recvmmsg and sendmmsg
+	vector<struct mmsghdr> headers;
+	vector<struct iovec> iovecs;
+#endif
+};
+
 
 //! @}
 
@@ -153,6 +183,11 @@ int32_t socket_blocking(socket_channel *channel, bool blocking);
 int32_t socket_close(socket_channel *channel);
 int32_t socket_recvfrom(socket_channel &channel, vector<uint8_t> &buffer, size_t maxlen, int flags=0);
 int32_t socket_sendto(socket_channel &channel, vector<uint8_t> &buffer, int flags=0);
+int32_t socket_batch_init(socket_batch &batch, size_t count, size_t maxlen);
+int32_t socket_recvbatch(socket_channel &channel, socket_batch &batch, int flags=0);
+int32_t socket_recvfrom(socket_channel &channel, socket_batch &batch, uint8_t *&data, int flags=0);
+int32_t socket_recvfrom(socket_channel &channel, socket_batch &batch, vector<uint8_t> &buffer, int flags=0);
+int32_t socket_sendto(socket_channel &channel, socket_batch &batch, vector<vector<uint8_t>> &buffers, size_t count, int flags=0);
 vector <socket_channel> socket_find_addresses(NetworkType ntype);
 
 //-------------------------------------------------------------------
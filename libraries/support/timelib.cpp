@@ -47,6 +47,7 @@ struct iersstruc
 
 static std::vector<iersstruc> iers;
 static uint32_t iersbase=0;
+static std::mutex iers_mutex;
 
 #define MAXLEAPS 26
 double leaps[MAXLEAPS] =
@@ -138,8 +139,8 @@ struct timeval utc2unix(double utc)
 */
 calstruc mjd2cal(double mjd)
 {
-    static double lmjd = 0.;
-    static calstruc date;
+    static thread_local double lmjd = 0.;
+    static thread_local calstruc date;
 
     if (lmjd != mjd)
     {
@@ -190,11 +191,11 @@ int32_t mjd2ymd(double mjd, int32_t &year, int32_t &month, double &day)
 */
 int32_t mjd2ymd(double mjd, int32_t &year, int32_t &month, double &day, double &doy)
 {
-    static double lmjd = 0.;
-    static int32_t lyear = 1858;
-    static int32_t lmonth = 11;
-    static double lday = 17.;
-    static double ldoy = 321.;
+    static thread_local double lmjd = 0.;
+    static thread_local int32_t lyear = 1858;
+    static thread_local int32_t lmonth = 11;
+    static thread_local double lday = 17.;
+    static thread_local double ldoy = 321.;
 
     if (mjd != lmjd)
     {
@@ -405,8 +406,8 @@ double gregorianToModJulianDate(int32_t year, int32_t month, int32_t day,
 */
 double utc2jcentt(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
 
     if (mjd != lmjd)
     {
@@ -431,8 +432,8 @@ double utc2jcentt(double mjd)
 */
 double utc2jcenut1(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
 
     if (mjd != lmjd)
     {
@@ -451,8 +452,8 @@ double utc2jcenut1(double mjd)
 */
 rvector utc2nuts(double mjd)
 {
-    static double lmjd=0.;
-    static uvector lcalc={{{0.,0.,0.},0.}};
+    static thread_local double lmjd=0.;
+    static thread_local uvector lcalc={{{0.,0.,0.},0.}};
 
     if (mjd != lmjd)
     {
@@ -474,8 +475,8 @@ rvector utc2nuts(double mjd)
 */
 double utc2dpsi(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     rvector nuts;
 
     if (mjd != lmjd)
@@ -495,8 +496,8 @@ double utc2dpsi(double mjd)
 */
 double utc2depsilon(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     rvector nuts;
 
     if (mjd != lmjd)
@@ -517,8 +518,8 @@ double utc2depsilon(double mjd)
 double utc2epsilon(double mjd)
 {
     // Vallado, et al, AAS-06_134, eq. 17
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -538,8 +539,8 @@ double utc2epsilon(double mjd)
 */
 double utc2L(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -559,8 +560,8 @@ double utc2L(double mjd)
 */
 double utc2Lp(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -580,8 +581,8 @@ double utc2Lp(double mjd)
 */
 double utc2F(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -601,8 +602,8 @@ double utc2F(double mjd)
 */
 double utc2D(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -622,8 +623,8 @@ double utc2D(double mjd)
 */
 double utc2omega(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -694,8 +695,8 @@ double utc2theta(double utc)
 */
 double utc2dut1(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc = 0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc = 0.;
     double frac;
     //	uint32_t mjdi;
     uint32_t iersidx;
@@ -735,8 +736,8 @@ double utc2dut1(double mjd)
 */
 double utc2ut1(double mjd) 
 {
-    static double lmjd=0.;
-    static double lut=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lut=0.;
 
     if (mjd != lmjd)
     {
@@ -769,8 +770,8 @@ double julcen(double mjd)
 */
 double utc2tdb(double mjd)
 {
-    static double lmjd=0.;
-    static double ltdb=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double ltdb=0.;
     double tt, g;
 
     if (mjd != lmjd)
@@ -827,8 +828,8 @@ double tt2utc(double mjd)
 */
 double utc2tt(double mjd)
 {
-    static double lmjd=0.;
-    static double ltt=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double ltt=0.;
     uint32_t iersidx=0;
     int32_t iretn;
 
@@ -956,8 +957,8 @@ double mjd2year(double mjd)
 */
 double utc2era(double mjd)
 {
-    static double lmjd=0.;
-    static double ltheta=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double ltheta=0.;
     double ut1;
 
     if (mjd != lmjd)
@@ -977,8 +978,8 @@ double utc2era(double mjd)
 */
 double utc2gast(double mjd)
 {
-    static double lmjd=0.;
-    static double lgast=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lgast=0.;
     double omega, F, D;
 
     if (mjd != lmjd)
@@ -1004,8 +1005,8 @@ double utc2gast(double mjd)
 */
 double utc2gmst1982(double mjd)
 {
-    static double lmjd=0.;
-    static double lcalc=0.;
+    static thread_local double lmjd=0.;
+    static thread_local double lcalc=0.;
     double jcen;
 
     if (mjd != lmjd)
@@ -1021,8 +1022,8 @@ double utc2gmst1982(double mjd)
 
 double utc2gmst2000(double utc)
 {
-    static double lutc=0.;
-    static double lgmst = 0.;
+    static thread_local double lutc=0.;
+    static thread_local double lgmst = 0.;
     double tt;
 
     if (utc != lutc)
@@ -1090,6 +1091,7 @@ int32_t load_iers()
     FILE *fdes;
     iersstruc tiers;
 
+    std::lock_guard<std::mutex> lock(iers_mutex);
     if (iers.size() == 0)
     {
         std::string fname;
@@ -29,7 +29,9 @@
 
 #include "support/transferlib.h"
 #include "support/timelib.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <sys/stat.h>
 
 //#define DA_BUG
@@ -213,6 +215,21 @@ void extract_metadata(std::vector<PACKET_BYTE>& packet, PACKET_TX_ID_TYPE &tx_id
 }
 
 void make_data_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE chunk_start, PACKET_BYTE* chunk)
+{
+    memmove(make_data_header(packet, node_id, tx_id, byte_count, chunk_start), chunk, byte_count);
+}
+
+//! Make data packet header
+/*! Size the packet for its chunk and fill in everything but the chunk itself, so the chunk
+ * can be read straight in to place.
+    \param packet Vector to hold packet. Its storage is reused if big enough.
+    \param node_id Destination node.
+    \param tx_id Transfer the chunk belongs to.
+    \param byte_count Size of the chunk.
+    \param chunk_start File offset of the chunk.
+    \return Where the chunk goes in the packet.
+*/
+PACKET_BYTE* make_data_header(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE chunk_start)
 {
     PACKET_TYPE type = salt_type(PACKET_DATA);
 
@@ -222,7 +239,7 @@ void make_data_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node
     memmove(&packet[0]+PACKET_DATA_TX_ID, &tx_id, sizeof(PACKET_TX_ID_TYPE));
     memmove(&packet[0]+PACKET_DATA_BYTE_COUNT, &byte_count, sizeof(PACKET_CHUNK_SIZE_TYPE));
     memmove(&packet[0]+PACKET_DATA_CHUNK_START, &chunk_start, sizeof(chunk_start));
-    memmove(&packet[0]+PACKET_DATA_CHUNK, chunk, byte_count);
+    return &packet[0]+PACKET_DATA_CHUNK;
 }
 
 //Function to extract necessary fileds from a received data packet
@@ -235,6 +252,85 @@ void extract_data(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE& node_id
     memmove(chunk, &packet[0]+PACKET_DATA_CHUNK, byte_count);
 }
 
+//! Extract data packet header
+/*! Read the header of a received data packet, leaving the chunk where it is.
+    \param packet Received packet.
+    \param node_id Set to source node.
+    \param tx_id Set to transfer.
+    \param byte_count Set to size of the chunk.
+    \param chunk_start Set to file offset of the chunk.
+    \return Where the chunk is in the packet, or nullptr if the packet is too short to hold it.
+*/
+const PACKET_BYTE* extract_data_header(const std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE& node_id, PACKET_TX_ID_TYPE& tx_id, PACKET_CHUNK_SIZE_TYPE& byte_count, PACKET_FILE_SIZE_TYPE& chunk_start)
+{
+    if (packet.size() < PACKET_DATA_HEADER_SIZE)
+    {
+        return nullptr;
+    }
+    memmove(&node_id, &packet[0]+PACKET_DATA_NODE_ID, sizeof(PACKET_NODE_ID_TYPE));
+    memmove(&tx_id, &packet[0]+PACKET_DATA_TX_ID, sizeof(PACKET_TX_ID_TYPE));
+    memmove(&byte_count, &packet[0]+PACKET_DATA_BYTE_COUNT, sizeof(byte_count));
+    memmove(&chunk_start, &packet[0]+PACKET_DATA_CHUNK_START, sizeof(chunk_start));
+    if (packet.size() < PACKET_DATA_HEADER_SIZE + (size_t)byte_count)
+    {
+        return nullptr;
+    }
+    return &packet[0]+PACKET_DATA_CHUNK;
+}
+
+//! Make FEC packet
+/*! \param packet Vector to hold packet.
+    \param node_id Destination node.
+    \param tx_id Transfer the group belongs to.
+    \param byte_count Size of each chunk in the group.
+    \param group_start File offset of the first chunk in the group.
+    \param group_count Number of data chunks in the group.
+    \param parity_index Which parity chunk this is.
+    \param chunk Parity chunk, as made by ::fec_encode.
+*/
+void make_fec_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE group_start, uint8_t group_count, uint8_t parity_index, PACKET_BYTE* chunk)
+{
+    PACKET_TYPE type = salt_type(PACKET_FEC);
+
+    packet.resize(PACKET_FEC_HEADER_SIZE+byte_count);
+    memmove(&packet[0]+PACKET_FEC_TYPE, &type, sizeof(PACKET_TYPE));
+    memmove(&packet[0]+PACKET_FEC_NODE_ID, &node_id, sizeof(PACKET_NODE_ID_TYPE));
+    memmove(&packet[0]+PACKET_FEC_TX_ID, &tx_id, sizeof(PACKET_TX_ID_TYPE));
+    memmove(&packet[0]+PACKET_FEC_BYTE_COUNT, &byte_count, sizeof(PACKET_CHUNK_SIZE_TYPE));
+    memmove(&packet[0]+PACKET_FEC_GROUP_START, &group_start, sizeof(group_start));
+    memmove(&packet[0]+PACKET_FEC_GROUP_COUNT, &group_count, sizeof(group_count));
+    memmove(&packet[0]+PACKET_FEC_PARITY_INDEX, &parity_index, sizeof(parity_index));
+    memmove(&packet[0]+PACKET_FEC_CHUNK, chunk, byte_count);
+}
+
+//! Extract FEC packet
+/*! Read the header and parity chunk of a received FEC packet. Nothing is read from a packet
+ * too short to hold the header and the chunk it claims.
+    \param packet Received packet.
+    \param fec Set to the contents of the packet.
+    \return Zero, or ::GENERAL_ERROR_BAD_SIZE if the packet is too short or the chunk too big.
+*/
+int32_t extract_fec(std::vector<PACKET_BYTE>& packet, packet_struct_fec& fec)
+{
+    if (packet.size() < PACKET_FEC_HEADER_SIZE)
+    {
+        return GENERAL_ERROR_BAD_SIZE;
+    }
+    memmove(&fec.node_id, &packet[0]+PACKET_FEC_NODE_ID, sizeof(PACKET_NODE_ID_TYPE));
+    memmove(&fec.tx_id, &packet[0]+PACKET_FEC_TX_ID, sizeof(PACKET_TX_ID_TYPE));
+    memmove(&fec.byte_count, &packet[0]+PACKET_FEC_BYTE_COUNT, sizeof(fec.byte_count));
+    memmove(&fec.group_start, &packet[0]+PACKET_FEC_GROUP_START, sizeof(fec.group_start));
+    memmove(&fec.group_count, &packet[0]+PACKET_FEC_GROUP_COUNT, sizeof(fec.group_count));
+    memmove(&fec.parity_index, &packet[0]+PACKET_FEC_PARITY_INDEX, sizeof(fec.parity_index));
+    if (packet.size() < PACKET_FEC_HEADER_SIZE + (size_t)fec.byte_count || fec.byte_count > PACKET_MAX_LENGTH)
+    {
+        fec.byte_count = 0;
+        return GENERAL_ERROR_BAD_SIZE;
+    }
+    memmove(fec.chunk, &packet[0]+PACKET_FEC_CHUNK, fec.byte_count);
+    return 0;
+}
+
 void make_queue_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, std::string node_name, std::vector<PACKET_TX_ID_TYPE> queue)
 {
     PACKET_TYPE type = salt_type(PACKET_QUEUE);
@@ -255,6 +351,558 @@ void extract_queue(std::vector<PACKET_BYTE>& packet, packet_struct_queue& queue)
     memmove(&queue.tx_id, &packet[0]+PACKET_QUEUE_TX_ID, COSMOS_SIZEOF(PACKET_TX_ID_TYPE)*TRANSFER_QUEUE_LIMIT);
 }
 
+//! Add range to set
+/*! Merge a range of bytes in to a set of ranges, joining it with any ranges it overlaps
+ * or touches.
+    \param chunks Set of ranges.
+    \param tp Range to add.
+    \return Number of bytes that were not already in the set.
+*/
+PACKET_FILE_SIZE_TYPE add_chunk(file_progress_set& chunks, file_progress tp)
+{
+    if (tp.chunk_end < tp.chunk_start)
+    {
+        return 0;
+    }
+
+    PACKET_FILE_SIZE_TYPE added = (tp.chunk_end - tp.chunk_start) + 1;
+    PACKET_FILE_SIZE_TYPE start = tp.chunk_start;
+    PACKET_FILE_SIZE_TYPE end = tp.chunk_end;
+
+    // Join with the range before, if it reaches us
+    file_progress_set::iterator it = chunks.upper_bound(tp.chunk_start);
+    if (it != chunks.begin())
+    {
+        file_progress_set::iterator prev = std::prev(it);
+        if (tp.chunk_start == 0 || prev->second >= tp.chunk_start - 1)
+        {
+            if (prev->second >= tp.chunk_start)
+            {
+                added -= (std::min(prev->second, tp.chunk_end) - tp.chunk_start) + 1;
+            }
+            start = prev->first;
+            end = std::max(end, prev->second);
+            chunks.erase(prev);
+        }
+    }
+
+    // Swallow ranges after, as long as we reach them
+    while (it != chunks.end() && (end == UINT32_MAX || it->first <= end + 1))
+    {
+        if (it->first <= tp.chunk_end)
+        {
+            added -= (std::min(it->second, tp.chunk_end) - it->first) + 1;
+        }
+        end = std::max(end, it->second);
+        it = chunks.erase(it);
+    }
+
+    chunks.insert(it, std::make_pair(start, end));
+    return added;
+}
+
+//! Remove range from set
+/*! Remove a range of bytes from a set of ranges, trimming or splitting any ranges it overlaps.
+    \param chunks Set of ranges.
+    \param tp Range to remove.
+    \return Number of bytes that were in the set.
+*/
+PACKET_FILE_SIZE_TYPE del_chunk(file_progress_set& chunks, file_progress tp)
+{
+    PACKET_FILE_SIZE_TYPE removed = 0;
+
+    if (tp.chunk_end < tp.chunk_start)
+    {
+        return 0;
+    }
+
+    file_progress_set::iterator it = chunks.upper_bound(tp.chunk_start);
+    if (it != chunks.begin())
+    {
+        --it;
+    }
+    while (it != chunks.end() && it->first <= tp.chunk_end)
+    {
+        PACKET_FILE_SIZE_TYPE start = it->first;
+        PACKET_FILE_SIZE_TYPE end = it->second;
+        if (end < tp.chunk_start)
+        {
+            ++it;
+            continue;
+        }
+
+        it = chunks.erase(it);
+        if (start < tp.chunk_start)
+        {
+            chunks.insert(it, std::make_pair(start, tp.chunk_start - 1));
+        }
+        if (end > tp.chunk_end)
+        {
+            chunks.insert(it, std::make_pair(tp.chunk_end + 1, end));
+            removed += (tp.chunk_end - std::max(start, tp.chunk_start)) + 1;
+            break;
+        }
+        removed += (end - std::max(start, tp.chunk_start)) + 1;
+    }
+
+    return removed;
+}
+
+//! Bytes in set
+/*! \param chunks Set of ranges.
+    \return Total number of bytes covered by the set.
+*/
+PACKET_FILE_SIZE_TYPE total_chunks(const file_progress_set& chunks)
+{
+    PACKET_FILE_SIZE_TYPE total = 0;
+    for (const std::pair<const PACKET_FILE_SIZE_TYPE, PACKET_FILE_SIZE_TYPE>& chunk : chunks)
+    {
+        total += (chunk.second - chunk.first) + 1;
+    }
+    return total;
+}
+
+//! Holes in set
+/*! Find the ranges of a file not covered by a set of ranges.
+    \param chunks Set of ranges.
+    \param file_size Size of file.
+    \return Vector of missing ranges, in order.
+*/
+std::vector<file_progress> find_chunks_missing(const file_progress_set& chunks, PACKET_FILE_SIZE_TYPE file_size)
+{
+    std::vector<file_progress> missing;
+    file_progress tp;
+    PACKET_FILE_SIZE_TYPE next = 0;
+
+    for (const std::pair<const PACKET_FILE_SIZE_TYPE, PACKET_FILE_SIZE_TYPE>& chunk : chunks)
+    {
+        if (chunk.first >= file_size)
+        {
+            break;
+        }
+        if (chunk.first > next)
+        {
+            tp.chunk_start = next;
+            tp.chunk_end = chunk.first - 1;
+            missing.push_back(tp);
+        }
+        next = chunk.second + 1;
+    }
+    if (next < file_size)
+    {
+        tp.chunk_start = next;
+        tp.chunk_end = file_size - 1;
+        missing.push_back(tp);
+    }
+
+    return missing;
+}
+
+//! Queue requested range for sending
+/*! Add a range asked for by the receiver to an outgoing transfer, and keep its statistics.
+ * Anything already sent, and not still queued, goes out again and is counted as repeated.
+ * Only what was sent more than grace bytes before the furthest byte sent is reported as
+ * lost, since the rest may still be on its way.
+    \param tx Outgoing transfer.
+    \param tp Range requested.
+    \param grace Bytes that may still be in flight.
+    \return Number of bytes lost.
+*/
+PACKET_FILE_SIZE_TYPE request_chunk(tx_progress& tx, file_progress tp, PACKET_FILE_SIZE_TYPE grace)
+{
+    PACKET_FILE_SIZE_TYPE settled = tx.stats.high_bytes > grace ? tx.stats.high_bytes - grace : 0;
+    PACKET_FILE_SIZE_TYPE lost = 0;
+    PACKET_FILE_SIZE_TYPE repeat = 0;
+
+    if (tp.chunk_start < settled)
+    {
+        file_progress part = tp;
+        if (part.chunk_end >= settled)
+        {
+            part.chunk_end = settled - 1;
+        }
+        lost = add_chunk(tx.file_info, part);
+    }
+    if (tp.chunk_start < tx.stats.high_bytes && tp.chunk_end >= settled)
+    {
+        file_progress part = tp;
+        if (part.chunk_start < settled)
+        {
+            part.chunk_start = settled;
+        }
+        if (part.chunk_end >= tx.stats.high_bytes)
+        {
+            part.chunk_end = tx.stats.high_bytes - 1;
+        }
+        repeat = add_chunk(tx.file_info, part);
+    }
+    tx.total_bytes += lost + repeat + add_chunk(tx.file_info, tp);
+    tx.stats.repeat_bytes += lost + repeat;
+
+    return lost;
+}
+
+// GF(256) arithmetic for the FEC code, polynomial x^8+x^4+x^3+x^2+1. gf_mul[a] is a
+// multiplication table for a, so a row of data can be scaled with one lookup per byte.
+static uint8_t gf_mul[256][256];
+static uint8_t gf_inv[256];
+
+static bool gf_build()
+{
+    uint8_t gf_exp[512];
+    uint16_t gf_log[256];
+    uint16_t x = 1;
+    for (uint16_t i=0; i<255; ++i)
+    {
+        gf_exp[i] = gf_exp[i+255] = (uint8_t)x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+        {
+            x ^= 0x11d;
+        }
+    }
+    gf_exp[510] = gf_exp[0];
+    gf_exp[511] = gf_exp[1];
+    for (uint16_t a=0; a<256; ++a)
+    {
+        for (uint16_t b=0; b<256; ++b)
+        {
+            gf_mul[a][b] = (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+        }
+        gf_inv[a] = a ? gf_exp[255 - gf_log[a]] : 0;
+    }
+    return true;
+}
+
+static void gf_init()
+{
+    // Built once, safely, whichever thread gets here first
+    static const bool ready = gf_build();
+    (void)ready;
+}
+
+// Cauchy matrix entry for parity row j and data column i. Every square submatrix of a
+// Cauchy matrix is invertible, so any group_count chunks rebuild the group.
+static inline uint8_t fec_coefficient(uint16_t group_count, uint16_t j, uint16_t i)
+{
+    return gf_inv[(uint8_t)(group_count + j) ^ (uint8_t)i];
+}
+
+// out ^= c * in
+static inline void gf_addmul(PACKET_BYTE* out, const PACKET_BYTE* in, uint8_t c, size_t count)
+{
+    if (c == 0)
+    {
+        return;
+    }
+    const uint8_t* mul = gf_mul[c];
+    for (size_t k=0; k<count; ++k)
+    {
+        out[k] ^= mul[in[k]];
+    }
+}
+
+//! Make FEC parity chunk
+/*! Reed-Solomon erasure code over GF(256) with a Cauchy matrix. The data chunks go out
+ * unchanged, followed by any number of parity chunks; the receiver can rebuild the group from
+ * any group_count of them. group_count plus the number of parity chunks can not exceed 256.
+    \param group_count Number of data chunks in the group.
+    \param byte_count Size of each chunk. A short last chunk must be zero padded.
+    \param data group_count chunks, one after another.
+    \param parity_index Which parity chunk to make.
+    \param parity Buffer for byte_count bytes of parity.
+    \return 0, or negative error.
+*/
+int32_t fec_encode(uint16_t group_count, PACKET_CHUNK_SIZE_TYPE byte_count, const PACKET_BYTE* data, uint16_t parity_index, PACKET_BYTE* parity)
+{
+    if (data == nullptr || parity == nullptr)
+    {
+        return GENERAL_ERROR_NULLPOINTER;
+    }
+    if (group_count == 0 || group_count + parity_index >= 256)
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+    gf_init();
+
+    memset(parity, 0, byte_count);
+    for (uint16_t i=0; i<group_count; ++i)
+    {
+        gf_addmul(parity, data + (size_t)i * byte_count, fec_coefficient(group_count, parity_index, i), byte_count);
+    }
+    return 0;
+}
+
+//! Rebuild FEC group
+/*! Fill in the missing data chunks of a group from the parity chunks received for it.
+    \param group_count Number of data chunks in the group.
+    \param byte_count Size of each chunk.
+    \param data group_count chunks, one after another. Missing chunks are overwritten.
+    \param have Which data chunks are present.
+    \param parity_index Index of each parity chunk held.
+    \param parity Parity chunks, one after another, in the order of parity_index.
+    \return Number of chunks rebuilt, or negative error. TRANSFER_ERROR_FEC if there is not
+    enough parity yet.
+*/
+int32_t fec_decode(uint16_t group_count, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_BYTE* data, const std::vector<bool>& have, const std::vector<uint16_t>& parity_index, const PACKET_BYTE* parity)
+{
+    if (data == nullptr || (parity == nullptr && parity_index.size()))
+    {
+        return GENERAL_ERROR_NULLPOINTER;
+    }
+    if (group_count == 0 || have.size() < group_count)
+    {
+        return GENERAL_ERROR_INPUT;
+    }
+    gf_init();
+
+    std::vector<uint16_t> missing;
+    for (uint16_t i=0; i<group_count; ++i)
+    {
+        if (!have[i])
+        {
+            missing.push_back(i);
+        }
+    }
+    size_t count = missing.size();
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (parity_index.size() < count)
+    {
+        return TRANSFER_ERROR_FEC;
+    }
+    for (size_t r=0; r<count; ++r)
+    {
+        if (group_count + parity_index[r] >= 256)
+        {
+            return GENERAL_ERROR_INPUT;
+        }
+    }
+
+    // Take what the present chunks contributed out of the first count parity chunks
+    std::vector<PACKET_BYTE> syndrome(parity, parity + count * (size_t)byte_count);
+    for (size_t r=0; r<count; ++r)
+    {
+        for (uint16_t i=0; i<group_count; ++i)
+        {
+            if (have[i])
+            {
+                gf_addmul(&syndrome[r * byte_count], data + (size_t)i * byte_count, fec_coefficient(group_count, parity_index[r], i), byte_count);
+            }
+        }
+    }
+
+    // Invert the Cauchy submatrix for the missing columns
+    std::vector<uint8_t> a(count * count);
+    std::vector<uint8_t> inv(count * count, 0);
+    for (size_t r=0; r<count; ++r)
+    {
+        for (size_t c=0; c<count; ++c)
+        {
+            a[r * count + c] = fec_coefficient(group_count, parity_index[r], missing[c]);
+        }
+        inv[r * count + r] = 1;
+    }
+    for (size_t c=0; c<count; ++c)
+    {
+        size_t pivot = c;
+        while (pivot < count && a[pivot * count + c] == 0)
+        {
+            ++pivot;
+        }
+        if (pivot == count)
+        {
+            // Only if the same parity chunk was given twice
+            return TRANSFER_ERROR_FEC;
+        }
+        if (pivot != c)
+        {
+            for (size_t k=0; k<count; ++k)
+            {
+                std::swap(a[pivot * count + k], a[c * count + k]);
+                std::swap(inv[pivot * count + k], inv[c * count + k]);
+            }
+        }
+        uint8_t scale = gf_inv[a[c * count + c]];
+        for (size_t k=0; k<count; ++k)
+        {
+            a[c * count + k] = gf_mul[scale][a[c * count + k]];
+            inv[c * count + k] = gf_mul[scale][inv[c * count + k]];
+        }
+        for (size_t r=0; r<count; ++r)
+        {
+            uint8_t f = a[r * count + c];
+            if (r != c && f)
+            {
+                gf_addmul(&a[r * count], &a[c * count], f, count);
+                gf_addmul(&inv[r * count], &inv[c * count], f, count);
+            }
+        }
+    }
+
+    for (size_t c=0; c<count; ++c)
+    {
+        PACKET_BYTE* out = data + (size_t)missing[c] * byte_count;
+        memset(out, 0, byte_count);
+        for (size_t r=0; r<count; ++r)
+        {
+            gf_addmul(out, &syndrome[r * byte_count], inv[c * count + r], byte_count);
+        }
+    }
+
+    return count;
+}
+
+//! Chunks of FEC group present
+/*! \param chunks Set of ranges received.
+    \param group_start File offset of the first chunk in the group.
+    \param byte_count Size of each chunk.
+    \param group_count Number of data chunks in the group.
+    \param file_size Size of file, which may end inside the last chunk.
+    \return For each chunk, whether all of it has been received.
+*/
+std::vector<bool> fec_group_have(const file_progress_set& chunks, PACKET_FILE_SIZE_TYPE group_start, PACKET_CHUNK_SIZE_TYPE byte_count, uint16_t group_count, PACKET_FILE_SIZE_TYPE file_size)
+{
+    std::vector<bool> have(group_count, false);
+    for (uint16_t i=0; i<group_count; ++i)
+    {
+        PACKET_FILE_SIZE_TYPE start = group_start + (PACKET_FILE_SIZE_TYPE)i * byte_count;
+        if (start >= file_size)
+        {
+            have[i] = true;
+            continue;
+        }
+        PACKET_FILE_SIZE_TYPE end = start + byte_count - 1;
+        if (end >= file_size)
+        {
+            end = file_size - 1;
+        }
+        file_progress_set::const_iterator it = chunks.upper_bound(start);
+        if (it != chunks.begin())
+        {
+            --it;
+            have[i] = it->second >= end;
+        }
+    }
+    return have;
+}
+
+//! Initialize pacer
+/*! Start sending at the nominal rate with a full bucket. Rate will grow by a quarter of the
+ * nominal rate for each second spent sending, and be cut to 70% when more than 2% is lost.
+    \param pacer Pacer to set up.
+    \param rate Starting rate, bytes per second.
+    \param min_rate Lowest rate loss can drive it to.
+    \param max_rate Highest rate it can grow to.
+    \param depth Largest burst, in bytes.
+*/
+void pacer_init(transfer_pacer& pacer, double rate, double min_rate, double max_rate, double depth)
+{
+    pacer.min_rate = min_rate;
+    pacer.max_rate = max_rate;
+    pacer.rate = rate < min_rate ? min_rate : (rate > max_rate ? max_rate : rate);
+    pacer.increase = rate / 4.;
+    pacer.decrease = .7;
+    pacer.threshold = .02;
+    pacer.holdoff = 1.;
+    pacer.depth = depth;
+    pacer.tokens = depth;
+    pacer.sent_bytes = 0.;
+    pacer.lost_bytes = 0.;
+    pacer.refill_mjd = currentmjd(0.);
+    pacer.check_mjd = pacer.refill_mjd;
+}
+
+//! Time until bytes can be sent
+/*! Refill the bucket for the time since it was last refilled, then work out how long it will
+ * be before there are tokens for the requested bytes.
+    \param pacer Pacer to check.
+    \param bytes Size of the next packet.
+    \param mjd Current time, or 0. to use the clock.
+    \return Seconds to wait, 0. if it can go now.
+*/
+double pacer_delay(transfer_pacer& pacer, size_t bytes, double mjd)
+{
+    if (mjd == 0.)
+    {
+        mjd = currentmjd(0.);
+    }
+    if (mjd > pacer.refill_mjd)
+    {
+        pacer.tokens += 86400. * (mjd - pacer.refill_mjd) * pacer.rate;
+        if (pacer.tokens > pacer.depth)
+        {
+            pacer.tokens = pacer.depth;
+        }
+        pacer.refill_mjd = mjd;
+    }
+
+    if (pacer.tokens >= bytes)
+    {
+        return 0.;
+    }
+    return (bytes - pacer.tokens) / pacer.rate;
+}
+
+//! Account for bytes sent
+/*! Take tokens for a packet that has gone out and grow the rate for the time it took to send.
+ * Tokens may go negative if the packet was sent without waiting.
+    \param pacer Pacer to update.
+    \param bytes Size of the packet.
+*/
+void pacer_consume(transfer_pacer& pacer, size_t bytes)
+{
+    pacer.tokens -= bytes;
+    pacer.sent_bytes += bytes;
+    pacer.rate += pacer.increase * bytes / pacer.rate;
+    if (pacer.rate > pacer.max_rate)
+    {
+        pacer.rate = pacer.max_rate;
+    }
+}
+
+//! Report loss
+/*! Add to the bytes lost. Once holdoff seconds have passed since the last check, cut the rate
+ * if too much of what was sent was lost, and start counting again.
+    \param pacer Pacer to update.
+    \param bytes Bytes reported lost.
+    \param mjd Current time, or 0. to use the clock.
+    \return True if the rate was cut.
+*/
+bool pacer_loss(transfer_pacer& pacer, size_t bytes, double mjd)
+{
+    if (mjd == 0.)
+    {
+        mjd = currentmjd(0.);
+    }
+    pacer.lost_bytes += bytes;
+    if (86400. * (mjd - pacer.check_mjd) < pacer.holdoff)
+    {
+        return false;
+    }
+
+    bool cut = pacer.lost_bytes > pacer.threshold * pacer.sent_bytes;
+    if (cut)
+    {
+        pacer.rate *= pacer.decrease;
+        if (pacer.rate < pacer.min_rate)
+        {
+            pacer.rate = pacer.min_rate;
+        }
+        if (pacer.tokens > 0.)
+        {
+            pacer.tokens *= pacer.decrease;
+        }
+    }
+    pacer.sent_bytes = 0.;
+    pacer.lost_bytes = 0.;
+    pacer.check_mjd = mjd;
+    return cut;
+}
+
 void show_fstream_state(std::ifstream& )  {
     std::cout<<"eobit =\t"<<std::ios_base::eofbit<<std::endl;
     std::cout<<"failbit =\t"<<std::ios_base::failbit<<std::endl;
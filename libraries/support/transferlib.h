@@ -91,6 +91,7 @@ namespace PACKET_TYPE_STUFF	{
     static const unsigned char PACKET_COMPLETE =	0xb;
     static const unsigned char PACKET_CANCEL = 0xa;
     static const unsigned char PACKET_QUEUE = 0x9;
+    static const unsigned char PACKET_FEC = 0x8;
 }
 
 using namespace PACKET_TYPE_STUFF;
@@ -185,6 +186,33 @@ typedef struct
 #define PACKET_DATA_CHUNK (PACKET_DATA_CHUNK_START + COSMOS_SIZEOF(PACKET_FILE_SIZE_TYPE))
 #define PACKET_DATA_HEADER_SIZE (PACKET_DATA_CHUNK)
 
+//! Parity for a group of data chunks
+/*! The group is group_count chunks of byte_count bytes, starting at group_start. The last
+ * chunk is zero padded if the file ends inside it. Any group_count of the data and parity
+ * chunks are enough to rebuild the group; see ::fec_encode and ::fec_decode.
+*/
+typedef struct
+{
+    PACKET_TYPE type;
+    PACKET_NODE_ID_TYPE node_id;
+    PACKET_TX_ID_TYPE tx_id;
+    PACKET_CHUNK_SIZE_TYPE byte_count;
+    PACKET_FILE_SIZE_TYPE group_start;
+    uint8_t group_count;
+    uint8_t parity_index;
+    PACKET_BYTE chunk[PACKET_MAX_LENGTH];
+} packet_struct_fec;
+
+#define PACKET_FEC_TYPE 0
+#define PACKET_FEC_NODE_ID (PACKET_FEC_TYPE + COSMOS_SIZEOF(PACKET_TYPE))
+#define PACKET_FEC_TX_ID (PACKET_FEC_NODE_ID + COSMOS_SIZEOF(PACKET_NODE_ID_TYPE))
+#define PACKET_FEC_BYTE_COUNT (PACKET_FEC_TX_ID + COSMOS_SIZEOF(PACKET_TX_ID_TYPE))
+#define PACKET_FEC_GROUP_START (PACKET_FEC_BYTE_COUNT + COSMOS_SIZEOF(PACKET_CHUNK_SIZE_TYPE))
+#define PACKET_FEC_GROUP_COUNT (PACKET_FEC_GROUP_START + COSMOS_SIZEOF(PACKET_FILE_SIZE_TYPE))
+#define PACKET_FEC_PARITY_INDEX (PACKET_FEC_GROUP_COUNT + COSMOS_SIZEOF(uint8_t))
+#define PACKET_FEC_CHUNK (PACKET_FEC_PARITY_INDEX + COSMOS_SIZEOF(uint8_t))
+#define PACKET_FEC_HEADER_SIZE (PACKET_FEC_CHUNK)
+
 typedef struct
 {
     PACKET_TYPE type;
@@ -267,6 +295,7 @@ typedef union
     packet_struct_complete complete;
     packet_struct_cancel cancel;
     packet_struct_data data;
+    packet_struct_fec fec;
     packet_struct_metalong metalong;
     packet_struct_metashort metashort;
     packet_struct_reqdata reqdata;
@@ -280,6 +309,44 @@ typedef struct
     PACKET_FILE_SIZE_TYPE	chunk_end;
 } file_progress;
 
+//! Set of byte ranges in a file
+/*! Maps chunk_start to chunk_end. Ranges are kept from overlapping or touching, so that
+ * adding, removing and merging a range only costs O(log n). Maintain with ::add_chunk and
+ * ::del_chunk.
+*/
+typedef std::map<PACKET_FILE_SIZE_TYPE, PACKET_FILE_SIZE_TYPE> file_progress_set;
+
+//! Parity received for one FEC group, held until the group can be rebuilt
+typedef struct
+{
+    PACKET_CHUNK_SIZE_TYPE byte_count;
+    uint8_t group_count;
+    //! Index of each parity chunk held
+    std::vector<uint16_t> index;
+    //! Parity chunks, byte_count apiece, in the same order as index
+    std::vector<PACKET_BYTE> parity;
+} fec_group;
+
+//! FEC groups waiting on parity, by group_start
+typedef std::map<PACKET_FILE_SIZE_TYPE, fec_group> fec_group_set;
+
+//! Running statistics for one transfer
+typedef struct
+{
+    //! Time transfer was queued, MJD
+    double start_mjd;
+    //! Time of last data packet, MJD
+    double last_mjd;
+    //! Data packets sent or received
+    uint32_t packets;
+    //! Payload bytes sent or received, including repeats
+    PACKET_FILE_SIZE_TYPE bytes;
+    //! Bytes asked for again after being sent, or received more than once
+    PACKET_FILE_SIZE_TYPE repeat_bytes;
+    //! End of the furthest range sent so far
+    PACKET_FILE_SIZE_TYPE high_bytes;
+} transfer_stats;
+
 typedef struct
 {
     PACKET_TX_ID_TYPE tx_id;
@@ -293,10 +360,39 @@ typedef struct
     double savetime;
     PACKET_FILE_SIZE_TYPE file_size;
     PACKET_FILE_SIZE_TYPE total_bytes;
-    std::deque<file_progress> file_info;
+    file_progress_set file_info;
     FILE * fp;
+    transfer_stats stats;
+    fec_group_set fec;
 } tx_progress;
 
+//! Token bucket pacer with AIMD rate control
+/*! Bytes may be sent while there are tokens for them. Tokens refill at rate bytes per second,
+ * up to depth. While sending, the rate grows by increase bytes per second every second. Loss
+ * reports are gathered for holdoff seconds at a time; if more than threshold of what was sent
+ * in that time was lost, the rate is cut by the factor decrease. Random loss below the
+ * threshold, as on a noisy radio link, does not slow things down. Set up with ::pacer_init.
+*/
+typedef struct
+{
+    double rate;
+    double min_rate;
+    double max_rate;
+    double increase;
+    double decrease;
+    double threshold;
+    double holdoff;
+    double depth;
+    double tokens;
+    //! Bytes sent and reported lost since check_mjd
+    double sent_bytes;
+    double lost_bytes;
+    //! Time of last refill, MJD
+    double refill_mjd;
+    //! Time loss was last checked, MJD
+    double check_mjd;
+} transfer_pacer;
+
 //! @}
 
 //! \ingroup transferlib
@@ -330,6 +426,8 @@ void make_data_packet(std::vector<PACKET_BYTE>& packet, packet_struct_data data)
 void make_data_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE chunk_start, PACKET_BYTE* chunk);
 void extract_data(std::vector<PACKET_BYTE>& packet, packet_struct_data& data);
 void extract_data(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE& node_id, PACKET_TX_ID_TYPE& tx_id, PACKET_CHUNK_SIZE_TYPE& byte_count, PACKET_FILE_SIZE_TYPE& chunk_start, PACKET_BYTE* chunk);
+PACKET_BYTE* make_data_header(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE chunk_start);
+const PACKET_BYTE* extract_data_header(const std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE& node_id, PACKET_TX_ID_TYPE& tx_id, PACKET_CHUNK_SIZE_TYPE& byte_count, PACKET_FILE_SIZE_TYPE& chunk_start);
 
 void make_reqdata_packet(std::vector<PACKET_BYTE>& packet, packet_struct_reqdata reqdata);
 void make_reqdata_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_FILE_SIZE_TYPE hole_start, PACKET_FILE_SIZE_TYPE hole_end);
@@ -349,9 +447,27 @@ void make_cancel_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE no
 void extract_cancel(std::vector<PACKET_BYTE>& packet, packet_struct_cancel& cancel);
 void extract_cancel(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE &node_id, PACKET_TX_ID_TYPE& tx_id);
 
+void make_fec_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, PACKET_TX_ID_TYPE tx_id, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_FILE_SIZE_TYPE group_start, uint8_t group_count, uint8_t parity_index, PACKET_BYTE* chunk);
+int32_t extract_fec(std::vector<PACKET_BYTE>& packet, packet_struct_fec& fec);
+
 void make_queue_packet(std::vector<PACKET_BYTE>& packet, PACKET_NODE_ID_TYPE node_id, std::string node_name, std::vector<PACKET_TX_ID_TYPE> queue);
 void extract_queue(std::vector<PACKET_BYTE>& packet, packet_struct_queue& queue);
 
+PACKET_FILE_SIZE_TYPE add_chunk(file_progress_set& chunks, file_progress tp);
+PACKET_FILE_SIZE_TYPE del_chunk(file_progress_set& chunks, file_progress tp);
+PACKET_FILE_SIZE_TYPE total_chunks(const file_progress_set& chunks);
+std::vector<file_progress> find_chunks_missing(const file_progress_set& chunks, PACKET_FILE_SIZE_TYPE file_size);
+PACKET_FILE_SIZE_TYPE request_chunk(tx_progress& tx, file_progress tp, PACKET_FILE_SIZE_TYPE grace);
+
+int32_t fec_encode(uint16_t group_count, PACKET_CHUNK_SIZE_TYPE byte_count, const PACKET_BYTE* data, uint16_t parity_index, PACKET_BYTE* parity);
+int32_t fec_decode(uint16_t group_count, PACKET_CHUNK_SIZE_TYPE byte_count, PACKET_BYTE* data, const std::vector<bool>& have, const std::vector<uint16_t>& parity_index, const PACKET_BYTE* parity);
+std::vector<bool> fec_group_have(const file_progress_set& chunks, PACKET_FILE_SIZE_TYPE group_start, PACKET_CHUNK_SIZE_TYPE byte_count, uint16_t group_count, PACKET_FILE_SIZE_TYPE file_size);
+
+void pacer_init(transfer_pacer& pacer, double rate, double min_rate, double max_rate, double depth);
+double pacer_delay(transfer_pacer& pacer, size_t bytes, double mjd=0.);
+void pacer_consume(transfer_pacer& pacer, size_t bytes);
+bool pacer_loss(transfer_pacer& pacer, size_t bytes, double mjd=0.);
+
 //void make_message_packet(std::vector<PACKET_BYTE>& packet, packet_struct_message message);
 //void make_message_packet(std::vector<PACKET_BYTE>& packet, PACKET_TX_ID_TYPE tx_id);
 //void extract_message(std::vector<PACKET_BYTE>& packet, packet_struct_message& message);
@@ -101,6 +101,7 @@ int32_t request_set_logperiod(char* request, char* response, Agent *agent);
 int32_t request_set_logstring(char* request, char* response, Agent *agent);
 int32_t request_get_logstring(char* request, char* response, Agent *agent);
 int32_t request_set_logstride_soh(char* request, char* response, Agent *agent);
+int32_t request_set_sohfull(char* request, char* response, Agent *agent);
 
 string jjstring;
 string myjstring;
@@ -117,6 +118,11 @@ double logdate_soh=0.;
 int32_t newlogperiod = 10, logperiod = 0;
 double newlogstride_soh = 900. / 86400.;
 double logstride_soh = 0.;
+// SOH is posted in full, unless sohfull is set, in which case only changes are posted in
+// between posts of everything every sohfull seconds
+double sohfull = 0.;
+double sohdate_full = 0.;
+uint32_t soh_version = 0;
 
 vector<shorteventstruc> eventdict;
 vector<shorteventstruc> events;
@@ -247,6 +253,8 @@ int main(int argc, char *argv[])
         exit (iretn);
     if ((iretn=agent->add_request("set_logstride_soh", request_set_logstride_soh)))
         exit (iretn);
+    if ((iretn=agent->add_request("set_sohfull", request_set_sohfull, "seconds", "seconds between posts of the full SOH, with only changes posted in between (0, the default, for always full)")))
+        exit (iretn);
 
     // Create default logstring
     logstring = json_list_of_soh(agent->cinfo->pdata);
@@ -309,7 +317,16 @@ int main(int argc, char *argv[])
         {
             loc_update(&agent->cinfo->pdata.node.loc);
             update_target(agent->cinfo->pdata);
-            agent->post(Agent::AGENT_MESSAGE_SOH, json_of_table(myjstring, logtable, agent->cinfo->meta, agent->cinfo->pdata));
+            if (sohfull <= 0. || cmjd - sohdate_full >= sohfull / 86400.)
+            {
+                soh_version = 0;
+                sohdate_full = cmjd;
+            }
+            json_of_table_since(myjstring, logtable, soh_version, agent->cinfo->meta, agent->cinfo->pdata);
+            if (myjstring.size())
+            {
+                agent->post(Agent::AGENT_MESSAGE_SOH, myjstring);
+            }
             calc_events(eventdict, agent->cinfo->meta, agent->cinfo->pdata, events);
             for (uint32_t k=0; k<events.size(); ++k)
             {
@@ -551,6 +568,7 @@ int32_t request_set_logstring(char* request, char* response, Agent *agent)
     logstring = &request[strlen("set_logstring")+1];
     logtable.clear();
     json_table_of_list(logtable, logstring.c_str(), agent->cinfo->meta);
+    sohdate_full = 0.;
     return 0;
 }
 
@@ -566,6 +584,13 @@ int32_t request_set_logstride_soh(char* request, char* response, Agent *agent)
     return 0;
 }
 
+int32_t request_set_sohfull(char* request, char* response, Agent *agent)
+{
+    sscanf(request,"set_sohfull %lf",&sohfull);
+    sohdate_full = 0.;
+    return 0;
+}
+
 void collect_data_loop()
 {
     size_t my_position = -1;
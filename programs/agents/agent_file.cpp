@@ -47,6 +47,8 @@
 #include "support/sliplib.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdarg>
 #include <cstring>
 #include <time.h>
 #include <iostream>
@@ -60,8 +62,14 @@
 #define PACKET_SIZE_LO (253-(PACKET_DATA_HEADER_SIZE+28))
 #define PACKET_SIZE_PAYLOAD (PACKET_SIZE_LO-PACKET_DATA_HEADER_SIZE)
 #define THROUGHPUT_LO 1000
+#define THROUGHPUT_LO_MIN 125
+#define THROUGHPUT_LO_MAX 1000
 #define PACKET_SIZE_HI (1472-(PACKET_DATA_HEADER_SIZE+28))
 #define THROUGHPUT_HI 150000
+#define THROUGHPUT_HI_MIN 10000
+#define THROUGHPUT_HI_MAX 1200000
+// Most DATA packets queued by send_loop per wake up
+#define TRANSFER_BURST 8
 //#define TRANSFER_QUEUE_LIMIT 10
 
 // Debug Var
@@ -94,6 +102,25 @@ Agent *agent;
 /** the (global) number of agent sending channels */
 uint16_t send_channels=0;
 uint16_t use_channel = 0;
+/** the (global) flag to stripe DATA packets across all sending channels */
+bool stripe_channels = true;
+/** data chunks per FEC group, and parity chunks sent for each; 0 for none */
+typedef struct
+{
+    uint16_t data;
+    uint16_t parity;
+} fec_setting;
+/** the (global) FEC setting, changed as a whole by request_fec and copied once per burst */
+std::atomic<fec_setting> fec(fec_setting{0, 0});
+typedef struct
+{
+    std::string type;
+    uint32_t channel;
+    std::vector<PACKET_BYTE> packet;
+} transmit_queue_entry;
+
+#define TRANSMIT_POOL_SIZE 64
+
 /** the (global) structure of sending channels */
 typedef struct
 {
@@ -101,27 +128,28 @@ typedef struct
     std::string destination_ip;
     PACKET_CHUNK_SIZE_TYPE packet_size;
     uint32_t throughput;
-    double nmjd;
+    transfer_pacer pacer;
+    std::mutex pacer_lock;
+    // Each channel has its own queue and transmit_loop, so a slow link never holds up a fast one
+    std::queue<transmit_queue_entry> transmit_queue;
+    std::mutex transmit_queue_lock;
+    std::condition_variable transmit_queue_check;
+    // Bytes waiting in transmit_queue
+    size_t queued_bytes;
+    // Packet buffers handed back by transmit_loop, reused by queuesendto
+    std::vector<std::vector<PACKET_BYTE>> transmit_pool;
+    // Headers for sending several queued packets with one system call
+    socket_batch send_batch;
 } sendchannelstruc;
 
 sendchannelstruc send_channel[2];
 
-typedef struct
-{
-    std::string type;
-    uint32_t channel;
-    std::vector<PACKET_BYTE> packet;
-} transmit_queue_entry;
-
-std::queue<transmit_queue_entry> transmit_queue;
-std::condition_variable transmit_queue_check;
-
 socket_channel recvchan;
 
 //Send and receive thread info
 void send_loop();
 void recv_loop();
-void transmit_loop();
+void transmit_loop(uint16_t channel);
 
 // Mutexes to avoid thread collisions
 std::mutex incoming_tx_lock;
@@ -153,12 +181,13 @@ typedef struct
     PACKET_NODE_ID_TYPE node_id;
     tx_entry incoming;
     tx_entry outgoing;
+    // Set once the node has sent us a QUEUE packet; send_loop serves all active nodes in turn
+    bool active;
 } tx_queue;
 
 static std::vector<tx_queue> txq;
 
 //static std::vector<tx_queue> incoming_tx;
-int32_t active_node = -1;
 
 //static std::vector<tx_queue> outgoing_tx;
 //int32_t node = -1;
@@ -171,6 +200,8 @@ int32_t request_remove_file(char* request, char* response, Agent *agent);
 int32_t request_ls(char* request, char* response, Agent *agent);
 int32_t request_list_incoming(char* request, char* response, Agent *agent);
 int32_t request_list_outgoing(char* request, char* response, Agent *agent);
+int32_t request_transfer_stats(char* request, char* response, Agent *agent);
+int32_t request_fec(char* request, char* response, Agent *agent);
 int32_t outgoing_tx_add(tx_progress tx_out);
 int32_t outgoing_tx_add(std::string node_name, std::string agent_name, std::string file_name);
 int32_t outgoing_tx_del(int32_t node, PACKET_TX_ID_TYPE tx_id);
@@ -180,22 +211,29 @@ int32_t incoming_tx_update(packet_struct_metashort meta);
 int32_t incoming_tx_del(int32_t node, PACKET_TX_ID_TYPE tx_id);
 std::vector<file_progress> find_chunks_missing(tx_progress& tx);
 PACKET_FILE_SIZE_TYPE merge_chunks_overlap(tx_progress& tx);
-void transmit_loop();
-double queuesendto(std::string type, uint16_t channel, std::vector<PACKET_BYTE> packet);
-int32_t mysendto(std::string type, sendchannelstruc& channel, std::vector<PACKET_BYTE>& buf);
-int32_t myrecvfrom(std::string type, socket_channel channel, std::vector<PACKET_BYTE>& buf, uint32_t length);
-void debug_packet(std::vector<PACKET_BYTE> buf, std::string type);
+double queuesendto(const std::string& type, uint16_t channel, std::vector<PACKET_BYTE>& packet);
+int32_t mysendto(const std::vector<std::string>& types, sendchannelstruc& channel, std::vector<std::vector<PACKET_BYTE>>& bufs, size_t count);
+int32_t myrecvfrom(const std::string& type, socket_channel& channel, std::vector<PACKET_BYTE>& buf, uint32_t length);
+void debug_packet(const std::vector<PACKET_BYTE>& buf, const std::string& type);
 int32_t write_meta(tx_progress& tx);
 int32_t read_meta(tx_progress& tx);
 bool tx_progress_compare_by_size(const tx_progress& a, const tx_progress& b);
 bool filestruc_compare_by_size(const filestruc& a, const filestruc& b);
-PACKET_TX_ID_TYPE check_tx_id(std::vector<tx_progress> tx_entry, PACKET_TX_ID_TYPE tx_id);
+PACKET_TX_ID_TYPE check_tx_id(const std::vector<tx_progress>& tx_entry, PACKET_TX_ID_TYPE tx_id);
 int32_t check_node_id(std::string node_name);
 int32_t check_node_id(PACKET_NODE_ID_TYPE node_id);
 int32_t lookup_remote_node_id(PACKET_NODE_ID_TYPE node_id);
 int32_t set_remote_node_id(PACKET_NODE_ID_TYPE node_id, std::string node_name);
 PACKET_TX_ID_TYPE choose_incoming_tx_id(int32_t node);
 int32_t next_incoming_tx(PACKET_NODE_ID_TYPE node);
+int32_t incoming_fec_rebuild(tx_progress& tx, PACKET_FILE_SIZE_TYPE offset);
+int32_t file_read_at(FILE *fp, void *buffer, size_t count, PACKET_FILE_SIZE_TYPE offset);
+int32_t file_write_at(FILE *fp, const void *buffer, size_t count, PACKET_FILE_SIZE_TYPE offset);
+double outgoing_fec_send(int32_t node, PACKET_TX_ID_TYPE tx_id, int32_t remote_node, PACKET_FILE_SIZE_TYPE group_start, PACKET_CHUNK_SIZE_TYPE chunk_size, fec_setting setting);
+double outgoing_tx_burst(int32_t node, std::vector<PACKET_BYTE>& packet);
+std::vector<uint16_t> stripe_set(fec_setting setting);
+uint16_t stripe_channel(fec_setting setting);
+int32_t request_stripe(char* request, char* response, Agent *agent);
 
 //main
 int main(int argc, char *argv[])
@@ -208,7 +246,7 @@ int main(int argc, char *argv[])
             send_channel[1].destination_ip = argv[2];
             send_channel[1].packet_size = PACKET_SIZE_HI;
             send_channel[1].throughput = THROUGHPUT_HI;
-            send_channel[1].nmjd = currentmjd(0.);
+            pacer_init(send_channel[1].pacer, THROUGHPUT_HI, THROUGHPUT_HI_MIN, THROUGHPUT_HI_MAX, TRANSFER_BURST * (PACKET_SIZE_HI + PACKET_DATA_HEADER_SIZE + 28));
             ++send_channels;
         }
     case 2:
@@ -216,7 +254,7 @@ int main(int argc, char *argv[])
             send_channel[0].destination_ip = argv[1];
             send_channel[0].packet_size = PACKET_SIZE_LO;
             send_channel[0].throughput = THROUGHPUT_LO;
-            send_channel[0].nmjd = currentmjd(0.);
+            pacer_init(send_channel[0].pacer, THROUGHPUT_LO, THROUGHPUT_LO_MIN, THROUGHPUT_LO_MAX, TRANSFER_BURST * (PACKET_SIZE_LO + PACKET_DATA_HEADER_SIZE + 28));
             ++send_channels;
             agentname += argv[1];
             break;
@@ -287,6 +325,7 @@ int main(int argc, char *argv[])
             tx.outgoing.next_id = 1;
             tx.outgoing.progress.resize(TRANSFER_QUEUE_SIZE);
             tx.outgoing.size = 0;
+            tx.active = false;
             txq.push_back(tx);
         }
 
@@ -323,6 +362,8 @@ int main(int argc, char *argv[])
     // add agent_file requests
     if ((iretn=agent->add_request("use_channel",request_use_channel,"{0|1}", "choose slow or fast channel")))
         exit (iretn);
+    if ((iretn=agent->add_request("stripe",request_stripe,"[0|1]", "set or show striping of data across all channels")))
+        exit (iretn);
     if ((iretn=agent->add_request("remove_file",request_remove_file,"in|out tx_id", "removes file from indicated queue")))
         exit (iretn);
     //	if ((iretn=agent->add_request("send_file",request_send_file,"", "creates and sends metadata/data packets")))
@@ -333,12 +374,20 @@ int main(int argc, char *argv[])
         exit (iretn);
     if ((iretn=agent->add_request("list_outgoing",request_list_outgoing,"", "lists contents outgoing queue")))
         exit (iretn);
+    if ((iretn=agent->add_request("transfer_stats",request_transfer_stats,"", "lists rate and loss for each channel and transfer")))
+        exit (iretn);
+    if ((iretn=agent->add_request("fec",request_fec,"[data_chunks parity_chunks]", "set or show forward error correction, 0 0 for none")))
+        exit (iretn);
     if ((iretn=agent->add_request("debug",request_debug,"{0|1}","Toggle Debug information")))
         exit (iretn);
 
     std::thread send_loop_thread(send_loop);
     std::thread recv_loop_thread(recv_loop);
-    std::thread transmit_loop_thread(transmit_loop);
+    std::vector<std::thread> transmit_loop_threads;
+    for (uint16_t i=0; i<send_channels; ++i)
+    {
+        transmit_loop_threads.push_back(std::thread(transmit_loop, i));
+    }
 
     double nextdiskcheck = currentmjd(0.);
     ElapsedTime etloop;
@@ -393,7 +442,7 @@ int main(int argc, char *argv[])
 
                         bool addtoqueue = true;
                         outgoing_tx_lock.lock();
-                        for(tx_progress progress : txq[node].outgoing.progress)
+                        for(const tx_progress& progress : txq[node].outgoing.progress)
                         {
                             if (progress.tx_id && file.path == progress.filepath)
                             {
@@ -421,8 +470,11 @@ int main(int argc, char *argv[])
 
     send_loop_thread.join();
     recv_loop_thread.join();
-    transmit_queue_check.notify_one();
-    transmit_loop_thread.join();
+    for (uint16_t i=0; i<send_channels; ++i)
+    {
+        send_channel[i].transmit_queue_check.notify_one();
+        transmit_loop_threads[i].join();
+    }
 
     agent->shutdown();
 
@@ -467,7 +519,12 @@ void recv_loop()
                 {
                     packet_struct_data data;
 
-                    extract_data(recvbuf, data.node_id, data.tx_id, data.byte_count, data.chunk_start, data.chunk);
+                    // Leave the chunk in the receive buffer; it is written straight from there
+                    const PACKET_BYTE* chunk = extract_data_header(recvbuf, data.node_id, data.tx_id, data.byte_count, data.chunk_start);
+                    if (chunk == nullptr)
+                    {
+                        break;
+                    }
 
                     last_data_receive_time = currentmjd();
 
@@ -485,131 +542,72 @@ void recv_loop()
                         if (tx_id > 0)
                         {
                             // tx_id now points to the valid entry to which we should add the data
+                            tx_progress& tx_in = txq[node].incoming.progress[tx_id];
                             file_progress tp;
                             tp.chunk_start = data.chunk_start;
                             tp.chunk_end = data.chunk_start + data.byte_count - 1;
 
-                            uint32_t check=0;
-                            bool duplicate = false;
-                            bool updated = false;
-
-                            // Do we have any data yet?
-                            if (!txq[node].incoming.progress[tx_id].file_info.size())
-                            {
-                                // Add first entry, then write data
-                                txq[node].incoming.progress[tx_id].file_info.push_back(tp);
-                                txq[node].incoming.progress[tx_id].total_bytes += data.byte_count;
-                                updated = true;
-                            }
-                            else
-                            {
-                                // Check against existing data
-                                for (uint32_t j=0; j<txq[node].incoming.progress[tx_id].file_info.size(); ++j)
-                                {
-                                    // Check for duplicate
-                                    if (tp.chunk_start >= txq[node].incoming.progress[tx_id].file_info[j].chunk_start && tp.chunk_end <= txq[node].incoming.progress[tx_id].file_info[j].chunk_end)
-                                    {
-                                        duplicate = true;
-                                        break;
-                                    }
-                                    // If we start before this entry
-                                    if (tp.chunk_start < txq[node].incoming.progress[tx_id].file_info[j].chunk_start)
-                                    {
-                                        // If we end before this entry (at least one byte between), insert
-                                        if (tp.chunk_end + 1 < txq[node].incoming.progress[tx_id].file_info[j].chunk_start)
-                                        {
-                                            txq[node].incoming.progress[tx_id].file_info.insert(txq[node].incoming.progress[tx_id].file_info.begin()+j, tp);
-                                            txq[node].incoming.progress[tx_id].total_bytes += data.byte_count;
-                                            updated = true;
-                                            break;
-                                        }
-                                        // Otherwise, extend the near end
-                                        else
-                                        {
-                                            tp.chunk_end = txq[node].incoming.progress[tx_id].file_info[j].chunk_start - 1;
-                                            txq[node].incoming.progress[tx_id].file_info[j].chunk_start = tp.chunk_start;
-                                            data.byte_count = (tp.chunk_end - tp.chunk_start) + 1;
-                                            txq[node].incoming.progress[tx_id].total_bytes += data.byte_count;
-                                            updated = true;
-                                            break;
-                                        }
-                                    }
-                                    else
-                                    {
-                                        // If we overlap on the end, extend the far end
-                                        if (tp.chunk_start <= txq[node].incoming.progress[tx_id].file_info[j].chunk_end + 1)
-                                        {
-                                            if (tp.chunk_end > txq[node].incoming.progress[tx_id].file_info[j].chunk_end)
-                                            {
-                                                data.byte_count = tp.chunk_end - txq[node].incoming.progress[tx_id].file_info[j].chunk_end;
-                                                tp.chunk_start = txq[node].incoming.progress[tx_id].file_info[j].chunk_end + 1;
-                                                txq[node].incoming.progress[tx_id].file_info[j].chunk_end = tp.chunk_end;
-                                                txq[node].incoming.progress[tx_id].total_bytes += data.byte_count;
-                                                updated = true;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                    check = j + 1;
-                                }
-
+                            // Merge with what we already have, counting only new bytes
+                            PACKET_FILE_SIZE_TYPE added = add_chunk(tx_in.file_info, tp);
+                            tx_in.total_bytes += added;
+                            bool updated = added > 0;
 
-                                // If we are higher than everything currently in the list, then append
-                                if (!duplicate && check == txq[node].incoming.progress[tx_id].file_info.size())
-                                {
-                                    txq[node].incoming.progress[tx_id].file_info.push_back(tp);
-                                    txq[node].incoming.progress[tx_id].total_bytes += data.byte_count;
-                                    updated = true;
-                                }
-
-                            }
+                            ++tx_in.stats.packets;
+                            tx_in.stats.bytes += data.byte_count;
+                            tx_in.stats.repeat_bytes += data.byte_count - added;
+                            tx_in.stats.last_mjd = currentmjd();
 
                             // Write to disk if this is new data
                             if (updated)
                             {
                                 // Write incoming data to disk
-                                if (txq[node].incoming.progress[tx_id].fp == NULL)
+                                if (tx_in.fp == NULL)
                                 {
-                                    partial_filepath = txq[node].incoming.progress[tx_id].temppath + ".file";
-                                    txq[node].incoming.progress[tx_id].fp = fopen(partial_filepath.c_str(), "w");
+                                    partial_filepath = tx_in.temppath + ".file";
+                                    tx_in.fp = fopen(partial_filepath.c_str(), "w+");
                                 }
 
-                                if (txq[node].incoming.progress[tx_id].fp == NULL)
+                                if (tx_in.fp == NULL)
                                 {
                                     perror(partial_filepath.c_str());
                                 }
                                 else
                                 {
-                                    fseek(txq[node].incoming.progress[tx_id].fp, tp.chunk_start, SEEK_SET);
-                                    fwrite(data.chunk, data.byte_count, 1, txq[node].incoming.progress[tx_id].fp);
-                                    fflush(txq[node].incoming.progress[tx_id].fp);
+                                    if (file_write_at(tx_in.fp, chunk, data.byte_count, tp.chunk_start) < 0)
+                                    {
+                                        perror(partial_filepath.c_str());
+                                    }
                                     // Write latest meta data to disk
-                                    write_meta(txq[node].incoming.progress[tx_id]);
+                                    write_meta(tx_in);
+
+                                    // This may be the last chunk a waiting FEC group needed
+                                    if (tx_in.fec.size())
+                                    {
+                                        incoming_fec_rebuild(tx_in, tp.chunk_start);
+                                    }
                                 }
 
                             }
 
                             // Check if file has been completely received
-                            if(txq[node].incoming.progress[tx_id].file_size == txq[node].incoming.progress[tx_id].total_bytes && txq[node].incoming.progress[tx_id].havemeta)
+                            if(tx_in.file_size == tx_in.total_bytes && tx_in.havemeta)
                             {
                                 // See if we know what the remote node_id is for this
                                 int32_t remote_node = lookup_remote_node_id(node);
                                 if (remote_node >= 0)
                                 {
-                                    tx_progress tx_in = txq[node].incoming.progress[tx_id];
-
                                     // inform other end that file has been received
                                     std::vector<PACKET_BYTE> packet;
                                     make_complete_packet(packet, remote_node, tx_in.tx_id);
                                     queuesendto("rx", use_channel, packet);
 
                                     // Move file to its final location
-                                    if (!txq[node].incoming.progress[tx_id].complete)
+                                    if (!tx_in.complete)
                                     {
-                                        if (txq[node].incoming.progress[tx_id].fp != nullptr)
+                                        if (tx_in.fp != nullptr)
                                         {
-                                            fclose(txq[node].incoming.progress[tx_id].fp);
-                                            txq[node].incoming.progress[tx_id].fp = nullptr;
+                                            fclose(tx_in.fp);
+                                            tx_in.fp = nullptr;
                                         }
                                         std::string final_filepath = tx_in.temppath + ".file";
                                         int iret = rename(final_filepath.c_str(), tx_in.filepath.c_str());
@@ -618,7 +616,7 @@ void recv_loop()
                                             printf("Renamed: %d %s\n", iret, tx_in.filepath.c_str());
                                         }
                                         // Mark complete
-                                        txq[node].incoming.progress[tx_id].complete = true;
+                                        tx_in.complete = true;
                                     }
                                 }
                             }
@@ -627,6 +625,53 @@ void recv_loop()
 
                     incoming_tx_lock.unlock();
 
+                    break;
+                }
+            case PACKET_FEC:
+                {
+                    packet_struct_fec fec;
+
+                    // Drop anything too short to be a whole FEC packet
+                    if (extract_fec(recvbuf, fec) < 0)
+                    {
+                        break;
+                    }
+
+                    last_data_receive_time = currentmjd();
+
+                    incoming_tx_lock.lock();
+
+                    int32_t node = check_node_id(fec.node_id);
+
+                    if (node >= 0 && fec.byte_count && fec.group_count && fec.group_count + fec.parity_index < 256)
+                    {
+                        PACKET_TX_ID_TYPE tx_id = check_tx_id(txq[node].incoming.progress, fec.tx_id);
+
+                        // Parity is only useful once we know how big the file is
+                        if (tx_id > 0 && txq[node].incoming.progress[tx_id].havemeta && !txq[node].incoming.progress[tx_id].complete)
+                        {
+                            tx_progress& tx_in = txq[node].incoming.progress[tx_id];
+                            fec_group& group = tx_in.fec[fec.group_start];
+                            if (group.index.empty())
+                            {
+                                group.byte_count = fec.byte_count;
+                                group.group_count = fec.group_count;
+                            }
+                            if (group.byte_count == fec.byte_count && group.group_count == fec.group_count && std::find(group.index.begin(), group.index.end(), fec.parity_index) == group.index.end())
+                            {
+                                group.index.push_back(fec.parity_index);
+                                group.parity.insert(group.parity.end(), fec.chunk, fec.chunk + fec.byte_count);
+                            }
+
+                            if (incoming_fec_rebuild(tx_in, fec.group_start) > 0 && tx_in.total_bytes == tx_in.file_size)
+                            {
+                                next_incoming_tx(node);
+                            }
+                        }
+                    }
+
+                    incoming_tx_lock.unlock();
+
                     break;
                 }
             case PACKET_REQDATA:
@@ -651,84 +696,36 @@ void recv_loop()
                     if (tx_id > 0)
                     {
                         // Add this chunk to the queue
+                        tx_progress& tx_out = txq[node].outgoing.progress[tx_id];
                         file_progress tp;
                         tp.chunk_start = reqdata.hole_start;
                         tp.chunk_end = reqdata.hole_end;
-                        PACKET_FILE_SIZE_TYPE byte_count = (reqdata.hole_end - reqdata.hole_start) + 1;
 
-                        uint32_t check=0;
-                        // Anything in the queue yet?
-                        if (!txq[node].outgoing.progress[tx_id].file_info.size())
+                        // The last burst or two on each channel may still be queued or on the link, so is not yet lost
+                        std::vector<uint16_t> stripe = stripe_set(fec.load());
+                        double depth = 0.;
+                        double rate = 0.;
+                        for (uint16_t channel : stripe)
                         {
-                            // Add first entry
-                            txq[node].outgoing.progress[tx_id].file_info.push_back(tp);
-                            txq[node].outgoing.progress[tx_id].total_bytes += byte_count;
-                            //							cout<<"[Send] In (new): "<<"["<<0<<":"<<txq[node].outgoing.progress[tx_id].file_info.size()<<"]"<<" tx_id: "<<txq[node].outgoing.progress[tx_id].tx_id<<" chunk:["<<reqdata.hole_start<<":"<<reqdata.hole_end<<"] now:["<<txq[node].outgoing.progress[tx_id].file_info[0].chunk_start<<":"<<txq[node].outgoing.progress[tx_id].file_info[0].chunk_end<< std::endl;
+                            send_channel[channel].pacer_lock.lock();
+                            depth += send_channel[channel].pacer.depth;
+                            rate += send_channel[channel].pacer.rate;
+                            send_channel[channel].pacer_lock.unlock();
                         }
-                        else
+                        PACKET_FILE_SIZE_TYPE lost = request_chunk(tx_out, tp, 2 * depth);
+                        if (lost)
                         {
-                            // Check against existing data
-                            for (uint32_t j=0; j<txq[node].outgoing.progress[tx_id].file_info.size(); ++j)
-                            {
-                                // If we match this entry
-                                if (tp.chunk_start == txq[node].outgoing.progress[tx_id].file_info[j].chunk_start && tp.chunk_end == txq[node].outgoing.progress[tx_id].file_info[j].chunk_end)
-                                {
-                                    break;
-                                }
-                                // If we start before this entry
-                                if (tp.chunk_start < txq[node].outgoing.progress[tx_id].file_info[j].chunk_start)
-                                {
-                                    // If we end before this entry (at least one byte between), insert
-                                    if (tp.chunk_end + 1 < txq[node].outgoing.progress[tx_id].file_info[j].chunk_start)
-                                    {
-                                        txq[node].outgoing.progress[tx_id].file_info.insert(txq[node].outgoing.progress[tx_id].file_info.begin()+j, tp);
-                                        txq[node].outgoing.progress[tx_id].total_bytes += byte_count;
-                                        //										cout<<"[Send] In (insert): "<<"["<<j<<":"<<txq[node].outgoing.progress[tx_id].file_info.size()<<"]"<<" tx_id: "<<txq[node].outgoing.progress[tx_id].tx_id<<" chunk:["<<reqdata.hole_start<<":"<<reqdata.hole_end<<"] now:["<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_start<<":"<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_end<< std::endl;
-                                        break;
-                                    }
-                                    // Otherwise, extend the near end
-                                    else
-                                    {
-                                        tp.chunk_end = txq[node].outgoing.progress[tx_id].file_info[j].chunk_start - 1;
-                                        txq[node].outgoing.progress[tx_id].file_info[j].chunk_start = tp.chunk_start;
-                                        byte_count = (tp.chunk_end - tp.chunk_start) + 1;
-                                        txq[node].outgoing.progress[tx_id].total_bytes += byte_count;
-                                        //										cout<<"[Send] In (extend near): "<<"["<<j<<":"<<txq[node].outgoing.progress[tx_id].file_info.size()<<"]"<<" tx_id: "<<txq[node].outgoing.progress[tx_id].tx_id<<" chunk:["<<reqdata.hole_start<<":"<<reqdata.hole_end<<"] now:["<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_start<<":"<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_end<< std::endl;
-                                        break;
-                                    }
-                                }
-                                else
-                                {
-                                    // If we overlap on the end, extend the far end
-                                    if (tp.chunk_start <= txq[node].outgoing.progress[tx_id].file_info[j].chunk_end + 1)
-                                    {
-                                        if (tp.chunk_end > txq[node].outgoing.progress[tx_id].file_info[j].chunk_end)
-                                        {
-                                            byte_count = tp.chunk_end - txq[node].outgoing.progress[tx_id].file_info[j].chunk_end;
-                                            tp.chunk_start = txq[node].outgoing.progress[tx_id].file_info[j].chunk_end + 1;
-                                            txq[node].outgoing.progress[tx_id].file_info[j].chunk_end = tp.chunk_end;
-                                            txq[node].outgoing.progress[tx_id].total_bytes += byte_count;
-                                            //											cout<<"[Send] In (extend far): "<<"["<<j<<":"<<txq[node].outgoing.progress[tx_id].file_info.size()<<"]"<<" tx_id: "<<txq[node].outgoing.progress[tx_id].tx_id<<" chunk:["<<reqdata.hole_start<<":"<<reqdata.hole_end<<"] now:["<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_start<<":"<<txq[node].outgoing.progress[tx_id].file_info[j].chunk_end<< std::endl;
-                                            break;
-                                        }
-                                    }
-                                }
-                                check = j + 1;
-                            }
-
-
-                            // If we are higher than everything currently in the list, then append
-                            if (check == txq[node].outgoing.progress[tx_id].file_info.size())
+                            // Which channel lost it is unknown, so charge each for its share of the data
+                            for (uint16_t channel : stripe)
                             {
-                                txq[node].outgoing.progress[tx_id].file_info.push_back(tp);
-                                txq[node].outgoing.progress[tx_id].total_bytes += byte_count;
-                                //								cout<<"[Send] In (append): "<<"["<<check<<":"<<txq[node].outgoing.progress[tx_id].file_info.size()<<"]"<<" tx_id: "<<txq[node].outgoing.progress[tx_id].tx_id<<" chunk:["<<reqdata.hole_start<<":"<<reqdata.hole_end<<"] now:["<<txq[node].outgoing.progress[tx_id].file_info[check].chunk_start<<":"<<txq[node].outgoing.progress[tx_id].file_info[check].chunk_end<< std::endl;
+                                send_channel[channel].pacer_lock.lock();
+                                pacer_loss(send_channel[channel].pacer, lost * send_channel[channel].pacer.rate / rate);
+                                send_channel[channel].pacer_lock.unlock();
                             }
-
                         }
 
                         // Save meta to disk
-                        write_meta(txq[node].outgoing.progress[tx_id]);
+                        write_meta(tx_out);
                         txq[node].outgoing.id = reqdata.tx_id;
                     }
 
@@ -759,7 +756,7 @@ void recv_loop()
                                 PACKET_TX_ID_TYPE tx_id = check_tx_id(txq[node].outgoing.progress, reqmeta.tx_id[i]);
                                 if (tx_id > 0)
                                 {
-                                    tx_progress tx = txq[node].outgoing.progress[tx_id];
+                                    const tx_progress& tx = txq[node].outgoing.progress[tx_id];
                                     std::vector<PACKET_BYTE> packet;
                                     make_metadata_packet(packet, remote_node, tx.tx_id, (char *)tx.file_name.c_str(), tx.file_size, (char *)tx.agent_name.c_str());
                                     queuesendto("tx", use_channel, packet);
@@ -843,8 +840,8 @@ void recv_loop()
                     {
                         // Set remote node_id
                         txq[node].node_id = queue.node_id + 1;
-                        // Set active_node
-                        active_node = node;
+                        // Start sending to it
+                        txq[node].active = true;
                         // Sort through incoming queue and remove anything not in sent queue
                         for (uint16_t tx_id=0; tx_id<TRANSFER_QUEUE_SIZE; ++tx_id)
                         {
@@ -1004,105 +1001,12 @@ void send_loop()
         next_data_time = 0.;
 
         outgoing_tx_lock.lock();
-        if (active_node >= 0)
+        // Serve every node that has asked, a burst each
+        for (uint16_t node=0; node<txq.size(); ++node)
         {
-            int32_t node = active_node;
-            PACKET_TX_ID_TYPE  tx_id = check_tx_id(txq[node].outgoing.progress, txq[node].outgoing.id);
-            if (tx_id > 0)
+            if (txq[node].active)
             {
-                if (txq[node].outgoing.progress[tx_id].file_info.size())
-                {
-                    if (txq[node].outgoing.progress[tx_id].fp == nullptr)
-                    {
-                        txq[node].outgoing.progress[tx_id].fp = fopen(txq[node].outgoing.progress[tx_id].filepath.c_str(), "r");
-                    }
-
-                    if(txq[node].outgoing.progress[tx_id].fp != nullptr)
-                    {
-                        file_progress tp;
-                        tp = txq[node].outgoing.progress[tx_id].file_info[0];
-
-                        PACKET_FILE_SIZE_TYPE byte_count = (tp.chunk_end - tp.chunk_start) + 1;
-                        switch (use_channel)
-                        {
-                        case 0:
-                            if (byte_count > PACKET_SIZE_LO)
-                            {
-                                byte_count = PACKET_SIZE_LO;
-                            }
-                            break;
-                        case 1:
-                            if (byte_count > PACKET_SIZE_HI)
-                            {
-                                byte_count = PACKET_SIZE_HI;
-                            }
-                            break;
-                        }
-
-                        tp.chunk_end = tp.chunk_start + byte_count - 1;
-
-                        // Read the packet and send it
-                        size_t nbytes;
-                        PACKET_BYTE* chunk = new PACKET_BYTE[byte_count]();
-                        if (!(nbytes = fseek(txq[node].outgoing.progress[tx_id].fp, tp.chunk_start, SEEK_SET)))
-                        {
-                            nbytes = fread(chunk, 1, byte_count, txq[node].outgoing.progress[tx_id].fp);
-                        }
-                        if (nbytes == byte_count)
-                        {
-                            // See if we know what the remote node_id is for this
-                            int32_t remote_node = lookup_remote_node_id(node);
-                            if (remote_node >= 0)
-                            {
-                                make_data_packet(packet, remote_node, txq[node].outgoing.progress[tx_id].tx_id, byte_count, tp.chunk_start, chunk);
-
-                                send_time = queuesendto("tx", use_channel, packet);
-                                next_data_time += send_time;
-                                txq[node].outgoing.progress[tx_id].file_info[0].chunk_start = tp.chunk_end + 1;
-                            }
-                        }
-                        else
-                        {
-                            // Some problem with this transmission, ask other end to dequeue it
-                            // Remove transaction
-                            outgoing_tx_del(node, tx_id);
-
-                            int32_t remote_node = lookup_remote_node_id(node);
-                            if (remote_node >= 0)
-                            {
-                                // Send a CANCEL packet
-                                std::vector<PACKET_BYTE> packet;
-                                make_cancel_packet(packet, remote_node, tx_id);
-                                queuesendto("tx", use_channel, packet);
-                            }
-                        }
-                        delete[] chunk;
-
-                        if (txq[node].outgoing.progress[tx_id].file_info[0].chunk_start > txq[node].outgoing.progress[tx_id].file_info[0].chunk_end)
-                        {
-                            // All done with this file_info entry. Close file and remove entry.
-                            fclose(txq[node].outgoing.progress[tx_id].fp);
-                            txq[node].outgoing.progress[tx_id].fp = nullptr;
-                            txq[node].outgoing.progress[tx_id].file_info.pop_front();
-                        }
-
-                        write_meta(txq[node].outgoing.progress[tx_id]);
-                    }
-                    else
-                    {
-                        // Some problem with this transmission, ask other end to dequeue it
-                        outgoing_tx_del(node, tx_id);
-
-                        int32_t remote_node = lookup_remote_node_id(node);
-                        if (remote_node >= 0)
-                        {
-                            // Send a CANCEL packet
-                            std::vector<PACKET_BYTE> packet;
-                            make_cancel_packet(packet, remote_node, tx_id);
-                            queuesendto("tx", use_channel, packet);
-                        }
-                    }
-                }
+                next_data_time += outgoing_tx_burst(node, packet);
             }
         }
 
@@ -1142,42 +1046,297 @@ void send_loop()
     }
 }
 
-void transmit_loop()
+//! Send a burst of DATA packets to a node
+/*! Queue up to ::TRANSFER_BURST packets from the current outgoing transfer for the node, each
+ * on the channel chosen by ::stripe_channel. Must be called with ::outgoing_tx_lock held.
+    \param node Index of node in ::txq.
+    \param packet Scratch buffer to build packets in.
+    \return Time needed to send the burst across all striped channels, in days.
+*/
+double outgoing_tx_burst(int32_t node, std::vector<PACKET_BYTE>& packet)
 {
-    std::mutex transmit_queue_lock;
-    std::unique_lock<std::mutex> locker(transmit_queue_lock);
+    double next_data_time = 0.;
+    // FEC may be changed by request at any time, so the whole burst works from one copy
+    fec_setting setting = fec.load();
+
+    // Combined rate of the channels the burst may go out on
+    double rate = 0.;
+    for (uint16_t channel : stripe_set(setting))
+    {
+        send_channel[channel].pacer_lock.lock();
+        rate += send_channel[channel].pacer.rate;
+        send_channel[channel].pacer_lock.unlock();
+    }
+
+    PACKET_TX_ID_TYPE  tx_id = check_tx_id(txq[node].outgoing.progress, txq[node].outgoing.id);
+    // Queue a burst of DATA packets per wake up; the channel pacer spaces them out
+    for (uint16_t burst=0; tx_id > 0 && burst<TRANSFER_BURST; ++burst)
+    {
+        if (txq[node].outgoing.progress[tx_id].file_info.size())
+        {
+            if (txq[node].outgoing.progress[tx_id].fp == nullptr)
+            {
+                txq[node].outgoing.progress[tx_id].fp = fopen(txq[node].outgoing.progress[tx_id].filepath.c_str(), "r");
+            }
+
+            if(txq[node].outgoing.progress[tx_id].fp != nullptr)
+            {
+                file_progress tp;
+                tp.chunk_start = txq[node].outgoing.progress[tx_id].file_info.begin()->first;
+                tp.chunk_end = txq[node].outgoing.progress[tx_id].file_info.begin()->second;
+                bool lastchunk = true;
+                bool sent = false;
+
+                PACKET_FILE_SIZE_TYPE byte_count = (tp.chunk_end - tp.chunk_start) + 1;
+                uint16_t channel = stripe_channel(setting);
+                PACKET_CHUNK_SIZE_TYPE chunk_size = send_channel[channel].packet_size;
+                if (setting.data)
+                {
+                    // Leave room for the larger FEC header, so parity chunks are the same size
+                    chunk_size -= PACKET_FEC_HEADER_SIZE - PACKET_DATA_HEADER_SIZE;
+                }
+                if (byte_count > chunk_size)
+                {
+                    byte_count = chunk_size;
+                }
+
+                if (byte_count < (tp.chunk_end - tp.chunk_start) + 1)
+                {
+                    tp.chunk_end = tp.chunk_start + byte_count - 1;
+                    lastchunk = false;
+                }
+
+                // See if we know what the remote node_id is for this
+                int32_t remote_node = lookup_remote_node_id(node);
+
+                // Read the chunk straight in to the packet and send it
+                PACKET_BYTE* chunk = make_data_header(packet, remote_node >= 0 ? remote_node : 0, txq[node].outgoing.progress[tx_id].tx_id, byte_count, tp.chunk_start);
+                int32_t nbytes = file_read_at(txq[node].outgoing.progress[tx_id].fp, chunk, byte_count, tp.chunk_start);
+                if (nbytes == (int32_t)byte_count)
+                {
+                    if (remote_node >= 0)
+                    {
+                        queuesendto("tx", channel, packet);
+                        next_data_time += (28. + PACKET_DATA_HEADER_SIZE + byte_count) / (86400. * rate);
+                        del_chunk(txq[node].outgoing.progress[tx_id].file_info, tp);
+                        sent = true;
+
+                        transfer_stats& stats = txq[node].outgoing.progress[tx_id].stats;
+                        ++stats.packets;
+                        stats.bytes += byte_count;
+                        stats.last_mjd = currentmjd();
+
+                        // Follow each group with its parity the first time through
+                        PACKET_FILE_SIZE_TYPE group_bytes = (PACKET_FILE_SIZE_TYPE)setting.data * chunk_size;
+                        if (setting.data && setting.parity && tp.chunk_end + 1 > stats.high_bytes && ((tp.chunk_end + 1) % group_bytes == 0 || tp.chunk_end + 1 == txq[node].outgoing.progress[tx_id].file_size))
+                        {
+                            next_data_time += outgoing_fec_send(node, tx_id, remote_node, (tp.chunk_end / group_bytes) * group_bytes, chunk_size, setting);
+                        }
+                        if (tp.chunk_end + 1 > stats.high_bytes)
+                        {
+                            stats.high_bytes = tp.chunk_end + 1;
+                        }
+                    }
+                }
+                else
+                {
+                    // Some problem with this transmission, ask other end to dequeue it
+                    // Remove transaction
+                    outgoing_tx_del(node, tx_id);
+
+                    if (remote_node >= 0)
+                    {
+                        // Send a CANCEL packet
+                        std::vector<PACKET_BYTE> packet;
+                        make_cancel_packet(packet, remote_node, tx_id);
+                        queuesendto("tx", use_channel, packet);
+                    }
+                    break;
+                }
+
+                if (sent && lastchunk)
+                {
+                    // All done with this file_info entry. Close file.
+                    fclose(txq[node].outgoing.progress[tx_id].fp);
+                    txq[node].outgoing.progress[tx_id].fp = nullptr;
+                }
+
+                write_meta(txq[node].outgoing.progress[tx_id]);
+                if (!sent)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                // Some problem with this transmission, ask other end to dequeue it
+                outgoing_tx_del(node, tx_id);
+
+                int32_t remote_node = lookup_remote_node_id(node);
+                if (remote_node >= 0)
+                {
+                    // Send a CANCEL packet
+                    std::vector<PACKET_BYTE> packet;
+                    make_cancel_packet(packet, remote_node, tx_id);
+                    queuesendto("tx", use_channel, packet);
+                }
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return next_data_time;
+}
+
+//! Channels to stripe DATA across
+/*! \param setting FEC setting in use.
+ * \return Indexes in ::send_channel that DATA packets may go out on: every open channel when
+ * ::stripe_channels is set, otherwise just ::use_channel. FEC groups need equal sized chunks, so
+ * striping is off while FEC is in use.
+*/
+std::vector<uint16_t> stripe_set(fec_setting setting)
+{
+    std::vector<uint16_t> stripe;
+    if (stripe_channels && !setting.data)
+    {
+        for (uint16_t i=0; i<send_channels; ++i)
+        {
+            stripe.push_back(i);
+        }
+    }
+    else
+    {
+        stripe.push_back(use_channel);
+    }
+    return stripe;
+}
+
+//! Choose the channel for the next DATA packet
+/*! Pick the channel in ::stripe_set that would finish sending a full packet soonest, given
+ * what is already waiting in its queue and its current pacing rate. Channels therefore carry
+ * data in proportion to their measured throughput, and a channel that backs up is passed over
+ * until it drains.
+    \param setting FEC setting in use.
+    \return Index in ::send_channel.
+*/
+uint16_t stripe_channel(fec_setting setting)
+{
+    uint16_t best = use_channel;
+    double best_time = 0.;
+    for (uint16_t channel : stripe_set(setting))
+    {
+        send_channel[channel].transmit_queue_lock.lock();
+        double bytes = send_channel[channel].queued_bytes + 28. + PACKET_DATA_HEADER_SIZE + send_channel[channel].packet_size;
+        send_channel[channel].transmit_queue_lock.unlock();
+        send_channel[channel].pacer_lock.lock();
+        double wait = bytes / send_channel[channel].pacer.rate;
+        send_channel[channel].pacer_lock.unlock();
+        if (best_time == 0. || wait < best_time)
+        {
+            best = channel;
+            best_time = wait;
+        }
+    }
+    return best;
+}
+
+void transmit_loop(uint16_t channel)
+{
+    sendchannelstruc& chan = send_channel[channel];
+    std::unique_lock<std::mutex> locker(chan.transmit_queue_lock);
+    std::vector<std::vector<PACKET_BYTE>> packets(TRANSFER_BURST);
+    std::vector<std::string> types(TRANSFER_BURST);
 
     while (agent->running())
     {
         if (agent->running() == (uint16_t)Agent::State::IDLE)
         {
+            locker.unlock();
             COSMOS_SLEEP(1);
+            locker.lock();
             continue;
         }
 
+        chan.transmit_queue_check.wait_for(locker, std::chrono::seconds(1), [&chan] { return !chan.transmit_queue.empty() || !agent->running(); });
 
-        transmit_queue_check.wait(locker);
-
-        while (!transmit_queue.empty())
+        while (!chan.transmit_queue.empty())
         {
-            // Get next packet from transceiver FIFO
-            transmit_queue_entry entry = transmit_queue.front();
-            transmit_queue.pop();
-            mysendto(entry.type, send_channel[entry.channel], entry.packet);
+            // Take as many packets from the transceiver FIFO as the pacer will let out now, at
+            // least one, and send them together without holding the queue
+            chan.pacer_lock.lock();
+            pacer_delay(chan.pacer, 0);
+            double tokens = chan.pacer.tokens;
+            chan.pacer_lock.unlock();
+            size_t count = 0;
+            size_t bytes = 0;
+            while (count < TRANSFER_BURST && !chan.transmit_queue.empty())
+            {
+                size_t size = 28 + chan.transmit_queue.front().packet.size();
+                if (count && bytes + size > tokens)
+                {
+                    break;
+                }
+                packets[count].swap(chan.transmit_queue.front().packet);
+                types[count].swap(chan.transmit_queue.front().type);
+                chan.transmit_queue.pop();
+                bytes += size;
+                ++count;
+            }
+            locker.unlock();
+            mysendto(types, chan, packets, count);
+            locker.lock();
+
+            for (size_t i=0; i<count; ++i)
+            {
+                chan.queued_bytes -= packets[i].size();
+                if (chan.transmit_pool.size() < TRANSMIT_POOL_SIZE)
+                {
+                    chan.transmit_pool.push_back(std::vector<PACKET_BYTE>());
+                    chan.transmit_pool.back().swap(packets[i]);
+                }
+            }
         }
     }
 }
 
-double queuesendto(std::string type, uint16_t channel, std::vector<PACKET_BYTE> packet)
+//! Queue a packet for a channel's transmit_loop
+/*! The packet is moved in to the channel's queue rather than copied. On return, packet has been
+ * swapped for an empty buffer from the channel's transmit_pool, so the caller can build the next
+ * packet in it without reallocating.
+    \param type Direction label used in debug output.
+    \param channel Index of channel in ::send_channel.
+    \param packet Packet to send; cleared on return.
+    \return Time needed to send the packet at the current pacing rate, in days.
+*/
+double queuesendto(const std::string& type, uint16_t channel, std::vector<PACKET_BYTE>& packet)
 {
-    transmit_queue_entry tentry;
-
-    tentry.type = type;
-    tentry.channel = channel;
-    tentry.packet = packet;
-    transmit_queue.push(tentry);
-    transmit_queue_check.notify_one();
-    double time_step = packet.size() / (86400. * send_channel[channel].throughput);
+    size_t packet_size = packet.size();
+
+    sendchannelstruc& chan = send_channel[channel];
+    {
+        std::lock_guard<std::mutex> locker(chan.transmit_queue_lock);
+        chan.transmit_queue.push(transmit_queue_entry());
+        chan.transmit_queue.back().type = type;
+        chan.transmit_queue.back().channel = channel;
+        chan.transmit_queue.back().packet.swap(packet);
+        chan.queued_bytes += packet_size;
+        if (chan.transmit_pool.size())
+        {
+            packet.swap(chan.transmit_pool.back());
+            chan.transmit_pool.pop_back();
+        }
+    }
+    packet.clear();
+    chan.transmit_queue_check.notify_one();
+
+    chan.pacer_lock.lock();
+    double rate = chan.pacer.rate;
+    chan.pacer_lock.unlock();
+    double time_step = (28 + packet_size) / (86400. * rate);
     if (time_step > 0)
     {
         return time_step;
@@ -1188,49 +1347,77 @@ double queuesendto(std::string type, uint16_t channel, std::vector<PACKET_BYTE>
     }
 }
 
-int32_t mysendto(std::string type, sendchannelstruc& channel, std::vector<PACKET_BYTE>& buf)
+//! Send packets on a channel
+/*! Wait until the channel pacer has room for all of the packets, then send them with one
+ * system call where possible.
+    \param types Direction label of each packet, used in debug output.
+    \param channel Channel to send on.
+    \param bufs Packets to send.
+    \param count Number of packets in bufs to send.
+    \return Number of packets sent, or negative error.
+*/
+int32_t mysendto(const std::vector<std::string>& types, sendchannelstruc& channel, std::vector<std::vector<PACKET_BYTE>>& bufs, size_t count)
 {
     int32_t iretn;
-    double cmjd;
+    size_t bytes = 0;
+    for (size_t i=0; i<count; ++i)
+    {
+        bytes += 28 + bufs[i].size();
+    }
 
-    if ((cmjd = currentmjd(0.)) < channel.nmjd)
+    // Wait for the token bucket
+    channel.pacer_lock.lock();
+    double delay = pacer_delay(channel.pacer, bytes);
+    channel.pacer_lock.unlock();
+    if (delay > 0.)
     {
-        COSMOS_USLEEP((uint32_t)(86400000000. * (channel.nmjd - cmjd)));
+        COSMOS_USLEEP((uint32_t)(1e6 * delay));
     }
 
-    iretn = sendto(channel.sendchan.cudp, (const char*)&buf[0], buf.size(), 0, (struct sockaddr*) &channel.sendchan.caddr, sizeof(struct sockaddr_in));
+    iretn = socket_sendto(channel.sendchan, channel.send_batch, bufs, count);
 
     if (iretn >= 0)
     {
-        channel.nmjd = currentmjd() + ((28+iretn) / (float)channel.throughput)/86400.;
-        debug_packet(buf, type+" out");
-    }
-    else
-    {
-        iretn = -errno;
+        bytes = 0;
+        for (int32_t i=0; i<iretn; ++i)
+        {
+            bytes += 28 + bufs[i].size();
+            if (debug_flag)
+            {
+                debug_packet(bufs[i], types[i]+" out");
+            }
+        }
+        channel.pacer_lock.lock();
+        pacer_delay(channel.pacer, 0);
+        pacer_consume(channel.pacer, bytes);
+        channel.pacer_lock.unlock();
     }
 
     return iretn;
 }
 
-int32_t myrecvfrom(std::string type, socket_channel channel, std::vector<PACKET_BYTE>& buf, uint32_t length)
+int32_t myrecvfrom(const std::string& type, socket_channel& channel, std::vector<PACKET_BYTE>& buf, uint32_t length)
 {
     int32_t nbytes;
 
-    buf.resize(length);
-    if (( nbytes = recvfrom(channel.cudp, (char *)&buf[0], length, 0, (struct sockaddr*) NULL, (socklen_t *)NULL)) > 0)
+    // Take whatever has arrived with one system call, then hand it out a packet at a time. Only
+    // recv_loop calls this, so the batch can persist between calls.
+    static socket_batch batch;
+    if (batch.maxlen < length)
     {
-        buf.resize(nbytes);
-        debug_packet(buf, type+" in");
+        socket_batch_init(batch, SOCKET_BATCH_COUNT, length);
     }
-    else
+    if (( nbytes = socket_recvfrom(channel, batch, buf)) > 0)
     {
-        nbytes = -errno;
+        if (debug_flag)
+        {
+            debug_packet(buf, type+" in");
+        }
     }
     return nbytes;
 }
 
-void debug_packet(std::vector<PACKET_BYTE> buf, std::string type)
+void debug_packet(const std::vector<PACKET_BYTE>& buf, const std::string& type)
 {
     if (debug_flag)
     {
@@ -1308,8 +1495,11 @@ int32_t write_meta(tx_progress& tx)
         file_name.write((char *)&packet[0], PACKET_METALONG_SIZE);
         crc = slip_calc_crc((uint8_t *)&packet[0], PACKET_METALONG_SIZE);
         file_name.write((char *)&crc, 2);
-        for (file_progress progress_info : tx.file_info)
+        for (const std::pair<const PACKET_FILE_SIZE_TYPE, PACKET_FILE_SIZE_TYPE>& chunk : tx.file_info)
         {
+            file_progress progress_info;
+            progress_info.chunk_start = chunk.first;
+            progress_info.chunk_end = chunk.second;
             file_name.write((const char *)&progress_info, sizeof(progress_info));
             crc = slip_calc_crc((uint8_t *)&progress_info, sizeof(progress_info));
             file_name.write((char *)&crc, 2);
@@ -1392,7 +1582,7 @@ int32_t read_meta(tx_progress& tx)
             return DATA_ERROR_CRC;
         }
 
-        tx.file_info.push_back(progress_info);
+        add_chunk(tx.file_info, progress_info);
     } while(!file_name.eof());
     file_name.close();
     if (debug_flag)
@@ -1412,102 +1602,17 @@ int32_t read_meta(tx_progress& tx)
     return 0;
 }
 
-bool lower_chunk(file_progress i,file_progress j)
-{
-    return (i.chunk_start<j.chunk_start);
-}
-
 PACKET_FILE_SIZE_TYPE merge_chunks_overlap(tx_progress& tx)
 {
-    switch (tx.file_info.size())
-    {
-    case 0:
-        {
-            tx.total_bytes = 0;
-            break;
-        }
-    case 1:
-        {
-            tx.total_bytes = (tx.file_info[0].chunk_end - tx.file_info[0].chunk_start) + 1;
-            break;
-        }
-    default:
-        {
-            tx.total_bytes = 0;
-            sort(tx.file_info.begin(), tx.file_info.end(), lower_chunk);
-            for (uint32_t i=0; i<tx.file_info.size(); ++i)
-            {
-                for (uint32_t j=i+1; j<tx.file_info.size(); ++j)
-                {
-                    while (j < tx.file_info.size() && tx.file_info[j].chunk_start <= tx.file_info[i].chunk_end+1)
-                    {
-                        if (tx.file_info[j].chunk_end > tx.file_info[i].chunk_end)
-                        {
-                            tx.file_info[i].chunk_end = tx.file_info[j].chunk_end;
-                        }
-                        tx.file_info.erase(tx.file_info.begin()+j);
-                    }
-                }
-                tx.total_bytes += (tx.file_info[i].chunk_end - tx.file_info[i].chunk_start) + 1;
-            }
-            break;
-        }
-    }
+    // file_info is kept merged as it is built, so only the count needs refreshing
+    tx.total_bytes = total_chunks(tx.file_info);
     return tx.total_bytes;
 }
 
 std::vector<file_progress> find_chunks_missing(tx_progress& tx)
 {
-    std::vector<file_progress> missing;
-    file_progress tp;
-
-    if (tx.file_info.size() == 0)
-    {
-        tp.chunk_start = 0;
-        tp.chunk_end = tx.file_size - 1;
-        missing.push_back(tp);
-    }
-    else
-    {
-        merge_chunks_overlap(tx);
-        sort(tx.file_info.begin(), tx.file_info.end(), lower_chunk);
-
-        // Check missing before first chunk
-        if (tx.file_info[0].chunk_start)
-        {
-            tp.chunk_start = 0;
-            tp.chunk_end = tx.file_info[0].chunk_start - 1;
-            missing.push_back(tp);
-        }
-
-        // Check missing between chunks
-        for (uint32_t i=1; i<tx.file_info.size(); ++i)
-        {
-            if (tx.file_info[i-1].chunk_end+1 != tx.file_info[i].chunk_start)
-            {
-                tp.chunk_start = tx.file_info[i-1].chunk_end + 1;
-                tp.chunk_end = tx.file_info[i].chunk_start - 1;
-                missing.push_back(tp);
-            }
-        }
-
-        // Check missing after last chunk
-        if (tx.file_info[tx.file_info.size()-1].chunk_end + 1 != tx.file_size)
-        {
-            tp.chunk_start = tx.file_info[tx.file_info.size()-1].chunk_end + 1;
-            tp.chunk_end = tx.file_size - 1;
-            missing.push_back(tp);
-        }
-    }
-
-    // calculate bytes so far
-    tx.total_bytes = 0;
-    for (file_progress prog : tx.file_info)
-    {
-        tx.total_bytes += (prog.chunk_end - prog.chunk_start) + 1;
-    }
-
-    return (missing);
+    merge_chunks_overlap(tx);
+    return find_chunks_missing(tx.file_info, tx.file_size);
 }
 
 int32_t request_ls(char* request, char* response, Agent *agent)
@@ -1546,7 +1651,7 @@ int32_t request_list_incoming(char* request, char* response, Agent *agent)
     for (uint16_t node = 0; node<txq.size(); ++node)
     {
         sprintf(&response[strlen(response)], "%u %s %u\n", node, txq[node].node_name.c_str(), txq[node].incoming.size);
-        for(tx_progress tx : txq[node].incoming.progress)
+        for(const tx_progress& tx : txq[node].incoming.progress)
         {
             if (tx.tx_id)
             {
@@ -1564,7 +1669,7 @@ int32_t request_list_outgoing(char* request, char* response, Agent *agent)
     for (uint16_t node=0; node<txq.size(); ++node)
     {
         sprintf(&response[strlen(response)], "%u %s %u\n", node, txq[node].node_name.c_str(), txq[node].outgoing.size);
-        for(tx_progress tx : txq[node].outgoing.progress)
+        for(const tx_progress& tx : txq[node].outgoing.progress)
         {
             if (tx.tx_id)
             {
@@ -1576,6 +1681,87 @@ int32_t request_list_outgoing(char* request, char* response, Agent *agent)
     return 0;
 }
 
+// Append to a request response, keeping within the response buffer and leaving room for the
+// [OK] that Agent adds after it. Once the buffer is full, the response is left cut short at the
+// last whole line and false is returned.
+static bool response_append(char *response, size_t &used, const char *format, ...)
+{
+    const size_t size = AGENTMAXBUFFER - 4;
+    if (used >= size)
+    {
+        return false;
+    }
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(&response[used], size - used, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= size - used)
+    {
+        response[used] = 0;
+        used = size;
+        return false;
+    }
+    used += length;
+    return true;
+}
+
+int32_t request_transfer_stats(char* request, char* response, Agent *agent)
+{
+    response[0] = 0;
+    size_t used = 0;
+    for (uint16_t i=0; i<send_channels; ++i)
+    {
+        send_channel[i].transmit_queue_lock.lock();
+        size_t queued_bytes = send_channel[i].queued_bytes;
+        send_channel[i].transmit_queue_lock.unlock();
+        send_channel[i].pacer_lock.lock();
+        bool room = response_append(response, used, "channel: %u rate: %.0f/%.0f-%.0f B/s queued: %zu bytes%s\n", i, send_channel[i].pacer.rate, send_channel[i].pacer.min_rate, send_channel[i].pacer.max_rate, queued_bytes, i==use_channel?" (in use)":"");
+        send_channel[i].pacer_lock.unlock();
+        if (!room)
+        {
+            return 0;
+        }
+    }
+
+    double cmjd = currentmjd();
+    for (uint16_t node=0; node<txq.size(); ++node)
+    {
+        for (uint16_t direction=0; direction<2; ++direction)
+        {
+            std::lock_guard<std::mutex> locker(direction ? incoming_tx_lock : outgoing_tx_lock);
+            for (const tx_progress& tx : direction ? txq[node].incoming.progress : txq[node].outgoing.progress)
+            {
+                if (tx.tx_id)
+                {
+                    double seconds = 86400. * ((tx.stats.last_mjd > tx.stats.start_mjd ? tx.stats.last_mjd : cmjd) - tx.stats.start_mjd);
+                    if (!response_append(response, used, "%s node: %s tx_id: %u name: %s packets: %u bytes: %u/%u repeat: %.1f%% rate: %.0f B/s\n", direction?"in":"out", txq[node].node_name.c_str(), tx.tx_id, tx.file_name.c_str(), tx.stats.packets, tx.stats.bytes, tx.file_size, tx.stats.bytes?(100. * tx.stats.repeat_bytes) / tx.stats.bytes:0., seconds>0.?tx.stats.bytes / seconds:0.))
+                    {
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int32_t request_stripe(char* request, char* response, Agent *agent)
+{
+    uint16_t stripe;
+
+    if (sscanf(request, "%*s %hu", &stripe) == 1)
+    {
+        stripe_channels = stripe != 0;
+    }
+    sprintf(response, "stripe: %u channels:", stripe_channels);
+    for (uint16_t channel : stripe_set(fec.load()))
+    {
+        sprintf(&response[strlen(response)], " %u", channel);
+    }
+    return 0;
+}
+
 int32_t request_use_channel(char* request, char* response, Agent *agent)
 {
     uint16_t channel;
@@ -1664,6 +1850,8 @@ int32_t outgoing_tx_add(tx_progress tx_out)
     tx_out.file_size = get_file_size(tx_out.filepath);
     tx_out.temppath = data_base_path(tx_out.node_name, "temp", "file", "out_"+std::to_string(tx_out.tx_id));
     tx_out.savetime = 0.;
+    tx_out.stats = transfer_stats();
+    tx_out.stats.start_mjd = currentmjd();
 
     // save and queue metadata packet
     //	tx_out.sendcomplete = false;
@@ -1822,6 +2010,8 @@ int32_t incoming_tx_add(tx_progress tx_in)
     tx_in.temppath = data_base_path(tx_in.node_name, "temp", "file", tx_name);
     tx_in.savetime = 0.;
     tx_in.fp = nullptr;
+    tx_in.stats = transfer_stats();
+    tx_in.stats.start_mjd = currentmjd();
 
     // Put it in list
     txq[node].incoming.progress[tx_in.tx_id] = tx_in;
@@ -1986,7 +2176,7 @@ PACKET_TX_ID_TYPE choose_incoming_tx_id(int32_t node)
     return tx_id;
 }
 
-PACKET_TX_ID_TYPE check_tx_id(std::vector<tx_progress> tx_entry, PACKET_TX_ID_TYPE tx_id)
+PACKET_TX_ID_TYPE check_tx_id(const std::vector<tx_progress>& tx_entry, PACKET_TX_ID_TYPE tx_id)
 {
     if (tx_id != 0 && tx_entry[tx_id].tx_id == tx_id)
     {
@@ -2062,7 +2252,7 @@ int32_t next_incoming_tx(PACKET_NODE_ID_TYPE node)
             // Check if file has been completely received
             if(txq[node].incoming.progress[tx_id].file_size == txq[node].incoming.progress[tx_id].total_bytes && txq[node].incoming.progress[tx_id].havemeta)
             {
-                tx_progress tx_in = txq[node].incoming.progress[tx_id];
+                const tx_progress& tx_in = txq[node].incoming.progress[tx_id];
 
                 // inform other end that file has been received
                 std::vector<PACKET_BYTE> packet;
@@ -2099,6 +2289,228 @@ int32_t next_incoming_tx(PACKET_NODE_ID_TYPE node)
     return tx_id;
 }
 
+//! Rebuild FEC group
+/*! Find the group waiting on parity that holds a file offset and, if enough of its data and
+ * parity has arrived, rebuild the missing chunks and write them to the partial file.
+    \param tx Incoming transfer.
+    \param offset Any offset in the group.
+    \return Number of chunks rebuilt, 0 if the group is still waiting, or negative error.
+*/
+int32_t incoming_fec_rebuild(tx_progress& tx, PACKET_FILE_SIZE_TYPE offset)
+{
+    fec_group_set::iterator it = tx.fec.upper_bound(offset);
+    if (it == tx.fec.begin())
+    {
+        return 0;
+    }
+    --it;
+    PACKET_FILE_SIZE_TYPE group_start = it->first;
+    fec_group& group = it->second;
+    if (offset >= group_start + (PACKET_FILE_SIZE_TYPE)group.group_count * group.byte_count)
+    {
+        return 0;
+    }
+
+    std::vector<bool> have = fec_group_have(tx.file_info, group_start, group.byte_count, group.group_count, tx.file_size);
+    size_t missing = std::count(have.begin(), have.end(), false);
+    if (missing == 0)
+    {
+        tx.fec.erase(it);
+        return 0;
+    }
+    if (group.index.size() < missing)
+    {
+        return 0;
+    }
+
+    if (tx.fp == nullptr)
+    {
+        std::string partial_filepath = tx.temppath + ".file";
+        tx.fp = fopen(partial_filepath.c_str(), "w+");
+        if (tx.fp == nullptr)
+        {
+            return -errno;
+        }
+    }
+
+    // Read back what we have of the group, then fill in the rest
+    std::vector<PACKET_BYTE> data((size_t)group.group_count * group.byte_count, 0);
+    for (uint16_t i=0; i<group.group_count; ++i)
+    {
+        PACKET_FILE_SIZE_TYPE start = group_start + (PACKET_FILE_SIZE_TYPE)i * group.byte_count;
+        if (have[i] && start < tx.file_size)
+        {
+            size_t count = std::min((PACKET_FILE_SIZE_TYPE)group.byte_count, tx.file_size - start);
+            int32_t nbytes = file_read_at(tx.fp, &data[(size_t)i * group.byte_count], count, start);
+            if (nbytes != (int32_t)count)
+            {
+                return nbytes < 0 ? nbytes : GENERAL_ERROR_OPEN;
+            }
+        }
+    }
+
+    int32_t iretn = fec_decode(group.group_count, group.byte_count, data.data(), have, group.index, group.parity.data());
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+
+    for (uint16_t i=0; i<group.group_count; ++i)
+    {
+        PACKET_FILE_SIZE_TYPE start = group_start + (PACKET_FILE_SIZE_TYPE)i * group.byte_count;
+        if (!have[i] && start < tx.file_size)
+        {
+            file_progress tp;
+            tp.chunk_start = start;
+            tp.chunk_end = std::min(start + group.byte_count, tx.file_size) - 1;
+            int32_t nbytes = file_write_at(tx.fp, &data[(size_t)i * group.byte_count], (tp.chunk_end - tp.chunk_start) + 1, start);
+            if (nbytes < 0)
+            {
+                return nbytes;
+            }
+            tx.total_bytes += add_chunk(tx.file_info, tp);
+        }
+    }
+    write_meta(tx);
+    tx.fec.erase(it);
+
+    if (debug_flag)
+    {
+        printf("FEC rebuilt %d chunks of group %u in tx_id: %u\n", iretn, group_start, tx.tx_id);
+    }
+
+    return iretn;
+}
+
+//! Read from a file at an offset
+/*! Read straight from the file descriptor with pread, without moving the file position, so
+ * chunks can be read in any order. Where pread is not available, seek and read instead.
+    \param fp Open file.
+    \param buffer Buffer to read in to.
+    \param count Number of bytes to read.
+    \param offset Offset in the file to read from.
+    \return Number of bytes read, or negative error.
+*/
+int32_t file_read_at(FILE *fp, void *buffer, size_t count, PACKET_FILE_SIZE_TYPE offset)
+{
+#ifdef COSMOS_WIN_OS
+    if (fseek(fp, offset, SEEK_SET) != 0)
+    {
+        return -errno;
+    }
+    size_t nbytes = fread(buffer, 1, count, fp);
+    if (nbytes < count && ferror(fp))
+    {
+        clearerr(fp);
+        return GENERAL_ERROR_OPEN;
+    }
+    return nbytes;
+#else
+    ssize_t nbytes = pread(fileno(fp), buffer, count, offset);
+    if (nbytes < 0)
+    {
+        return -errno;
+    }
+    return nbytes;
+#endif
+}
+
+//! Write to a file at an offset
+/*! Write straight to the file descriptor with pwrite, without moving the file position, so
+ * chunks can be written in the order they arrive. Where pwrite is not available, seek and write
+ * instead.
+    \param fp Open file.
+    \param buffer Bytes to write.
+    \param count Number of bytes to write.
+    \param offset Offset in the file to write at.
+    \return Number of bytes written, or negative error.
+*/
+int32_t file_write_at(FILE *fp, const void *buffer, size_t count, PACKET_FILE_SIZE_TYPE offset)
+{
+#ifdef COSMOS_WIN_OS
+    if (fseek(fp, offset, SEEK_SET) != 0)
+    {
+        return -errno;
+    }
+    size_t nbytes = fwrite(buffer, 1, count, fp);
+    if (nbytes < count)
+    {
+        clearerr(fp);
+        return GENERAL_ERROR_OPEN;
+    }
+    fflush(fp);
+    return nbytes;
+#else
+    ssize_t nbytes = pwrite(fileno(fp), buffer, count, offset);
+    if (nbytes < 0)
+    {
+        return -errno;
+    }
+    return nbytes;
+#endif
+}
+
+//! Send FEC parity for a group
+/*! Read a group of chunks back from the file being sent and queue its parity packets.
+    \param node Index of node in ::txq.
+    \param tx_id Outgoing transfer.
+    \param remote_node Node id the other end knows us by.
+    \param group_start File offset of the group.
+    \param chunk_size Size of each chunk.
+    \param setting FEC setting the group was sent with: chunks in the group, and parity to send.
+    \return Time needed to send the parity, in days, as for ::queuesendto.
+*/
+double outgoing_fec_send(int32_t node, PACKET_TX_ID_TYPE tx_id, int32_t remote_node, PACKET_FILE_SIZE_TYPE group_start, PACKET_CHUNK_SIZE_TYPE chunk_size, fec_setting setting)
+{
+    tx_progress& tx = txq[node].outgoing.progress[tx_id];
+    PACKET_FILE_SIZE_TYPE group_end = std::min(group_start + (PACKET_FILE_SIZE_TYPE)setting.data * chunk_size, tx.file_size);
+    if (tx.fp == nullptr || group_end <= group_start)
+    {
+        return 0.;
+    }
+    uint16_t group_count = (group_end - group_start + chunk_size - 1) / chunk_size;
+
+    std::vector<PACKET_BYTE> data((size_t)group_count * chunk_size, 0);
+    if (file_read_at(tx.fp, data.data(), group_end - group_start, group_start) != (int32_t)(group_end - group_start))
+    {
+        return 0.;
+    }
+
+    double send_time = 0.;
+    std::vector<PACKET_BYTE> parity(chunk_size);
+    std::vector<PACKET_BYTE> packet;
+    for (uint16_t j=0; j<setting.parity; ++j)
+    {
+        if (fec_encode(group_count, chunk_size, data.data(), j, parity.data()) < 0)
+        {
+            break;
+        }
+        make_fec_packet(packet, remote_node, tx.tx_id, chunk_size, group_start, group_count, j, parity.data());
+        send_time += queuesendto("tx", use_channel, packet);
+    }
+
+    return send_time;
+}
+
+int32_t request_fec(char* request, char* response, Agent *agent)
+{
+    uint16_t data;
+    uint16_t parity;
+
+    if (sscanf(request, "%*s %hu %hu", &data, &parity) == 2)
+    {
+        if (data + parity >= 256 || (data == 0 && parity != 0))
+        {
+            sprintf(response, "Need data_chunks + parity_chunks < 256");
+            return 0;
+        }
+        fec.store(fec_setting{data, parity});
+    }
+    fec_setting setting = fec.load();
+    sprintf(response, "fec: %u data %u parity (%.0f%% overhead)", setting.data, setting.parity, setting.data ? (100. * setting.parity) / setting.data : 0.);
+    return 0;
+}
+
 int32_t request_debug(char *request, char *response, Agent *agent)
 {
 
@@ -152,12 +152,14 @@ void incoming_thread()
     //	int32_t iretn;
     int32_t nbytes;
     int32_t iretn;
-    vector <uint8_t> input;
+    uint8_t *input;
+    socket_batch batch;
+    socket_batch_init(batch, SOCKET_BATCH_COUNT, AGENTMAXBUFFER);
 
     while(agent->running())
     {
         //        if ((nbytes = recvfrom(rcvchan.cudp,input,AGENTMAXBUFFER,0,(struct sockaddr *)&rcvchan.caddr,(socklen_t *)&rcvchan.addrlen)) > 0)
-        if ((nbytes = socket_recvfrom(rcvchan, input, AGENTMAXBUFFER, 0)) > 0)
+        if ((nbytes = socket_recvfrom(rcvchan, batch, input)) > 0)
         {
             // New forwarder? Add to forwarding list
             bool found = false;
@@ -196,7 +198,7 @@ void incoming_thread()
 
             for (size_t i=0; i<agent->cinfo->pdata.agent[0].ifcnt; ++i)
             {
-                sendto(agent->cinfo->pdata.agent[0].pub[i].cudp, (const char *)input.data(), nbytes, 0, (struct sockaddr *)&agent->cinfo->pdata.agent[0].pub[i].caddr, sizeof(struct sockaddr_in));
+                sendto(agent->cinfo->pdata.agent[0].pub[i].cudp, (const char *)input, nbytes, 0, (struct sockaddr *)&agent->cinfo->pdata.agent[0].pub[i].caddr, sizeof(struct sockaddr_in));
             }
         }
     }
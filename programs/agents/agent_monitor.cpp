@@ -110,6 +110,8 @@ int waitsec = 5;
 
 void collect_data_loop();
 thread cdthread;
+// Node and devices as last collected, for the main loop
+json_snapshot snapshot;
 
 string logstring;
 vector<jsonentry*> logtable;
@@ -219,6 +221,8 @@ int main(int argc, char *argv[])
     load_dictionary(eventdict, agent->cinfo->meta, agent->cinfo->pdata, (const char *)"events.dict");
 
     // Start thread to collect SOH data
+    json_snapshot_init(snapshot, agent->cinfo->pdata);
+    agent->snapshot = &snapshot;
     cdthread = thread(collect_data_loop);
 
     // Start performing the body of the agent
@@ -227,6 +231,7 @@ int main(int argc, char *argv[])
     while(agent->running())
     {
         nextmjd += agent->cinfo->pdata.agent[0].aprd/86400.;
+        json_snapshot_acquire(snapshot, agent->cinfo->meta, agent->cinfo->pdata);
         dmjd = (cmjd-lmjd)*86400.;
         agent->cinfo->pdata.node.utc = cmjd = currentmjd();
 
@@ -531,7 +536,8 @@ void collect_data_loop()
     size_t my_position = -1;
     while (agent->running())
     {
-        // Collect new data
+        // Collect new data, and values set by request, in to the secondary, then publish it all at once
+        bool updated = json_snapshot_take(snapshot, agent->cinfo->meta, agent->cinfo->sdata) > 0;
         while (my_position != agent->message_head)
         {
             ++my_position;
@@ -539,24 +545,26 @@ void collect_data_loop()
             {
                 my_position = 0;
             }
-            if (agent->cinfo->pdata.node.name == agent->message_ring[my_position].meta.beat.node && agent->message_ring[my_position].meta.type < Agent::AGENT_MESSAGE_BINARY)
+            if (!strcmp(agent->cinfo->sdata.node.name, agent->message_ring[my_position].meta.beat.node) && agent->message_ring[my_position].meta.type < Agent::AGENT_MESSAGE_BINARY)
             {
-                agent->cinfo->sdata.node = agent->cinfo->pdata.node;
-                agent->cinfo->sdata.device = agent->cinfo->pdata.device;
                 json_parse(agent->message_ring[my_position].adata, agent->cinfo->meta, agent->cinfo->sdata);
-                agent->cinfo->pdata.node  = agent->cinfo->sdata.node ;
-                agent->cinfo->pdata.device  = agent->cinfo->sdata.device ;
-                loc_update(&agent->cinfo->pdata.node.loc);
-                agent->cinfo->pdata.node.utc = currentmjd(0.);
+                updated = true;
+            }
+        }
 
-                for (devicestruc device: agent->cinfo->pdata.device)
+        if (updated)
+        {
+            loc_update(&agent->cinfo->sdata.node.loc);
+            agent->cinfo->sdata.node.utc = currentmjd(0.);
+
+            for (devicestruc &device: agent->cinfo->sdata.device)
+            {
+                if (device.all.gen.utc > agent->cinfo->sdata.node.utc)
                 {
-                    if (device.all.gen.utc > agent->cinfo->pdata.node.utc)
-                    {
-                        agent->cinfo->pdata.node.utc = device.all.gen.utc;
-                    }
+                    agent->cinfo->sdata.node.utc = device.all.gen.utc;
                 }
             }
+            json_snapshot_publish(snapshot, agent->cinfo->sdata);
         }
         COSMOS_SLEEP(.1);
     }
@@ -195,15 +195,9 @@ int main(int, char* argv[])
 
     total = 0;
     count = 0;
-    for (size_t i=0; i<myagent->cinfo->meta.jmap.size(); ++i)
-    {
-        for (size_t j=0; j<myagent->cinfo->meta.jmap[j].size(); ++j)
-        {
-            ++count;
-            total += COSMOS_SIZEOF(jsonentry);
-        }
-    }
-    printf("Jmap: %lu x %ld = %lu : %lu\n", count, COSMOS_SIZEOF(jsonentry), count*COSMOS_SIZEOF(jsonentry), total);
+    count = myagent->cinfo->meta.jinfo.size();
+    total += count * (COSMOS_SIZEOF(jsonentry) + COSMOS_SIZEOF(jsoninfo)) + myagent->cinfo->meta.jname.size() + myagent->cinfo->meta.jshadow.size();
+    printf("Jmap: %lu x %ld = %lu : %lu\n", count, COSMOS_SIZEOF(jsonentry) + COSMOS_SIZEOF(jsoninfo), count*(COSMOS_SIZEOF(jsonentry) + COSMOS_SIZEOF(jsoninfo)), total);
 
     count = 0;
     for (size_t i=0; i<myagent->cinfo->meta.emap.size(); ++i)
@@ -0,0 +1,80 @@
+/********************************************************************
+* Copyright (C) 2015 by Interstel Technologies, Inc.
+*   and Hawaii Space Flight Laboratory.
+*
+* This file is part of the COSMOS/core that is the central
+* module for COSMOS. For more information on COSMOS go to
+* <http://cosmos-project.com>
+*
+* The COSMOS/core software is licenced under the
+* GNU Lesser General Public License (LGPL) version 3 licence.
+*
+* You should have received a copy of the
+* GNU Lesser General Public License
+* If not, go to <http://www.gnu.org/licenses/>
+*
+* COSMOS/core is free software: you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License
+* as published by the Free Software Foundation, either version 3 of
+* the License, or (at your option) any later version.
+*
+* COSMOS/core is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* Refer to the "licences" folder for further information on the
+* condititons and terms to use this software.
+********************************************************************/
+
+// Build the Namespace image for a Node, so that its Agents start from it without first having
+// to set the Namespace up themselves.
+// Usage: namespace_image node [image]
+// The image goes in the Node directory, unless another path is given (for a Node directory that
+// will be read only in flight, for example).
+
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: namespace_image node [image]\n");
+        exit(1);
+    }
+
+    string image = argc > 2 ? argv[2] : json_image_path(argv[1]);
+    if (image.empty())
+    {
+        printf("No directory for node %s\n", argv[1]);
+        exit(1);
+    }
+
+    cosmosstruc *cinfo = json_create();
+    if (cinfo == nullptr)
+    {
+        printf("Unable to create Namespace\n");
+        exit(1);
+    }
+
+    jsonnode json;
+    int32_t iretn = json_load_node(argv[1], json);
+    if (iretn >= 0)
+    {
+        iretn = json_setup_node(json, cinfo);
+    }
+    if (iretn >= 0)
+    {
+        iretn = json_save_image(image, json_image_key(json), cinfo);
+    }
+    if (iretn < 0)
+    {
+        printf("Unable to build image for %s: %s\n", argv[1], cosmos_error_string(iretn).c_str());
+        json_destroy(cinfo);
+        exit(1);
+    }
+
+    printf("%s: %u names, %u devices, %d bytes\n", image.c_str(), cinfo->meta.jmapped, (uint32_t)cinfo->pdata.device.size(), iretn);
+    json_destroy(cinfo);
+}
@@ -42,6 +42,8 @@
  ***        - 2 arguments: any two arguments, prints results only
  ***        - After running listener, run sender to this listener's IP
  ***        - Use with script to pipe output to file.  CSV compatible.
+ ***        - "-b count" anywhere: receive up to count packets per system call
+ ***          with recvmmsg, to compare packets/second with and without batching.
  ****************************************************************************
  *** Version 1.0
  *** Target OS: Linux Only
@@ -69,6 +71,7 @@ bool debug_verbose = false;
 char address[] = "0.0.0.0";
 uint16_t port = 6101;
 uint16_t bsize = 10000;
+uint16_t batch = 1;
 
 int main(int argc, char *argv[])
 {
@@ -154,12 +157,32 @@ int main(int argc, char *argv[])
 	packet_count_dropped = 0;
 	packet_count_crc_err = 0;
 	packet_count_runt = 0;
+
+	// Strip out the batch option before looking at the rest
+	for (int i=1; i<argc-1; ++i)
+	{
+		if (!strcmp(argv[i], "-b"))
+		{
+			batch = atoi(argv[i+1]);
+			for (int j=i; j+2<argc; ++j)
+			{
+				argv[j] = argv[j+2];
+			}
+			argc -= 2;
+			break;
+		}
+	}
+	socket_batch rbatch;
+	if (batch > 1)
+	{
+		socket_batch_init(rbatch, batch, BUFSIZE - 8);
+	}
 	
 	switch(argc)
 	{
 	case 2:
 		// 1 arguments = log header only and exit
-		printf("Packet Size [bytes]\tSpeed [bytes/sec]\tRX Time[us]\tPackets Received\tPacket Drops\tPacket CRC Errors\tPacket Runts\tBytes Received\tData Rate: Min [bytes/sec]\tData Rate: Average [bytes/sec]\tData Rate: Max [bytes/sec]\tInter-Packet Delay: Min [us]\tInter-Packet Delay: Avg [us]\tInter-Packet Delay: Max [us]\n");
+		printf("Packet Size [bytes]\tSpeed [bytes/sec]\tRX Time[us]\tPackets Received\tPacket Drops\tPacket CRC Errors\tPacket Runts\tBytes Received\tData Rate: Min [bytes/sec]\tData Rate: Average [bytes/sec]\tData Rate: Max [bytes/sec]\tInter-Packet Delay: Min [us]\tInter-Packet Delay: Avg [us]\tInter-Packet Delay: Max [us]\tPackets/s\n");
 		exit(0);
 		break;
 	case 3:
@@ -182,7 +205,19 @@ int main(int argc, char *argv[])
 	while (1)
 	{
 		// UDP Receive: Check for new packet, return -1 if none
-		received = recvfrom( chan.cudp, (char *)buf1, BUFSIZE, 0, (struct sockaddr*) &chan.caddr, (socklen_t*) &fromlen);
+		if (batch > 1)
+		{
+			uint8_t *data;
+			if ((received = socket_recvfrom(chan, rbatch, data)) > 0)
+			{
+				memcpy(buf1, data, received);
+			}
+		}
+		else
+		{
+			// Leave room for the terminators added below
+			received = recvfrom( chan.cudp, (char *)buf1, BUFSIZE - 8, 0, (struct sockaddr*) &chan.caddr, (socklen_t*) &fromlen);
+		}
 		if (received < 1)
 		{
 			// If result: No new packet received
@@ -213,7 +248,7 @@ int main(int argc, char *argv[])
 				{
 					t_avg = 0;
 				}
-				printf("%.0f\t%d\t%d\t%d\t%d\t%.0f\t%.0f\n",(final_t-initial_t),packet_count,packet_count_dropped,packet_count_crc_err,data_accumulator,data_rate,t_avg);
+				printf("%.0f\t%d\t%d\t%d\t%d\t%.0f\t%.0f\t%.0f\n",(final_t-initial_t),packet_count,packet_count_dropped,packet_count_crc_err,data_accumulator,data_rate,t_avg,packet_count / ((final_t - initial_t) / 1000000));
 				
 				fflush(stdout);
 				// End Exit Report Code
@@ -27,9 +27,13 @@
 * condititons and terms to use this software.
 ********************************************************************/
 
+// Usage: netperf_send [address] [packet_size] [bytes_per_second] [packets] [delay_seconds] [batch]
+// A speed of 0 sends as fast as possible. A batch greater than 1 sends that many packets per
+// system call with sendmmsg.
 #include "agent/agentclass.h"
 #include "support/jsondef.h"
 #include "support/sliplib.h"
+#include "support/elapsedtime.h"
 
 #define INFO_SIZE 32
 
@@ -37,6 +41,7 @@ char address[20] = "127.0.0.1";
 uint16_t bsize = 1500;
 uint16_t delay = 1;
 uint16_t packets = 10000;
+uint16_t batch = 1;
 float speed = 281250.;
 double cmjd;
 
@@ -55,10 +60,17 @@ int main(int argc, char *argv[])
 	uint8_t buf1[10000];
 	char buf2[10000];
 	int32_t lsleep;
-	uint16_t nbytes;
+	uint32_t nbytes;
+	size_t nsent;
 
 	switch (argc)
 	{
+	case 7:
+		batch = atoi(argv[6]);
+		if (batch < 1)
+		{
+			batch = 1;
+		}
 	case 6:
 		delay = atoi(argv[5]);
 	case 5:
@@ -89,17 +101,26 @@ int main(int argc, char *argv[])
 		printf("Unable to open connection to [%s:6101]\n",address);
 	}
 
+	socket_batch sbatch;
+	vector<vector<uint8_t>> queued(batch);
+	size_t nqueued = 0;
+
 	COSMOS_USLEEP(delay*1000000);
+	ElapsedTime et;
 	while (count < packets)
 	{
 		cmjd = currentmjd(0.);
-		for (uint16_t i=0; i<bsize-INFO_SIZE; i++)
+		// Random payload only once when going flat out, so the test measures the network path
+		if (speed > 0. || count == 0)
 		{
+			for (uint16_t i=0; i<bsize-INFO_SIZE; i++)
+			{
 #if defined(COSMOS_WIN_OS)
-			buf1[i] = (char)rand();
+				buf1[i] = (char)rand();
 #else
-			buf1[i] = (char)random();
+				buf1[i] = (char)random();
 #endif
+			}
 		}
 
 
@@ -121,17 +142,40 @@ int main(int argc, char *argv[])
 			// Skip packet
 			error_injector_drop_counter = 100; // Error every 100 packets
 			nbytes = 0;
+			nsent = 0;
 		} 
+		else if (batch > 1)
+		{
+			// Send packets a batch at a time
+			queued[nqueued++].assign(buf2, buf2 + bsize);
+			if (nqueued == batch || count == packets)
+			{
+				iretn = socket_sendto(chan, sbatch, queued, nqueued);
+				nsent = iretn > 0 ? iretn : 0;
+				nbytes = bsize * nsent;
+				nqueued = 0;
+			}
+			else
+			{
+				continue;
+			}
+		}
 		else
 		{
 			// Send packet
 			nbytes = sendto(chan.cudp, (const char *)buf2, bsize, 0, (struct sockaddr *)&chan.caddr, sizeof(struct sockaddr_in));
+			nsent = 1;
+		}
+		if (speed > 0.)
+		{
+			lsleep =  1e6 * ((nbytes+28*nsent)/speed - 86400. * (currentmjd(0.) - cmjd));
+			if (lsleep < 0) lsleep = 0;
+			printf("[%6d: %4d] %6d\r", count, nbytes, lsleep);
+			fflush(stdout);
+			COSMOS_USLEEP(lsleep);
 		}
-		lsleep =  1e6 * ((nbytes+28)/speed - 86400. * (currentmjd(0.) - cmjd));
-		if (lsleep < 0) lsleep = 0;
-		printf("[%6d: %4d] %6d\r", count, nbytes, lsleep);
-		fflush(stdout);
-		COSMOS_USLEEP(lsleep);
 	}
 
+	double seconds = et.split();
+	printf("\n%u packets of %u bytes in %.3f s, batch %u: %.0f packets/s\n", count, bsize, seconds, batch, count / seconds);
 }
@@ -0,0 +1,172 @@
+// Idle cost and request latency of many Agents on one host, with and without the reactor
+// Usage: agentreactor [agents] [idle_seconds] [requests]
+// The Agents are started in one process, first with their message, request and heartbeat
+// threads, then each with a single reactor thread. All of them hear each other's heartbeats.
+// Threads, CPU time and context switches are counted while they sit idle, then one Agent sends
+// echo requests round the others and the latency is reported, along with how long shutdown takes.
+#include "support/configCosmos.h"
+#include "agent/agentclass.h"
+#include "support/elapsedtime.h"
+#include <sys/resource.h>
+#include <dirent.h>
+#include <algorithm>
+
+struct reactor_result
+{
+    uint32_t started;
+    uint32_t threads;
+    double cpu_percent;
+    double switches;
+    double median;
+    double worst;
+    uint32_t failed;
+    double shutdown;
+};
+
+static double cpu_seconds(struct rusage &usage)
+{
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static uint32_t thread_count()
+{
+    uint32_t count = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir != nullptr)
+    {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            if (entry->d_name[0] != '.')
+            {
+                ++count;
+            }
+        }
+        closedir(dir);
+    }
+    return count;
+}
+
+static reactor_result run(uint16_t count, double idle, uint16_t requests, bool reactor)
+{
+    reactor_result result = reactor_result();
+    std::vector<Agent *> agents(count, nullptr);
+
+    // Each Agent listens for a while to see if it is already running, so start them together
+    std::vector<std::thread> threads;
+    for (uint16_t i=0; i<count; ++i)
+    {
+        threads.push_back(std::thread([&agents, i, reactor] {
+            char name[COSMOS_MAX_NAME+1];
+            sprintf(name, "%s_%03u", reactor ? "react" : "thread", i);
+            agents[i] = new Agent("", name, 1., AGENTMAXBUFFER, false, 0, NetworkType::UDP, 0, reactor);
+        }));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+    for (Agent *agent : agents)
+    {
+        if (agent->cinfo != nullptr && agent->running())
+        {
+            ++result.started;
+        }
+    }
+
+    // Idle
+    COSMOS_SLEEP(1.);
+    result.threads = thread_count();
+    struct rusage before, after;
+    double cpu = cpu_seconds(before);
+    ElapsedTime et;
+    COSMOS_SLEEP(idle);
+    cpu = cpu_seconds(after) - cpu;
+    double seconds = et.split();
+    result.cpu_percent = 100. * cpu / seconds;
+    result.switches = ((after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw)) / seconds;
+
+    // Requests from the first Agent round the rest
+    std::vector<double> latency;
+    std::string output;
+    for (uint16_t j=0; j<requests; ++j)
+    {
+        for (uint16_t i=1; i<count; ++i)
+        {
+            if (agents[i]->cinfo == nullptr)
+            {
+                continue;
+            }
+            beatstruc beat = agents[i]->cinfo->pdata.agent[0].beat;
+            strcpy(beat.addr, "127.0.0.1");
+            beat.utc = currentmjd();
+            et.reset();
+            if (agents[0]->send_request(beat, "echo 0 0 0", output, 1.) > 0 && output.find("[OK]") != std::string::npos)
+            {
+                latency.push_back(et.split());
+            }
+            else
+            {
+                ++result.failed;
+            }
+        }
+    }
+    if (latency.size())
+    {
+        std::sort(latency.begin(), latency.end());
+        result.median = latency[latency.size() / 2];
+        result.worst = latency.back();
+    }
+
+    et.reset();
+    for (Agent *agent : agents)
+    {
+        threads.push_back(std::thread([agent] { delete agent; }));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    result.shutdown = et.split();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t count = 20;
+    double idle = 10.;
+    uint16_t requests = 20;
+
+    if (argc > 1)
+    {
+        count = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        idle = atof(argv[2]);
+    }
+    if (argc > 3)
+    {
+        requests = atoi(argv[3]);
+    }
+    if (count < 2)
+    {
+        count = 2;
+    }
+
+    printf("%u agents, %.0f s idle, %u requests to each\n", count, idle, requests);
+    printf("mode     started threads   idle cpu  switches/s  median ms  worst ms  failed  shutdown s\n");
+    bool failed = false;
+    for (bool reactor : {false, true})
+    {
+        reactor_result result = run(count, idle, requests, reactor);
+        printf("%-8s %7u %7u %9.2f%% %11.0f %10.3f %9.3f %7u %11.2f\n", reactor ? "reactor" : "threads", result.started, result.threads, result.cpu_percent, result.switches, 1000. * result.median, 1000. * result.worst, result.failed, result.shutdown);
+        failed |= result.started != count || result.failed;
+    }
+    if (failed)
+    {
+        exit(1);
+    }
+}
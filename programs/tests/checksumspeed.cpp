@@ -0,0 +1,201 @@
+// Agreement and speed of the table driven CRCs and checksums, against bit by bit ones
+// Usage: checksumspeed [bytes] [runs]
+// Each CRC must give the published check value for "123456789", and agree with a bit at a
+// time reference over random data, whole and fed through in random pieces, with the SSE4.2
+// instruction and without it. The throughput of each, and of its reference, is printed in MB/s.
+#include "support/configCosmos.h"
+#include "math/mathlib.h"
+#include "support/sliplib.h"
+#include "support/elapsedtime.h"
+#include <functional>
+
+// CRC-16, least significant bit first, as slip_calc_crc used to work it out
+static uint16_t bit_crc16r(uint16_t crc, const uint8_t *buf, size_t size)
+{
+    for (size_t i=0; i<size; ++i)
+    {
+        uint8_t ch = buf[i];
+        for (uint16_t j=0; j<8; ++j)
+        {
+            crc = (crc >> 1)^(((ch^crc)&0x01)?0x8408:0);
+            ch >>= 1;
+        }
+    }
+    return crc;
+}
+
+// CRC-16, most significant bit first
+static uint16_t bit_crc16(uint16_t crc, const uint8_t *buf, size_t size)
+{
+    for (size_t i=0; i<size; ++i)
+    {
+        crc ^= buf[i] << 8;
+        for (uint16_t j=0; j<8; ++j)
+        {
+            crc = (crc << 1) ^ ((crc & 0x8000) ? 0x1021 : 0);
+        }
+    }
+    return crc;
+}
+
+// CRC-32C register
+static uint32_t bit_crc32c(uint32_t crc, const uint8_t *buf, size_t size)
+{
+    for (size_t i=0; i<size; ++i)
+    {
+        crc ^= buf[i];
+        for (uint16_t j=0; j<8; ++j)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+        }
+    }
+    return crc;
+}
+
+// Ones' complement sum of 16-bit words, one word at a time
+static uint16_t word_sum16(const uint8_t *buf, size_t size)
+{
+    uint32_t sum = 0;
+    for (size_t i=0; i+1<size; i+=2)
+    {
+        uint16_t w;
+        memcpy(&w, &buf[i], 2);
+        sum += w;
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    if (size % 2)
+    {
+        uint8_t w[2] = {buf[size-1], 0};
+        uint16_t w16;
+        memcpy(&w16, w, 2);
+        sum += w16;
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return sum;
+}
+
+static bool agree = true;
+
+static void check(const char *name, uint32_t result, uint32_t expected)
+{
+    if (result != expected)
+    {
+        printf("%s gave %x, not %x\n", name, result, expected);
+        agree = false;
+    }
+}
+
+// Feed the buffer through in random pieces
+static uint32_t pieces(std::function<uint32_t(uint32_t, const uint8_t *, size_t)> crc, uint32_t start, const std::vector<uint8_t> &data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        size_t size = rand() % 40;
+        if (size > data.size() - done)
+        {
+            size = data.size() - done;
+        }
+        start = crc(start, &data[done], size);
+        done += size;
+    }
+    return start;
+}
+
+// Time a function over the buffer, in MB/s
+static double speed(std::function<uint32_t()> calc, uint32_t runs, size_t bytes, uint32_t &result)
+{
+    ElapsedTime et;
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        result = calc();
+    }
+    return runs * bytes / (1e6 * et.split());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t bytes = 1000000;
+    uint32_t runs = 20;
+    if (argc > 1)
+    {
+        bytes = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        runs = atol(argv[2]);
+    }
+
+    const uint8_t *text = (const uint8_t *)"123456789";
+    for (int simd=0; simd<2; ++simd)
+    {
+        crc_simd(simd);
+        check("CRC-16/MCRF4XX", crc16_update(CRC16_INIT, text, 9), 0x6f91);
+        check("CRC-16/X.25", crc16_x25(0, text, 9), 0x906e);
+        check("CRC-16/CCITT-FALSE", crc16_ccitt_update(CRC16_INIT, text, 9), 0x29b1);
+        check("CRC-16/XMODEM", crc16_ccitt_update(0, text, 9), 0x31c3);
+        check("CRC-32C", crc32c(0, text, 9), 0xe3069283);
+    }
+    check("calc_crc16ccitt", calc_crc16ccitt((uint8_t *)text, 9), 0x6f91);
+
+    srand(1);
+    std::vector<uint8_t> data(bytes);
+    for (uint8_t &byte : data)
+    {
+        byte = rand();
+    }
+    // Every length up to 64, for the ends that are not a whole word
+    for (size_t size=0; size<64 && size<=bytes; ++size)
+    {
+        check("crc16_update", crc16_update(CRC16_INIT, data.data(), size), bit_crc16r(CRC16_INIT, data.data(), size));
+        check("crc16_ccitt_update", crc16_ccitt_update(CRC16_INIT, data.data(), size), bit_crc16(CRC16_INIT, data.data(), size));
+        check("checksum_sum16", checksum_sum16(0, data.data(), size), word_sum16(data.data(), size));
+        for (int simd=0; simd<2; ++simd)
+        {
+            crc_simd(simd);
+            check("crc32c", crc32c(0, data.data(), size), ~bit_crc32c(~0U, data.data(), size));
+        }
+    }
+
+    printf("%u bytes, %u runs, SSE4.2 %s\n", (uint32_t)bytes, runs, crc_simd(true) ? "available" : "not available");
+    printf("                     bit by bit          table\n");
+    uint32_t reference, result;
+    double bits = speed([&] { return bit_crc16r(CRC16_INIT, data.data(), bytes); }, runs, bytes, reference);
+    double table = speed([&] { return crc16_update(CRC16_INIT, data.data(), bytes); }, runs, bytes, result);
+    check("crc16_update", result, reference);
+    check("crc16_update in pieces", pieces(crc16_update, CRC16_INIT, data), reference);
+    check("crc16_x25 in pieces", pieces(crc16_x25, 0, data), (uint16_t)~reference);
+    printf("%-18s %8.1f MB/s %8.1f MB/s %6.1fx\n", "CRC-16 (SLIP)", bits, table, table / bits);
+
+    bits = speed([&] { return bit_crc16(CRC16_INIT, data.data(), bytes); }, runs, bytes, reference);
+    table = speed([&] { return crc16_ccitt_update(CRC16_INIT, data.data(), bytes); }, runs, bytes, result);
+    check("crc16_ccitt_update", result, reference);
+    check("crc16_ccitt_update in pieces", pieces(crc16_ccitt_update, CRC16_INIT, data), reference);
+    printf("%-18s %8.1f MB/s %8.1f MB/s %6.1fx\n", "CRC-16 (CCITT)", bits, table, table / bits);
+
+    bits = speed([&] { return ~bit_crc32c(~0U, data.data(), bytes); }, runs, bytes, reference);
+    for (int simd=0; simd<2; ++simd)
+    {
+        if (crc_simd(simd) != (bool)simd)
+        {
+            continue;
+        }
+        table = speed([&] { return crc32c(0, data.data(), bytes); }, runs, bytes, result);
+        check("crc32c", result, reference);
+        check("crc32c in pieces", pieces(crc32c, 0, data), reference);
+        printf("%-18s %8.1f MB/s %8.1f MB/s %6.1fx\n", simd ? "CRC-32C (SSE4.2)" : "CRC-32C", bits, table, table / bits);
+    }
+
+    bits = speed([&] { return word_sum16(data.data(), bytes); }, runs, bytes, reference);
+    table = speed([&] { return checksum_sum16(0, data.data(), bytes); }, runs, bytes, result);
+    check("checksum_sum16", result, reference);
+    size_t half = (bytes / 2) & ~1;
+    check("checksum_sum16 in two", checksum_sum16(checksum_sum16(0, data.data(), half), &data[half], bytes - half), reference);
+    printf("%-18s %8.1f MB/s %8.1f MB/s %6.1fx\n", "Ones' sum", bits, table, table / bits);
+
+    printf("table and bit by bit %s\n", agree ? "agree" : "DISAGREE");
+    if (!agree)
+    {
+        exit(1);
+    }
+}
@@ -0,0 +1,176 @@
+// Compare contact_find against brute force stepping of every satellite over every site
+// Usage: contactspeed [satellite_count] [site_count] [days] [threads]
+#include "support/configCosmos.h"
+#include "support/contactlib.h"
+#include "support/timelib.h"
+#include "support/elapsedtime.h"
+
+ElapsedTime et;
+
+int main(int argc, char *argv[])
+{
+    size_t satcount = 200;
+    size_t sitecount = 20;
+    double days = 1.;
+    uint16_t threads = thread::hardware_concurrency();
+    double utc = currentmjd(0.);
+
+    if (argc > 1)
+    {
+        satcount = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        sitecount = atol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        days = atof(argv[3]);
+    }
+    if (argc > 4)
+    {
+        threads = atoi(argv[4]);
+    }
+
+    // Synthetic catalog of LEO satellites
+    vector<tlestruc> tle;
+    vector<string> satname;
+    for (size_t i=0; i<satcount; ++i)
+    {
+        tlestruc ntle;
+        memset(&ntle, 0, sizeof(tlestruc));
+        ntle.utc = utc - (i % 7) / 3.;
+        ntle.snumber = i + 1;
+        ntle.bstar = 1e-5 * (1 + i % 10);
+        ntle.i = RADOF(30. + (i * 7) % 70);
+        ntle.raan = RADOF((i * 13) % 360);
+        ntle.e = .0001 + .0001 * (i % 50);
+        ntle.ap = RADOF((i * 17) % 360);
+        ntle.ma = RADOF((i * 29) % 360);
+        ntle.mm = D2PI * (14.5 + .01 * (i % 100)) / 1440.;
+        tle.push_back(ntle);
+        satname.push_back("sat" + std::to_string(i));
+    }
+    vector<sgp4struc> sat;
+    sgp4_init(tle, sat);
+
+    // Sites spread over the globe
+    vector<contactsitestruc> site;
+    vector<string> sitename;
+    for (size_t j=0; j<sitecount; ++j)
+    {
+        contactsitestruc nsite;
+        nsite.geod.lat = RADOF(-60. + (j * 37) % 120);
+        nsite.geod.lon = RADOF(-180. + (j * 71) % 360);
+        nsite.geod.h = 100. * (j % 5);
+        nsite.minelev = RADOF(5. * (j % 3));
+        site.push_back(nsite);
+        sitename.push_back("site" + std::to_string(j));
+    }
+
+    vector<contactstruc> contact;
+    et.reset();
+    int32_t iretn = contact_find(sat, site, utc, utc + days, contact, threads);
+    double tfind = et.split();
+    if (iretn < 0)
+    {
+        printf("contact_find: %s\n", cosmos_error_string(iretn).c_str());
+        exit(1);
+    }
+
+    vector<shorteventstruc> event;
+    contact_events(contact, satname, sitename, event);
+
+    // Brute force at one second steps for a sample of satellites
+    size_t scount = sat.size() < 10 ? sat.size() : 10;
+    vector<contactstruc> brute;
+    vector<bool> visible(scount * site.size(), false);
+    vector<float> elpeak(scount * site.size(), 0.);
+    et.reset();
+    for (double t=utc; t<=utc+days; t+=1./86400.)
+    {
+        rmatrix pw;
+        pef2itrs(t, &pw);
+        rmatrix rm = rm_mmult(pw, rm_change_around_z(-utc2gmst1982(t)));
+        for (size_t i=0; i<scount; ++i)
+        {
+            cartpos teme;
+            sgp4_propagate(sat[i], t, teme);
+            rvector geoc = rv_mmult(rm, teme.s);
+            for (size_t j=0; j<site.size(); ++j)
+            {
+                rvector topo;
+                float az, el;
+                geoc2topo(site[j].geod, geoc, topo);
+                topo2azel(topo, &az, &el);
+                size_t p = i * site.size() + j;
+                if (el > site[j].minelev)
+                {
+                    if (!visible[p])
+                    {
+                        contactstruc ncontact;
+                        ncontact.satidx = i;
+                        ncontact.siteidx = j;
+                        ncontact.utcrise = t;
+                        brute.push_back(ncontact);
+                        visible[p] = true;
+                        elpeak[p] = el;
+                    }
+                    elpeak[p] = el > elpeak[p] ? el : elpeak[p];
+                }
+                else if (visible[p])
+                {
+                    for (contactstruc &bcontact : brute)
+                    {
+                        if (bcontact.satidx == i && bcontact.siteidx == j && bcontact.utcset == 0.)
+                        {
+                            bcontact.utcset = t;
+                            bcontact.elpeak = elpeak[p];
+                        }
+                    }
+                    visible[p] = false;
+                }
+            }
+        }
+    }
+    double tbrute = et.split();
+
+    // Match brute force windows to the ones found
+    size_t matched = 0;
+    double maxdt = 0.;
+    double maxdel = 0.;
+    for (contactstruc &bcontact : brute)
+    {
+        if (bcontact.utcset == 0.)
+        {
+            continue;
+        }
+        for (contactstruc &ncontact : contact)
+        {
+            if (ncontact.satidx == bcontact.satidx && ncontact.siteidx == bcontact.siteidx && fabs(ncontact.utcrise - bcontact.utcrise) < 10./86400.)
+            {
+                ++matched;
+                maxdt = fmax(maxdt, 86400. * fabs(ncontact.utcrise - bcontact.utcrise));
+                maxdt = fmax(maxdt, 86400. * fabs(ncontact.utcset - bcontact.utcset));
+                maxdel = fmax(maxdel, fabs(ncontact.elpeak - bcontact.elpeak));
+                break;
+            }
+        }
+    }
+    size_t bcount = 0;
+    size_t ccount = 0;
+    for (contactstruc &bcontact : brute)
+    {
+        bcount += bcontact.utcset != 0. ? 1 : 0;
+    }
+    for (contactstruc &ncontact : contact)
+    {
+        ccount += ncontact.satidx < scount && ncontact.utcrise > utc && ncontact.utcset < utc + days ? 1 : 0;
+    }
+
+    printf("%lu satellites, %lu sites, %.1f days, %u threads\n", sat.size(), site.size(), days, threads);
+    printf("contact_find: %lu contacts, %lu events in %.3f s (%.0f pair-days/s)\n", contact.size(), event.size(), tfind, sat.size() * site.size() * days / tfind);
+    printf("brute force:  %lu satellites in %.3f s (%.0f pair-days/s)\n", scount, tbrute, scount * site.size() * days / tbrute);
+    printf("Matched %lu of %lu complete brute force contacts (%lu found)\n", matched, bcount, ccount);
+    printf("Maximum rise/set difference: %.3f s, peak elevation difference: %.3g deg\n", maxdt, DEGOF(maxdel));
+}
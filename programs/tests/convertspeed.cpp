@@ -0,0 +1,223 @@
+// Check batch coordinate conversions against the scalar versions, and compare their speed
+// Usage: convertspeed [count] [threads]
+// Every batch conversion must agree with its scalar version to within the tolerance printed
+// beside it, or the program exits with 1. eci2kep needs the JPL ephemeris in the COSMOS
+// resources.
+#include "support/configCosmos.h"
+#include "support/convertlib.h"
+#include "support/timelib.h"
+#include "support/elapsedtime.h"
+
+ElapsedTime et;
+bool agree = true;
+
+// Keep the largest error, and any NaN
+static void worst(double &maxerr, double err)
+{
+    if (!std::isnan(maxerr) && !(err <= maxerr))
+    {
+        maxerr = err;
+    }
+}
+
+// Note whether the largest error is within the tolerance
+static const char *within(double maxerr, double tolerance)
+{
+    bool ok = maxerr <= tolerance;
+    agree = agree && ok;
+    return ok ? "ok" : "TOO LARGE";
+}
+
+// Difference between two angles, in radians
+static double angle_error(double a, double b)
+{
+    return fabs(remainder(a - b, D2PI));
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 1000000;
+    uint16_t threads = thread::hardware_concurrency();
+
+    if (argc > 1)
+    {
+        count = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        threads = atoi(argv[2]);
+    }
+
+    // Ground track of a 500 km, 51.6 degree orbit at 1 second steps
+    double utc = currentmjd(0.);
+    vector<kepstruc> kep(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        memset(&kep[i], 0, sizeof(kepstruc));
+        kep[i].utc = utc + i / 86400.;
+        kep[i].a = REARTHM + 500000.;
+        kep[i].e = .001;
+        kep[i].i = RADOF(51.6);
+        kep[i].raan = RADOF(30.);
+        kep[i].ap = RADOF(10.);
+        kep[i].ea = fmod(i * sqrt(GM / pow(kep[i].a, 3.)), D2PI);
+    }
+
+    vector<cartpos> eci;
+    vector<double> t(count), x(count), y(count), z(count);
+    vector<double> lat(count), lon(count), h(count);
+    vector<double> gx(count), gy(count), gz(count);
+    vector<double> tx(count), ty(count), tz(count);
+    vector<float> az(count), el(count);
+
+    // Scalar versions
+    vector<geoidpos> geod(count);
+    vector<cartpos> geoc(count);
+    vector<rvector> topo(count);
+    vector<float> saz(count), sel(count);
+    gvector gs = {RADOF(21.3), RADOF(-157.8), 30.};
+
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        kep2eci(kep[i], geoc[i]);
+    }
+    double skep = et.split();
+    et.reset();
+    kep2eci_batch(kep, eci, threads);
+    double bkep = et.split();
+    double maxerr = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        worst(maxerr, length_rv(rv_sub(eci[i].s, geoc[i].s)) + length_rv(rv_sub(eci[i].v, geoc[i].v)));
+    }
+    printf("kep2eci:    scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g m %s\n", 1e-6 * count / skep, 1e-6 * count / bkep, maxerr, within(maxerr, 1e-6));
+
+    // Back again, checked against a sample as the scalar version looks up the Sun every time
+    vector<kepstruc> bkepback;
+    et.reset();
+    int32_t iretn = eci2kep_batch(eci, bkepback, threads);
+    double beci2kep = et.split();
+    if (iretn < 0)
+    {
+        printf("eci2kep_batch: %s\n", cosmos_error_string(iretn).c_str());
+        exit(1);
+    }
+    size_t scount = 0;
+    maxerr = 0.;
+    et.reset();
+    for (size_t i=0; i<count; i+=97)
+    {
+        kepstruc skepback;
+        eci2kep(eci[i], skepback);
+        const kepstruc &b = bkepback[i];
+        double err = fabs(b.a - skepback.a) + skepback.a * fabs(b.e - skepback.e);
+        err += skepback.a * (angle_error(b.i, skepback.i) + angle_error(b.raan, skepback.raan) + angle_error(b.ap, skepback.ap) + angle_error(b.ma, skepback.ma) + angle_error(b.beta, skepback.beta));
+        worst(maxerr, err);
+        ++scount;
+    }
+    double seci2kep = et.split();
+    printf("eci2kep:    scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g m %s\n", 1e-6 * scount / seci2kep, 1e-6 * count / beci2kep, maxerr, within(maxerr, 1e-6));
+
+    for (size_t i=0; i<count; ++i)
+    {
+        t[i] = eci[i].utc;
+        x[i] = eci[i].s.col[0];
+        y[i] = eci[i].s.col[1];
+        z[i] = eci[i].s.col[2];
+    }
+
+    et.reset();
+    pos_eci2geoc_batch(count, t.data(), x.data(), y.data(), z.data(), nullptr, nullptr, nullptr, gx.data(), gy.data(), gz.data(), nullptr, nullptr, nullptr, threads);
+    double beci = et.split();
+
+    // Scalar rotation is slow, so only check a sample
+    scount = 0;
+    maxerr = 0.;
+    et.reset();
+    for (size_t i=0; i<count; i+=97)
+    {
+        rmatrix rnp, rm, drm, ddrm;
+        gcrf2itrs(eci[i].utc, &rnp, &rm, &drm, &ddrm);
+        rvector s = rv_mmult(rm, eci[i].s);
+        double err = fabs(gx[i] - s.col[0]) + fabs(gy[i] - s.col[1]) + fabs(gz[i] - s.col[2]);
+        worst(maxerr, err);
+        ++scount;
+    }
+    double seci = et.split();
+    printf("eci2geoc:   scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g m %s\n", 1e-6 * scount / seci, 1e-6 * count / beci, maxerr, within(maxerr, .1));
+
+    for (size_t i=0; i<count; ++i)
+    {
+        geoc[i].s.col[0] = gx[i];
+        geoc[i].s.col[1] = gy[i];
+        geoc[i].s.col[2] = gz[i];
+        geoc[i].v = rv_zero();
+    }
+
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        geoc2geod(geoc[i], geod[i]);
+    }
+    double sgeod = et.split();
+    et.reset();
+    geoc2geod_batch(count, gx.data(), gy.data(), gz.data(), lat.data(), lon.data(), h.data(), threads);
+    double bgeod = et.split();
+    maxerr = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        double err = fabs(h[i] - geod[i].s.h) + REARTHM * (fabs(lat[i] - geod[i].s.lat) + fabs(lon[i] - geod[i].s.lon));
+        worst(maxerr, err);
+    }
+    printf("geoc2geod:  scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g m %s\n", 1e-6 * count / sgeod, 1e-6 * count / bgeod, maxerr, within(maxerr, .1));
+
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        geod2geoc(geod[i], geoc[i]);
+    }
+    double sgeoc = et.split();
+    for (size_t i=0; i<count; ++i)
+    {
+        lat[i] = geod[i].s.lat;
+        lon[i] = geod[i].s.lon;
+        h[i] = geod[i].s.h;
+    }
+    et.reset();
+    geod2geoc_batch(count, lat.data(), lon.data(), h.data(), x.data(), y.data(), z.data(), threads);
+    double bgeoc = et.split();
+    maxerr = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        double err = fabs(x[i] - geoc[i].s.col[0]) + fabs(y[i] - geoc[i].s.col[1]) + fabs(z[i] - geoc[i].s.col[2]);
+        worst(maxerr, err);
+    }
+    printf("geod2geoc:  scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g m %s\n", 1e-6 * count / sgeoc, 1e-6 * count / bgeoc, maxerr, within(maxerr, 1e-6));
+
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        geoc2topo(gs, geoc[i].s, topo[i]);
+        topo2azel(topo[i], &saz[i], &sel[i]);
+    }
+    double stopo = et.split();
+    et.reset();
+    geoc2topo_batch(gs, count, x.data(), y.data(), z.data(), tx.data(), ty.data(), tz.data(), threads);
+    topo2azel_batch(count, tx.data(), ty.data(), tz.data(), az.data(), el.data(), threads);
+    double btopo = et.split();
+    maxerr = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        double err = fabs(az[i] - saz[i]) + fabs(el[i] - sel[i]);
+        worst(maxerr, err);
+    }
+    printf("geoc2azel:  scalar %8.3f Mpps  batch %8.3f Mpps  max error %.3g rad %s\n", 1e-6 * count / stopo, 1e-6 * count / btopo, maxerr, within(maxerr, 1e-5));
+
+    printf("%zu points, %u threads\n", count, threads);
+    printf("batch and scalar %s\n", agree ? "agree" : "DISAGREE");
+    if (!agree)
+    {
+        exit(1);
+    }
+}
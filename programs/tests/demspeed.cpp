@@ -0,0 +1,159 @@
+// Compare DEM lookups through the in memory cache against memory mapped and batched lookups
+// Usage: demspeed [resources_folder] [point_count] [threads]
+// Without a resources folder, a synthetic Earth DEM is written to /tmp/demspeed.
+#include "support/configCosmos.h"
+#include "support/demlib.h"
+#include "support/datalib.h"
+#include "support/elapsedtime.h"
+
+ElapsedTime et;
+
+// Write a synthetic global DEM of 8 tiles, 0.1 degree pixels
+static int32_t make_dem(string root)
+{
+    string folder = root + "/mapping/earth";
+    int32_t iretn = set_cosmosresources(root, true);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    COSMOS_MKDIR((root + "/mapping").c_str(), 00777);
+    COSMOS_MKDIR(folder.c_str(), 00777);
+
+    FILE *fp = fopen((folder + "/body.dat").c_str(), "w");
+    if (fp == nullptr)
+    {
+        return -errno;
+    }
+    fprintf(fp, "1. 6378.137 9.\n");
+    fclose(fp);
+
+    FILE *fd = fopen((folder + "/dems5.dat").c_str(), "w");
+    double psize = .1;
+    uint32_t count = (uint32_t)(90. / psize);
+    vector<dem_pixel> row(count);
+    for (uint16_t tr=0; tr<2; ++tr)
+    {
+        for (uint16_t tc=0; tc<4; ++tc)
+        {
+            char name[50];
+            sprintf(name, "synth%u%u.dem", tr, tc);
+            double latul = 90. - tr * 90. - psize / 2.;
+            double lonul = -180. + tc * 90. + psize / 2.;
+            fprintf(fd, "%s %.6f %.6f %u %u %.6f %u\n", name, lonul, latul, count, count, psize, DEM_TYPE_SINGLE);
+            FILE *ft = fopen((folder + "/" + name).c_str(), "wb");
+            for (uint32_t r=0; r<count; ++r)
+            {
+                for (uint32_t c=0; c<count; ++c)
+                {
+                    double lat = RADOF(latul - r * psize);
+                    double lon = RADOF(lonul + c * psize);
+                    row[c].alt = (float)(2000. * sin(3. * lat) * cos(5. * lon) + 500. * sin(40. * lon + 30. * lat));
+                    row[c].nmap[0] = row[c].nmap[1] = 0.f;
+                    row[c].nmap[2] = 1.f;
+                }
+                fwrite(row.data(), sizeof(dem_pixel), count, ft);
+            }
+            fclose(ft);
+        }
+    }
+    fclose(fd);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 1000000;
+    uint16_t threads = thread::hardware_concurrency();
+    double res = RADOF(.1);
+
+    if (argc > 1 && strcmp(argv[1], "-"))
+    {
+        if (set_cosmosresources(argv[1], false) < 0)
+        {
+            printf("Unable to use %s\n", argv[1]);
+            exit(1);
+        }
+        res = 1. / REARTHM;
+    }
+    else if (make_dem("/tmp/demspeed") < 0)
+    {
+        printf("Unable to write synthetic DEM\n");
+        exit(1);
+    }
+    if (argc > 2)
+    {
+        count = atol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        threads = atoi(argv[3]);
+    }
+
+    // Random points, clustered the way a ground track or line of sight would be
+    vector<double> lon(count);
+    vector<double> lat(count);
+    double clon = 0.;
+    double clat = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        if (i % 1000 == 0)
+        {
+            clon = RADOF(-179. + 358. * rand() / RAND_MAX);
+            clat = RADOF(-89. + 178. * rand() / RAND_MAX);
+        }
+        lon[i] = clon + RADOF(1.) * rand() / RAND_MAX;
+        lat[i] = clat + RADOF(1.) * rand() / RAND_MAX - RADOF(.5);
+        if (lon[i] > DPI)
+        {
+            lon[i] -= D2PI;
+        }
+    }
+
+    // Old way: loaded in to the cache, one point at a time
+    map_dem_mmap(false);
+    vector<float> oldalt(count);
+    map_dem_alt(COSMOS_EARTH, lon[0], lat[0], res);
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        oldalt[i] = (float)map_dem_alt(COSMOS_EARTH, lon[i], lat[i], res);
+    }
+    double tcache = et.split();
+
+    // Memory mapped, one point at a time
+    map_dem_mmap(true);
+    vector<float> mapalt(count);
+    map_dem_alt(COSMOS_EARTH, lon[0], lat[0], res);
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        mapalt[i] = (float)map_dem_alt(COSMOS_EARTH, lon[i], lat[i], res);
+    }
+    double tmap = et.split();
+
+    // Batched, nearest and bilinear
+    vector<float> nearalt(count);
+    vector<float> bilalt(count);
+    et.reset();
+    map_dem_alt_batch(COSMOS_EARTH, count, lon.data(), lat.data(), res, nearalt.data(), false, threads);
+    double tnear = et.split();
+    et.reset();
+    map_dem_alt_batch(COSMOS_EARTH, count, lon.data(), lat.data(), res, bilalt.data(), true, threads);
+    double tbil = et.split();
+
+    size_t mismatch = 0;
+    double maxdiff = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        mismatch += (oldalt[i] != mapalt[i] || oldalt[i] != nearalt[i]) ? 1 : 0;
+        maxdiff = fmax(maxdiff, fabs(bilalt[i] - nearalt[i]));
+    }
+
+    printf("%lu points, %u threads\n", count, threads);
+    printf("cache:           %10.0f lookups/s\n", count / tcache);
+    printf("mmap:            %10.0f lookups/s\n", count / tmap);
+    printf("batch nearest:   %10.0f lookups/s\n", count / tnear);
+    printf("batch bilinear:  %10.0f lookups/s\n", count / tbil);
+    printf("Nearest mismatches: %lu, largest bilinear to nearest difference: %.1f m\n", mismatch, maxdiff);
+}
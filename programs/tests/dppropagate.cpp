@@ -0,0 +1,112 @@
+// Steps and speed of Dormand-Prince against Gauss-Jackson propagation, at equal accuracy
+// Usage: dppropagate [hours]
+// A near circular low orbit and a highly elliptical one are each propagated for the given number
+// of hours, with Gauss-Jackson at a range of fixed steps and with Dormand-Prince at a range of
+// tolerances. The error of each is its distance at the end from a Dormand-Prince propagation at a
+// much tighter tolerance. The force models need the COSMOS resources (IERS, JPL ephemeris and
+// gravity coefficients).
+#include "support/configCosmos.h"
+#include "support/datalib.h"
+#include "physics/physicslib.h"
+#include "support/elapsedtime.h"
+
+static locstruc start_loc(double utc, double a, double e, double i)
+{
+    locstruc loc;
+    kepstruc kep;
+    pos_clear(loc);
+    loc.utc = utc;
+    kep.utc = utc;
+    kep.a = a;
+    kep.e = e;
+    kep.i = i;
+    kep.raan = 1.;
+    kep.ap = .5;
+    kep.ea = 0.;
+    kep2eci(kep, loc.pos.eci);
+    loc.pos.eci.utc = utc;
+    ++loc.pos.eci.pass;
+    pos_eci(&loc);
+    loc.att.icrf.s = q_eye();
+    loc.att.icrf.v = rv_zero();
+    loc.att.icrf.a = rv_zero();
+    loc.att.icrf.utc = utc;
+    return loc;
+}
+
+static void start_physics(physicsstruc &physics)
+{
+    physics = physicsstruc();
+    physics.mass = 1.;
+    physics.area = .01;
+    physics.moi = rv_one();
+}
+
+// Distance from the reference, moved to the same time
+static double error_of(const locstruc &loc, const locstruc &reference)
+{
+    rvector s = rv_add(reference.pos.eci.s, rv_smult(86400. * (loc.utc - reference.utc), reference.pos.eci.v));
+    return length_rv(rv_sub(loc.pos.eci.s, s));
+}
+
+static void compare(const char *name, double a, double e, double i, double utc, double tomjd)
+{
+    physicsstruc physics;
+    locstruc iloc = start_loc(utc, a, e, i);
+    locstruc loc, reference;
+    dp_handle dph;
+    ElapsedTime et;
+
+    start_physics(physics);
+    dormand_prince_init(dph, physics, iloc, 60., 1e-14, 1e-7);
+    if (dormand_prince_propagate(dph, physics, reference, tomjd, nullptr) < 0)
+    {
+        printf("Unable to make reference for %s\n", name);
+        exit(1);
+    }
+    printf("%s: perigee %.0f km, apogee %.0f km, reference in %u steps\n", name, (a * (1. - e) - REARTHM) / 1000., (a * (1. + e) - REARTHM) / 1000., dph.steps);
+    printf("               steps  evaluations  rejected   seconds    error (m)\n");
+
+    double dts[] = {60., 30., 10., 5.};
+    for (double dt : dts)
+    {
+        gj_handle gjh;
+        start_physics(physics);
+        gauss_jackson_init_eci(gjh, 8, 0, dt, iloc.utc, iloc.pos.eci, iloc.att.icrf, physics, loc);
+        et.reset();
+        int32_t steps = gauss_jackson_propagate(gjh, physics, loc, tomjd, nullptr);
+        double seconds = et.split();
+        printf("GJ %4.0f s    %8d     %8d         -  %8.3f  %11.3e\n", dt, steps, steps, seconds, error_of(loc, reference));
+    }
+
+    double tolerances[] = {1e-8, 1e-10, 1e-12};
+    for (double rtol : tolerances)
+    {
+        start_physics(physics);
+        dormand_prince_init(dph, physics, iloc, 60., rtol, rtol * 1e4);
+        et.reset();
+        int32_t steps = dormand_prince_propagate(dph, physics, loc, tomjd, nullptr);
+        double seconds = et.split();
+        printf("DP %5.0e    %8d     %8u  %8u  %8.3f  %11.3e\n", rtol, steps, dph.evaluations, dph.rejected, seconds, error_of(loc, reference));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    double hours = 24.;
+    if (argc > 1)
+    {
+        hours = atof(argv[1]);
+    }
+    string resources;
+    if (get_cosmosresources(resources) < 0)
+    {
+        printf("Unable to find COSMOS resources\n");
+        exit(1);
+    }
+
+    double utc = 58000.;
+    double tomjd = utc + hours / 24.;
+    compare("LEO", REARTHM + 500000., .001, RADOF(51.6), utc, tomjd);
+    compare("HEO", 26600000., .74, RADOF(63.4), utc, tomjd);
+}
@@ -0,0 +1,321 @@
+// Speed of the polynomial estimators, against the estimator they replaced
+// Usage: estimatorspeed [channels] [samples] [size] [degree]
+// Each channel is fed a noisy slow sine, one sample per channel at each time, first through the
+// estimator as it was (every fit kept in its own vectors, shifted down and refitted with polyfit
+// for each sample), then through set_estimate channel by channel, then through set_estimates for
+// all channels at once. Estimates are taken after every sample, and those of the two new ways
+// must agree, also when some channels are fed through set_estimate as well. Accuracy is then
+// checked on samples of polynomials of the fit degree, which every fit should follow exactly.
+#include "support/configCosmos.h"
+#include "math/mathlib.h"
+#include "support/elapsedtime.h"
+
+// The estimator as it was
+struct legacyhandle
+{
+    std::vector<estimatorstruc> r;
+    uint32_t size;
+    uint32_t degree;
+    double xbase;
+    double ybase;
+};
+
+static void legacy_open(legacyhandle *estimate, uint32_t size, uint32_t degree)
+{
+    if (degree > 4) degree = 4;
+    estimate->degree = degree;
+    if (size < degree) size = degree;
+    estimate->size = size;
+    estimate->r.resize(0);
+}
+
+static void legacy_set(legacyhandle *estimate, double independent, double dependent)
+{
+    if (estimate->r.size() == estimate->size && estimate->r[estimate->size-1].x.size() == estimate->degree+1)
+    {
+        for (uint32_t i=0; i<estimate->size-1; ++i)
+        {
+            estimate->r[i] = estimate->r[i+1];
+        }
+        for (uint32_t i=0; i<estimate->degree; ++i)
+        {
+            estimate->r[estimate->size-1].x[i] = estimate->r[estimate->size-1].x[i+1];
+            estimate->r[estimate->size-1].y[i] = estimate->r[estimate->size-1].y[i+1];
+        }
+        estimate->r[estimate->size-1].x[estimate->degree] = independent  - estimate->xbase;
+        estimate->r[estimate->size-1].y[estimate->degree] = dependent  - estimate->ybase;
+        estimate->r[estimate->size-1].a = polyfit(estimate->r[estimate->size-1].x,estimate->r[estimate->size-1].y);
+    }
+    else if (estimate->r.size() > 0)
+    {
+        if (estimate->r.size() < estimate->size) estimate->r.resize(estimate->r.size()+1);
+        for (uint32_t i=0; i<estimate->r.size(); ++i)
+        {
+            if (estimate->r[i].x.size() < estimate->degree+1)
+            {
+                estimate->r[i].x.push_back(independent - estimate->xbase);
+                estimate->r[i].y.push_back(dependent - estimate->ybase);
+            }
+            if (estimate->r[i].x.size() == estimate->degree+1 && !estimate->r[i].a.size()) estimate->r[i].a = polyfit(estimate->r[i].x,estimate->r[i].y);
+        }
+    }
+    else
+    {
+        estimate->xbase = independent;
+        estimate->ybase = dependent;
+        estimate->r.resize(1);
+        estimate->r[0].x.push_back(independent - estimate->xbase);
+        estimate->r[0].y.push_back(dependent - estimate->ybase);
+    }
+}
+
+// Only once there are size fits; before that the two differ
+static estimatorstruc legacy_get(legacyhandle *estimate, double x)
+{
+    estimatorstruc result;
+    result.value[0] = result.value[1] = result.value[2] = 0.;
+    result.error[0] = result.error[1] = result.error[2] = 0.;
+    x -= estimate->xbase;
+    for (uint32_t i=0; i<estimate->size; i++)
+    {
+        double tx = 1.;
+        double value[3] = {0., 0., 0.};
+        for (uint32_t j=0; j<estimate->degree+1; j++)
+        {
+            if (j == 0)
+            {
+                value[0] = estimate->r[i].a[0];
+                if (estimate->degree > 0) value[1] = estimate->r[i].a[1];
+                if (estimate->degree > 1) value[2] = 2. * estimate->r[i].a[2];
+            }
+            else
+            {
+                tx *= x;
+                value[0] += tx * estimate->r[i].a[j];
+                if (estimate->degree > j) value[1] += tx * (j+1) * estimate->r[i].a[j+1];
+                if (estimate->degree > j+1) value[2] += tx * (j+2) * (j+1) * estimate->r[i].a[j+2];
+            }
+        }
+        for (int j=0; j<3; ++j)
+        {
+            result.value[j] += value[j];
+            result.error[j] += value[j] * value[j];
+        }
+    }
+    for (int i=0; i<3; i++)
+    {
+        result.error[i] = result.error[i] - result.value[i]*result.value[i]/(estimate->size);
+        if (result.error[i] < 0.) result.error[i] = 0.;
+        if (estimate->size > 1)
+        {
+            result.error[i] /= (estimate->size - 1);
+        }
+        result.error[i] = sqrt(result.error[i]);
+        result.value[i] /= (estimate->size);
+    }
+    result.value[0] += estimate->ybase;
+    return result;
+}
+
+// Relative difference, against the size of what is being estimated
+static double difference(const estimatorstruc &a, const double *value)
+{
+    double worst = 0.;
+    for (int j=0; j<3; ++j)
+    {
+        worst = fmax(worst, fabs(a.value[j] - value[j]) / (1. + fabs(value[j])));
+        worst = fmax(worst, a.error[j] / (1. + fabs(value[j])));
+    }
+    return worst;
+}
+
+// Largest error of each estimator for samples of a polynomial of the fit degree
+static void accuracy(uint32_t samples, uint32_t size, uint32_t degree, double &lworst, double &worst)
+{
+    legacyhandle legacy;
+    estimatorhandle estimate;
+    legacy_open(&legacy, size, degree);
+    open_estimate(&estimate, size, degree);
+    double c[5] = {20., -.3, .02, -1e-4, 2e-7};
+    lworst = worst = 0.;
+    for (uint32_t s=0; s<samples; ++s)
+    {
+        double t = 100. + s * .1;
+        double value[3] = {0., 0., 0.};
+        for (uint32_t i=degree+1; i>0; --i)
+        {
+            value[2] = value[2] * t + 2. * value[1];
+            value[1] = value[1] * t + value[0];
+            value[0] = value[0] * t + c[i-1];
+        }
+        legacy_set(&legacy, t, value[0]);
+        set_estimate(&estimate, t, value[0]);
+        if (s + 1 >= size + degree)
+        {
+            lworst = fmax(lworst, difference(legacy_get(&legacy, t), value));
+            worst = fmax(worst, difference(get_estimate(&estimate, t), value));
+        }
+    }
+}
+
+// Whether set_estimates still agrees with set_estimate when some channels are also fed through
+// set_estimate, so that they hold as many pairs as their neighbours but at other times
+static bool mixed(uint32_t size, uint32_t degree)
+{
+    std::vector<estimatorhandle> single(3);
+    std::vector<estimatorhandle> batch;
+    std::vector<double> value(3);
+    std::vector<estimatorstruc> bresults;
+    open_estimates(batch, 3, size, degree);
+    bool same = true;
+    for (uint32_t c=0; c<3; ++c)
+    {
+        open_estimate(&single[c], size, degree);
+    }
+    for (uint32_t s=0; s<size+degree+5; ++s)
+    {
+        double t = s * .1;
+        if (s == 1)
+        {
+            // Channels 0 and 1 get one more pair each, at different times
+            for (uint32_t c=0; c<2; ++c)
+            {
+                set_estimate(&single[c], t - .02 - .03 * c, 3. * c);
+                set_estimate(&batch[c], t - .02 - .03 * c, 3. * c);
+            }
+        }
+        for (uint32_t c=0; c<3; ++c)
+        {
+            value[c] = 10. + c + sin(t + c);
+            set_estimate(&single[c], t, value[c]);
+        }
+        set_estimates(batch, t, value);
+        get_estimates(batch, t, bresults);
+        for (uint32_t c=0; c<3; ++c)
+        {
+            estimatorstruc sresult = get_estimate(&single[c], t);
+            for (int j=0; j<3; ++j)
+            {
+                same = same && sresult.value[j] == bresults[c].value[j] && sresult.error[j] == bresults[c].error[j];
+            }
+        }
+    }
+    return same;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t channels = 300;
+    uint32_t samples = 2000;
+    uint32_t size = 10;
+    uint32_t degree = 2;
+    if (argc > 1) channels = atol(argv[1]);
+    if (argc > 2) samples = atol(argv[2]);
+    if (argc > 3) size = atol(argv[3]);
+    if (argc > 4) degree = atol(argv[4]);
+    estimatorhandle probe;
+    if (open_estimate(&probe, size, ESTIMATOR_MAXDEGREE+1) >= 0)
+    {
+        printf("open_estimate accepted degree %u\n", ESTIMATOR_MAXDEGREE+1);
+        exit(1);
+    }
+    if (degree > ESTIMATOR_MAXDEGREE)
+    {
+        printf("degree %u is above the largest, %u\n", degree, ESTIMATOR_MAXDEGREE);
+        exit(1);
+    }
+
+    // Telemetry at 10 Hz, against seconds
+    std::vector<double> times(samples);
+    std::vector< std::vector<double> > values(samples, std::vector<double>(channels));
+    srand(1);
+    for (uint32_t s=0; s<samples; ++s)
+    {
+        times[s] = s * .1;
+        for (uint32_t c=0; c<channels; ++c)
+        {
+            values[s][c] = 20. + c + 5. * sin(s * .01 + c) + .01 * rand() / RAND_MAX;
+        }
+    }
+
+    std::vector<legacyhandle> legacy(channels);
+    std::vector<estimatorhandle> single(channels);
+    std::vector<estimatorhandle> batch;
+    for (uint32_t c=0; c<channels; ++c)
+    {
+        legacy_open(&legacy[c], size, degree);
+        open_estimate(&single[c], size, degree);
+    }
+    open_estimates(batch, channels, size, degree);
+
+    // Estimates are asked for at the latest time
+    uint32_t settled = size + degree;
+    std::vector<estimatorstruc> lresults(channels);
+    std::vector<estimatorstruc> sresults(channels);
+    std::vector<estimatorstruc> bresults(channels);
+    bool same = true;
+    ElapsedTime et;
+    double tlegacyset = 0., tlegacyget = 0., tsingleset = 0., tsingleget = 0., tbatchset = 0., tbatchget = 0.;
+    for (uint32_t s=0; s<samples; ++s)
+    {
+        et.reset();
+        for (uint32_t c=0; c<channels; ++c)
+        {
+            legacy_set(&legacy[c], times[s], values[s][c]);
+        }
+        tlegacyset += et.split();
+        if (s + 1 >= settled)
+        {
+            et.reset();
+            for (uint32_t c=0; c<channels; ++c)
+            {
+                lresults[c] = legacy_get(&legacy[c], times[s]);
+            }
+            tlegacyget += et.split();
+        }
+
+        et.reset();
+        for (uint32_t c=0; c<channels; ++c)
+        {
+            set_estimate(&single[c], times[s], values[s][c]);
+        }
+        tsingleset += et.split();
+        et.reset();
+        for (uint32_t c=0; c<channels; ++c)
+        {
+            sresults[c] = get_estimate(&single[c], times[s]);
+        }
+        tsingleget += et.split();
+
+        et.reset();
+        set_estimates(batch, times[s], values[s]);
+        tbatchset += et.split();
+        et.reset();
+        get_estimates(batch, times[s], bresults);
+        tbatchget += et.split();
+
+        for (uint32_t c=0; c<channels; ++c)
+        {
+            for (int j=0; j<3; ++j)
+            {
+                same = same && sresults[c].value[j] == bresults[c].value[j] && sresults[c].error[j] == bresults[c].error[j];
+            }
+        }
+    }
+
+    double updates = (double)channels * samples;
+    printf("%u channels, %u samples, %u fits of degree %u\n", channels, samples, size, degree);
+    printf("as before:      set %8.1f ns  get %8.1f ns per channel\n", 1e9 * tlegacyset / updates, 1e9 * tlegacyget / (channels * (samples - settled + 1.)));
+    printf("set_estimate:   set %8.1f ns  get %8.1f ns per channel  %5.1fx\n", 1e9 * tsingleset / updates, 1e9 * tsingleget / updates, tlegacyset / tsingleset);
+    printf("set_estimates:  set %8.1f ns  get %8.1f ns per channel  %5.1fx\n", 1e9 * tbatchset / updates, 1e9 * tbatchget / updates, tlegacyset / tbatchset);
+    double lworst, worst;
+    accuracy(samples, size, degree, lworst, worst);
+    printf("largest relative error on a polynomial: %.3e as before, %.3e now\n", lworst, worst);
+    printf("set_estimate and set_estimates %s\n", same ? "agree" : "DISAGREE");
+    bool msame = mixed(size, degree);
+    printf("with channels also fed through set_estimate they %s\n", msame ? "agree" : "DISAGREE");
+    if (!same || !msame || worst > 1e-6)
+    {
+        exit(1);
+    }
+}
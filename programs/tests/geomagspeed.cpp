@@ -0,0 +1,131 @@
+// Compare the original NGDC geomagnetic routine against the reentrant model and batch evaluation
+// Usage: geomagspeed [resources_folder] [position_count] [threads]
+// Without a resources folder, a synthetic coefficient file is written to /tmp/geomagspeed.
+#include "support/configCosmos.h"
+#include "support/geomag.h"
+#include "support/datalib.h"
+#include "support/elapsedtime.h"
+
+ElapsedTime et;
+
+// Write a degree 12 coefficient file with a realistic dipole and decaying higher terms
+static int32_t make_cof(string root, int year)
+{
+    int32_t iretn = set_cosmosresources(root, true);
+    if (iretn < 0)
+    {
+        return iretn;
+    }
+    COSMOS_MKDIR((root + "/general").c_str(), 00777);
+
+    char name[100];
+    sprintf(name, "%s/general/wmm_%04d.cof", root.c_str(), year);
+    FILE *fp = fopen(name, "w");
+    if (fp == nullptr)
+    {
+        return -errno;
+    }
+    fprintf(fp, "    %d.0            WMM-SYNTH        01/01/%d\n", year, year);
+    srand(year);
+    for (int n=1; n<=GEOMAG_MAX_DEGREE; ++n)
+    {
+        for (int m=0; m<=n; ++m)
+        {
+            double scale = 3000. / pow(2., n);
+            double g = scale * (2. * rand() / RAND_MAX - 1.);
+            double h = m ? scale * (2. * rand() / RAND_MAX - 1.) : 0.;
+            if (n == 1 && m == 0)
+            {
+                g = -29404.8;
+            }
+            fprintf(fp, "%3d%3d%11.1f%11.1f%11.1f%11.1f\n", n, m, g, h, .01 * g, .01 * h);
+        }
+    }
+    fprintf(fp, "999999999999999999999999999999999999999999999999\n");
+    fprintf(fp, "999999999999999999999999999999999999999999999999\n");
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 100000;
+    uint16_t threads = thread::hardware_concurrency();
+    double year = 2017.5;
+
+    if (argc > 1 && strcmp(argv[1], "-"))
+    {
+        if (set_cosmosresources(argv[1], false) < 0)
+        {
+            printf("Unable to use %s\n", argv[1]);
+            exit(1);
+        }
+    }
+    else if (make_cof("/tmp/geomagspeed", 5 * (int)(year / 5.)) < 0)
+    {
+        printf("Unable to write synthetic coefficients\n");
+        exit(1);
+    }
+    if (argc > 2)
+    {
+        count = atol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        threads = atoi(argv[3]);
+    }
+
+    // Positions along many low orbits
+    vector<gvector> pos(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        pos[i].lat = RADOF(-89.9 + 179.8 * rand() / RAND_MAX);
+        pos[i].lon = RADOF(-180. + 360. * rand() / RAND_MAX);
+        pos[i].h = 300000. + 500000. * rand() / RAND_MAX;
+    }
+
+    // Old way: one position at a time through the NGDC routine, the time moving each step
+    vector<rvector> oldcomp(count);
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        if (geomag_front_ngdc(pos[i], year + i * 1e-9, &oldcomp[i]) < 0)
+        {
+            printf("Unable to load model\n");
+            exit(1);
+        }
+    }
+    double tngdc = et.split();
+
+    // Through the front end
+    vector<rvector> frontcomp(count);
+    et.reset();
+    for (size_t i=0; i<count; ++i)
+    {
+        geomag_front(pos[i], year + i * 1e-9, &frontcomp[i]);
+    }
+    double tfront = et.split();
+
+    // Loaded model, one epoch
+    geomagstruc model;
+    geomag_load(year, model);
+    vector<rvector> batchcomp(count);
+    et.reset();
+    geomag_batch(model, year, count, pos.data(), batchcomp.data(), threads);
+    double tbatch = et.split();
+
+    double maxerr = 0.;
+    double maxfront = 0.;
+    for (size_t i=0; i<count; ++i)
+    {
+        maxerr = fmax(maxerr, length_rv(rv_sub(oldcomp[i], batchcomp[i])) / length_rv(oldcomp[i]));
+        maxfront = fmax(maxfront, length_rv(rv_sub(frontcomp[i], batchcomp[i])));
+    }
+
+    printf("%lu positions, %u threads\n", count, threads);
+    printf("NGDC routine:  %10.0f evaluations/s\n", count / tngdc);
+    printf("geomag_front:  %10.0f evaluations/s\n", count / tfront);
+    printf("geomag_batch:  %10.0f evaluations/s\n", count / tbatch);
+    printf("Largest relative difference from NGDC routine: %.3g\n", maxerr);
+    printf("Largest difference between front end and batch: %.3g nT\n", maxfront * 1e9);
+}
@@ -0,0 +1,115 @@
+// Memory and speed of Gauss-Jackson propagation, keeping every step or streaming them
+// Usage: gjpropagate [hours] [dt]
+// An orbit is started with gauss_jackson_init and propagated for the given number of hours at
+// steps of dt seconds, first with the gauss_jackson_propagate that returns every locstruc, then
+// with the one that hands each step to a function, asking for ECI only. The most heap held at
+// once is counted through operator new. Both must end at the same place. The force models need
+// the COSMOS resources (IERS, JPL ephemeris and gravity coefficients).
+#include "support/configCosmos.h"
+#include "support/datalib.h"
+#include "physics/physicslib.h"
+#include "support/elapsedtime.h"
+#include <new>
+
+static size_t heap_bytes = 0;
+static size_t heap_peak = 0;
+
+void *operator new(size_t size)
+{
+    size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *block = size;
+    heap_bytes += size;
+    if (heap_bytes > heap_peak)
+    {
+        heap_peak = heap_bytes;
+    }
+    return (uint8_t *)block + sizeof(max_align_t);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        size_t *block = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+        heap_bytes -= *block;
+        free(block);
+    }
+}
+
+static void start(gj_handle &gjh, physicsstruc &physics, locstruc &loc, double utc, double dt)
+{
+    locstruc iloc;
+    physics = physicsstruc();
+    physics.mass = 1.;
+    physics.area = .01;
+    physics.moi = rv_one();
+    gauss_jackson_init(gjh, 8, 0, dt, utc, 500000., RADOF(51.6), 10., iloc, physics, loc);
+}
+
+int main(int argc, char *argv[])
+{
+    double hours = 24.;
+    double dt = 1.;
+    if (argc > 1)
+    {
+        hours = atof(argv[1]);
+    }
+    if (argc > 2)
+    {
+        dt = atof(argv[2]);
+    }
+    string resources;
+    if (get_cosmosresources(resources) < 0)
+    {
+        printf("Unable to find COSMOS resources\n");
+        exit(1);
+    }
+
+    double utc = 58000.;
+    double tomjd = utc + hours / 24.;
+
+    // Keeping every step
+    gj_handle gjh;
+    physicsstruc physics;
+    locstruc loc;
+    start(gjh, physics, loc, utc, dt);
+    size_t base = heap_bytes;
+    heap_peak = heap_bytes;
+    ElapsedTime et;
+    size_t vsteps = gauss_jackson_propagate(gjh, physics, loc, tomjd).size() - 1;
+    double tvector = et.split();
+    size_t vpeak = heap_peak - base;
+    cartpos vend = loc.pos.eci;
+
+    // Streaming them
+    gj_handle sgjh;
+    start(sgjh, physics, loc, utc, dt);
+    base = heap_bytes;
+    heap_peak = heap_bytes;
+    double distance = 0.;
+    cartpos last = sgjh.loc.pos.eci;
+    et.reset();
+    int32_t ssteps = gauss_jackson_propagate(sgjh, physics, loc, tomjd, [&] (const gj_sample &sample)
+    {
+        distance += length_rv(rv_sub(sample.eci.s, last.s));
+        last = sample.eci;
+    });
+    double tstream = et.split();
+    size_t speak = heap_peak - base;
+
+    bool same = vsteps == (size_t)ssteps && memcmp(&vend.s, &last.s, sizeof(rvector)) == 0 && memcmp(&vend.v, &last.v, sizeof(rvector)) == 0 && memcmp(&loc.pos.eci.s, &last.s, sizeof(rvector)) == 0;
+
+    printf("%.1f hours at %.1f s, integrator state of %u bytes per step\n", hours, dt, (uint32_t)sizeof(gjstruc));
+    printf("vector of locstruc: %8u steps %9.3f MB peak %10.0f steps/s\n", (uint32_t)vsteps, vpeak / 1048576., vsteps / tvector);
+    printf("streaming ECI:      %8d steps %9.3f MB peak %10.0f steps/s  %5.2fx\n", ssteps, speak / 1048576., ssteps / tstream, tvector / tstream);
+    printf("travelled %.0f km, ending at %.3f %.3f %.3f km\n", distance / 1000., last.s.col[0] / 1000., last.s.col[1] / 1000., last.s.col[2] / 1000.);
+    printf("end points %s\n", same ? "agree" : "DISAGREE");
+    if (!same)
+    {
+        exit(1);
+    }
+}
@@ -0,0 +1,300 @@
+// Bandwidth of posting SOH in full every period, against posting only what changed
+// Usage: jsondelta [seconds] [full_seconds]
+// A node with a typical mix of devices is set up in memory and its default SOH list
+// (json_list_of_soh) is posted once a second, as agent_exec does. Values are written straight in
+// to the namespace at the rates they would be in flight: attitude, position, rates and power every
+// second; utc as each device is sampled; temperatures and battery state slowly; names, types and
+// counts never. Bytes posted are compared for json_of_table every time, json_of_table_since with
+// a full post every full_seconds, and json_of_table_since alone. A receiver parses the changes in
+// to its own copy, which is checked against the sender at the end. The whole run is then repeated
+// with another thread parsing different values in to the secondary data all the while, as
+// agent_exec's collect thread does, which must not change the changes posted.
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+#include "support/elapsedtime.h"
+#include <atomic>
+#include <thread>
+
+struct device_mix
+{
+    uint16_t type;
+    uint16_t count;
+    // Seconds between samples, or 0 for never
+    uint16_t sample;
+};
+
+static const device_mix mix[] = {
+    {DEVICE_TYPE_IMU, 2, 1},
+    {DEVICE_TYPE_RW, 3, 1},
+    {DEVICE_TYPE_MTR, 3, 1},
+    {DEVICE_TYPE_GPS, 1, 1},
+    {DEVICE_TYPE_CPU, 2, 1},
+    {DEVICE_TYPE_SSEN, 6, 1},
+    {DEVICE_TYPE_BATT, 4, 10},
+    {DEVICE_TYPE_TSEN, 24, 10},
+    {DEVICE_TYPE_ANT, 2, 0},
+    {DEVICE_TYPE_RXR, 2, 10},
+    {DEVICE_TYPE_TXR, 2, 10},
+    {DEVICE_TYPE_HTR, 6, 10},
+    {DEVICE_TYPE_SWCH, 12, 0},
+    {DEVICE_TYPE_BUS, 8, 10},
+};
+
+static cosmosstruc *make_node()
+{
+    cosmosstruc *cinfo = json_create();
+    if (cinfo == nullptr)
+    {
+        return nullptr;
+    }
+
+    char entry[200];
+    jsonnode json;
+    uint16_t count = 0;
+    for (const device_mix &group : mix)
+    {
+        for (uint16_t didx=0; didx<group.count; ++didx, ++count)
+        {
+            sprintf(entry, "{\"piece_type_%03u\":0}{\"piece_cidx_%03u\":%u}", count, count, count);
+            json.pieces += entry;
+            sprintf(entry, "{\"comp_type_%03u\":%u}{\"comp_didx_%03u\":%u}{\"comp_pidx_%03u\":%u}", count, group.type, count, didx, count, count);
+            json.devgen += entry;
+        }
+    }
+    sprintf(entry, "{\"node_name\":\"delta\"}{\"piece_cnt\":%u}{\"comp_cnt\":%u}{\"port_cnt\":0}", count, count);
+    json.node = entry;
+    if (json_setup_node(json, cinfo, false) < 0 || json_clone(cinfo->pdata, cinfo->sdata) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+// Seconds between changes for an SOH name
+static uint16_t change_period(const std::string &name)
+{
+    if (name.compare(0, 7, "device_"))
+    {
+        // Node: attitude, position and power move all the time; name, type and state do not
+        if (name.find("loc") != std::string::npos || name.find("pow") != std::string::npos || name.find("battlev") != std::string::npos)
+        {
+            return 1;
+        }
+        return 0;
+    }
+
+    // Devices change only when sampled, and then only their measurements
+    for (const device_mix &group : mix)
+    {
+        std::string prefix = "device_" + device_type_name(group.type) + "_";
+        if (name.compare(0, prefix.size(), prefix) == 0)
+        {
+            if (name.find("boot_count") != std::string::npos || name.find("status") != std::string::npos || name.find("position_type") != std::string::npos || name.find("freq") != std::string::npos || name.find("band") != std::string::npos)
+            {
+                return 0;
+            }
+            if (name.find("temp") != std::string::npos && group.sample == 1)
+            {
+                return 10;
+            }
+            return group.sample;
+        }
+    }
+    return 0;
+}
+
+// Nudge a value, as a fresh measurement would
+static void nudge(jsonentry *entry, cosmosmetastruc &cmeta, cosmosdatastruc &cdata, double step)
+{
+    uint8_t *data = json_ptr_of_offset(entry->offset, entry->group, cmeta, cdata);
+    switch (entry->type)
+    {
+    case JSON_TYPE_FLOAT:
+        *(float *)data += step;
+        break;
+    case JSON_TYPE_UINT16:
+        *(uint16_t *)data += 1;
+        break;
+    case JSON_TYPE_UINT32:
+        *(uint32_t *)data += 1;
+        break;
+    case JSON_TYPE_DOUBLE:
+    case JSON_TYPE_TIMESTAMP:
+        *(double *)data += step;
+        break;
+    default:
+        // Vectors, positions and attitudes all start with a double
+        if (entry->size >= sizeof(double))
+        {
+            *(double *)data += step;
+        }
+        break;
+    }
+}
+
+struct delta_run
+{
+    double bytes_full = 0.;
+    double bytes_refresh = 0.;
+    double bytes_delta = 0.;
+    double time_full = 0.;
+    double time_delta = 0.;
+    // Every change posted, in order
+    string posted;
+    bool match = false;
+};
+
+// Post the SOH of a fresh node for the given seconds, with or without a parser busy on sdata
+static int32_t run(uint32_t seconds, uint32_t full, bool parser, delta_run &result)
+{
+    cosmosstruc *cinfo = make_node();
+    cosmosstruc *rinfo = make_node();
+    if (cinfo == nullptr || rinfo == nullptr)
+    {
+        json_destroy(cinfo);
+        json_destroy(rinfo);
+        return GENERAL_ERROR_NULLPOINTER;
+    }
+
+    vector<jsonentry *> table;
+    json_table_of_list(table, json_list_of_soh(cinfo->pdata), cinfo->meta);
+    vector<uint16_t> period;
+    uint32_t moving = 0;
+    for (jsonentry *entry : table)
+    {
+        // Names in the list that this node lacks are left empty in the table
+        period.push_back(entry == nullptr ? 0 : change_period(json_name_of(entry, cinfo->meta)));
+        moving += period.back() == 1;
+    }
+    if (!parser)
+    {
+        printf("%u devices, %u SOH values, %u changing every second, %u s, full every %u s\n", (uint32_t)cinfo->pdata.device.size(), (uint32_t)table.size(), moving, seconds, full);
+    }
+
+    // Secondary data gets its own values, parsed in over and over
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> parses(0);
+    std::thread collect;
+    if (parser)
+    {
+        for (size_t i=0; i<table.size(); ++i)
+        {
+            if (table[i] != nullptr)
+            {
+                nudge(table[i], cinfo->meta, cinfo->sdata, 1. + i);
+            }
+        }
+        string incoming;
+        json_of_table(incoming, table, cinfo->meta, cinfo->sdata);
+        collect = std::thread([&, incoming]()
+        {
+            while (running)
+            {
+                json_parse(incoming, cinfo->meta, cinfo->sdata);
+                ++parses;
+            }
+        });
+        while (parses == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    string jstring;
+    uint32_t version_refresh = 0;
+    uint32_t version_delta = 0;
+    ElapsedTime et;
+    for (uint32_t second=0; second<seconds; ++second)
+    {
+        for (size_t i=0; i<table.size(); ++i)
+        {
+            // Spread the slower samples over their period
+            if (period[i] && (second + i) % period[i] == 0)
+            {
+                nudge(table[i], cinfo->meta, cinfo->pdata, .001 * (1 + second % 7));
+            }
+        }
+
+        et.reset();
+        json_of_table(jstring, table, cinfo->meta, cinfo->pdata);
+        result.time_full += et.split();
+        result.bytes_full += jstring.size();
+
+        if (full && second % full == 0)
+        {
+            version_refresh = 0;
+        }
+        json_of_table_since(jstring, table, version_refresh, cinfo->meta, cinfo->pdata);
+        result.bytes_refresh += jstring.size();
+
+        // Changes only, after the first
+        et.reset();
+        json_of_table_since(jstring, table, version_delta, cinfo->meta, cinfo->pdata);
+        result.time_delta += et.split();
+        result.bytes_delta += jstring.size();
+        result.posted += jstring;
+        json_parse(jstring, rinfo->meta, rinfo->pdata);
+
+        if (parser)
+        {
+            // Let the parser in between every post
+            uint32_t count = parses;
+            while (parses < count + 2)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    if (parser)
+    {
+        running = false;
+        collect.join();
+    }
+
+    // The receiver of changes only should end up with the same values
+    string sent, received;
+    vector<jsonentry *> rtable;
+    json_table_of_list(rtable, json_list_of_soh(rinfo->pdata), rinfo->meta);
+    json_of_table(sent, table, cinfo->meta, cinfo->pdata);
+    json_of_table(received, rtable, rinfo->meta, rinfo->pdata);
+    result.match = sent == received;
+
+    json_destroy(cinfo);
+    json_destroy(rinfo);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seconds = 600;
+    uint32_t full = 10;
+
+    if (argc > 1)
+    {
+        seconds = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        full = atol(argv[2]);
+    }
+
+    delta_run alone, shared;
+    if (run(seconds, full, false, alone) < 0 || run(seconds, full, true, shared) < 0)
+    {
+        printf("Unable to set up node\n");
+        exit(1);
+    }
+    bool same = alone.posted == shared.posted;
+
+    printf("full every second:      %8.0f bytes/s %8.1f us\n", alone.bytes_full / seconds, 1e6 * alone.time_full / seconds);
+    printf("changes, full every %2u: %8.0f bytes/s  %5.1f%% saved\n", full, alone.bytes_refresh / seconds, 100. * (1. - alone.bytes_refresh / alone.bytes_full));
+    printf("changes only:           %8.0f bytes/s %8.1f us  %5.1f%% saved\n", alone.bytes_delta / seconds, 1e6 * alone.time_delta / seconds, 100. * (1. - alone.bytes_delta / alone.bytes_full));
+    printf("receiver of changes %s\n", alone.match ? "matches" : "DOES NOT MATCH");
+    printf("with sdata parsed meanwhile: %8.0f bytes/s, changes %s, receiver %s\n", shared.bytes_delta / seconds, same ? "the same" : "DIFFER", shared.match ? "matches" : "DOES NOT MATCH");
+
+    if (!alone.match || !shared.match || !same)
+    {
+        exit(1);
+    }
+}
@@ -0,0 +1,267 @@
+// Message ingest rate and view consistency of agent_monitor, before and after namespace snapshots
+// Usage: jsonsnapshot [devices] [messages] [devices_per_message]
+// A node with the given number of temperature sensors is set up in memory. Messages each carry a
+// temperature and time for some of the devices, as an agent's SOH would. They are parsed once the
+// way agent_monitor used to (node and devices copied to the secondary, parsed, copied back, then
+// scanned by value), and once the way it does now (parsed straight in to the secondary, published
+// with json_snapshot_publish after every batch, and taken by the main loop with
+// json_snapshot_acquire). Then a writer thread sets every device to the same value, over and
+// over, while a reader checks that all the devices it sees agree. Last, a value is set in the
+// primary as a setvalue request would, and must survive SOH for the other devices being
+// published both before and after the writer takes it.
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+#include "support/convertlib.h"
+#include "support/elapsedtime.h"
+#include <atomic>
+
+static cosmosstruc *make_node(uint16_t devices)
+{
+    cosmosstruc *cinfo = json_create();
+    if (cinfo == nullptr)
+    {
+        return nullptr;
+    }
+
+    char entry[100];
+    jsonnode json;
+    sprintf(entry, "{\"node_name\":\"snapshot\"}{\"piece_cnt\":%u}{\"comp_cnt\":%u}{\"port_cnt\":0}", devices, devices);
+    json.node = entry;
+    for (uint16_t i=0; i<devices; ++i)
+    {
+        sprintf(entry, "{\"piece_type_%03u\":0}{\"piece_cidx_%03u\":%u}", i, i, i);
+        json.pieces += entry;
+        sprintf(entry, "{\"comp_type_%03u\":%u}{\"comp_didx_%03u\":%u}{\"comp_pidx_%03u\":%u}", i, DEVICE_TYPE_TSEN, i, i, i, i);
+        json.devgen += entry;
+    }
+    if (json_setup_node(json, cinfo, false) < 0 || json_clone(cinfo->pdata, cinfo->sdata) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+// Temperature and time for count devices, starting from first
+static std::string make_message(uint16_t first, uint16_t count, uint16_t devices, float temp, double utc)
+{
+    std::string message;
+    char entry[100];
+    for (uint16_t i=0; i<count; ++i)
+    {
+        uint16_t cidx = (first + i) % devices;
+        sprintf(entry, "{\"device_tsen_temp_%03u\":%.3f}{\"comp_utc_%03u\":%.15g}", cidx, temp, cidx, utc);
+        message += entry;
+    }
+    return message;
+}
+
+// As agent_monitor did, for every message
+static void ingest_old(cosmosstruc *cinfo, const std::string &message)
+{
+    cinfo->sdata.node = cinfo->pdata.node;
+    cinfo->sdata.device = cinfo->pdata.device;
+    json_parse(message, cinfo->meta, cinfo->sdata);
+    cinfo->pdata.node = cinfo->sdata.node;
+    cinfo->pdata.device = cinfo->sdata.device;
+    loc_update(&cinfo->pdata.node.loc);
+    cinfo->pdata.node.utc = currentmjd(0.);
+    for (devicestruc device: cinfo->pdata.device)
+    {
+        if (device.all.gen.utc > cinfo->pdata.node.utc)
+        {
+            cinfo->pdata.node.utc = device.all.gen.utc;
+        }
+    }
+}
+
+// As agent_monitor does, for every batch of messages
+static void publish_new(cosmosstruc *cinfo, json_snapshot &snapshot)
+{
+    loc_update(&cinfo->sdata.node.loc);
+    cinfo->sdata.node.utc = currentmjd(0.);
+    for (devicestruc &device: cinfo->sdata.device)
+    {
+        if (device.all.gen.utc > cinfo->sdata.node.utc)
+        {
+            cinfo->sdata.node.utc = device.all.gen.utc;
+        }
+    }
+    json_snapshot_publish(snapshot, cinfo->sdata);
+}
+
+static double ingest_rate(cosmosstruc *cinfo, const std::vector<std::string> &messages, uint16_t batch)
+{
+    json_snapshot snapshot;
+    json_snapshot_init(snapshot, cinfo->pdata);
+    ElapsedTime et;
+    for (size_t i=0; i<messages.size(); ++i)
+    {
+        if (batch == 0)
+        {
+            ingest_old(cinfo, messages[i]);
+        }
+        else
+        {
+            json_parse(messages[i], cinfo->meta, cinfo->sdata);
+            if ((i + 1) % batch == 0)
+            {
+                publish_new(cinfo, snapshot);
+                json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata);
+            }
+        }
+    }
+    return messages.size() / et.split();
+}
+
+static bool agree(cosmosdatastruc &cdata)
+{
+    for (devicestruc &device : cdata.device)
+    {
+        if (device.tsen.gen.temp != cdata.device[0].tsen.gen.temp)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Count views in which the devices disagree, while a writer keeps setting them all alike
+static uint32_t torn_views(cosmosstruc *cinfo, bool snapshots, double seconds, uint32_t &views)
+{
+    json_snapshot snapshot;
+    json_snapshot_init(snapshot, cinfo->pdata);
+    std::atomic<bool> done(false);
+    uint16_t devices = cinfo->pdata.device.size();
+
+    std::thread writer([&] {
+        for (uint32_t k=0; !done; ++k)
+        {
+            std::string message = make_message(0, devices, devices, k % 1000, 0.);
+            if (snapshots)
+            {
+                json_parse(message, cinfo->meta, cinfo->sdata);
+                publish_new(cinfo, snapshot);
+            }
+            else
+            {
+                ingest_old(cinfo, message);
+            }
+        }
+    });
+
+    uint32_t torn = 0;
+    views = 0;
+    ElapsedTime et;
+    while (et.split() < seconds)
+    {
+        if (snapshots)
+        {
+            json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata);
+        }
+        ++views;
+        if (!agree(cinfo->pdata))
+        {
+            ++torn;
+        }
+        std::this_thread::yield();
+    }
+    done = true;
+    writer.join();
+    return torn;
+}
+
+// Whether a value set as Agent::req_setvalue does is kept by the reader and reaches the writer
+static bool setvalue_kept(cosmosstruc *cinfo)
+{
+    json_snapshot snapshot;
+    json_snapshot_init(snapshot, cinfo->pdata);
+    uint16_t devices = cinfo->pdata.device.size();
+    uint16_t target = devices - 1;
+    char request[100];
+    sprintf(request, "setvalue {\"device_tsen_temp_%03u\":123.5}", target);
+
+    json_parse(make_message(0, devices, devices, 20., 0.), cinfo->meta, cinfo->sdata);
+    publish_new(cinfo, snapshot);
+    json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata);
+    json_snapshot_set(snapshot, request);
+    json_parse(request, cinfo->meta, cinfo->pdata);
+
+    // SOH for the other devices published before the writer takes the value
+    bool kept = true;
+    json_parse(make_message(target + 1, devices - 1, devices, 30., 0.), cinfo->meta, cinfo->sdata);
+    publish_new(cinfo, snapshot);
+    kept = json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata) == 1 && kept;
+    kept = cinfo->pdata.device[target].tsen.gen.temp == 123.5f && cinfo->pdata.device[0].tsen.gen.temp == 30.f && kept;
+
+    // Then, as collect_data_loop does, taken along with more SOH
+    kept = json_snapshot_take(snapshot, cinfo->meta, cinfo->sdata) == 1 && kept;
+    json_parse(make_message(target + 1, devices - 1, devices, 40., 0.), cinfo->meta, cinfo->sdata);
+    publish_new(cinfo, snapshot);
+    kept = json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata) == 1 && kept;
+    kept = cinfo->pdata.device[target].tsen.gen.temp == 123.5f && cinfo->pdata.device[0].tsen.gen.temp == 40.f && kept;
+
+    // And nothing left to apply again once it has been published
+    kept = cinfo->sdata.device[target].tsen.gen.temp == 123.5f && snapshot.pending.empty() && snapshot.taken.empty() && kept;
+    json_parse(make_message(target + 1, devices - 1, devices, 50., 0.), cinfo->meta, cinfo->sdata);
+    publish_new(cinfo, snapshot);
+    kept = json_snapshot_acquire(snapshot, cinfo->meta, cinfo->pdata) == 1 && kept;
+    kept = cinfo->pdata.device[target].tsen.gen.temp == 123.5f && cinfo->pdata.device[0].tsen.gen.temp == 50.f && kept;
+    return kept;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t devices = 200;
+    uint32_t count = 20000;
+    uint16_t per_message = 10;
+
+    if (argc > 1)
+    {
+        devices = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        count = atol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        per_message = atoi(argv[3]);
+    }
+
+    cosmosstruc *cinfo = make_node(devices);
+    if (cinfo == nullptr || cinfo->pdata.device.size() != devices)
+    {
+        printf("Unable to set up node of %u devices\n", devices);
+        exit(1);
+    }
+
+    std::vector<std::string> messages;
+    for (uint32_t i=0; i<count; ++i)
+    {
+        messages.push_back(make_message(i * per_message, per_message, devices, i % 100, 59000. + i / 86400.));
+    }
+
+    printf("%u devices of %u bytes, %u messages of %u devices\n", devices, (uint32_t)sizeof(devicestruc), count, per_message);
+    double old_rate = ingest_rate(cinfo, messages, 0);
+    printf("copy per message:      %9.0f messages/s\n", old_rate);
+    for (uint16_t batch : {1, 10, 100})
+    {
+        double rate = ingest_rate(cinfo, messages, batch);
+        printf("snapshot per %3u:      %9.0f messages/s  %5.1fx\n", batch, rate, rate / old_rate);
+    }
+
+    uint32_t old_views, new_views;
+    uint32_t old_torn = torn_views(cinfo, false, 2., old_views);
+    uint32_t new_torn = torn_views(cinfo, true, 2., new_views);
+    printf("torn views, copy per message: %u of %u\n", old_torn, old_views);
+    printf("torn views, snapshot:         %u of %u\n", new_torn, new_views);
+    bool kept = setvalue_kept(cinfo);
+    printf("value set by request %s\n", kept ? "kept" : "LOST");
+
+    json_destroy(cinfo);
+    if (new_torn || !kept)
+    {
+        exit(1);
+    }
+}
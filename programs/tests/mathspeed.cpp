@@ -6,6 +6,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include "support/elapsedtime.h"
+#include "math/mathlib.h"
+#include "math/fixedmatrix.h"
 
 #define BUFSIZE 10000000
 
@@ -162,4 +164,229 @@ int main(int argc, char **argv)
     printf("%6.3lf Mv10000flops (%.1lf)",1e-6/dvariable10000, dvariable10000/dassign);
     printf("\n");
 
+    // Small matrices, generic against fixed size. Each chain multiplies by a rotation, so the
+    // values stay bounded, and both ways must end up at the same place.
+    rmatrix rrot = rm_mmult(rm_change_around_z(.1), rm_change_around_x(.2));
+    fmatrix3 frot = fm_from_rm(rrot);
+    double disagree = 0.;
+
+    // 3x3 product
+    rmatrix rm = rm_eye();
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            rm = rm_mmult(rm, rrot);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    size_t rmcnt = loopcnt * 1000;
+    double drmmult = et.split() / rmcnt;
+    printf("%6.3lf Mrm_mmultps (%.1lf) : ",1e-6/drmmult, drmmult/dassign);
+    fflush(stdout);
+
+    fmatrix3 fm = fm_eye<3>();
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            fm = fm_mmult(fm, frot);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double dfmmult = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mfm_mmult3ps (%.1lf) : ",1e-6/dfmmult, dfmmult/dassign);
+    fflush(stdout);
+    // Same number of products, to compare
+    fm = fm_eye<3>();
+    for (size_t i=0; i<rmcnt; ++i)
+    {
+        fm = fm_mmult(fm, frot);
+    }
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            disagree = fmax(disagree, fabs(rm.row[i].col[j] - fm.a[i][j]));
+        }
+    }
+
+    // Matrix times vector
+    rvector rv = rv_unitx();
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            rv = rv_mmult(rrot, rv);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    size_t rvcnt = loopcnt * 1000;
+    double drvmult = et.split() / rvcnt;
+    printf("%6.3lf Mrv_mmultps (%.1lf) : ",1e-6/drvmult, drvmult/dassign);
+    fflush(stdout);
+
+    fvector3 fv = fv_from_rv(rv_unitx());
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            fv = fv_mmult(frot, fv);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double dfvmult = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mfv_mmult3ps (%.1lf) : ",1e-6/dfvmult, dfvmult/dassign);
+    fflush(stdout);
+    fv = fv_from_rv(rv_unitx());
+    for (size_t i=0; i<rvcnt; ++i)
+    {
+        fv = fv_mmult(frot, fv);
+    }
+    disagree = fmax(disagree, length_rv(rv_sub(rv, rv_from_fv(fv))));
+
+    // 3x3 inverse, of a matrix that is not a rotation
+    rmatrix rskew = rm_add(rrot, rm_smult(.3, rm_skew(rv_one())));
+    rm = rskew;
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            rm = rm_inverse(rm);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double drminverse = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mrm_inverseps (%.1lf) : ",1e-6/drminverse, drminverse/dassign);
+    fflush(stdout);
+
+    fm = fm_from_rm(rskew);
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            fm = fm_inverse(fm);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double dfminverse = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mfm_inverse3ps (%.1lf) : ",1e-6/dfminverse, dfminverse/dassign);
+    fflush(stdout);
+    fmatrix3 fcheck = fm_sub(fm_inverse(fm_from_rm(rskew)), fm_from_rm(rm_inverse(rskew)));
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            disagree = fmax(disagree, fabs(fcheck.a[i][j]));
+        }
+    }
+
+    // 3x3 product through matrix2d, the largest m2_mmult will take
+    matrix2d m2rot = m2_from_fm(frot);
+    matrix2d m2 = m2_eye(3);
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            m2 = m2_mmult(m2, m2rot);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    size_t m2cnt = loopcnt * 1000;
+    double dm2mult = et.split() / m2cnt;
+    printf("%6.3lf Mm2_mmultps (%.1lf) : ",1e-6/dm2mult, dm2mult/dassign);
+    fflush(stdout);
+    fm = fm_eye<3>();
+    for (size_t i=0; i<m2cnt; ++i)
+    {
+        fm = fm_mmult(fm, frot);
+    }
+    fcheck = fm_sub(fm, fm_from_m2<3,3>(m2));
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            disagree = fmax(disagree, fabs(fcheck.a[i][j]));
+        }
+    }
+
+    // 4x4 product, rotating about a different plane each way
+    fmatrix4 f4rot = fm_eye<4>();
+    f4rot.a[0][0] = f4rot.a[3][3] = cos(.1);
+    f4rot.a[0][3] = sin(.1);
+    f4rot.a[3][0] = -sin(.1);
+    fmatrix4 f4rot3 = fm_from_m2<4,4>(m2rot);
+    f4rot3.a[3][3] = 1.;
+    f4rot = fm_mmult(f4rot, f4rot3);
+    fmatrix4 f4 = fm_eye<4>();
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            f4 = fm_mmult(f4, f4rot);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double df4mult = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mfm_mmult4ps (%.1lf) : ",1e-6/df4mult, df4mult/dassign);
+    fflush(stdout);
+    // Still a rotation
+    fmatrix4 f4check = fm_sub(fm_mmult(f4, fm_transpose(f4)), fm_eye<4>());
+    for (size_t i=0; i<4; ++i)
+    {
+        for (size_t j=0; j<4; ++j)
+        {
+            disagree = fmax(disagree, fabs(f4check.a[i][j]));
+        }
+    }
+
+    // 6x6 covariance propagation, with a block rotation of position and velocity
+    fmatrix6 f6rot = fm_zero<6,6>();
+    fmatrix6 f6 = fm_eye<6>();
+    for (size_t i=0; i<3; ++i)
+    {
+        for (size_t j=0; j<3; ++j)
+        {
+            f6rot.a[i][j] = f6rot.a[i+3][j+3] = frot.a[i][j];
+        }
+        f6.a[i][i] = 1e4;
+    }
+    loopcnt = 0;
+    et.reset();
+    do
+    {
+        for (size_t i=0; i<1000; ++i)
+        {
+            f6 = fm_quadratic(f6rot, f6);
+        }
+        ++loopcnt;
+    } while (et.split() < 5.);
+    double df6quad = et.split() / (loopcnt*1000.);
+    printf("%6.3lf Mfm_quadratic6ps (%.1lf) : ",1e-6/df6quad, df6quad/dassign);
+    fflush(stdout);
+    double trace = 0.;
+    for (size_t i=0; i<6; ++i)
+    {
+        trace += f6.a[i][i];
+    }
+    disagree = fmax(disagree, fabs(trace - 30003.) / 30003.);
+    printf("disagree %.1e", disagree);
+    printf("\n");
+
 }
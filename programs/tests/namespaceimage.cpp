@@ -0,0 +1,196 @@
+// Namespace set up time of an Agent, from the Node description and from the Namespace image
+// Usage: namespaceimage [devices] [runs]
+// A Node with the given number of devices of mixed types, an alias and an equation is written
+// to a temporary nodes directory. The Namespace is then set up the way Agents did before
+// images (json_load_node and json_setup_node from the JSON), the first time with the image
+// being made, and from the image. The two Namespaces are compared name by name and value by
+// value, and the image is checked to be remade when the description changes.
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+#include "support/elapsedtime.h"
+#include <sys/stat.h>
+
+#define NODE_NAME "imagetest"
+
+static bool make_node(uint16_t count)
+{
+    cosmosstruc *cinfo = json_create();
+    uint16_t types[] = {DEVICE_TYPE_TSEN, DEVICE_TYPE_IMU, DEVICE_TYPE_RW, DEVICE_TYPE_MTR, DEVICE_TYPE_BATT, DEVICE_TYPE_SWCH, DEVICE_TYPE_CPU, DEVICE_TYPE_HTR};
+    uint16_t didx[8] = {0};
+    char entry[300];
+    jsonnode json;
+    for (uint16_t i=0; i<count; ++i)
+    {
+        uint16_t type = types[i % 8];
+        sprintf(entry, "{\"piece_name_%03u\":\"piece%u\"}{\"piece_type_%03u\":0}{\"piece_cidx_%03u\":%u}{\"piece_mass_%03u\":%.1f}", i, i, i, i, i, i, 1. + i % 5);
+        json.pieces += entry;
+        sprintf(entry, "{\"comp_type_%03u\":%u}{\"comp_didx_%03u\":%u}{\"comp_pidx_%03u\":%u}{\"comp_nvolt_%03u\":%.1f}", i, type, i, didx[i % 8]++, i, i, i, 3.3 + i % 3);
+        json.devgen += entry;
+    }
+    sprintf(entry, "{\"node_name\":\"%s\"}{\"node_type\":0}{\"piece_cnt\":%u}{\"comp_cnt\":%u}{\"port_cnt\":0}", NODE_NAME, count, count);
+    json.node = entry;
+    bool good = json_setup_node(json, cinfo, false) >= 0;
+    good = good && json_addentry("first_temp", "device_tsen_temp_000", cinfo->meta) >= 0;
+    good = good && json_addentry("mean_temp", "(\"device_tsen_temp_000\"+\"device_tsen_temp_001\")", cinfo->meta) >= 0;
+    good = good && json_dump_node(cinfo->meta, cinfo->pdata) >= 0;
+    json_destroy(cinfo);
+    return good;
+}
+
+// As Agents set up before images
+static cosmosstruc *setup_json()
+{
+    cosmosstruc *cinfo = json_create();
+    jsonnode json;
+    if (json_load_node(NODE_NAME, json) < 0 || json_setup_node(json, cinfo) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+// As Agents set up now
+static cosmosstruc *setup_image()
+{
+    cosmosstruc *cinfo = json_create();
+    if (json_setup_node(NODE_NAME, cinfo) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+static string describe(cosmosstruc *cinfo)
+{
+    string description, jstring;
+    char line[200];
+    for (vector<uint32_t> &bucket : cinfo->meta.jmap)
+    {
+        for (uint32_t index : bucket)
+        {
+            jsonentry *entry = json_entry_at(index, cinfo->meta);
+            sprintf(line, "%s %u %u %ld %lu %u\n", json_name_of(entry, cinfo->meta), entry->type, entry->group, (long)entry->offset, (unsigned long)entry->size, entry->enabled ? 1 : 0);
+            description += line;
+        }
+    }
+    for (vector<jsonequation> &bucket : cinfo->meta.emap)
+    {
+        for (jsonequation &equation : bucket)
+        {
+            description += string(equation.text) + "\n";
+        }
+    }
+    description += json_node(jstring, cinfo->meta, cinfo->pdata);
+    description += json_pieces(jstring, cinfo->meta, cinfo->pdata);
+    description += json_devices_general(jstring, cinfo->meta, cinfo->pdata);
+    description += json_devices_specific(jstring, cinfo->meta, cinfo->pdata);
+    for (aliasstruc &alias : cinfo->meta.alias)
+    {
+        description += alias.name + " " + (alias.type == JSON_TYPE_EQUATION ? string(cinfo->meta.emap[alias.handle.hash][alias.handle.index].text) : string(json_name_of(json_entry_of(alias.handle, cinfo->meta), cinfo->meta))) + "\n";
+    }
+    // Specific devices must point in to this Namespace's own devices
+    for (uint16_t i=0; i<cinfo->pdata.devspec.tsen_cnt; ++i)
+    {
+        sprintf(line, "tsen %u at %ld\n", i, (long)((devicestruc *)cinfo->pdata.devspec.tsen[i] - cinfo->pdata.device.data()));
+        description += line;
+    }
+    return description;
+}
+
+static double time_setup(cosmosstruc *(*setup)(), uint32_t runs, bool fresh)
+{
+    double seconds = 0.;
+    for (uint32_t i=0; i<runs; ++i)
+    {
+        if (fresh)
+        {
+            remove(json_image_path(NODE_NAME).c_str());
+        }
+        ElapsedTime et;
+        cosmosstruc *cinfo = setup();
+        seconds += et.split();
+        json_destroy(cinfo);
+    }
+    return seconds / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t devices = 300;
+    uint32_t runs = 10;
+    if (argc > 1)
+    {
+        devices = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        runs = atol(argv[2]);
+    }
+
+    char nodes[] = "/tmp/namespaceimageXXXXXX";
+    if (mkdtemp(nodes) == nullptr)
+    {
+        printf("Unable to make nodes directory\n");
+        exit(1);
+    }
+    setenv("COSMOSNODES", nodes, 1);
+    if (!make_node(devices))
+    {
+        printf("Unable to make node of %u devices\n", devices);
+        exit(1);
+    }
+
+    double tcreate = 0.;
+    for (uint32_t i=0; i<runs; ++i)
+    {
+        ElapsedTime et;
+        cosmosstruc *cinfo = json_create();
+        tcreate += et.split();
+        json_destroy(cinfo);
+    }
+    tcreate /= runs;
+    double tjson = time_setup(setup_json, runs, false);
+    double tfirst = time_setup(setup_image, runs, true);
+    double timage = time_setup(setup_image, runs, false);
+    struct stat fstat;
+    stat(json_image_path(NODE_NAME).c_str(), &fstat);
+
+    cosmosstruc *cjson = setup_json();
+    cosmosstruc *cimage = setup_image();
+    bool match = cjson != nullptr && cimage != nullptr && cjson->meta.jmapped == cimage->meta.jmapped && describe(cjson) == describe(cimage);
+    uint16_t names = cjson != nullptr ? cjson->meta.jmapped : 0;
+    json_destroy(cjson);
+    json_destroy(cimage);
+
+    // Change the description: the next Agent should remake the image, and see the change
+    string devgen = get_nodedir(NODE_NAME) + "/devices_general.ini";
+    FILE *fp = fopen(devgen.c_str(), "a");
+    fprintf(fp, "{\"comp_nvolt_000\":12.5}");
+    fclose(fp);
+    cimage = setup_image();
+    bool remade = cimage != nullptr && cimage->pdata.device[0].all.gen.nvolt == 12.5f;
+    json_destroy(cimage);
+    cimage = setup_image();
+    remade = remade && cimage != nullptr && cimage->pdata.device[0].all.gen.nvolt == 12.5f;
+    json_destroy(cimage);
+
+    printf("%u devices, %u names, image of %ld bytes\n", devices, names, (long)fstat.st_size);
+    printf("json_create:              %8.3f ms\n", 1e3 * tcreate);
+    printf("setup from JSON:          %8.3f ms\n", 1e3 * tjson);
+    printf("setup, making the image:  %8.3f ms\n", 1e3 * tfirst);
+    printf("setup from image:         %8.3f ms  %5.1fx\n", 1e3 * timage, tjson / timage);
+    printf("image and JSON Namespaces %s\n", match ? "match" : "DIFFER");
+    printf("image %s after change\n", remade ? "remade" : "NOT REMADE");
+
+    string command = string("rm -rf ") + nodes;
+    if (system(command.c_str()) != 0)
+    {
+        printf("Unable to remove %s\n", nodes);
+    }
+    if (!match || !remade)
+    {
+        exit(1);
+    }
+}
@@ -0,0 +1,177 @@
+// Memory and lookup speed of the Namespace map
+// Usage: namespacememory [devices] [runs]
+// A Node with the given number of devices of mixed types is set up in memory. The heap taken by
+// the Namespace meta information (cosmosmetastruc) is counted through operator new, along with
+// the number of blocks it is scattered over. Lookups are then timed the ways Agents make them: by
+// name with json_entry_of and json_name_map, every name in a shuffled order; by json_parse of an
+// SOH message; and by json_of_table of the SOH list.
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+#include "support/elapsedtime.h"
+#include <new>
+
+static size_t heap_bytes = 0;
+static size_t heap_blocks = 0;
+
+void *operator new(size_t size)
+{
+    size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *block = size;
+    heap_bytes += size;
+    ++heap_blocks;
+    return (uint8_t *)block + sizeof(max_align_t);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        size_t *block = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+        heap_bytes -= *block;
+        --heap_blocks;
+        free(block);
+    }
+}
+
+static cosmosstruc *make_node(uint16_t count)
+{
+    cosmosstruc *cinfo = json_create();
+    if (cinfo == nullptr)
+    {
+        return nullptr;
+    }
+
+    uint16_t types[] = {DEVICE_TYPE_TSEN, DEVICE_TYPE_IMU, DEVICE_TYPE_RW, DEVICE_TYPE_MTR, DEVICE_TYPE_BATT, DEVICE_TYPE_SWCH, DEVICE_TYPE_CPU, DEVICE_TYPE_HTR, DEVICE_TYPE_SSEN, DEVICE_TYPE_BUS};
+    uint16_t didx[10] = {0};
+    char entry[200];
+    jsonnode json;
+    for (uint16_t i=0; i<count; ++i)
+    {
+        uint16_t type = types[i % 10];
+        sprintf(entry, "{\"piece_type_%03u\":0}{\"piece_cidx_%03u\":%u}", i, i, i);
+        json.pieces += entry;
+        sprintf(entry, "{\"comp_type_%03u\":%u}{\"comp_didx_%03u\":%u}{\"comp_pidx_%03u\":%u}", i, type, i, didx[i % 10]++, i, i);
+        json.devgen += entry;
+    }
+    sprintf(entry, "{\"node_name\":\"memory\"}{\"piece_cnt\":%u}{\"comp_cnt\":%u}{\"port_cnt\":0}", count, count);
+    json.node = entry;
+    if (json_setup_node(json, cinfo, false) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+// Names in a list from json_list_of_all or json_list_of_soh
+static vector<string> split_list(const string &list)
+{
+    vector<string> names;
+    size_t start = list.find('"');
+    while (start != string::npos)
+    {
+        size_t end = list.find('"', start + 1);
+        names.push_back(list.substr(start + 1, end - start - 1));
+        start = list.find('"', end + 1);
+    }
+    return names;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t devices = 500;
+    uint32_t runs = 20;
+    if (argc > 1)
+    {
+        devices = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        runs = atol(argv[2]);
+    }
+
+    cosmosstruc *cinfo = make_node(devices);
+    if (cinfo == nullptr || cinfo->pdata.device.size() != devices)
+    {
+        printf("Unable to set up node of %u devices\n", devices);
+        exit(1);
+    }
+
+    vector<string> names = split_list(json_list_of_all(cinfo->meta));
+    srand(1);
+    for (size_t i=names.size()-1; i>0; --i)
+    {
+        std::swap(names[i], names[rand() % (i + 1)]);
+    }
+
+    // By name
+    ElapsedTime et;
+    size_t found = 0;
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        for (const string &name : names)
+        {
+            found += json_entry_of(name, cinfo->meta) != nullptr;
+        }
+    }
+    double tentry = et.split() / (runs * names.size());
+    et.reset();
+    jsonhandle handle;
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        for (const string &name : names)
+        {
+            found += json_name_map(name, cinfo->meta, handle) == 0;
+        }
+    }
+    double tmap = et.split() / (runs * names.size());
+
+    // By message and by table
+    vector<jsonentry *> table;
+    json_table_of_list(table, json_list_of_soh(cinfo->pdata), cinfo->meta);
+    // Values printed and parsed back settle after one round
+    string message;
+    json_of_table(message, table, cinfo->meta, cinfo->pdata);
+    json_parse(message, cinfo->meta, cinfo->pdata);
+    json_of_table(message, table, cinfo->meta, cinfo->pdata);
+    et.reset();
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        json_parse(message, cinfo->meta, cinfo->pdata);
+    }
+    double tparse = et.split() / runs;
+    string jstring;
+    et.reset();
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        json_of_table(jstring, table, cinfo->meta, cinfo->pdata);
+    }
+    double ttable = et.split() / runs;
+    bool same = jstring == message && found == 2 * runs * names.size();
+
+    // Heap taken by the meta information is what is given back when it is emptied
+    size_t bytes = heap_bytes;
+    size_t blocks = heap_blocks;
+    {
+        cosmosmetastruc empty;
+        std::swap(cinfo->meta, empty);
+    }
+    bytes -= heap_bytes;
+    blocks -= heap_blocks;
+
+    printf("%u devices, %u names, jsonentry of %u bytes\n", devices, (uint32_t)names.size(), (uint32_t)sizeof(jsonentry));
+    printf("meta heap:        %9.3f MB in %u blocks, %5.1f bytes per name\n", bytes / 1048576., (uint32_t)blocks, (double)bytes / names.size());
+    printf("json_entry_of:    %9.1f ns per name\n", 1e9 * tentry);
+    printf("json_name_map:    %9.1f ns per name\n", 1e9 * tmap);
+    printf("json_parse:       %9.1f us for %u SOH values\n", 1e6 * tparse, (uint32_t)table.size());
+    printf("json_of_table:    %9.1f us for %u SOH values\n", 1e6 * ttable, (uint32_t)table.size());
+    printf("lookups %s\n", same ? "agree" : "DISAGREE");
+    if (!same)
+    {
+        exit(1);
+    }
+}
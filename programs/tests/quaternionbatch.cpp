@@ -0,0 +1,244 @@
+// Agreement and speed of the batch quaternion functions, against the ones for one element
+// Usage: quaternionbatch [count] [runs]
+// Random unit quaternions and vectors, count of each, are put through rotate_q, transform_q,
+// q_mult, q_conjugate, rm_quaternion2dcm and q_slerp one at a time, then through the batch
+// functions of the same names, with the AVX2 kernels and without them. Each result must agree
+// with the one at a time result to within rounding, relative to its size.
+#include "support/configCosmos.h"
+#include "math/mathlib.h"
+#include "support/elapsedtime.h"
+#include <functional>
+
+static double random_unit()
+{
+    return 2. * rand() / RAND_MAX - 1.;
+}
+
+static double difference(const rvector &a, const rvector &b)
+{
+    return length_rv(rv_sub(a, b)) / (1. + length_rv(b));
+}
+
+static double difference(const quaternion &a, const quaternion &b)
+{
+    return length_q(q_sub(a, b)) / (1. + length_q(b));
+}
+
+static double difference(const rmatrix &a, const rmatrix &b)
+{
+    double worst = 0.;
+    for (int i=0; i<3; ++i)
+    {
+        worst = fmax(worst, difference(a.row[i], b.row[i]));
+    }
+    return worst;
+}
+
+template <class T> static double difference(const std::vector<T> &a, const std::vector<T> &b)
+{
+    if (a.size() != b.size())
+    {
+        return 1.;
+    }
+    double worst = 0.;
+    for (size_t i=0; i<a.size(); ++i)
+    {
+        worst = fmax(worst, difference(a[i], b[i]));
+    }
+    return worst;
+}
+
+static bool agree = true;
+static uint32_t runs = 20;
+
+// Time one at a time, then batch with and without AVX2, and print the speeds and the worst differences
+template <class T> static void compare(const char *name, size_t count, std::function<void(std::vector<T> &)> single, std::function<void(std::vector<T> &)> batch)
+{
+    std::vector<T> reference, result;
+    ElapsedTime et;
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        single(reference);
+    }
+    double tsingle = et.split() / (runs * count);
+
+    double times[2];
+    double worst[2];
+    for (int simd=0; simd<2; ++simd)
+    {
+        if (q_batch_simd(simd) != (bool)simd)
+        {
+            times[simd] = 0.;
+            worst[simd] = 0.;
+            continue;
+        }
+        et.reset();
+        for (uint32_t run=0; run<runs; ++run)
+        {
+            batch(result);
+        }
+        times[simd] = et.split() / (runs * count);
+        worst[simd] = difference(result, reference);
+        agree = agree && worst[simd] < 1e-14;
+    }
+    printf("%-18s %8.2f ns %8.2f ns %5.1fx %9.2e %8.2f ns %5.1fx %9.2e\n", name, 1e9 * tsingle, 1e9 * times[0], tsingle / times[0], worst[0], 1e9 * times[1], times[1] > 0. ? tsingle / times[1] : 0., worst[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 100000;
+    if (argc > 1)
+    {
+        count = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        runs = atol(argv[2]);
+    }
+
+    srand(1);
+    std::vector<quaternion> q1(count), q2(count);
+    std::vector<rvector> v(count);
+    std::vector<double> t(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        q1[i] = {{random_unit(), random_unit(), random_unit()}, random_unit()};
+        q1[i] = q_smult(1. / length_q(q1[i]), q1[i]);
+        q2[i] = {{random_unit(), random_unit(), random_unit()}, random_unit()};
+        q2[i] = q_smult(1. / length_q(q2[i]), q2[i]);
+        // Some pairs close enough to be interpolated linearly
+        if (i % 10 == 0)
+        {
+            q2[i] = q_add(q1[i], q_smult(.01, q2[i]));
+            q2[i] = q_smult(1. / length_q(q2[i]), q2[i]);
+        }
+        v[i] = {{1000. * random_unit(), 1000. * random_unit(), 1000. * random_unit()}};
+        t[i] = .5 * (random_unit() + 1.);
+    }
+    quaternion q = q1[0];
+
+    printf("%u quaternions and vectors, %u runs, AVX2 %s\n", (uint32_t)count, runs, q_batch_simd(true) ? "available" : "not available");
+    printf("                   one at a time   scalar batch            AVX2 batch\n");
+    compare<rvector>("rotate_q one", count, [&] (std::vector<rvector> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = rotate_q(q, v[i]);
+        }
+    },
+    [&] (std::vector<rvector> &r)
+    {
+        rotate_q(q, v, r);
+    });
+    compare<rvector>("rotate_q each", count, [&] (std::vector<rvector> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = rotate_q(q1[i], v[i]);
+        }
+    },
+    [&] (std::vector<rvector> &r)
+    {
+        rotate_q(q1, v, r);
+    });
+    compare<rvector>("transform_q one", count, [&] (std::vector<rvector> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = transform_q(q, v[i]);
+        }
+    },
+    [&] (std::vector<rvector> &r)
+    {
+        transform_q(q, v, r);
+    });
+    compare<rvector>("transform_q each", count, [&] (std::vector<rvector> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = transform_q(q1[i], v[i]);
+        }
+    },
+    [&] (std::vector<rvector> &r)
+    {
+        transform_q(q1, v, r);
+    });
+    compare<quaternion>("q_mult one", count, [&] (std::vector<quaternion> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = q_mult(q, q2[i]);
+        }
+    },
+    [&] (std::vector<quaternion> &r)
+    {
+        q_mult(q, q2, r);
+    });
+    compare<quaternion>("q_mult each", count, [&] (std::vector<quaternion> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = q_mult(q1[i], q2[i]);
+        }
+    },
+    [&] (std::vector<quaternion> &r)
+    {
+        q_mult(q1, q2, r);
+    });
+    compare<quaternion>("q_conjugate", count, [&] (std::vector<quaternion> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = q_conjugate(q1[i]);
+        }
+    },
+    [&] (std::vector<quaternion> &r)
+    {
+        q_conjugate(q1, r);
+    });
+    compare<rmatrix>("rm_quaternion2dcm", count, [&] (std::vector<rmatrix> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = rm_quaternion2dcm(q1[i]);
+        }
+    },
+    [&] (std::vector<rmatrix> &r)
+    {
+        rm_quaternion2dcm(q1, r);
+    });
+    compare<quaternion>("q_slerp", count, [&] (std::vector<quaternion> &r)
+    {
+        r.resize(count);
+        for (size_t i=0; i<count; ++i)
+        {
+            r[i] = q_slerp(q1[i], q2[i], t[i]);
+        }
+    },
+    [&] (std::vector<quaternion> &r)
+    {
+        q_slerp(q1, q2, t, r);
+    });
+
+    // In place, and a count that is not a multiple of four
+    std::vector<rvector> inplace(v.begin(), v.begin() + 7);
+    rotate_q(q1, inplace, inplace);
+    for (size_t i=0; i<inplace.size(); ++i)
+    {
+        agree = agree && difference(inplace[i], rotate_q(q1[i], v[i])) < 1e-14;
+    }
+
+    printf("batch and one at a time %s\n", agree ? "agree" : "DISAGREE");
+    if (!agree)
+    {
+        exit(1);
+    }
+}
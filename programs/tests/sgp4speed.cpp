@@ -0,0 +1,102 @@
+// Compare catalog propagation with tle2eci against the batched SGP4 engine
+// Usage: sgp4speed [tle_file|satellite_count] [threads]
+#include "support/configCosmos.h"
+#include "support/convertlib.h"
+#include "support/timelib.h"
+#include "support/elapsedtime.h"
+
+ElapsedTime et;
+
+int main(int argc, char *argv[])
+{
+    vector<tlestruc> tle;
+    size_t satcount = 1000;
+    uint16_t threads = thread::hardware_concurrency();
+    double utc = currentmjd(0.);
+
+    if (argc > 1)
+    {
+        if (atol(argv[1]) > 0)
+        {
+            satcount = atol(argv[1]);
+        }
+        else if (load_lines_multi(argv[1], tle) <= 0)
+        {
+            printf("Unable to load %s\n", argv[1]);
+            exit(1);
+        }
+    }
+    if (argc > 2)
+    {
+        threads = atoi(argv[2]);
+    }
+
+    // Synthetic catalog of LEO satellites
+    if (tle.empty())
+    {
+        for (size_t i=0; i<satcount; ++i)
+        {
+            tlestruc ntle;
+            memset(&ntle, 0, sizeof(tlestruc));
+            ntle.utc = utc - (i % 7) / 3.;
+            ntle.snumber = i + 1;
+            ntle.bstar = 1e-5 * (1 + i % 10);
+            ntle.i = RADOF(30. + (i * 7) % 70);
+            ntle.raan = RADOF((i * 13) % 360);
+            ntle.e = .0001 + .0001 * (i % 50);
+            ntle.ap = RADOF((i * 17) % 360);
+            ntle.ma = RADOF((i * 29) % 360);
+            ntle.mm = D2PI * (14.5 + .01 * (i % 100)) / 1440.;
+            tle.push_back(ntle);
+        }
+    }
+    else
+    {
+        utc = tle[0].utc;
+    }
+
+    // One day at one minute steps
+    vector<double> times;
+    for (size_t j=0; j<1440; ++j)
+    {
+        times.push_back(utc + j / 1440.);
+    }
+
+    // Old way: every satellite at every time through tle2eci. Only time a sample.
+    size_t scount = tle.size() < 100 ? tle.size() : 100;
+    vector<cartpos> oldeci(scount * times.size());
+    et.reset();
+    for (size_t j=0; j<times.size(); ++j)
+    {
+        for (size_t i=0; i<scount; ++i)
+        {
+            tle2eci(times[j], tle[i], oldeci[i * times.size() + j]);
+        }
+    }
+    double told = et.split();
+
+    et.reset();
+    vector<sgp4struc> sat;
+    sgp4_init(tle, sat);
+    double tinit = et.split();
+
+    vector<cartpos> eci;
+    et.reset();
+    sgp4_batch(sat, times, eci, threads);
+    double tbatch = et.split();
+
+    double maxerr = 0.;
+    for (size_t i=0; i<scount * times.size(); ++i)
+    {
+        double err = length_rv(rv_sub(oldeci[i].s, eci[i].s));
+        if (err > maxerr)
+        {
+            maxerr = err;
+        }
+    }
+
+    printf("%lu satellites, %lu epochs, %u threads\n", tle.size(), times.size(), threads);
+    printf("tle2eci:    %10.0f satellite-epochs/s\n", scount * times.size() / told);
+    printf("sgp4_batch: %10.0f satellite-epochs/s (init %.3f s)\n", tle.size() * times.size() / tbatch, tinit);
+    printf("Maximum difference: %.3g m\n", maxerr);
+}
@@ -0,0 +1,182 @@
+// Scaling of simulate_nodes with threads, and that its results do not depend on them
+// Usage: simulatenodes [nodes] [minutes] [threads]
+// Nodes with a mix of devices are each put in a different orbit and stepped for the given
+// number of minutes at 1 s steps with simulate_nodes, in one thread and then in 2, 4 and so on
+// up to the given number of threads (by default, as many as there are cores). After each step,
+// every node draws sensor noise from gaussian_random, inside the simulate_nodes task. Every run
+// must end with every node in exactly the same state, having drawn exactly the same noise, and
+// the noise of no two nodes may be the same.
+// The force models need the COSMOS resources (IERS, JPL ephemeris and gravity coefficients).
+#include "support/configCosmos.h"
+#include "support/datalib.h"
+#include "support/jsonlib.h"
+#include "physics/physicslib.h"
+#include "support/elapsedtime.h"
+
+static cosmosstruc *make_node(uint16_t index)
+{
+    cosmosstruc *cinfo = json_create();
+    if (cinfo == nullptr)
+    {
+        return nullptr;
+    }
+
+    uint16_t types[] = {DEVICE_TYPE_IMU, DEVICE_TYPE_SSEN, DEVICE_TYPE_MTR, DEVICE_TYPE_RW, DEVICE_TYPE_STRG, DEVICE_TYPE_BATT, DEVICE_TYPE_TSEN};
+    uint16_t count = sizeof(types) / sizeof(types[0]);
+    char entry[200];
+    jsonnode json;
+    for (uint16_t i=0; i<count; ++i)
+    {
+        sprintf(entry, "{\"piece_type_%03u\":0}{\"piece_cidx_%03u\":%u}{\"piece_mass_%03u\":1}{\"piece_temp_%03u\":300}{\"piece_hcap_%03u\":900}", i, i, i, i, i, i);
+        json.pieces += entry;
+        sprintf(entry, "{\"comp_type_%03u\":%u}{\"comp_didx_%03u\":0}{\"comp_pidx_%03u\":%u}", i, types[i], i, i, i);
+        json.devgen += entry;
+    }
+    sprintf(entry, "{\"node_name\":\"node%u\"}{\"piece_cnt\":%u}{\"comp_cnt\":%u}{\"port_cnt\":0}", index, count, count);
+    json.node = entry;
+    if (json_setup_node(json, cinfo, false) < 0)
+    {
+        json_destroy(cinfo);
+        return nullptr;
+    }
+    return cinfo;
+}
+
+// Set up every node afresh in its own orbit, with its own random stream
+static bool start(vector<cosmosstruc *> &cinfo, vector<simnodestruc> &nodes, double utc)
+{
+    nodes.resize(cinfo.size());
+    for (size_t i=0; i<cinfo.size(); ++i)
+    {
+        cinfo[i] = make_node(i);
+        if (cinfo[i] == nullptr)
+        {
+            return false;
+        }
+        cosmosdatastruc &cdata = cinfo[i]->pdata;
+        cdata.physics.mass = 1.;
+        cdata.physics.area = .01;
+        cdata.physics.hcap = 900.;
+        cdata.physics.heat = 300. * cdata.physics.mass * cdata.physics.hcap;
+        cdata.physics.moi = rv_one();
+        locstruc iloc;
+        nodes[i].cdata = &cdata;
+        nodes[i].random = random_seed(1, i);
+        gauss_jackson_init(nodes[i].gjh, 8, 0, 1., utc, 400000. + 1000. * i, RADOF(51.6), 10. + i, iloc, cdata.physics, cdata.node.loc);
+    }
+    return true;
+}
+
+// Whether every node ended where it did in the first run, having drawn the same noise
+static bool same_as(const vector<simnodestruc> &nodes, const vector<locstruc> &locs, const vector<uint64_t> &randoms, const vector<vector<double>> &noise, const vector<vector<double>> &first_noise)
+{
+    for (size_t i=0; i<nodes.size(); ++i)
+    {
+        const locstruc &loc = nodes[i].cdata->node.loc;
+        if (memcmp(&loc.pos.eci, &locs[i].pos.eci, sizeof(cartpos)) || memcmp(&loc.att.icrf, &locs[i].att.icrf, sizeof(qatt)) || nodes[i].random != randoms[i] || noise[i] != first_noise[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t count = 32;
+    double minutes = 10.;
+    uint16_t maxthreads = std::thread::hardware_concurrency();
+    if (argc > 1)
+    {
+        count = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        minutes = atof(argv[2]);
+    }
+    if (argc > 3)
+    {
+        maxthreads = atoi(argv[3]);
+    }
+    if (maxthreads < 1)
+    {
+        maxthreads = 1;
+    }
+    string resources;
+    if (get_cosmosresources(resources) < 0)
+    {
+        printf("Unable to find COSMOS resources\n");
+        exit(1);
+    }
+
+    vector<cosmosstruc *> cinfo(count);
+    double utc = 58000.;
+    double tomjd = utc + minutes / 1440.;
+    vector<simnodestruc> nodes;
+    vector<locstruc> locs(count);
+    vector<uint64_t> randoms(count);
+    vector<vector<double>> noise(count);
+    vector<vector<double>> first_noise;
+    bool same = true;
+    double tone = 0.;
+    printf("%u nodes, %.1f minutes at 1 s steps, up to %u threads\n", count, minutes, maxthreads);
+    printf("threads  steps      seconds  steps/s   speedup\n");
+    uint16_t threads = 1;
+    while (true)
+    {
+        if (!start(cinfo, nodes, utc))
+        {
+            printf("Unable to set up %u nodes\n", count);
+            exit(1);
+        }
+        for (vector<double> &draws : noise)
+        {
+            draws.clear();
+        }
+        ElapsedTime et;
+        // Sensor noise for each node after each step, from whichever thread is stepping it
+        int32_t steps = simulate_nodes(nodes, tomjd, threads, [&](simnodestruc &node)
+        {
+            noise[&node - nodes.data()].push_back(gaussian_random(0., 1.));
+        });
+        double seconds = et.split();
+        if (threads == 1)
+        {
+            tone = seconds;
+            for (uint16_t i=0; i<count; ++i)
+            {
+                locs[i] = nodes[i].cdata->node.loc;
+                randoms[i] = nodes[i].random;
+            }
+            first_noise = noise;
+            for (uint16_t i=0; i<count; ++i)
+            {
+                same = same && !noise[i].empty() && nodes[i].random != random_seed(1, i);
+                for (uint16_t j=0; j<i; ++j)
+                {
+                    same = same && noise[i] != noise[j];
+                }
+            }
+        }
+        else
+        {
+            same = same && same_as(nodes, locs, randoms, noise, first_noise);
+        }
+        printf("%7u %6d %12.3f %8.0f %9.2fx\n", threads, steps, seconds, steps / seconds, tone / seconds);
+        for (cosmosstruc *node : cinfo)
+        {
+            json_destroy(node);
+        }
+        if (threads == maxthreads)
+        {
+            break;
+        }
+        threads = threads * 2 < maxthreads ? threads * 2 : maxthreads;
+    }
+
+    printf("nodes %s across thread counts\n", same ? "agree" : "DISAGREE");
+    if (!same)
+    {
+        exit(1);
+    }
+}
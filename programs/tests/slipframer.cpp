@@ -0,0 +1,262 @@
+// Agreement and speed of the streaming SLIP framer, against decoding whole frames
+// Usage: slipframer [frames] [runs]
+// Random frames, heavy in bytes that need escaping, are packed as COSMOS SLIP packets, as
+// plain SLIP (KISS) frames, and as frames with an AX.25 frame check sequence, into one stream
+// each, with noise between some frames and a corrupted byte in others. Each stream is fed to a
+// slip_framer in random pieces, and every good frame must come out whole and in order, with
+// every bad one counted. The speed of the framer, and of slip_unpack on frames already split
+// out of the stream, is then printed, with the share of a processor needed at 1 and 10 Mbaud.
+#include "support/configCosmos.h"
+#include "support/sliplib.h"
+#include "math/mathlib.h"
+#include "support/elapsedtime.h"
+
+#define MAXLEN 300
+
+static bool agree = true;
+
+static void check(const char *name, bool good)
+{
+    if (!good)
+    {
+        printf("%s failed\n", name);
+        agree = false;
+    }
+}
+
+// Random frame contents, one byte in eight a FEND or FESC
+static vector<uint8_t> random_frame()
+{
+    vector<uint8_t> frame(1 + rand() % (MAXLEN - 2));
+    for (uint8_t &byte : frame)
+    {
+        switch (rand() % 16)
+        {
+        case 0:
+            byte = SLIP_FEND;
+            break;
+        case 1:
+            byte = SLIP_FESC;
+            break;
+        default:
+            byte = rand();
+            break;
+        }
+    }
+    return frame;
+}
+
+// Whether a byte means nothing special, even after an escape
+static bool plain(uint8_t byte)
+{
+    return byte != SLIP_FEND && byte != SLIP_FESC && byte != SLIP_TFEND && byte != SLIP_TFESC;
+}
+
+// One frame as it would be sent with the given framing
+static vector<uint8_t> encode(uint16_t mode, vector<uint8_t> frame)
+{
+    vector<uint8_t> packet(2 * frame.size() + 8);
+    int32_t size;
+    switch (mode)
+    {
+    case SLIP_FRAMER_COSMOS:
+        size = slip_pack(frame.data(), frame.size(), packet.data(), packet.size());
+        break;
+    case SLIP_FRAMER_FCS:
+        {
+            uint16_t fcs = crc16_x25(0, frame.data(), frame.size());
+            frame.push_back(fcs & 0xff);
+            frame.push_back(fcs >> 8);
+        }
+        // Fall through
+    default:
+        size = slip_encode(frame.data(), frame.size(), packet.data(), packet.size());
+        break;
+    }
+    packet.resize(size);
+    return packet;
+}
+
+// Build a stream of frames, returning the ones that should come out of it
+static vector<vector<uint8_t>> make_stream(uint16_t mode, size_t count, vector<uint8_t> &stream, uint32_t &bad)
+{
+    vector<vector<uint8_t>> good;
+    stream.clear();
+    bad = 0;
+    for (size_t i=0; i<count; ++i)
+    {
+        // Noise, which should be skipped, where the framing can tell it from a frame
+        if (mode == SLIP_FRAMER_COSMOS && i % 50 == 7)
+        {
+            stream.push_back(0x55);
+            stream.push_back(0xaa);
+        }
+        vector<uint8_t> frame = random_frame();
+        vector<uint8_t> packet = encode(mode, frame);
+        if (mode != SLIP_FRAMER_RAW && i % 50 == 13)
+        {
+            // Change one plain byte into another, which only the CRC can catch
+            for (size_t j=packet.size()/2; j<packet.size(); ++j)
+            {
+                if (plain(packet[j]) && plain(packet[j] ^ 0x01) && packet[j-1] != SLIP_FESC)
+                {
+                    packet[j] ^= 0x01;
+                    break;
+                }
+            }
+            ++bad;
+        }
+        else
+        {
+            good.push_back(frame);
+        }
+        stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+    return good;
+}
+
+// Feed a stream in random pieces, checking frames against the good ones as they come out
+static void check_stream(const char *name, uint16_t mode, size_t count)
+{
+    vector<uint8_t> stream;
+    uint32_t bad;
+    vector<vector<uint8_t>> good = make_stream(mode, count, stream, bad);
+    slip_framer framer;
+    slip_framer_init(framer, mode, 256, MAXLEN);
+    size_t done = 0;
+    size_t found = 0;
+    bool same = true;
+    while (done < stream.size())
+    {
+        size_t size = 1 + rand() % 700;
+        if (size > stream.size() - done)
+        {
+            size = stream.size() - done;
+        }
+        slip_framer_feed(framer, &stream[done], size);
+        done += size;
+        uint8_t *data;
+        int32_t length;
+        while ((length = slip_framer_next(framer, data)) > 0)
+        {
+            same = same && found < good.size() && (size_t)length == good[found].size() && !memcmp(data, good[found].data(), length);
+            ++found;
+        }
+    }
+    check(name, same && found == good.size() && framer.crcerrors == bad && framer.drops == 0 && framer.overruns == 0 && framer.escapeerrors == 0);
+    printf("%-7s %6u frames, %4u bad CRC: %6u out, %4u bad CRC, %u dropped\n", name, (uint32_t)good.size(), bad, framer.frames, framer.crcerrors, framer.drops + framer.overruns + framer.escapeerrors);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = 10000;
+    uint32_t runs = 10;
+    if (argc > 1)
+    {
+        count = atol(argv[1]);
+    }
+    if (argc > 2)
+    {
+        runs = atol(argv[2]);
+    }
+
+    srand(1);
+    check_stream("COSMOS", SLIP_FRAMER_COSMOS, count);
+    check_stream("KISS", SLIP_FRAMER_RAW, count);
+    check_stream("AX.25", SLIP_FRAMER_FCS, count);
+
+    // A full ring drops frames rather than overwrite them
+    vector<uint8_t> stream;
+    uint32_t bad;
+    vector<vector<uint8_t>> good = make_stream(SLIP_FRAMER_RAW, 10, stream, bad);
+    slip_framer framer;
+    slip_framer_init(framer, SLIP_FRAMER_RAW, 3, MAXLEN);
+    uint8_t *held;
+    slip_framer_feed(framer, stream.data(), stream.size() / 2);
+    int32_t length = slip_framer_next(framer, held);
+    vector<uint8_t> copy(held, held + (length > 0 ? length : 0));
+    slip_framer_feed(framer, &stream[stream.size() / 2], stream.size() - stream.size() / 2);
+    check("full ring", framer.ready == 2 && framer.drops > 0 && copy == good[0] && !memcmp(held, copy.data(), copy.size()));
+
+    // Frames too long for the buffers are dropped, and the ones after them still found
+    good = make_stream(SLIP_FRAMER_RAW, 200, stream, bad);
+    slip_framer_init(framer, SLIP_FRAMER_RAW, 256, 100);
+    slip_framer_feed(framer, stream.data(), stream.size());
+    size_t shorter = 0;
+    bool same = true;
+    for (const vector<uint8_t> &frame : good)
+    {
+        if (frame.size() <= 100)
+        {
+            length = slip_framer_next(framer, held);
+            same = same && (size_t)length == frame.size() && !memcmp(held, frame.data(), length);
+            ++shorter;
+        }
+    }
+    check("overlong frames", same && framer.frames == shorter && framer.overruns == good.size() - shorter);
+
+    // Speed, fed in pieces the size of a typical bulk read
+    good = make_stream(SLIP_FRAMER_COSMOS, count, stream, bad);
+    slip_framer_init(framer, SLIP_FRAMER_COSMOS, 16, MAXLEN);
+    size_t decoded = 0;
+    ElapsedTime et;
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        for (size_t done=0; done<stream.size(); done+=256)
+        {
+            slip_framer_feed(framer, &stream[done], stream.size() - done < 256 ? stream.size() - done : 256);
+            uint8_t *data;
+            while ((length = slip_framer_next(framer, data)) > 0)
+            {
+                decoded += length;
+            }
+        }
+    }
+    double tframer = et.split() / runs;
+
+    // The same frames split out of the stream, each copied into its own buffer and unpacked
+    vector<slip_t> packets;
+    for (size_t start=0; start<stream.size(); )
+    {
+        while (start < stream.size() && stream[start] != SLIP_FEND)
+        {
+            ++start;
+        }
+        size_t end = start + 1;
+        while (end < stream.size() && stream[end] != SLIP_FEND)
+        {
+            ++end;
+        }
+        packets.push_back(slip_t(&stream[start], &stream[end < stream.size() - 2 ? end + 3 : stream.size()]));
+        start = end + 3;
+    }
+    size_t unpacked = 0;
+    et.reset();
+    for (uint32_t run=0; run<runs; ++run)
+    {
+        for (slip_t &packet : packets)
+        {
+            slip_t sbuf(packet);
+            slip_t rbuf;
+            if (slip_unpack(sbuf, rbuf) > 0)
+            {
+                unpacked += rbuf.size();
+            }
+        }
+    }
+    double tunpack = et.split() / runs;
+    check("speed frames", decoded == unpacked);
+
+    // At 10 bits a byte on the line, 1 Mbaud is 100000 bytes a second
+    double mbytes = stream.size() / 1e6;
+    printf("%u bytes of COSMOS SLIP, %u runs\n", (uint32_t)stream.size(), runs);
+    printf("                    MB/s   CPU at 1 Mbaud   at 10 Mbaud\n");
+    printf("slip_framer     %8.1f %14.3f%% %12.3f%%\n", mbytes / tframer, 100. * tframer / (mbytes / .1), 100. * tframer / (mbytes / 1.));
+    printf("slip_unpack     %8.1f %14.3f%% %12.3f%%\n", mbytes / tunpack, 100. * tunpack / (mbytes / .1), 100. * tunpack / (mbytes / 1.));
+
+    printf("framer %s\n", agree ? "agrees" : "DISAGREES");
+    if (!agree)
+    {
+        exit(1);
+    }
+}
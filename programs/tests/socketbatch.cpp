@@ -0,0 +1,150 @@
+// Receive cost of datagrams taken one system call each, against taking them in batches
+// Usage: socketbatch [rounds] [burst] [packet_bytes]
+// Each round a burst of numbered packets is sent over loopback to a nonblocking listener, and
+// then drained, once with socket_recvfrom in to a vector, as the agent message path used to,
+// and once with socket_recvfrom from a socket_batch. Sending and receiving take turns in one
+// thread, so only the cost of receiving is timed. Both ways must get every packet, intact and in
+// order. The batch must start with room for two packets, stay there while packets come one at a
+// time, and grow to its limit, and no further, once they come in bursts.
+#include "support/configCosmos.h"
+#include "support/socketlib.h"
+#include "support/elapsedtime.h"
+#include "agent/agentclass.h"
+#include <sys/resource.h>
+
+#define TEST_PORT 20106
+
+static double cpu_seconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Send packets numbered from first
+static void send_burst(socket_channel &out, uint32_t first, uint32_t burst, vector<uint8_t> &packet)
+{
+    for (uint32_t i=0; i<burst; ++i)
+    {
+        uint32_t number = first + i;
+        memcpy(packet.data(), &number, sizeof(number));
+        memset(&packet[sizeof(number)], number & 0xff, packet.size() - sizeof(number));
+        socket_sendto(out, packet);
+    }
+}
+
+// Whether a received packet is the one expected next
+static bool check_packet(const uint8_t *data, int32_t nbytes, uint32_t &expected, size_t size)
+{
+    uint32_t number;
+    if (nbytes != (int32_t)size)
+    {
+        return false;
+    }
+    memcpy(&number, data, sizeof(number));
+    if (number != expected++)
+    {
+        return false;
+    }
+    for (size_t i=sizeof(number); i<size; ++i)
+    {
+        if (data[i] != (number & 0xff))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t rounds = 2000;
+    uint32_t burst = 64;
+    uint32_t size = 256;
+    if (argc > 1) rounds = atol(argv[1]);
+    if (argc > 2) burst = atol(argv[2]);
+    if (argc > 3) size = atol(argv[3]);
+    if (size < sizeof(uint32_t)) size = sizeof(uint32_t);
+
+    socket_channel in;
+    socket_channel out;
+    if (socket_open(&in, NetworkType::UDP, "", TEST_PORT, SOCKET_LISTEN, SOCKET_NONBLOCKING, 0) < 0 || socket_open(&out, NetworkType::UDP, "127.0.0.1", TEST_PORT, SOCKET_TALK, SOCKET_BLOCKING, 1000000) < 0)
+    {
+        printf("Unable to open port %u\n", TEST_PORT);
+        exit(1);
+    }
+
+    vector<uint8_t> packet(size);
+    vector<uint8_t> buffer;
+    bool intact = true;
+    uint32_t number = 0;
+    uint32_t expected = 0;
+    int32_t nbytes;
+
+    // One system call per packet, in to a vector as big as the largest agent message
+    double tsingle = 0.;
+    for (uint32_t r=0; r<rounds; ++r)
+    {
+        send_burst(out, number, burst, packet);
+        number += burst;
+        double start = cpu_seconds();
+        while ((nbytes = socket_recvfrom(in, buffer, AGENTMAXBUFFER)) > 0)
+        {
+            intact = check_packet(buffer.data(), nbytes, expected, size) && intact;
+        }
+        tsingle += cpu_seconds() - start;
+    }
+    bool single_all = expected == number;
+
+    // Batches, as for the agent message path
+    socket_batch batch;
+    socket_batch_init(batch, SOCKET_BATCH_COUNT, AGENTMAXBUFFER);
+    size_t initial_storage = batch.storage.size();
+    uint8_t *data;
+
+    // Packets one at a time
+    for (uint32_t r=0; r<100; ++r)
+    {
+        send_burst(out, number, 1, packet);
+        number += 1;
+        while ((nbytes = socket_recvfrom(in, batch, data)) > 0)
+        {
+            intact = check_packet(data, nbytes, expected, size) && intact;
+        }
+    }
+    size_t trickle_storage = batch.storage.size();
+
+    double tbatch = 0.;
+    for (uint32_t r=0; r<rounds; ++r)
+    {
+        send_burst(out, number, burst, packet);
+        number += burst;
+        double start = cpu_seconds();
+        while ((nbytes = socket_recvfrom(in, batch, data)) > 0)
+        {
+            intact = check_packet(data, nbytes, expected, size) && intact;
+        }
+        tbatch += cpu_seconds() - start;
+    }
+    size_t burst_storage = batch.storage.size();
+    bool batch_all = expected == number;
+
+    socket_close(&in);
+    socket_close(&out);
+
+    double packets = (double)rounds * burst;
+    printf("%u bursts of %u packets of %u bytes\n", rounds, burst, size);
+    printf("one per call:  %8.1f ns cpu per packet\n", 1e9 * tsingle / packets);
+    printf("batched:       %8.1f ns cpu per packet  %5.1fx\n", 1e9 * tbatch / packets, tsingle / tbatch);
+    printf("batch storage: %zu bytes at first, %zu one at a time, %zu in bursts\n", initial_storage, trickle_storage, burst_storage);
+    bool grown = initial_storage == 2 * AGENTMAXBUFFER && trickle_storage == 2 * AGENTMAXBUFFER && burst_storage <= SOCKET_BATCH_COUNT * AGENTMAXBUFFER;
+    if (burst >= SOCKET_BATCH_COUNT)
+    {
+        grown = grown && burst_storage == SOCKET_BATCH_COUNT * AGENTMAXBUFFER;
+    }
+    printf("packets %s, batch storage %s\n", intact && single_all && batch_all ? "intact" : "LOST OR DAMAGED", grown ? "as expected" : "NOT AS EXPECTED");
+    if (!intact || !single_all || !batch_all || !grown)
+    {
+        exit(1);
+    }
+}
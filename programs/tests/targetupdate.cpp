@@ -0,0 +1,142 @@
+// Cost of update_target for many ground sites, before and after static Targets
+// Usage: targetupdate [threads]
+// Nodes with 10, 1000 and 50000 Targets scattered over the Earth follow a satellite. Each
+// cycle is timed the way update_target used to work (loc_update and two geoc2topo for every
+// Target), and as it works now with the Targets left moving, flagged static, and flagged static
+// with the views split across threads. Azimuth, elevation and range are checked against the old
+// way.
+#include "support/configCosmos.h"
+#include "support/jsonlib.h"
+#include "support/convertlib.h"
+#include "support/elapsedtime.h"
+#include <random>
+
+// As update_target was
+static void update_old(cosmosdatastruc &cdata)
+{
+    rvector topo, dv, ds;
+    for (uint32_t i=0; i<cdata.target.size(); ++i)
+    {
+        loc_update(&cdata.target[i].loc);
+        geoc2topo(cdata.target[i].loc.pos.geod.s,cdata.node.loc.pos.geoc.s,topo);
+        topo2azel(topo,&cdata.target[i].azto,&cdata.target[i].elto);
+        geoc2topo(cdata.node.loc.pos.geod.s,cdata.target[i].loc.pos.geoc.s,topo);
+        topo2azel(topo,&cdata.target[i].azfrom,&cdata.target[i].elfrom);
+        ds = rv_sub(cdata.target[i].loc.pos.geoc.s,cdata.node.loc.pos.geoc.s);
+        cdata.target[i].range = length_rv(ds);
+        dv = rv_sub(cdata.target[i].loc.pos.geoc.v,cdata.node.loc.pos.geoc.v);
+        cdata.target[i].close = length_rv(rv_sub(ds,dv)) - length_rv(ds);
+    }
+}
+
+static void make_targets(cosmosdatastruc &cdata, uint32_t count, double utc, uint16_t fixed)
+{
+    std::mt19937 gen(count);
+    std::uniform_real_distribution<double> lat(-DPI2, DPI2);
+    std::uniform_real_distribution<double> lon(-DPI, DPI);
+    std::uniform_real_distribution<double> h(0., 3000.);
+    cdata.target.clear();
+    cdata.target.resize(count);
+    for (targetstruc &target : cdata.target)
+    {
+        target.loc.utc = target.loc.pos.geod.utc = utc;
+        target.loc.pos.geod.s.lat = lat(gen);
+        target.loc.pos.geod.s.lon = lon(gen);
+        target.loc.pos.geod.s.h = h(gen);
+        ++target.loc.pos.geod.pass;
+        target.fixed = fixed;
+        loc_update(&target.loc);
+    }
+}
+
+// Move the satellite on by a second
+static void move_node(cosmosdatastruc &cdata, double utc)
+{
+    cartpos eci = cdata.node.loc.pos.eci;
+    eci.s = rv_add(eci.s, eci.v);
+    eci.utc = cdata.node.loc.utc = utc;
+    cdata.node.loc.pos.eci = eci;
+    ++cdata.node.loc.pos.eci.pass;
+    loc_update(&cdata.node.loc);
+}
+
+// Seconds per cycle, running for at least a second
+static double time_cycles(cosmosdatastruc &cdata, double &utc, int16_t threads)
+{
+    uint32_t cycles = 0;
+    ElapsedTime et;
+    double seconds = 0.;
+    do
+    {
+        utc += 1. / 86400.;
+        move_node(cdata, utc);
+        et.reset();
+        if (threads < 0)
+        {
+            update_old(cdata);
+        }
+        else
+        {
+            update_target(cdata, threads);
+        }
+        seconds += et.split();
+        ++cycles;
+    } while (seconds < 1.);
+    return seconds / cycles;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t threads = 4;
+    if (argc > 1)
+    {
+        threads = atoi(argv[1]);
+    }
+
+    cosmosstruc *cinfo = json_create();
+    cosmosdatastruc &cdata = cinfo->pdata;
+    double utc = 59000.;
+    kepstruc kep = kepstruc();
+    kep.a = REARTHM + 500000.;
+    kep.i = RADOF(51.6);
+    kep.e = .001;
+    kep2eci(kep, cdata.node.loc.pos.eci);
+    cdata.node.loc.pos.eci.utc = cdata.node.loc.utc = utc;
+    ++cdata.node.loc.pos.eci.pass;
+    loc_update(&cdata.node.loc);
+
+    bool failed = false;
+    printf("targets    old ms   moving ms   static ms  static x%u ms  speedup  max error deg/m\n", threads);
+    for (uint32_t count : {10, 1000, 50000})
+    {
+        make_targets(cdata, count, utc, 0);
+        double told = time_cycles(cdata, utc, -1);
+        std::vector<targetstruc> old = cdata.target;
+        update_target(cdata, 0);
+        double derr = 0., rerr = 0.;
+        for (uint32_t i=0; i<count; ++i)
+        {
+            for (double d : {cdata.target[i].azto - old[i].azto, cdata.target[i].elto - old[i].elto, cdata.target[i].azfrom - old[i].azfrom, cdata.target[i].elfrom - old[i].elfrom})
+            {
+                // Azimuths either side of the wrap
+                d = fabs(d) > DPI ? D2PI - fabs(d) : fabs(d);
+                derr = d > derr ? d : derr;
+            }
+            double d = fabs(cdata.target[i].range - old[i].range);
+            rerr = d > rerr ? d : rerr;
+        }
+        double tmoving = time_cycles(cdata, utc, 1);
+
+        make_targets(cdata, count, utc, 1);
+        double tfixed = time_cycles(cdata, utc, 1);
+        double tthreads = time_cycles(cdata, utc, threads);
+        printf("%7u %9.3f %11.3f %11.3f %13.3f %7.0fx  %.2g / %.2g\n", count, 1e3 * told, 1e3 * tmoving, 1e3 * tfixed, 1e3 * tthreads, told / tfixed, DEGOF(derr), rerr);
+        failed |= DEGOF(derr) > 1e-3 || rerr > 1e-3;
+    }
+
+    json_destroy(cinfo);
+    if (failed)
+    {
+        exit(1);
+    }
+}
@@ -0,0 +1,174 @@
+// Goodput of agent_file transfers with and without FEC, over a simulated lossy, high latency link
+// Usage: transferfec [file_megabytes] [round_trip_seconds] [link_bytes_per_second]
+// Each pass sends what the receiver is missing; the first pass follows every group of data
+// chunks with its parity. The receiver rebuilds what it can, then asks for the rest with
+// REQDATA, costing a round trip. Encoding and decoding are done for real, and the rebuilt file
+// is checked against the original.
+#include "support/configCosmos.h"
+#include "support/transferlib.h"
+#include "support/elapsedtime.h"
+#include <algorithm>
+
+// As for the fast channel in agent_file with FEC on
+#define CHUNK_SIZE ((PACKET_FILE_SIZE_TYPE)((1472-(PACKET_DATA_HEADER_SIZE+28)) - (PACKET_FEC_HEADER_SIZE - PACKET_DATA_HEADER_SIZE)))
+
+struct fec_result
+{
+    uint32_t passes;
+    uint32_t packets;
+    double wire_bytes;
+    uint32_t rebuilt;
+    double encode_seconds;
+    double decode_seconds;
+    bool match;
+};
+
+static fec_result transfer(const std::vector<PACKET_BYTE>& file, double loss, uint16_t group_count, uint16_t parity_count)
+{
+    fec_result result = fec_result();
+    PACKET_FILE_SIZE_TYPE file_size = file.size();
+    PACKET_FILE_SIZE_TYPE group_bytes = group_count * CHUNK_SIZE;
+    std::vector<PACKET_BYTE> received(file_size, 0);
+    file_progress_set have;
+    std::vector<PACKET_BYTE> group(group_bytes);
+    std::vector<PACKET_BYTE> parity(CHUNK_SIZE);
+    fec_group_set waiting;
+    ElapsedTime et;
+
+    std::vector<file_progress> missing = find_chunks_missing(have, file_size);
+    while (missing.size())
+    {
+        ++result.passes;
+        for (const file_progress& hole : missing)
+        {
+            for (PACKET_FILE_SIZE_TYPE start=hole.chunk_start; start<=hole.chunk_end; start+=CHUNK_SIZE)
+            {
+                file_progress tp;
+                tp.chunk_start = start;
+                tp.chunk_end = std::min(start + CHUNK_SIZE - 1, hole.chunk_end);
+                PACKET_FILE_SIZE_TYPE byte_count = tp.chunk_end - tp.chunk_start + 1;
+                ++result.packets;
+                result.wire_bytes += PACKET_DATA_HEADER_SIZE + byte_count + 28;
+                if ((double)rand() / RAND_MAX >= loss)
+                {
+                    memcpy(&received[start], &file[start], byte_count);
+                    add_chunk(have, tp);
+                }
+
+                // Parity after each group, first time through only
+                if (parity_count && result.passes == 1 && ((tp.chunk_end + 1) % group_bytes == 0 || tp.chunk_end + 1 == file_size))
+                {
+                    PACKET_FILE_SIZE_TYPE group_start = (tp.chunk_end / group_bytes) * group_bytes;
+                    PACKET_FILE_SIZE_TYPE group_end = std::min(group_start + group_bytes, file_size);
+                    uint16_t count = (group_end - group_start + CHUNK_SIZE - 1) / CHUNK_SIZE;
+                    std::fill(group.begin(), group.end(), 0);
+                    memcpy(group.data(), &file[group_start], group_end - group_start);
+                    fec_group& held = waiting[group_start];
+                    held.byte_count = CHUNK_SIZE;
+                    held.group_count = count;
+                    for (uint16_t j=0; j<parity_count; ++j)
+                    {
+                        et.reset();
+                        fec_encode(count, CHUNK_SIZE, group.data(), j, parity.data());
+                        result.encode_seconds += et.split();
+                        ++result.packets;
+                        result.wire_bytes += PACKET_FEC_HEADER_SIZE + CHUNK_SIZE + 28;
+                        if ((double)rand() / RAND_MAX >= loss)
+                        {
+                            held.index.push_back(j);
+                            held.parity.insert(held.parity.end(), parity.begin(), parity.end());
+                        }
+                    }
+                }
+            }
+        }
+
+        // Rebuild whatever groups now have enough
+        for (fec_group_set::iterator it=waiting.begin(); it!=waiting.end(); )
+        {
+            PACKET_FILE_SIZE_TYPE group_start = it->first;
+            fec_group& held = it->second;
+            std::vector<bool> present = fec_group_have(have, group_start, held.byte_count, held.group_count, file_size);
+            size_t lost = std::count(present.begin(), present.end(), false);
+            if (lost == 0)
+            {
+                it = waiting.erase(it);
+                continue;
+            }
+            if (held.index.size() < lost)
+            {
+                ++it;
+                continue;
+            }
+            PACKET_FILE_SIZE_TYPE group_end = std::min(group_start + (PACKET_FILE_SIZE_TYPE)held.group_count * held.byte_count, file_size);
+            std::fill(group.begin(), group.end(), 0);
+            memcpy(group.data(), &received[group_start], group_end - group_start);
+            et.reset();
+            int32_t iretn = fec_decode(held.group_count, held.byte_count, group.data(), present, held.index, held.parity.data());
+            result.decode_seconds += et.split();
+            if (iretn > 0)
+            {
+                result.rebuilt += iretn;
+                memcpy(&received[group_start], group.data(), group_end - group_start);
+                file_progress tp;
+                tp.chunk_start = group_start;
+                tp.chunk_end = group_end - 1;
+                add_chunk(have, tp);
+            }
+            it = waiting.erase(it);
+        }
+
+        missing = find_chunks_missing(have, file_size);
+    }
+
+    result.match = received == file;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    PACKET_FILE_SIZE_TYPE file_size = 1024 * 1024;
+    // agent_file asks for holes on its 10 second QUEUE cycle, so each repair costs at least that
+    double rtt = 10.;
+    double rate = 150000.;
+
+    if (argc > 1)
+    {
+        file_size = atof(argv[1]) * 1024 * 1024;
+    }
+    if (argc > 2)
+    {
+        rtt = atof(argv[2]);
+    }
+    if (argc > 3)
+    {
+        rate = atof(argv[3]);
+    }
+
+    std::vector<PACKET_BYTE> file(file_size);
+    for (PACKET_BYTE& byte : file)
+    {
+        byte = rand();
+    }
+
+    printf("%u byte file, %u byte chunks, %.0f B/s link, %.1f s round trip\n", file_size, CHUNK_SIZE, rate, rtt);
+    printf("loss  data parity  passes  packets  rebuilt   seconds  goodput B/s  parity MB/s rebuilt MB/s\n");
+    const uint16_t groups[][2] = {{0, 0}, {32, 2}, {32, 4}, {32, 8}, {32, 16}};
+    bool failed = false;
+    for (double loss : {.01, .05, .20})
+    {
+        for (const uint16_t* group : groups)
+        {
+            srand(1);
+            fec_result result = transfer(file, loss, group[0], group[1]);
+            double seconds = result.wire_bytes / rate + (result.passes - 1) * rtt;
+            double parity_bytes = (double)file_size * group[1] / (group[0] ? group[0] : 1);
+            printf("%3.0f%%  %4u %6u  %6u %8u %8u %9.1f %12.0f %12.1f %12.1f%s\n", 100. * loss, group[0], group[1], result.passes, result.packets, result.rebuilt, seconds, file_size / seconds, result.encode_seconds > 0. ? parity_bytes / result.encode_seconds / 1e6 : 0., result.decode_seconds > 0. ? CHUNK_SIZE * result.rebuilt / result.decode_seconds / 1e6 : 0., result.match ? "" : "  MISMATCH");
+            failed |= !result.match;
+        }
+    }
+    if (failed)
+    {
+        exit(1);
+    }
+}
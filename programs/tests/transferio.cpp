@@ -0,0 +1,282 @@
+// CPU cost of moving file chunks through agent_file, before and after the zero copy changes
+// Usage: transferio [file_megabytes]
+// A temporary file is sent chunk by chunk over loopback UDP and written back out, once the way
+// agent_file used to (fseek/fread in to a scratch chunk, packets copied by value on the way to
+// transmit_loop, a full PACKET_MAX_LENGTH receive buffer, fseek/fwrite/fflush) and once the way
+// it does now (pread straight in to the packet, packets swapped through the queue and recycled,
+// pwrite straight from the receive buffer). User plus system time is reported per megabyte, and
+// both copies are checked against the original.
+#include "support/configCosmos.h"
+#include "support/transferlib.h"
+#include "support/socketlib.h"
+#include "support/elapsedtime.h"
+#include <sys/resource.h>
+#include <queue>
+
+// As for the fast channel in agent_file
+#define CHUNK_SIZE ((PACKET_FILE_SIZE_TYPE)(1472-(PACKET_DATA_HEADER_SIZE+28)))
+#define TEST_PORT 20104
+
+struct io_result
+{
+    double cpu_seconds;
+    double wall_seconds;
+    bool match;
+};
+
+static double cpu_seconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+struct old_entry
+{
+    std::string type;
+    uint32_t channel;
+    std::vector<PACKET_BYTE> packet;
+};
+
+// Queue and transmit as agent_file did: by value in to queuesendto, copied in to the entry, copied out again
+static std::queue<old_entry> old_queue;
+
+static void old_queuesendto(std::string type, uint16_t channel, std::vector<PACKET_BYTE> packet)
+{
+    old_entry tentry;
+    tentry.type = type;
+    tentry.channel = channel;
+    tentry.packet = packet;
+    old_queue.push(tentry);
+}
+
+static void old_transmit(socket_channel& out)
+{
+    while (!old_queue.empty())
+    {
+        old_entry entry = old_queue.front();
+        old_queue.pop();
+        sendto(out.cudp, (const char*)&entry.packet[0], entry.packet.size(), 0, (struct sockaddr*)&out.caddr, sizeof(struct sockaddr_in));
+    }
+}
+
+static size_t old_debug_packet(std::vector<PACKET_BYTE> buf, std::string type)
+{
+    return buf.size() + type.size();
+}
+
+static int32_t old_recv(socket_channel& in, std::vector<PACKET_BYTE>& buf, FILE* fp)
+{
+    buf.resize(PACKET_MAX_LENGTH);
+    int32_t nbytes = recvfrom(in.cudp, (char *)&buf[0], PACKET_MAX_LENGTH, 0, (struct sockaddr*) NULL, (socklen_t *)NULL);
+    if (nbytes <= 0)
+    {
+        return nbytes;
+    }
+    buf.resize(nbytes);
+    old_debug_packet(buf, std::string("rx")+" in");
+
+    packet_struct_data data;
+    extract_data(buf, data.node_id, data.tx_id, data.byte_count, data.chunk_start, data.chunk);
+    fseek(fp, data.chunk_start, SEEK_SET);
+    fwrite(data.chunk, data.byte_count, 1, fp);
+    fflush(fp);
+    return nbytes;
+}
+
+static io_result run_old(const std::string& source, const std::string& target, PACKET_FILE_SIZE_TYPE file_size, socket_channel& in, socket_channel& out)
+{
+    io_result result;
+    FILE* src = fopen(source.c_str(), "r");
+    FILE* dst = fopen(target.c_str(), "w");
+    std::vector<PACKET_BYTE> packet;
+    std::vector<PACKET_BYTE> buf;
+    ElapsedTime et;
+    double cpu = cpu_seconds();
+
+    for (PACKET_FILE_SIZE_TYPE start=0; start<file_size; start+=CHUNK_SIZE)
+    {
+        PACKET_FILE_SIZE_TYPE byte_count = std::min(CHUNK_SIZE, file_size - start);
+        PACKET_BYTE* chunk = new PACKET_BYTE[byte_count]();
+        fseek(src, start, SEEK_SET);
+        if (fread(chunk, 1, byte_count, src) == byte_count)
+        {
+            make_data_packet(packet, 1, 1, byte_count, start, chunk);
+            old_queuesendto("tx", 0, packet);
+        }
+        delete[] chunk;
+        old_transmit(out);
+        old_recv(in, buf, dst);
+    }
+
+    result.cpu_seconds = cpu_seconds() - cpu;
+    result.wall_seconds = et.split();
+    fclose(src);
+    fclose(dst);
+    return result;
+}
+
+// Queue and transmit as agent_file does now
+static std::queue<old_entry> new_queue;
+static std::vector<std::vector<PACKET_BYTE>> new_pool;
+
+static void new_queuesendto(const std::string& type, uint16_t channel, std::vector<PACKET_BYTE>& packet)
+{
+    new_queue.push(old_entry());
+    new_queue.back().type = type;
+    new_queue.back().channel = channel;
+    new_queue.back().packet.swap(packet);
+    if (new_pool.size())
+    {
+        packet.swap(new_pool.back());
+        new_pool.pop_back();
+    }
+    packet.clear();
+}
+
+static void new_transmit(socket_channel& out)
+{
+    old_entry entry;
+    while (!new_queue.empty())
+    {
+        entry.packet.swap(new_queue.front().packet);
+        entry.type.swap(new_queue.front().type);
+        new_queue.pop();
+        sendto(out.cudp, (const char*)&entry.packet[0], entry.packet.size(), 0, (struct sockaddr*)&out.caddr, sizeof(struct sockaddr_in));
+        new_pool.push_back(std::vector<PACKET_BYTE>());
+        new_pool.back().swap(entry.packet);
+    }
+}
+
+static int32_t new_recv(socket_channel& in, std::vector<PACKET_BYTE>& buf, FILE* fp)
+{
+    static std::vector<PACKET_BYTE> scratch(PACKET_MAX_LENGTH);
+    int32_t nbytes = recvfrom(in.cudp, (char *)scratch.data(), PACKET_MAX_LENGTH, 0, (struct sockaddr*) NULL, (socklen_t *)NULL);
+    if (nbytes <= 0)
+    {
+        return nbytes;
+    }
+    buf.assign(scratch.begin(), scratch.begin() + nbytes);
+
+    packet_struct_data data;
+    const PACKET_BYTE* chunk = extract_data_header(buf, data.node_id, data.tx_id, data.byte_count, data.chunk_start);
+    if (chunk != nullptr && pwrite(fileno(fp), chunk, data.byte_count, data.chunk_start) < 0)
+    {
+        return -errno;
+    }
+    return nbytes;
+}
+
+static io_result run_new(const std::string& source, const std::string& target, PACKET_FILE_SIZE_TYPE file_size, socket_channel& in, socket_channel& out)
+{
+    io_result result;
+    FILE* src = fopen(source.c_str(), "r");
+    FILE* dst = fopen(target.c_str(), "w");
+    std::vector<PACKET_BYTE> packet;
+    std::vector<PACKET_BYTE> buf;
+    ElapsedTime et;
+    double cpu = cpu_seconds();
+
+    for (PACKET_FILE_SIZE_TYPE start=0; start<file_size; start+=CHUNK_SIZE)
+    {
+        PACKET_FILE_SIZE_TYPE byte_count = std::min(CHUNK_SIZE, file_size - start);
+        PACKET_BYTE* chunk = make_data_header(packet, 1, 1, byte_count, start);
+        if (pread(fileno(src), chunk, byte_count, start) == (ssize_t)byte_count)
+        {
+            new_queuesendto("tx", 0, packet);
+        }
+        new_transmit(out);
+        new_recv(in, buf, dst);
+    }
+
+    result.cpu_seconds = cpu_seconds() - cpu;
+    result.wall_seconds = et.split();
+    fclose(src);
+    fclose(dst);
+    return result;
+}
+
+static bool same_file(const std::string& a, const std::string& b)
+{
+    FILE* fa = fopen(a.c_str(), "r");
+    FILE* fb = fopen(b.c_str(), "r");
+    bool same = fa != nullptr && fb != nullptr;
+    std::vector<char> ba(65536);
+    std::vector<char> bb(65536);
+    while (same)
+    {
+        size_t na = fread(ba.data(), 1, ba.size(), fa);
+        size_t nb = fread(bb.data(), 1, bb.size(), fb);
+        same = na == nb && !memcmp(ba.data(), bb.data(), na);
+        if (na == 0)
+        {
+            break;
+        }
+    }
+    if (fa != nullptr)
+    {
+        fclose(fa);
+    }
+    if (fb != nullptr)
+    {
+        fclose(fb);
+    }
+    return same;
+}
+
+int main(int argc, char *argv[])
+{
+    PACKET_FILE_SIZE_TYPE file_size = 64 * 1024 * 1024;
+
+    if (argc > 1)
+    {
+        file_size = atof(argv[1]) * 1024 * 1024;
+    }
+
+    std::string source = "/tmp/transferio.src";
+    std::string target = "/tmp/transferio.dst";
+    FILE* fp = fopen(source.c_str(), "w");
+    if (fp == nullptr)
+    {
+        printf("Unable to create %s\n", source.c_str());
+        exit(1);
+    }
+    std::vector<PACKET_BYTE> block(1024 * 1024);
+    for (PACKET_FILE_SIZE_TYPE written=0; written<file_size; written+=block.size())
+    {
+        for (PACKET_BYTE& byte : block)
+        {
+            byte = rand();
+        }
+        fwrite(block.data(), 1, std::min((PACKET_FILE_SIZE_TYPE)block.size(), file_size - written), fp);
+    }
+    fclose(fp);
+
+    // Each packet is sent and then received in the same thread, so loopback never drops any
+    socket_channel in;
+    socket_channel out;
+    if (socket_open(&in, NetworkType::UDP, "", TEST_PORT, SOCKET_LISTEN, SOCKET_BLOCKING, 1000000) < 0 || socket_open(&out, NetworkType::UDP, "127.0.0.1", TEST_PORT, SOCKET_TALK, SOCKET_BLOCKING, 1000000) < 0)
+    {
+        printf("Unable to open port %u\n", TEST_PORT);
+        exit(1);
+    }
+
+    double megabytes = file_size / (1024. * 1024.);
+    printf("%u byte file, %u byte chunks\n", file_size, CHUNK_SIZE);
+    io_result old_result = run_old(source, target, file_size, in, out);
+    old_result.match = same_file(source, target);
+    io_result new_result = run_new(source, target, file_size, in, out);
+    new_result.match = same_file(source, target);
+    printf("old: %8.3f ms cpu/MB %8.1f MB/s%s\n", 1000. * old_result.cpu_seconds / megabytes, megabytes / old_result.wall_seconds, old_result.match ? "" : "  MISMATCH");
+    printf("new: %8.3f ms cpu/MB %8.1f MB/s%s\n", 1000. * new_result.cpu_seconds / megabytes, megabytes / new_result.wall_seconds, new_result.match ? "" : "  MISMATCH");
+    printf("cpu reduction: %.1f%%\n", 100. * (1. - new_result.cpu_seconds / old_result.cpu_seconds));
+
+    socket_close(&in);
+    socket_close(&out);
+    remove(source.c_str());
+    remove(target.c_str());
+    if (!old_result.match || !new_result.match)
+    {
+        exit(1);
+    }
+}
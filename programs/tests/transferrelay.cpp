@@ -0,0 +1,293 @@
+// Send a file through a local lossy UDP relay, with fixed and AIMD pacing
+// Usage: transferrelay [file_kilobytes] [random_loss_percent]
+// Sender, relay and receiver run as threads talking UDP over loopback, the way agent_file
+// does: the sender queues DATA packets a burst at a time behind a transfer_pacer, the relay
+// drops some at random and tail drops what will not fit through its bottleneck, and the
+// receiver asks for holes with REQDATA once a second. Each link is tried with the pacer held
+// at the nominal agent_file rate, and with it free to adapt.
+#include "support/configCosmos.h"
+#include "support/transferlib.h"
+#include "support/socketlib.h"
+#include "support/timelib.h"
+#include "support/elapsedtime.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+// As for the fast channel in agent_file
+#define CHUNK_SIZE (1472-(PACKET_DATA_HEADER_SIZE+28))
+#define NOMINAL_RATE 150000.
+#define TRANSFER_BURST 8
+
+#define SENDER_PORT 20101
+#define RELAY_PORT 20102
+#define RECEIVER_PORT 20103
+
+struct relay_result
+{
+    double seconds;
+    uint32_t sent_packets;
+    uint32_t dropped_packets;
+    PACKET_FILE_SIZE_TYPE repeat_bytes;
+    double final_rate;
+    bool complete;
+};
+
+static std::atomic<bool> done;
+static std::mutex sender_lock;
+static tx_progress tx_out;
+static transfer_pacer pacer;
+
+// Take REQDATA from the receiver, as agent_file recv_loop does
+static void sender_recv()
+{
+    socket_channel chan;
+    if (socket_open(&chan, NetworkType::UDP, "", SENDER_PORT, SOCKET_LISTEN, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to listen on %u\n", SENDER_PORT);
+        exit(1);
+    }
+    std::vector<PACKET_BYTE> buf;
+    while (!done)
+    {
+        if (socket_recvfrom(chan, buf, PACKET_MAX_LENGTH) > 0 && (buf[0] & 0x0f) == PACKET_REQDATA)
+        {
+            packet_struct_reqdata reqdata;
+            extract_reqdata(buf, reqdata);
+            file_progress tp;
+            tp.chunk_start = reqdata.hole_start;
+            tp.chunk_end = reqdata.hole_end;
+
+            sender_lock.lock();
+            PACKET_FILE_SIZE_TYPE lost = request_chunk(tx_out, tp, 2 * pacer.depth);
+            if (lost)
+            {
+                pacer_loss(pacer, lost);
+            }
+            sender_lock.unlock();
+        }
+    }
+    socket_close(&chan);
+}
+
+// Queue a burst of DATA packets, then send them behind the pacer, as agent_file send_loop
+// and transmit_loop do
+static void sender_send()
+{
+    socket_channel chan;
+    if (socket_open(&chan, NetworkType::UDP, "127.0.0.1", RELAY_PORT, SOCKET_TALK, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to talk to %u\n", RELAY_PORT);
+        exit(1);
+    }
+    std::vector<PACKET_BYTE> chunk(CHUNK_SIZE, 0);
+    std::vector<std::vector<PACKET_BYTE>> burst;
+    while (!done)
+    {
+        burst.clear();
+        sender_lock.lock();
+        for (uint16_t i=0; i<TRANSFER_BURST && tx_out.file_info.size(); ++i)
+        {
+            file_progress tp;
+            tp.chunk_start = tx_out.file_info.begin()->first;
+            tp.chunk_end = tx_out.file_info.begin()->second;
+            if (tp.chunk_end - tp.chunk_start + 1 > CHUNK_SIZE)
+            {
+                tp.chunk_end = tp.chunk_start + CHUNK_SIZE - 1;
+            }
+            PACKET_CHUNK_SIZE_TYPE byte_count = tp.chunk_end - tp.chunk_start + 1;
+            burst.resize(burst.size() + 1);
+            make_data_packet(burst.back(), 0, tx_out.tx_id, byte_count, tp.chunk_start, chunk.data());
+            del_chunk(tx_out.file_info, tp);
+            ++tx_out.stats.packets;
+            tx_out.stats.bytes += byte_count;
+            if (tp.chunk_end + 1 > tx_out.stats.high_bytes)
+            {
+                tx_out.stats.high_bytes = tp.chunk_end + 1;
+            }
+        }
+        sender_lock.unlock();
+
+        if (burst.empty())
+        {
+            COSMOS_USLEEP(1000);
+            continue;
+        }
+
+        for (std::vector<PACKET_BYTE>& packet : burst)
+        {
+            sender_lock.lock();
+            double delay = pacer_delay(pacer, 28 + packet.size());
+            sender_lock.unlock();
+            if (delay > 0.)
+            {
+                COSMOS_USLEEP((uint32_t)(1e6 * delay));
+            }
+            socket_sendto(chan, packet);
+            sender_lock.lock();
+            pacer_delay(pacer, 0);
+            pacer_consume(pacer, 28 + packet.size());
+            sender_lock.unlock();
+        }
+    }
+    socket_close(&chan);
+}
+
+// Forward to the receiver through a bottleneck with a limited queue, dropping some at random
+static void relay(double bottleneck, double queue_seconds, double loss, uint32_t &forwarded, uint32_t &dropped)
+{
+    socket_channel in;
+    socket_channel out;
+    if (socket_open(&in, NetworkType::UDP, "", RELAY_PORT, SOCKET_LISTEN, SOCKET_NONBLOCKING, 0) < 0 || socket_open(&out, NetworkType::UDP, "127.0.0.1", RECEIVER_PORT, SOCKET_TALK, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to open relay\n");
+        exit(1);
+    }
+
+    std::deque<std::pair<double, std::vector<PACKET_BYTE>>> queue;
+    std::vector<PACKET_BYTE> buf;
+    ElapsedTime et;
+    double free_time = 0.;
+    forwarded = 0;
+    dropped = 0;
+    while (!done)
+    {
+        double now = et.split();
+        while (socket_recvfrom(in, buf, PACKET_MAX_LENGTH) > 0)
+        {
+            if (free_time < now)
+            {
+                free_time = now;
+            }
+            if ((double)rand() / RAND_MAX < loss || free_time - now > queue_seconds)
+            {
+                ++dropped;
+                continue;
+            }
+            free_time += (28 + buf.size()) / bottleneck;
+            queue.push_back(std::make_pair(free_time, buf));
+        }
+        while (queue.size() && queue.front().first <= now)
+        {
+            socket_sendto(out, queue.front().second);
+            queue.pop_front();
+            ++forwarded;
+        }
+        COSMOS_USLEEP(200);
+    }
+    socket_close(&in);
+    socket_close(&out);
+}
+
+static relay_result run(PACKET_FILE_SIZE_TYPE file_size, double bottleneck, double loss, bool adapt)
+{
+    relay_result result;
+
+    tx_out = tx_progress();
+    tx_out.tx_id = 1;
+    tx_out.file_size = file_size;
+    tx_out.stats = transfer_stats();
+    double depth = TRANSFER_BURST * (CHUNK_SIZE + PACKET_DATA_HEADER_SIZE + 28);
+    if (adapt)
+    {
+        pacer_init(pacer, NOMINAL_RATE, NOMINAL_RATE / 16., NOMINAL_RATE * 8., depth);
+    }
+    else
+    {
+        pacer_init(pacer, NOMINAL_RATE, NOMINAL_RATE, NOMINAL_RATE, depth);
+    }
+
+    done = false;
+    socket_channel rx;
+    socket_channel tx;
+    if (socket_open(&rx, NetworkType::UDP, "", RECEIVER_PORT, SOCKET_LISTEN, SOCKET_BLOCKING, 10000) < 0 || socket_open(&tx, NetworkType::UDP, "127.0.0.1", SENDER_PORT, SOCKET_TALK, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to open receiver\n");
+        exit(1);
+    }
+    uint32_t forwarded;
+    std::thread relay_thread(relay, bottleneck, .05, loss, std::ref(forwarded), std::ref(result.dropped_packets));
+    std::thread recv_thread(sender_recv);
+    std::thread send_thread(sender_send);
+    COSMOS_USLEEP(10000);
+
+    // Receive, asking for everything missing once a second
+    file_progress_set have;
+    std::vector<PACKET_BYTE> buf;
+    ElapsedTime et;
+    double next_request = 0.;
+    result.complete = false;
+    while (et.split() < 300.)
+    {
+        if (et.split() >= next_request)
+        {
+            for (const file_progress& hole : find_chunks_missing(have, file_size))
+            {
+                std::vector<PACKET_BYTE> packet;
+                make_reqdata_packet(packet, 0, 1, hole.chunk_start, hole.chunk_end);
+                socket_sendto(tx, packet);
+            }
+            next_request = et.split() + 1.;
+        }
+        if (socket_recvfrom(rx, buf, PACKET_MAX_LENGTH) > 0 && (buf[0] & 0x0f) == PACKET_DATA)
+        {
+            packet_struct_data data;
+            extract_data(buf, data.node_id, data.tx_id, data.byte_count, data.chunk_start, data.chunk);
+            file_progress tp;
+            tp.chunk_start = data.chunk_start;
+            tp.chunk_end = data.chunk_start + data.byte_count - 1;
+            add_chunk(have, tp);
+            if (total_chunks(have) == file_size)
+            {
+                result.complete = true;
+                break;
+            }
+        }
+    }
+    result.seconds = et.split();
+
+    done = true;
+    relay_thread.join();
+    recv_thread.join();
+    send_thread.join();
+    socket_close(&rx);
+    socket_close(&tx);
+
+    result.sent_packets = tx_out.stats.packets;
+    result.repeat_bytes = tx_out.stats.repeat_bytes;
+    result.final_rate = pacer.rate;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    PACKET_FILE_SIZE_TYPE file_size = 1024 * 1024;
+    double loss = .01;
+
+    if (argc > 1)
+    {
+        file_size = atol(argv[1]) * 1024;
+    }
+    if (argc > 2)
+    {
+        loss = atof(argv[2]) / 100.;
+    }
+
+    // A link faster than nominal, and one slower
+    double bottleneck[2] = {8. * NOMINAL_RATE, NOMINAL_RATE / 2.};
+    bool failed = false;
+    printf("%u byte file, %.1f%% random loss, nominal rate %.0f B/s\n", file_size, 100. * loss, NOMINAL_RATE);
+    for (double link : bottleneck)
+    {
+        for (bool adapt : {false, true})
+        {
+            relay_result result = run(file_size, link, loss, adapt);
+            printf("link %8.0f B/s %s: %6.2f s %8.0f B/s goodput, %6u packets sent, %5u dropped, %5.1f%% resent, final rate %8.0f B/s%s\n", link, adapt?"aimd ":"fixed", result.seconds, file_size / result.seconds, result.sent_packets, result.dropped_packets, (100. * result.repeat_bytes) / file_size, result.final_rate, result.complete?"":" INCOMPLETE");
+            failed |= !result.complete;
+        }
+    }
+    if (failed)
+    {
+        exit(1);
+    }
+}
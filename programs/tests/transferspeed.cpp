@@ -0,0 +1,220 @@
+// Compare agent_file chunk bookkeeping before and after the file_progress_set change
+// Usage: transferspeed [file_megabytes] [loss_percent]
+// Replays a lossy transfer of one file: every chunk is sent once, then holes are re-requested
+// until the receiver has all of it. Only the bookkeeping is timed; no data is written.
+#include "support/configCosmos.h"
+#include "support/transferlib.h"
+#include "support/elapsedtime.h"
+#include <deque>
+
+// Same as PACKET_SIZE_HI in agent_file
+#define CHUNK_SIZE (1472-(PACKET_DATA_HEADER_SIZE+28))
+
+ElapsedTime et;
+
+// Previous bookkeeping: sorted deque, searched from the front for every chunk
+typedef struct
+{
+    PACKET_TX_ID_TYPE tx_id;
+    PACKET_FILE_SIZE_TYPE file_size;
+    PACKET_FILE_SIZE_TYPE total_bytes;
+    std::deque<file_progress> file_info;
+} old_progress;
+
+static PACKET_TX_ID_TYPE old_check_tx_id(std::vector<old_progress> tx_entry, PACKET_TX_ID_TYPE tx_id)
+{
+    return tx_entry[tx_id].tx_id;
+}
+
+static void old_add_chunk(old_progress& tx, file_progress tp)
+{
+    PACKET_FILE_SIZE_TYPE byte_count = (tp.chunk_end - tp.chunk_start) + 1;
+    uint32_t check=0;
+    bool duplicate = false;
+
+    if (!tx.file_info.size())
+    {
+        tx.file_info.push_back(tp);
+        tx.total_bytes += byte_count;
+        return;
+    }
+
+    for (uint32_t j=0; j<tx.file_info.size(); ++j)
+    {
+        if (tp.chunk_start >= tx.file_info[j].chunk_start && tp.chunk_end <= tx.file_info[j].chunk_end)
+        {
+            duplicate = true;
+            break;
+        }
+        if (tp.chunk_start < tx.file_info[j].chunk_start)
+        {
+            if (tp.chunk_end + 1 < tx.file_info[j].chunk_start)
+            {
+                tx.file_info.insert(tx.file_info.begin()+j, tp);
+                tx.total_bytes += byte_count;
+                return;
+            }
+            else
+            {
+                tp.chunk_end = tx.file_info[j].chunk_start - 1;
+                tx.file_info[j].chunk_start = tp.chunk_start;
+                tx.total_bytes += (tp.chunk_end - tp.chunk_start) + 1;
+                return;
+            }
+        }
+        else
+        {
+            if (tp.chunk_start <= tx.file_info[j].chunk_end + 1)
+            {
+                if (tp.chunk_end > tx.file_info[j].chunk_end)
+                {
+                    tx.total_bytes += tp.chunk_end - tx.file_info[j].chunk_end;
+                    tx.file_info[j].chunk_end = tp.chunk_end;
+                    return;
+                }
+            }
+        }
+        check = j + 1;
+    }
+
+    if (!duplicate && check == tx.file_info.size())
+    {
+        tx.file_info.push_back(tp);
+        tx.total_bytes += byte_count;
+    }
+}
+
+static std::vector<file_progress> old_find_chunks_missing(old_progress& tx)
+{
+    std::vector<file_progress> missing;
+    file_progress tp;
+    PACKET_FILE_SIZE_TYPE next = 0;
+    for (uint32_t j=0; j<tx.file_info.size(); ++j)
+    {
+        if (tx.file_info[j].chunk_start > next)
+        {
+            tp.chunk_start = next;
+            tp.chunk_end = tx.file_info[j].chunk_start - 1;
+            missing.push_back(tp);
+        }
+        next = tx.file_info[j].chunk_end + 1;
+    }
+    if (next < tx.file_size)
+    {
+        tp.chunk_start = next;
+        tp.chunk_end = tx.file_size - 1;
+        missing.push_back(tp);
+    }
+    return missing;
+}
+
+// Split the requested ranges in to packets, dropping each with the given probability
+static std::vector<file_progress> deliver(const std::vector<file_progress>& holes, double loss, size_t &sent)
+{
+    std::vector<file_progress> delivered;
+    for (const file_progress& hole : holes)
+    {
+        for (PACKET_FILE_SIZE_TYPE start=hole.chunk_start; start<=hole.chunk_end; start+=CHUNK_SIZE)
+        {
+            file_progress tp;
+            tp.chunk_start = start;
+            tp.chunk_end = start + CHUNK_SIZE - 1;
+            if (tp.chunk_end > hole.chunk_end)
+            {
+                tp.chunk_end = hole.chunk_end;
+            }
+            ++sent;
+            if ((double)rand() / RAND_MAX >= loss)
+            {
+                delivered.push_back(tp);
+            }
+        }
+    }
+    return delivered;
+}
+
+int main(int argc, char *argv[])
+{
+    PACKET_FILE_SIZE_TYPE file_size = 100 * 1024 * 1024;
+    double loss = .05;
+
+    if (argc > 1)
+    {
+        file_size = atol(argv[1]) * 1024 * 1024;
+    }
+    if (argc > 2)
+    {
+        loss = atof(argv[2]) / 100.;
+    }
+
+    // Precompute the traffic so both versions see exactly the same packets
+    std::vector<std::vector<file_progress>> passes;
+    std::vector<file_progress> holes(1);
+    holes[0].chunk_start = 0;
+    holes[0].chunk_end = file_size - 1;
+    size_t sent = 0;
+    size_t received = 0;
+    file_progress_set reference;
+    while (holes.size())
+    {
+        passes.push_back(deliver(holes, loss, sent));
+        for (const file_progress& tp : passes.back())
+        {
+            add_chunk(reference, tp);
+        }
+        received += passes.back().size();
+        holes = find_chunks_missing(reference, file_size);
+    }
+
+    // Old: table copied for every packet, linear merge
+    std::vector<old_progress> oldtable(PACKET_TX_ID_TYPE(-1) + 1);
+    oldtable[1].tx_id = 1;
+    oldtable[1].file_size = file_size;
+    oldtable[1].total_bytes = 0;
+    size_t oldholes = 0;
+    et.reset();
+    for (const std::vector<file_progress>& pass : passes)
+    {
+        for (const file_progress& tp : pass)
+        {
+            if (old_check_tx_id(oldtable, 1))
+            {
+                old_add_chunk(oldtable[1], tp);
+            }
+        }
+        oldholes += old_find_chunks_missing(oldtable[1]).size();
+    }
+    double told = et.split();
+
+    // New: table by reference, interval map
+    std::vector<tx_progress> newtable(PACKET_TX_ID_TYPE(-1) + 1);
+    newtable[1].tx_id = 1;
+    newtable[1].file_size = file_size;
+    newtable[1].total_bytes = 0;
+    size_t newholes = 0;
+    et.reset();
+    for (const std::vector<file_progress>& pass : passes)
+    {
+        for (const file_progress& tp : pass)
+        {
+            const std::vector<tx_progress>& table = newtable;
+            if (table[1].tx_id)
+            {
+                newtable[1].total_bytes += add_chunk(newtable[1].file_info, tp);
+            }
+        }
+        newholes += find_chunks_missing(newtable[1].file_info, file_size).size();
+    }
+    double tnew = et.split();
+
+    printf("%u byte file, %u byte chunks, %.1f%% loss\n", file_size, CHUNK_SIZE, 100. * loss);
+    printf("%lu packets sent, %lu received, %lu passes\n", sent, received, passes.size());
+    printf("old: %10.0f packets/s  total %u bytes, %lu hole requests\n", received / told, oldtable[1].total_bytes, oldholes);
+    printf("new: %10.0f packets/s  total %u bytes, %lu hole requests\n", received / tnew, newtable[1].total_bytes, newholes);
+    printf("speedup: %.1fx\n", told / tnew);
+    if (oldtable[1].total_bytes != file_size || newtable[1].total_bytes != file_size || oldholes != newholes)
+    {
+        printf("Mismatch\n");
+        exit(1);
+    }
+}
@@ -0,0 +1,335 @@
+// Stripe file transfers for several nodes across several UDP links, as agent_file does
+// Usage: transferstripe [file_kilobytes] [nodes] [fast_bytes_per_second] [slow_bytes_per_second]
+// The sender serves every node a burst at a time, choosing a channel for each DATA packet the
+// way agent_file stripe_channel does. Each channel goes through its own local relay that
+// forwards at a fixed link rate, and all relays deliver to one receiver. Runs are made with all
+// data on the fast channel, striped through the single shared transmit queue agent_file used
+// to have, and striped with a transmit queue and thread per channel.
+#include "support/configCosmos.h"
+#include "support/transferlib.h"
+#include "support/socketlib.h"
+#include "support/elapsedtime.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// As for the fast channel in agent_file
+#define CHUNK_SIZE ((PACKET_FILE_SIZE_TYPE)(1472-(PACKET_DATA_HEADER_SIZE+28)))
+#define TRANSFER_BURST 8
+#define CHANNELS 2
+
+#define RECEIVER_PORT 20110
+#define RELAY_PORT 20111
+
+enum class StripeMode
+{
+    Single,
+    Shared,
+    PerChannel
+};
+
+struct channel_state
+{
+    socket_channel chan;
+    double link_rate;
+    transfer_pacer pacer;
+    std::deque<std::pair<uint16_t, std::vector<PACKET_BYTE>>> queue;
+    std::condition_variable check;
+    size_t queued_bytes;
+    uint32_t packets;
+};
+
+struct stripe_result
+{
+    double seconds;
+    std::vector<double> node_seconds;
+    uint32_t packets[CHANNELS];
+    bool complete;
+};
+
+static std::atomic<bool> done;
+static std::mutex state_lock;
+static channel_state channels[CHANNELS];
+static StripeMode mode;
+
+// Take packets off a queue and send each behind the pacer of its own channel, as agent_file
+// transmit_loop does
+static void transmit(uint16_t queue)
+{
+    std::unique_lock<std::mutex> locker(state_lock);
+    while (!done)
+    {
+        channels[queue].check.wait_for(locker, std::chrono::milliseconds(100));
+        while (!done && channels[queue].queue.size())
+        {
+            std::pair<uint16_t, std::vector<PACKET_BYTE>> entry;
+            entry.swap(channels[queue].queue.front());
+            channels[queue].queue.pop_front();
+            channel_state& channel = channels[entry.first];
+            double delay = pacer_delay(channel.pacer, 28 + entry.second.size());
+            locker.unlock();
+            if (delay > 0.)
+            {
+                COSMOS_USLEEP((uint32_t)(1e6 * delay));
+            }
+            socket_sendto(channel.chan, entry.second);
+            locker.lock();
+            pacer_delay(channel.pacer, 0);
+            pacer_consume(channel.pacer, 28 + entry.second.size());
+            channel.queued_bytes -= entry.second.size();
+            ++channel.packets;
+        }
+    }
+}
+
+// As agent_file stripe_channel: the channel that would finish a full packet soonest
+static uint16_t stripe_channel()
+{
+    if (mode == StripeMode::Single)
+    {
+        return 0;
+    }
+    uint16_t best = 0;
+    double best_time = 0.;
+    for (uint16_t i=0; i<CHANNELS; ++i)
+    {
+        double wait = (channels[i].queued_bytes + 28. + PACKET_DATA_HEADER_SIZE + CHUNK_SIZE) / channels[i].pacer.rate;
+        if (best_time == 0. || wait < best_time)
+        {
+            best = i;
+            best_time = wait;
+        }
+    }
+    return best;
+}
+
+// Serve every node a burst at a time, sleeping for as long as the bursts take on the striped
+// channels, as agent_file send_loop does
+static void sender(std::vector<file_progress_set>& todo)
+{
+    std::vector<PACKET_BYTE> packet;
+    std::vector<PACKET_BYTE> chunk(CHUNK_SIZE, 0);
+    ElapsedTime et;
+    double next_time = 0.;
+    while (!done)
+    {
+        double now = et.split();
+        if (next_time > now)
+        {
+            COSMOS_USLEEP((uint32_t)(1e6 * (next_time - now)));
+        }
+
+        std::lock_guard<std::mutex> locker(state_lock);
+        double rate = 0.;
+        for (uint16_t i=0; i<(mode == StripeMode::Single ? 1 : CHANNELS); ++i)
+        {
+            rate += channels[i].pacer.rate;
+        }
+        double burst_time = 0.;
+        for (uint16_t node=0; node<todo.size(); ++node)
+        {
+            for (uint16_t burst=0; burst<TRANSFER_BURST && todo[node].size(); ++burst)
+            {
+                file_progress tp;
+                tp.chunk_start = todo[node].begin()->first;
+                tp.chunk_end = std::min(todo[node].begin()->second, tp.chunk_start + CHUNK_SIZE - 1);
+                PACKET_CHUNK_SIZE_TYPE byte_count = tp.chunk_end - tp.chunk_start + 1;
+                make_data_packet(packet, node, 1, byte_count, tp.chunk_start, chunk.data());
+                del_chunk(todo[node], tp);
+
+                uint16_t channel = stripe_channel();
+                uint16_t queue = mode == StripeMode::PerChannel ? channel : 0;
+                channels[channel].queued_bytes += packet.size();
+                channels[queue].queue.push_back(std::make_pair(channel, packet));
+                channels[queue].check.notify_one();
+                burst_time += (28. + packet.size()) / rate;
+            }
+        }
+        next_time = (next_time > now ? next_time : now) + (burst_time > 0. ? burst_time : .01);
+    }
+}
+
+// Forward to the receiver at the link rate
+static void relay(uint16_t channel)
+{
+    socket_channel in;
+    socket_channel out;
+    if (socket_open(&in, NetworkType::UDP, "", RELAY_PORT + channel, SOCKET_LISTEN, SOCKET_NONBLOCKING, 0) < 0 || socket_open(&out, NetworkType::UDP, "127.0.0.1", RECEIVER_PORT, SOCKET_TALK, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to open relay %u\n", channel);
+        exit(1);
+    }
+
+    std::deque<std::pair<double, std::vector<PACKET_BYTE>>> queue;
+    std::vector<PACKET_BYTE> buf;
+    ElapsedTime et;
+    double free_time = 0.;
+    while (!done)
+    {
+        double now = et.split();
+        while (socket_recvfrom(in, buf, PACKET_MAX_LENGTH) > 0)
+        {
+            if (free_time < now)
+            {
+                free_time = now;
+            }
+            free_time += (28 + buf.size()) / channels[channel].link_rate;
+            queue.push_back(std::make_pair(free_time, buf));
+        }
+        while (queue.size() && queue.front().first <= now)
+        {
+            socket_sendto(out, queue.front().second);
+            queue.pop_front();
+        }
+        COSMOS_USLEEP(200);
+    }
+    socket_close(&in);
+    socket_close(&out);
+}
+
+static stripe_result run(PACKET_FILE_SIZE_TYPE file_size, uint16_t nodes, StripeMode run_mode)
+{
+    stripe_result result;
+    mode = run_mode;
+    done = false;
+
+    socket_channel rx;
+    if (socket_open(&rx, NetworkType::UDP, "", RECEIVER_PORT, SOCKET_LISTEN, SOCKET_BLOCKING, 10000) < 0)
+    {
+        printf("Unable to open receiver\n");
+        exit(1);
+    }
+    for (uint16_t i=0; i<CHANNELS; ++i)
+    {
+        // Pace a little under the link, so the relays never back up
+        double rate = .95 * channels[i].link_rate;
+        pacer_init(channels[i].pacer, rate, rate, rate, TRANSFER_BURST * (CHUNK_SIZE + PACKET_DATA_HEADER_SIZE + 28));
+        channels[i].queue.clear();
+        channels[i].queued_bytes = 0;
+        channels[i].packets = 0;
+        if (socket_open(&channels[i].chan, NetworkType::UDP, "127.0.0.1", RELAY_PORT + i, SOCKET_TALK, SOCKET_BLOCKING, 10000) < 0)
+        {
+            printf("Unable to talk to %u\n", RELAY_PORT + i);
+            exit(1);
+        }
+    }
+
+    std::vector<file_progress_set> todo(nodes);
+    std::vector<file_progress_set> have(nodes);
+    for (file_progress_set& set : todo)
+    {
+        file_progress tp;
+        tp.chunk_start = 0;
+        tp.chunk_end = file_size - 1;
+        add_chunk(set, tp);
+    }
+
+    std::vector<std::thread> threads;
+    for (uint16_t i=0; i<CHANNELS; ++i)
+    {
+        threads.push_back(std::thread(relay, i));
+        if (run_mode == StripeMode::PerChannel || i == 0)
+        {
+            threads.push_back(std::thread(transmit, i));
+        }
+    }
+    COSMOS_USLEEP(10000);
+    ElapsedTime et;
+    threads.push_back(std::thread(sender, std::ref(todo)));
+
+    std::vector<PACKET_BYTE> buf;
+    result.node_seconds.resize(nodes, 0.);
+    uint16_t finished = 0;
+    result.complete = false;
+    while (et.split() < 120.)
+    {
+        if (socket_recvfrom(rx, buf, PACKET_MAX_LENGTH) > 0 && (buf[0] & 0x0f) == PACKET_DATA)
+        {
+            PACKET_NODE_ID_TYPE node_id;
+            PACKET_TX_ID_TYPE tx_id;
+            PACKET_CHUNK_SIZE_TYPE byte_count;
+            PACKET_FILE_SIZE_TYPE chunk_start;
+            if (extract_data_header(buf, node_id, tx_id, byte_count, chunk_start) == nullptr || node_id >= nodes)
+            {
+                continue;
+            }
+            file_progress tp;
+            tp.chunk_start = chunk_start;
+            tp.chunk_end = chunk_start + byte_count - 1;
+            add_chunk(have[node_id], tp);
+            if (result.node_seconds[node_id] == 0. && total_chunks(have[node_id]) == file_size)
+            {
+                result.node_seconds[node_id] = et.split();
+                if (++finished == nodes)
+                {
+                    result.complete = true;
+                    break;
+                }
+            }
+        }
+    }
+    result.seconds = et.split();
+
+    done = true;
+    for (uint16_t i=0; i<CHANNELS; ++i)
+    {
+        channels[i].check.notify_all();
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (uint16_t i=0; i<CHANNELS; ++i)
+    {
+        result.packets[i] = channels[i].packets;
+        socket_close(&channels[i].chan);
+    }
+    socket_close(&rx);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    PACKET_FILE_SIZE_TYPE file_size = 512 * 1024;
+    uint16_t nodes = 2;
+    channels[0].link_rate = 400000.;
+    channels[1].link_rate = 100000.;
+
+    if (argc > 1)
+    {
+        file_size = atol(argv[1]) * 1024;
+    }
+    if (argc > 2)
+    {
+        nodes = atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        channels[0].link_rate = atof(argv[3]);
+    }
+    if (argc > 4)
+    {
+        channels[1].link_rate = atof(argv[4]);
+    }
+
+    printf("%u nodes of %u bytes, links of %.0f and %.0f B/s\n", nodes, file_size, channels[0].link_rate, channels[1].link_rate);
+    bool failed = false;
+    const char* names[] = {"fast only", "striped, shared", "striped, per-channel"};
+    StripeMode modes[] = {StripeMode::Single, StripeMode::Shared, StripeMode::PerChannel};
+    for (uint16_t m=0; m<3; ++m)
+    {
+        stripe_result result = run(file_size, nodes, modes[m]);
+        printf("%-20s %6.2f s %8.0f B/s goodput, packets %5u / %5u, node finish", names[m], result.seconds, nodes * file_size / result.seconds, result.packets[0], result.packets[1]);
+        for (double seconds : result.node_seconds)
+        {
+            printf(" %.2f", seconds);
+        }
+        printf("%s\n", result.complete ? "" : " INCOMPLETE");
+        failed |= !result.complete;
+    }
+    if (failed)
+    {
+        exit(1);
+    }
+}
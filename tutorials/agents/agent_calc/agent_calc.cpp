@@ -116,7 +116,7 @@ int main(int argc, char *argv[])
 	{
         if (agent->cinfo->meta.jmap[i].size())
 		{
-            cout<<"jmap["<<i<<"]:"<<agent->cinfo->meta.jmap[i][0].name<<endl;
+            cout<<"jmap["<<i<<"]:"<<json_name_of(json_entry_at(agent->cinfo->meta.jmap[i][0], agent->cinfo->meta), agent->cinfo->meta)<<endl;
 		}
 	}
     cout<<agent->cinfo->pdata.node.name<<endl;